@@ -24,6 +24,7 @@
 #include <common.h>
 #include <asm/io.h>
 #include <asm/arch/clock.h>
+#include <asm/arch/cpu.h>
 #include <asm/arch/dram.h>
 #include <asm/arch/timer.h>
 #include <asm/arch/sys_proto.h>
@@ -436,6 +437,104 @@ fail:
 	return dramc_scan_readpipe();
 }
 
+#ifdef CONFIG_SUNXI_DRAM_TRAIN_CACHE
+/* Verify 16 bursts of 64 bytes, spread over the first MiB */
+#define DRAM_VERIFY_SPOTS	16
+#define DRAM_VERIFY_WORDS	16
+#define DRAM_VERIFY_STRIDE	(64 << 10)
+
+/*
+ * Must be initialised so that it is placed in .data, i.e. in the part of
+ * the SPL image which the boot ROM loads into SRAM.
+ */
+struct sunxi_dram_train sunxi_dram_train __aligned(SUNXI_DRAM_TRAIN_ALIGN) = {
+	.magic = SUNXI_DRAM_TRAIN_MAGIC,
+};
+
+/*
+ * Results are only reused for the same DRAM parameters on the same chip,
+ * so that an SD card moved to another board is retrained.
+ */
+static u32 dramc_fingerprint(struct dram_para *para)
+{
+	const u32 *p = (const u32 *)para;
+	u32 hash = readl(SUNXI_SID_BASE);
+	int i;
+
+	for (i = 0; i < sizeof(*para) / sizeof(u32); i++)
+		hash = (hash ^ p[i]) * 16777619;	/* FNV prime */
+
+	return hash;
+}
+
+static int dramc_train_cached(u32 fingerprint)
+{
+	struct sunxi_dram_train *train = &sunxi_dram_train;
+
+	return (train->flags & SUNXI_DRAM_TRAIN_VALID) &&
+		train->fingerprint == fingerprint;
+}
+
+static void dramc_train_restore(void)
+{
+	struct sunxi_dram_reg *dram = (struct sunxi_dram_reg *)SUNXI_DRAMC_BASE;
+	struct sunxi_dram_train *train = &sunxi_dram_train;
+
+	writel(train->rslr[0], &dram->rslr0);
+	writel(train->rslr[1], &dram->rslr1);
+	writel(train->rdgr[0], &dram->rdgr0);
+	writel(train->rdgr[1], &dram->rdgr1);
+}
+
+static void dramc_train_save(u32 fingerprint, u32 tpr3)
+{
+	struct sunxi_dram_reg *dram = (struct sunxi_dram_reg *)SUNXI_DRAMC_BASE;
+	struct sunxi_dram_train *train = &sunxi_dram_train;
+
+	train->fingerprint = fingerprint;
+	train->tpr3 = tpr3;
+	train->rslr[0] = readl(&dram->rslr0);
+	train->rslr[1] = readl(&dram->rslr1);
+	train->rdgr[0] = readl(&dram->rdgr0);
+	train->rdgr[1] = readl(&dram->rdgr1);
+	train->flags = SUNXI_DRAM_TRAIN_VALID | SUNXI_DRAM_TRAIN_UPDATED;
+}
+
+/*
+ * Quick check that restored training results are still good. Wrong DQS
+ * gating shows up as corrupted reads, so write alternating patterns
+ * covering every data line and read them back.
+ */
+static int dramc_verify(void)
+{
+	u32 i, j, addr, val;
+
+	for (i = 0; i < DRAM_VERIFY_SPOTS; i++) {
+		for (j = 0; j < DRAM_VERIFY_WORDS; j++) {
+			addr = PHYS_SDRAM_0 + i * DRAM_VERIFY_STRIDE + j * 4;
+			val = (j & 1) ? ~addr : addr ^ 0x5aa5a55a;
+			writel(val, addr);
+		}
+	}
+	for (i = 0; i < DRAM_VERIFY_SPOTS; i++) {
+		for (j = 0; j < DRAM_VERIFY_WORDS; j++) {
+			addr = PHYS_SDRAM_0 + i * DRAM_VERIFY_STRIDE + j * 4;
+			val = (j & 1) ? ~addr : addr ^ 0x5aa5a55a;
+			if (readl(addr) != val)
+				return -1;
+		}
+	}
+
+	return 0;
+}
+#else
+static inline u32 dramc_fingerprint(struct dram_para *para) { return 0; }
+static inline int dramc_train_cached(u32 fingerprint) { return 0; }
+static inline void dramc_train_restore(void) {}
+static inline void dramc_train_save(u32 fingerprint, u32 tpr3) {}
+static inline int dramc_verify(void) { return -1; }
+#endif
+
 static void dramc_clock_output_en(u32 on)
 {
 #if defined(CONFIG_SUN5I) || defined(CONFIG_SUN7I)
@@ -479,12 +578,24 @@ unsigned long dramc_init(struct dram_para *para)
 	struct sunxi_dram_reg *dram = (struct sunxi_dram_reg *)SUNXI_DRAMC_BASE;
 	u32 reg_val;
 	u32 density;
+	u32 fingerprint;
+	int scan_dll, cached;
 	int ret_val;
+#ifdef CONFIG_SUNXI_DRAM_TRAIN_CACHE
+	ulong start = timer_get_us();
+#endif
 
 	/* check input dram parameter structure */
 	if (!para)
 		return 0;
 
+	/* use the DLL phases and read pipe settings from an earlier boot */
+	scan_dll = para->tpr3 & (0x1 << 31);
+	fingerprint = dramc_fingerprint(para);
+	cached = dramc_train_cached(fingerprint);
+	if (cached && scan_dll)
+		para->tpr3 = sunxi_dram_train.tpr3;
+
 	/* setup DRAM relative clock */
 	mctl_setup_dram_clock(para->clock);
 
@@ -667,9 +778,21 @@ unsigned long dramc_init(struct dram_para *para)
 	}
 #endif
 
-	/* scan read pipe value */
+	/*
+	 * scan read pipe value, unless the cached one still works. DRAM can
+	 * only be checked once the host ports are set up.
+	 */
+	if (cached)
+		dramc_train_restore();
 	mctl_itm_enable();
-	if (para->tpr3 & (0x1 << 31)) {
+	if (cached) {
+		mctl_configure_hostport();
+		if (dramc_verify())
+			cached = 0;
+	}
+	if (cached) {
+		ret_val = 0;
+	} else if (scan_dll) {
 		ret_val = dramc_scan_dll_para();
 		if (ret_val == 0)
 			para->tpr3 =
@@ -686,6 +809,14 @@ unsigned long dramc_init(struct dram_para *para)
 	if (ret_val < 0)
 		return 0;
 
+	if (!cached)
+		dramc_train_save(fingerprint, para->tpr3);
+#ifdef CONFIG_SUNXI_DRAM_TRAIN_CACHE
+	else
+		sunxi_dram_train.flags |= SUNXI_DRAM_TRAIN_CACHED;
+	sunxi_dram_train.time_us = timer_get_us() - start;
+#endif
+
 	/* configure all host port */
 	mctl_configure_hostport();
 
@@ -0,0 +1,156 @@
+/*
+ * Store DRAM training results found by the SPL
+ *
+ * The SPL keeps its training results in a struct sunxi_dram_train in its
+ * .data section. After retraining it marks the record as updated, and the
+ * record is still sitting in SRAM when U-Boot proper runs. Here we copy it
+ * into the SPL image on MMC, so the next boot gets it loaded into SRAM by
+ * the boot ROM.
+ *
+ * A board that loses power while the SPL is rewritten may not boot again,
+ * so the image is only written when the results have changed, and then
+ * only the sector holding the record. The record's balance word keeps the
+ * boot ROM checksum valid without rewriting the header.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <malloc.h>
+#include <mmc.h>
+#include <asm/arch/cpu.h>
+#include <asm/arch/dram.h>
+
+#define SPL_MMC_SECTOR		16		/* boot ROM loads SPL from 8KiB */
+#define SPL_LOAD_MAX_SIZE	0x7600		/* as tools/mksunxiboot.c */
+#define SPL_START		0x20		/* after the eGON header */
+
+#define BOOT0_MAGIC		"eGON.BT0"
+
+/* boot head definition from sun4i boot code, see tools/mksunxiboot.c */
+struct boot_file_head {
+	uint32_t b_instruction;
+	uint8_t magic[8];
+	uint32_t check_sum;
+	uint32_t length;
+	uint8_t pad[12];
+};
+
+static struct sunxi_dram_train *find_train(void *base, ulong size)
+{
+	ulong offset;
+
+	for (offset = SPL_START; offset + sizeof(struct sunxi_dram_train) <=
+	     size; offset += 4) {
+		if (!memcmp(base + offset, SUNXI_DRAM_TRAIN_MAGIC,
+			    sizeof(SUNXI_DRAM_TRAIN_MAGIC) - 1))
+			return base + offset;
+	}
+
+	return NULL;
+}
+
+static uint32_t train_sum(const struct sunxi_dram_train *train)
+{
+	const uint32_t *buf = (const uint32_t *)train;
+	uint32_t sum = 0;
+	int i;
+
+	for (i = 0; i < sizeof(*train) / 4; i++)
+		sum += buf[i];
+
+	return sum;
+}
+
+/* Check whether the stored record already holds these results */
+static int train_same(const struct sunxi_dram_train *stored,
+		      const struct sunxi_dram_train *train)
+{
+	return (stored->flags & SUNXI_DRAM_TRAIN_VALID) &&
+		stored->fingerprint == train->fingerprint &&
+		stored->tpr3 == train->tpr3 &&
+		!memcmp(stored->rslr, train->rslr, sizeof(train->rslr)) &&
+		!memcmp(stored->rdgr, train->rdgr, sizeof(train->rdgr));
+}
+
+int sunxi_dram_train_store(void)
+{
+	struct sunxi_dram_train *train, *stored;
+	struct boot_file_head *head;
+	struct mmc *mmc;
+	ulong offset, blks, blk;
+	uint32_t sum;
+	void *buf;
+	int ret = 0;
+
+	/* The record was loaded into SRAM A1 along with the SPL */
+	train = find_train((void *)SUNXI_SRAM_A1_BASE, SPL_LOAD_MAX_SIZE);
+	if (!train || !(train->flags & SUNXI_DRAM_TRAIN_UPDATED))
+		return 0;
+	offset = (ulong)train - SUNXI_SRAM_A1_BASE;
+
+	mmc = find_mmc_device(0);
+	if (!mmc)
+		return -ENODEV;
+	if (mmc_init(mmc))
+		return -EIO;
+
+	buf = memalign(ARCH_DMA_MINALIGN, SPL_LOAD_MAX_SIZE);
+	if (!buf)
+		return -ENOMEM;
+	head = buf;
+	blks = SPL_LOAD_MAX_SIZE / mmc->read_bl_len;
+	if (mmc->block_dev.block_read(0, SPL_MMC_SECTOR, blks, buf) != blks) {
+		ret = -EIO;
+		goto out;
+	}
+
+	/*
+	 * Only touch the image if it is the one we booted from, i.e. it has
+	 * the record at the same place. This is not the case when booted
+	 * through FEL, for example.
+	 */
+	stored = buf + offset;
+	if (memcmp(head->magic, BOOT0_MAGIC, sizeof(head->magic)) ||
+	    head->length > SPL_LOAD_MAX_SIZE || head->length % 512 ||
+	    offset + sizeof(*stored) > head->length ||
+	    memcmp(stored->magic, SUNXI_DRAM_TRAIN_MAGIC,
+		   sizeof(stored->magic))) {
+		ret = -ENOENT;
+		goto out;
+	}
+
+	/* Retraining often finds the same results; then there is no write */
+	if (train_same(stored, train)) {
+		train->flags &= ~SUNXI_DRAM_TRAIN_UPDATED;
+		goto out;
+	}
+
+	/* The record must not straddle sectors, or the write is not atomic */
+	blk = offset / mmc->write_bl_len;
+	if (offset % mmc->write_bl_len + sizeof(*stored) > mmc->write_bl_len) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	sum = train_sum(stored);
+	memcpy(stored, train, sizeof(*stored));
+	stored->flags = SUNXI_DRAM_TRAIN_VALID;
+	stored->time_us = 0;
+	stored->balance = 0;
+	stored->balance = sum - train_sum(stored);
+
+	if (mmc->block_dev.block_write(0, SPL_MMC_SECTOR + blk, 1,
+				       buf + blk * mmc->write_bl_len) != 1) {
+		ret = -EIO;
+		goto out;
+	}
+	train->flags &= ~SUNXI_DRAM_TRAIN_UPDATED;
+	printf("DRAM: Stored training results\n");
+
+out:
+	free(buf);
+
+	return ret;
+}
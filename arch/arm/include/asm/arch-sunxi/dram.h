@@ -173,7 +173,36 @@ struct dram_para {
 
 #define DRAM_CSEL_MAGIC 0x16237495
 
+/*
+ * Cached DRAM training results (CONFIG_SUNXI_DRAM_TRAIN_CACHE). The record
+ * lives in the .data section of the SPL, so the boot ROM loads it into SRAM
+ * along with the SPL itself. U-Boot proper writes updated results back into
+ * the SPL image on MMC. The record is aligned so that it sits in a single
+ * sector, and 'balance' keeps the sum of its words, and so the checksum of
+ * the SPL image, the same. Storing it then only rewrites that one sector.
+ */
+#define SUNXI_DRAM_TRAIN_ALIGN		64
+#define SUNXI_DRAM_TRAIN_MAGIC		"sxdramtc"
+
+#define SUNXI_DRAM_TRAIN_VALID		(1 << 0)	/* results are usable */
+#define SUNXI_DRAM_TRAIN_CACHED		(1 << 1)	/* used on this boot */
+#define SUNXI_DRAM_TRAIN_UPDATED	(1 << 2)	/* retrained, not stored */
+
+struct sunxi_dram_train {
+	char magic[8];		/* SUNXI_DRAM_TRAIN_MAGIC, not C-style str */
+	u32 fingerprint;	/* hash of chip ID and struct dram_para */
+	u32 flags;		/* SUNXI_DRAM_TRAIN_... */
+	u32 tpr3;		/* DLL phases found by dramc_scan_dll_para() */
+	u32 rslr[2];		/* rank system latency from data training */
+	u32 rdgr[2];		/* rank DQS gating from data training */
+	u32 time_us;		/* time taken by dramc_init() on this boot */
+	u32 balance;		/* keeps the eGON checksum of the SPL */
+};
+
+extern struct sunxi_dram_train sunxi_dram_train;
+
 unsigned long sunxi_dram_init(void);
 unsigned long dramc_init(struct dram_para *para);
+int sunxi_dram_train_store(void);
 
 #endif /* _SUNXI_DRAM_H */
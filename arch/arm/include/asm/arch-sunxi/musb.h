@@ -0,0 +1,12 @@
+/*
+ * Allwinner sunxi MUSB OTG controller
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef _SUNXI_MUSB_H
+#define _SUNXI_MUSB_H
+
+extern const struct musb_platform_ops sunxi_musb_ops;
+
+#endif /* _SUNXI_MUSB_H */
@@ -76,6 +76,7 @@ static void announce_and_cleanup(int fake)
 #ifdef CONFIG_BOOTSTAGE_REPORT
 	bootstage_report();
 #endif
+	console_flush();
 
 #ifdef CONFIG_USB_DEVICE
 	udc_disconnect();
@@ -26,6 +26,7 @@
 int do_reset(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	puts ("resetting ...\n");
+	console_flush();
 
 	udelay (50000);				/* wait 50 ms */
 
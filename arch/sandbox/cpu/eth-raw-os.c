@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/if_tun.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <asm/eth-raw-os.h>
+
+static int set_nonblock(int fd)
+{
+	int flags = fcntl(fd, F_GETFL, 0);
+
+	if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+		return -errno;
+
+	return 0;
+}
+
+static int eth_raw_tap_start(const char *ifname,
+			     struct eth_sandbox_raw_priv *priv)
+{
+	struct ifreq ifr;
+	int fd, ret;
+
+	fd = open("/dev/net/tun", O_RDWR);
+	if (fd == -1) {
+		printf("Failed to open /dev/net/tun: %s\n", strerror(errno));
+		return -errno;
+	}
+
+	memset(&ifr, 0, sizeof(ifr));
+	ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+	strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+	if (ioctl(fd, TUNSETIFF, &ifr) == -1) {
+		ret = -errno;
+		printf("Failed to attach to tap '%s': %s\n", ifname,
+		       strerror(errno));
+		close(fd);
+		return ret;
+	}
+	priv->fd = fd;
+
+	return 0;
+}
+
+static int eth_raw_packet_start(const char *ifname,
+				struct eth_sandbox_raw_priv *priv)
+{
+	struct sockaddr_ll addr;
+	struct packet_mreq mr;
+	int ifindex;
+	int fd, ret;
+
+	ifindex = if_nametoindex(ifname);
+	if (!ifindex) {
+		printf("Unknown host interface '%s'\n", ifname);
+		return -ENODEV;
+	}
+
+	fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if (fd == -1) {
+		printf("Failed to open raw socket: %s\n", strerror(errno));
+		return -errno;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sll_family = AF_PACKET;
+	addr.sll_ifindex = ifindex;
+	addr.sll_protocol = htons(ETH_P_ALL);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+		goto err;
+
+	/* Our MAC address is not the host's, so take everything */
+	memset(&mr, 0, sizeof(mr));
+	mr.mr_ifindex = ifindex;
+	mr.mr_type = PACKET_MR_PROMISC;
+	if (setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mr,
+		       sizeof(mr)) == -1)
+		goto err;
+	priv->fd = fd;
+
+	return 0;
+
+err:
+	ret = -errno;
+	printf("Failed to bind to '%s': %s\n", ifname, strerror(errno));
+	close(fd);
+	return ret;
+}
+
+static int eth_raw_udp_start(const char *spec,
+			     struct eth_sandbox_raw_priv *priv)
+{
+	struct sockaddr_in addr;
+	char ip[16];
+	unsigned int lport, rport;
+	int fd, ret;
+
+	if (sscanf(spec, "%u:%15[0-9.]:%u", &lport, ip, &rport) != 3 ||
+	    !inet_aton(ip, (struct in_addr *)&priv->peer_ip)) {
+		printf("Invalid UDP spec '%s'\n", spec);
+		return -EINVAL;
+	}
+	priv->peer_port = htons(rport);
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd == -1) {
+		printf("Failed to open UDP socket: %s\n", strerror(errno));
+		return -errno;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(lport);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		ret = -errno;
+		printf("Failed to bind UDP port %u: %s\n", lport,
+		       strerror(errno));
+		close(fd);
+		return ret;
+	}
+	priv->fd = fd;
+
+	return 0;
+}
+
+int sandbox_eth_raw_os_start(const char *spec,
+			     struct eth_sandbox_raw_priv *priv)
+{
+	int ret;
+
+	priv->fd = -1;
+	if (!strncmp(spec, "tap:", 4)) {
+		priv->type = SANDBOX_ETH_RAW_TAP;
+		ret = eth_raw_tap_start(spec + 4, priv);
+	} else if (!strncmp(spec, "raw:", 4)) {
+		priv->type = SANDBOX_ETH_RAW_PACKET;
+		ret = eth_raw_packet_start(spec + 4, priv);
+	} else if (!strncmp(spec, "udp:", 4)) {
+		priv->type = SANDBOX_ETH_RAW_UDP;
+		ret = eth_raw_udp_start(spec + 4, priv);
+	} else {
+		printf("Unknown ethernet back-end '%s'\n", spec);
+		return -EINVAL;
+	}
+	if (ret)
+		return ret;
+
+	ret = set_nonblock(priv->fd);
+	if (ret) {
+		sandbox_eth_raw_os_stop(priv);
+		return ret;
+	}
+
+	return 0;
+}
+
+int sandbox_eth_raw_os_send(const void *packet, int length,
+			    const struct eth_sandbox_raw_priv *priv)
+{
+	struct sockaddr_in addr;
+	ssize_t ret;
+
+	if (priv->fd == -1)
+		return -ENODEV;
+
+	if (priv->type == SANDBOX_ETH_RAW_UDP) {
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = priv->peer_ip;
+		addr.sin_port = priv->peer_port;
+		ret = sendto(priv->fd, packet, length, 0,
+			     (struct sockaddr *)&addr, sizeof(addr));
+	} else {
+		ret = write(priv->fd, packet, length);
+	}
+	if (ret == -1)
+		return -errno;
+
+	return ret;
+}
+
+int sandbox_eth_raw_os_recv(void *packet, int *length,
+			    const struct eth_sandbox_raw_priv *priv)
+{
+	struct sockaddr_ll from;
+	socklen_t fromlen = sizeof(from);
+	ssize_t ret;
+
+	if (priv->fd == -1)
+		return -ENODEV;
+
+	do {
+		if (priv->type == SANDBOX_ETH_RAW_PACKET)
+			ret = recvfrom(priv->fd, packet, *length, 0,
+				       (struct sockaddr *)&from, &fromlen);
+		else
+			ret = read(priv->fd, packet, *length);
+		if (ret == -1)
+			return errno == EWOULDBLOCK ? -EAGAIN : -errno;
+
+		/* A packet socket also sees what we sent */
+	} while (priv->type == SANDBOX_ETH_RAW_PACKET &&
+		 from.sll_pkttype == PACKET_OUTGOING);
+	*length = ret;
+
+	return 0;
+}
+
+void sandbox_eth_raw_os_stop(struct eth_sandbox_raw_priv *priv)
+{
+	if (priv->fd != -1)
+		close(priv->fd);
+	priv->fd = -1;
+}
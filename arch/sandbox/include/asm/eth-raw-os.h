@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __SANDBOX_ETH_RAW_OS_H
+#define __SANDBOX_ETH_RAW_OS_H
+
+/* How frames get to and from the host */
+enum sandbox_eth_raw_type {
+	SANDBOX_ETH_RAW_TAP,	/* tap:<ifname> - a host tap device */
+	SANDBOX_ETH_RAW_PACKET,	/* raw:<ifname> - AF_PACKET on a host NIC */
+	SANDBOX_ETH_RAW_UDP,	/* udp:<port>:<ip>:<port> - one frame/datagram */
+};
+
+/**
+ * struct eth_sandbox_raw_priv - host side of the sandbox ethernet device
+ *
+ * @type:	Back-end in use
+ * @fd:		Host file descriptor for the tap device or socket
+ * @peer_ip:	IPv4 address of the UDP peer, in network order
+ * @peer_port:	UDP port of the peer, in network order
+ */
+struct eth_sandbox_raw_priv {
+	enum sandbox_eth_raw_type type;
+	int fd;
+	unsigned int peer_ip;
+	unsigned short peer_port;
+};
+
+/**
+ * sandbox_eth_raw_os_start() - Open the host end of the device
+ *
+ * @spec:	Back-end to use, e.g. "tap:tap0", "raw:eth0" or
+ *		"udp:9000:127.0.0.1:9001"
+ * @priv:	Returns the host state
+ * @return 0 if OK, -ve on error
+ */
+int sandbox_eth_raw_os_start(const char *spec,
+			     struct eth_sandbox_raw_priv *priv);
+
+/**
+ * sandbox_eth_raw_os_send() - Send one frame to the host
+ *
+ * @packet:	Frame, starting with the ethernet header
+ * @length:	Length of frame in bytes
+ * @priv:	Host state
+ * @return number of bytes sent, -ve on error
+ */
+int sandbox_eth_raw_os_send(const void *packet, int length,
+			    const struct eth_sandbox_raw_priv *priv);
+
+/**
+ * sandbox_eth_raw_os_recv() - Receive one frame from the host, if any
+ *
+ * This does not block.
+ *
+ * @packet:	Buffer for the frame
+ * @length:	Size of the buffer on entry; length of the frame on exit
+ * @priv:	Host state
+ * @return 0 if a frame was received, -EAGAIN if none is waiting, other
+ *	-ve value on error
+ */
+int sandbox_eth_raw_os_recv(void *packet, int *length,
+			    const struct eth_sandbox_raw_priv *priv);
+
+/**
+ * sandbox_eth_raw_os_stop() - Close the host end of the device
+ *
+ * @priv:	Host state
+ */
+void sandbox_eth_raw_os_stop(struct eth_sandbox_raw_priv *priv);
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __SANDBOX_ETH_H
+#define __SANDBOX_ETH_H
+
+/**
+ * struct sandbox_eth_stats - traffic through the sandbox ethernet device
+ *
+ * Times are in microseconds. A reply is the first frame received after one
+ * or more frames were sent, and its latency is counted from the earliest of
+ * those sends.
+ *
+ * @tx_frames:		Frames sent
+ * @tx_bytes:		Bytes sent
+ * @rx_frames:		Frames received
+ * @rx_bytes:		Bytes received
+ * @first_us:		Time of the first frame in either direction
+ * @last_us:		Time of the last frame in either direction
+ * @replies:		Number of replies
+ * @latency_us:		Total latency of all replies
+ * @latency_min_us:	Shortest latency
+ * @latency_max_us:	Longest latency
+ */
+struct sandbox_eth_stats {
+	unsigned long tx_frames;
+	unsigned long tx_bytes;
+	unsigned long rx_frames;
+	unsigned long rx_bytes;
+	uint64_t first_us;
+	uint64_t last_us;
+	unsigned long replies;
+	uint64_t latency_us;
+	uint64_t latency_min_us;
+	uint64_t latency_max_us;
+};
+
+/**
+ * sandbox_eth_get_stats() - Get the traffic seen since the last reset
+ *
+ * @stats:	Returns the statistics
+ */
+void sandbox_eth_get_stats(struct sandbox_eth_stats *stats);
+
+/**
+ * sandbox_eth_reset_stats() - Zero the traffic statistics
+ */
+void sandbox_eth_reset_stats(void);
+
+#endif
@@ -67,6 +67,11 @@ struct sandbox_state {
 	bool ignore_missing_state_on_read;	/* No error if state missing */
 	bool show_lcd;			/* Show LCD on start-up */
 	enum state_terminal_raw term_raw;	/* Terminal raw/cooked */
+	const char *eth_spec;		/* Host back-end for ethernet */
+	ulong mem_fault_addr;		/* Address of a faulty RAM word */
+	ulong mem_fault_bit;		/* Mask of its bit stuck at 0 */
+	/* Files to bind to host block devices on first use */
+	const char *host_fname[CONFIG_HOST_MAX_DEVICES];
 
 	/* Pointer to information for each SPI bus/cs */
 	struct sandbox_spi_info spi[CONFIG_SANDBOX_SPI_MAX_BUS]
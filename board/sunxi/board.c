@@ -28,6 +28,13 @@
 #include <asm/arch/mmc.h>
 #include <asm/io.h>
 #include <net.h>
+#ifdef CONFIG_USB_MUSB_SUNXI
+#include <usb.h>
+#include <linux/usb/ch9.h>
+#include <linux/usb/gadget.h>
+#include <linux/usb/musb.h>
+#include <asm/arch/musb.h>
+#endif
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -179,7 +186,13 @@ void sunxi_board_init(void)
 #if !defined(CONFIG_SUN6I) && !defined(CONFIG_SUN8I)
 	printf("DRAM:");
 	ramsize = sunxi_dram_init();
+#ifdef CONFIG_SUNXI_DRAM_TRAIN_CACHE
+	printf(" %lu MiB (%s in %u us)\n", ramsize >> 20,
+	       sunxi_dram_train.flags & SUNXI_DRAM_TRAIN_CACHED ?
+	       "cached" : "trained", sunxi_dram_train.time_us);
+#else
 	printf(" %lu MiB\n", ramsize >> 20);
+#endif
 	if (!ramsize)
 		hang();
 
@@ -213,9 +226,53 @@ void spl_display_print(void)
 }
 #endif
 
+#ifdef CONFIG_USB_MUSB_SUNXI
+/*
+ * 8KiB of FIFO RAM: double buffered high-speed bulk endpoints, so the
+ * core can take the next packet while the CPU empties the last one.
+ */
+static struct musb_fifo_cfg musb_fifo_cfg[] = {
+	MUSB_EP_FIFO_DOUBLE(1, FIFO_TX, 512),
+	MUSB_EP_FIFO_DOUBLE(1, FIFO_RX, 512),
+	MUSB_EP_FIFO_DOUBLE(2, FIFO_TX, 512),
+	MUSB_EP_FIFO_DOUBLE(2, FIFO_RX, 512),
+	MUSB_EP_FIFO_SINGLE(3, FIFO_TX, 512),
+	MUSB_EP_FIFO_SINGLE(3, FIFO_RX, 512),
+	MUSB_EP_FIFO_SINGLE(4, FIFO_TX, 512),
+	MUSB_EP_FIFO_SINGLE(4, FIFO_RX, 512),
+	MUSB_EP_FIFO_SINGLE(5, FIFO_TX, 512),
+	MUSB_EP_FIFO_SINGLE(5, FIFO_RX, 512),
+};
+
+static struct musb_hdrc_config musb_config = {
+	.fifo_cfg	= musb_fifo_cfg,
+	.fifo_cfg_size	= ARRAY_SIZE(musb_fifo_cfg),
+	.multipoint	= 1,
+	.dyn_fifo	= 1,
+	.num_eps	= 6,
+	.ram_bits	= 11,
+};
+
+static struct musb_hdrc_platform_data musb_plat = {
+	.mode		= MUSB_PERIPHERAL,
+	.config		= &musb_config,
+	.power		= 250,
+	.platform_ops	= &sunxi_musb_ops,
+};
+
+/* VBUS is not sensed: the glue forces it valid */
+int usb_cable_connected(void)
+{
+	return 1;
+}
+#endif
+
 #ifdef CONFIG_MISC_INIT_R
 int misc_init_r(void)
 {
+#ifdef CONFIG_USB_MUSB_SUNXI
+	musb_register(&musb_plat, NULL, (void *)SUNXI_USB0_BASE);
+#endif
 	if (!getenv("ethaddr")) {
 		uint32_t reg_val = readl(SUNXI_SID_BASE);
 
@@ -261,6 +318,10 @@ int misc_init_r(void)
    		}
 	}
 #endif
+#ifdef CONFIG_SUNXI_DRAM_TRAIN_CACHE
+	if (sunxi_dram_train_store())
+		printf("DRAM: Could not store training results\n");
+#endif
 
 	return 0;
 }
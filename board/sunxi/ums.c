@@ -0,0 +1,55 @@
+/*
+ * USB mass storage access to a whole MMC device
+ *
+ * Based on board/samsung/common/ums.c
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <mmc.h>
+#include <usb_mass_storage.h>
+
+static int ums_read_sector(struct ums *ums_dev,
+			   ulong start, lbaint_t blkcnt, void *buf)
+{
+	block_dev_desc_t *block_dev = &ums_dev->mmc->block_dev;
+
+	return block_dev->block_read(block_dev->dev,
+				     start + ums_dev->start_sector, blkcnt,
+				     buf);
+}
+
+static int ums_write_sector(struct ums *ums_dev,
+			    ulong start, lbaint_t blkcnt, const void *buf)
+{
+	block_dev_desc_t *block_dev = &ums_dev->mmc->block_dev;
+
+	return block_dev->block_write(block_dev->dev,
+				      start + ums_dev->start_sector, blkcnt,
+				      buf);
+}
+
+static struct ums ums_dev = {
+	.read_sector = ums_read_sector,
+	.write_sector = ums_write_sector,
+	.name = "UMS disk",
+};
+
+struct ums *ums_init(unsigned int dev_num)
+{
+	struct mmc *mmc;
+
+	mmc = find_mmc_device(dev_num);
+	if (!mmc || mmc_init(mmc)) {
+		error("MMC device %u not found", dev_num);
+		return NULL;
+	}
+
+	ums_dev.mmc = mmc;
+	ums_dev.start_sector = 0;
+	ums_dev.num_sectors = mmc->block_dev.lba;
+	printf("UMS: MMC %u, %#x sectors\n", dev_num, ums_dev.num_sectors);
+
+	return &ums_dev;
+}
@@ -266,6 +266,20 @@ static int initr_malloc(void)
 	return 0;
 }
 
+#ifdef CONFIG_OF_INDEX
+static int initr_of_index(void)
+{
+	int ret;
+
+	/* Lookups fall back to searching the device tree if this fails */
+	ret = fdtdec_index_build(gd->fdt_blob);
+	if (ret)
+		debug("fdtdec_index_build() failed: %d\n", ret);
+
+	return 0;
+}
+#endif
+
 #ifdef CONFIG_DM
 static int initr_dm(void)
 {
@@ -288,6 +302,11 @@ static int initr_dm(void)
 		return ret;
 	}
 #endif
+#ifdef CONFIG_DM_BACKGROUND_PROBE
+	ret = dm_probe_background();
+	if (ret)
+		debug("dm_probe_background() failed: %d\n", ret);
+#endif
 
 	return 0;
 }
@@ -791,6 +810,9 @@ init_fnc_t init_sequence_r[] = {
 	initr_barrier,
 	initr_malloc,
 	bootstage_relocate,
+#ifdef CONFIG_OF_INDEX
+	initr_of_index,
+#endif
 #ifdef CONFIG_DM
 	initr_dm,
 #endif
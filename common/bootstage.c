@@ -25,6 +25,7 @@ struct bootstage_record {
 	const char *name;
 	int flags;		/* see enum bootstage_flags */
 	enum bootstage_id id;
+	ulong addr;		/* Initcall address (BOOTSTAGEF_INITCALL) */
 };
 
 static struct bootstage_record record[BOOTSTAGE_ID_COUNT] = { {1} };
@@ -34,6 +35,7 @@ enum {
 	BOOTSTAGE_VERSION	= 0,
 	BOOTSTAGE_MAGIC		= 0xb00757a3,
 	BOOTSTAGE_DIGITS	= 9,
+	BOOTSTAGE_NAME_LEN	= 32,
 };
 
 struct bootstage_hdr {
@@ -131,6 +133,25 @@ ulong bootstage_mark_code(const char *file, const char *func, int linenum)
 	return bootstage_mark_name(BOOTSTAGE_ID_ALLOC, str);
 }
 
+ulong bootstage_initcall(ulong addr, ulong start_us)
+{
+	struct bootstage_record *rec;
+	ulong now = timer_get_boot_us();
+	int id = next_id++;
+
+	if (id < BOOTSTAGE_ID_COUNT) {
+		rec = &record[id];
+		rec->start_us = start_us;
+		rec->time_us = now - start_us;
+		rec->name = NULL;
+		rec->flags = BOOTSTAGEF_INITCALL;
+		rec->id = id;
+		rec->addr = addr;
+	}
+
+	return now;
+}
+
 uint32_t bootstage_start(enum bootstage_id id, const char *name)
 {
 	struct bootstage_record *rec = &record[id];
@@ -150,6 +171,20 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+/**
+ * Check whether a record holds any information
+ *
+ * Initcall records are always valid, since a fast initcall may take less
+ * time than the timer resolution.
+ *
+ * @param rec	Boot stage record to check
+ * @return true if the record is in use
+ */
+static bool record_used(struct bootstage_record *rec)
+{
+	return rec->time_us != 0 || (rec->flags & BOOTSTAGEF_INITCALL);
+}
+
 /**
  * Get a record name as a printable string
  *
@@ -163,7 +198,17 @@ static const char *get_record_name(char *buf, int len,
 {
 	if (rec->name)
 		return rec->name;
-	else if (rec->id >= BOOTSTAGE_ID_USER)
+	if (rec->flags & BOOTSTAGEF_INITCALL) {
+#ifdef CONFIG_KALLSYMS
+		const char *sym;
+		ulong caddr;
+
+		sym = symbol_lookup(rec->addr, &caddr);
+		if (sym && caddr == rec->addr)
+			return sym;
+#endif
+		snprintf(buf, len, "initcall %#lx", rec->addr);
+	} else if (rec->id >= BOOTSTAGE_ID_USER)
 		snprintf(buf, len, "user_%d", rec->id - BOOTSTAGE_ID_USER);
 	else
 		snprintf(buf, len, "id=%d", rec->id);
@@ -174,7 +219,7 @@ static const char *get_record_name(char *buf, int len,
 static uint32_t print_time_record(enum bootstage_id id,
 			struct bootstage_record *rec, uint32_t prev)
 {
-	char buf[20];
+	char buf[BOOTSTAGE_NAME_LEN];
 
 	if (prev == -1U) {
 		printf("%11s", "");
@@ -195,6 +240,19 @@ static int h_compare_record(const void *r1, const void *r2)
 	return rec1->time_us > rec2->time_us ? 1 : -1;
 }
 
+/* Sort initcall records first, slowest at the top */
+static int h_compare_initcall(const void *r1, const void *r2)
+{
+	const struct bootstage_record *rec1 = r1, *rec2 = r2;
+	int initcall1 = rec1->flags & BOOTSTAGEF_INITCALL;
+	int initcall2 = rec2->flags & BOOTSTAGEF_INITCALL;
+
+	if (initcall1 != initcall2)
+		return initcall1 ? -1 : 1;
+
+	return rec1->time_us < rec2->time_us ? 1 : -1;
+}
+
 #ifdef CONFIG_OF_LIBFDT
 /**
  * Add all bootstage timings to a device tree.
@@ -205,7 +263,7 @@ static int h_compare_record(const void *r1, const void *r2)
 static int add_bootstages_devicetree(struct fdt_header *blob)
 {
 	int bootstage;
-	char buf[20];
+	char buf[BOOTSTAGE_NAME_LEN];
 	int id;
 	int i;
 
@@ -228,7 +286,7 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 		struct bootstage_record *rec = &record[id];
 		int node;
 
-		if (id != BOOTSTAGE_ID_AWAKE && rec->time_us == 0)
+		if (id != BOOTSTAGE_ID_AWAKE && !record_used(rec))
 			continue;
 
 		node = fdt_add_subnode(blob, bootstage, simple_itoa(i));
@@ -240,6 +298,11 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 				get_record_name(buf, sizeof(buf), rec)))
 			return -1;
 
+		/* Initcalls record their start time and duration */
+		if ((rec->flags & BOOTSTAGEF_INITCALL) &&
+		    fdt_setprop_cell(blob, node, "start", rec->start_us))
+			return -1;
+
 		/* Check if this is a 'mark' or 'accum' record */
 		if (fdt_setprop_cell(blob, node,
 				rec->start_us ? "accum" : "mark",
@@ -262,6 +325,7 @@ int bootstage_fdt_add_report(void)
 void bootstage_report(void)
 {
 	struct bootstage_record *rec = record;
+	char buf[BOOTSTAGE_NAME_LEN];
 	int id;
 	uint32_t prev;
 
@@ -277,6 +341,8 @@ void bootstage_report(void)
 	qsort(record, ARRAY_SIZE(record), sizeof(*rec), h_compare_record);
 
 	for (id = 0; id < BOOTSTAGE_ID_COUNT; id++, rec++) {
+		if (rec->flags & BOOTSTAGEF_INITCALL)
+			continue;
 		if (rec->time_us != 0 && !rec->start_us)
 			prev = print_time_record(rec->id, rec, prev);
 	}
@@ -287,9 +353,25 @@ void bootstage_report(void)
 
 	puts("\nAccumulated time:\n");
 	for (id = 0, rec = record; id < BOOTSTAGE_ID_COUNT; id++, rec++) {
-		if (rec->start_us)
+		if (rec->start_us && !(rec->flags & BOOTSTAGEF_INITCALL))
 			prev = print_time_record(id, rec, -1);
 	}
+
+	/* Initcalls come last, slowest first */
+	qsort(record, ARRAY_SIZE(record), sizeof(*rec), h_compare_initcall);
+	rec = record;
+	if (!(rec->flags & BOOTSTAGEF_INITCALL))
+		return;
+
+	puts("\nInitcall time:\n");
+	printf("%11s%11s  %s\n", "Start", "Duration", "Initcall");
+	for (id = 0; id < BOOTSTAGE_ID_COUNT; id++, rec++) {
+		if (!(rec->flags & BOOTSTAGEF_INITCALL))
+			break;
+		print_grouped_ull(rec->start_us, BOOTSTAGE_DIGITS);
+		print_grouped_ull(rec->time_us, BOOTSTAGE_DIGITS);
+		printf("  %s\n", get_record_name(buf, sizeof(buf), rec));
+	}
 }
 
 ulong __timer_get_boot_us(void)
@@ -335,7 +417,7 @@ int bootstage_stash(void *base, int size)
 {
 	struct bootstage_hdr *hdr = (struct bootstage_hdr *)base;
 	struct bootstage_record *rec;
-	char buf[20];
+	char buf[BOOTSTAGE_NAME_LEN];
 	char *ptr = base, *end = ptr + size;
 	uint32_t count;
 	int id;
@@ -351,7 +433,7 @@ int bootstage_stash(void *base, int size)
 	/* Count the number of records, and write that value first */
 	for (rec = record, id = count = 0; id < BOOTSTAGE_ID_COUNT;
 			id++, rec++) {
-		if (rec->time_us != 0)
+		if (record_used(rec))
 			count++;
 	}
 	hdr->count = count;
@@ -361,13 +443,13 @@ int bootstage_stash(void *base, int size)
 
 	/* Write the records, silently stopping when we run out of space */
 	for (rec = record, id = 0; id < BOOTSTAGE_ID_COUNT; id++, rec++) {
-		if (rec->time_us != 0)
+		if (record_used(rec))
 			append_data(&ptr, end, rec, sizeof(*rec));
 	}
 
 	/* Write the name strings */
 	for (rec = record, id = 0; id < BOOTSTAGE_ID_COUNT; id++, rec++) {
-		if (rec->time_us != 0) {
+		if (record_used(rec)) {
 			const char *name;
 
 			name = get_record_name(buf, sizeof(buf), rec);
@@ -14,6 +14,7 @@
 #include <bmp_layout.h>
 #include <command.h>
 #include <asm/byteorder.h>
+#include <asm/io.h>
 #include <malloc.h>
 #include <splash.h>
 #include <video.h>
@@ -224,10 +225,26 @@ static int bmp_info(ulong addr)
 int bmp_display(ulong addr, int x, int y)
 {
 	int ret;
-	bmp_image_t *bmp = (bmp_image_t *)addr;
+	bmp_image_t *bmp = map_sysmem(addr, 0);
 	void *bmp_alloc_addr = NULL;
 	unsigned long len;
 
+#if defined(CONFIG_LCD) && defined(CONFIG_LCD_BMP_GZIP)
+	/*
+	 * Inflate straight to the framebuffer rather than to a copy. The
+	 * compressed size comes from the command that loaded the image.
+	 */
+	if (bmp->header.signature[0] == 0x1f &&
+	    bmp->header.signature[1] == (char)0x8b) {
+		len = getenv_ulong("filesize", 16, 0);
+		if (!len) {
+			printf("Error: filesize not set for gzipped bmp\n");
+			return 1;
+		}
+		return lcd_display_bitmap_gzip(addr, len, x, y);
+	}
+#endif
+
 	if (!((bmp->header.signature[0]=='B') &&
 	      (bmp->header.signature[1]=='M')))
 		bmp = gunzip_bmp(addr, &len, &bmp_alloc_addr);
@@ -238,7 +255,7 @@ int bmp_display(ulong addr, int x, int y)
 	}
 
 #if defined(CONFIG_LCD)
-	ret = lcd_display_bitmap((ulong)bmp, x, y);
+	ret = lcd_display_bitmap(map_to_sysmem(bmp), x, y);
 #elif defined(CONFIG_VIDEO)
 	ret = video_display_bitmap((unsigned long)bmp, x, y);
 #else
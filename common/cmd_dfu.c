@@ -11,6 +11,7 @@
 #include <common.h>
 #include <dfu.h>
 #include <g_dnl.h>
+#include <task.h>
 #include <usb.h>
 
 static int do_dfu(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
@@ -53,6 +54,8 @@ static int do_dfu(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 			goto exit;
 
 		usb_gadget_handle_interrupts();
+		/* let DFU write to the medium while waiting for data */
+		task_yield();
 	}
 exit:
 	g_dnl_unregister();
@@ -37,6 +37,7 @@
 #include <linux/stat.h>
 #include <malloc.h>
 #include <fs.h>
+#include <asm/io.h>
 
 #if defined(CONFIG_CMD_USB) && defined(CONFIG_USB_STORAGE)
 #include <usb.h>
@@ -63,6 +64,8 @@ int do_ext4_write(cmd_tbl_t *cmdtp, int flag, int argc,
 	unsigned long file_size;
 	disk_partition_t info;
 	block_dev_desc_t *dev_desc;
+	void *buf;
+	int ret;
 
 	if (argc < 6)
 		return cmd_usage(cmdtp);
@@ -92,7 +95,10 @@ int do_ext4_write(cmd_tbl_t *cmdtp, int flag, int argc,
 	}
 
 	/* start write */
-	if (ext4fs_write(filename, (unsigned char *)ram_address, file_size)) {
+	buf = map_sysmem(ram_address, file_size);
+	ret = ext4fs_write(filename, buf, file_size);
+	unmap_sysmem(buf);
+	if (ret) {
 		printf("** Error ext4fs_write() **\n");
 		goto fail;
 	}
@@ -113,6 +119,31 @@ U_BOOT_CMD(ext4write, 6, 1, do_ext4_write,
 
 #endif
 
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+static int do_ext4_cache(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char *const argv[])
+{
+	if (argc == 2 && !strcmp(argv[1], "drop")) {
+		ext4fs_cache_invalidate();
+		ext4fs_close();
+		return 0;
+	}
+	if (argc != 1)
+		return CMD_RET_USAGE;
+
+	ext4fs_cache_print();
+
+	return 0;
+}
+
+U_BOOT_CMD(ext4cache, 2, 1, do_ext4_cache,
+	"show the ext4 mount cache",
+	"\n"
+	"    - show the cached mount and how many reads it saved\n"
+	"ext4cache drop\n"
+	"    - forget the cached mount");
+#endif
+
 U_BOOT_CMD(ext4ls, 4, 1, do_ext4_ls,
 	   "list files in a directory (default /)",
 	   "<interface> <dev[:part]> [directory]\n"
@@ -0,0 +1,57 @@
+/*
+ * cmd_fastboot.c -- Android fastboot over USB
+ *
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <fastboot.h>
+#include <g_dnl.h>
+#include <usb.h>
+
+static int do_fastboot(cmd_tbl_t *cmdtp, int flag, int argc,
+		       char * const argv[])
+{
+	int controller_index;
+	char cmd[32];
+	int ret;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	puts("Android fastboot\n");
+
+	controller_index = simple_strtoul(argv[1], NULL, 0);
+	ret = board_usb_init(controller_index, USB_INIT_DEVICE);
+	if (ret) {
+		error("USB init failed: %d", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	g_dnl_register("fastboot");
+	ret = fastboot_handle();
+	g_dnl_unregister();
+
+	if (ret == FASTBOOT_BOOT) {
+		sprintf(cmd, "bootm %lx", (ulong)CONFIG_USB_FASTBOOT_BUF_ADDR);
+		return run_command(cmd, flag);
+	} else if (ret == -EINTR) {
+		puts("\nfastboot interrupted\n");
+		return CMD_RET_FAILURE;
+	} else if (ret) {
+		error("fastboot failed: %d", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(fastboot, 2, 1, do_fastboot,
+	   "Android fastboot protocol over USB",
+	   "<USB_controller>\n"
+	   "  - serve fastboot commands from a host over <USB_controller>,\n"
+	   "    until it sends 'continue' or 'boot' or Ctrl-C is pressed\n"
+);
@@ -49,3 +49,23 @@ U_BOOT_CMD(
 	"    - List files in directory 'directory' of partition 'part' on\n"
 	"      device type 'interface' instance 'dev'."
 );
+
+#ifdef CONFIG_FIT
+int do_fitload_wrapper(cmd_tbl_t *cmdtp, int flag, int argc,
+		       char * const argv[])
+{
+	return do_fitload(cmdtp, flag, argc, argv, FS_TYPE_ANY);
+}
+
+U_BOOT_CMD(
+	fitload,	6,	0,	do_fitload_wrapper,
+	"load the images of a FIT configuration from a filesystem",
+	"<interface> <dev[:part]> <addr> <filename> [<conf>]\n"
+	"    - Read the FIT in 'filename' to address 'addr', then load the\n"
+	"      kernel, fdt and ramdisk of configuration 'conf' (or the\n"
+	"      default) to their load addresses, or after the FIT if they\n"
+	"      have none. Images must not be compressed. Images built with\n"
+	"      'mkimage -E' are read straight from the file. The addresses\n"
+	"      and sizes are set in fit_<image>_addr and fit_<image>_size."
+);
+#endif
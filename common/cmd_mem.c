@@ -20,6 +20,13 @@
 #include <watchdog.h>
 #include <asm/io.h>
 #include <linux/compiler.h>
+#ifdef CONFIG_SYS_MEMTEST_FAST
+#include <div64.h>
+#endif
+#if defined(CONFIG_SYS_MEMTEST_FAST) && defined(CONFIG_SANDBOX)
+#include <asm/getopt.h>
+#include <asm/state.h>
+#endif
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -981,6 +988,275 @@ static ulong mem_test_quick(vu_long *buf, ulong start_addr, ulong end_addr,
 	return 0;
 }
 
+#ifdef CONFIG_SYS_MEMTEST_FAST
+/*
+ * The fast test works on bursts of words, which the compiler can turn into
+ * multiple-register or paired loads and stores. Each burst is checked by
+ * combining the differences from the expected values, and only when that
+ * is non-zero do we look at the words one at a time. This tests memory at
+ * close to the bus bandwidth, rather than at the speed of single volatile
+ * accesses.
+ */
+#define MTEST_BURST		8	/* Words per burst */
+#define MTEST_CHUNK		(16 << 20)	/* Bytes between ctrl-c checks */
+#define MTEST_MAX_REPORT	16	/* Errors to show in each test */
+
+/* The value of word i is val + i * inc */
+struct mtest_pattern {
+	ulong val;
+	ulong inc;
+};
+
+struct mtest_fast {
+	ulong *buf;		/* Memory under test */
+	ulong start_addr;	/* Address of buf, for reporting */
+	ulong words;		/* Number of words to test, a whole burst */
+	ulong errs;		/* Errors found in this test */
+	u64 bytes;		/* Bytes read and written in this test */
+	ulong us;		/* Time taken by this test */
+};
+
+#ifdef CONFIG_SANDBOX
+/*
+ * Sandbox memory does not fail, so allow a bit to be stuck at zero, to
+ * check that errors are found and reported
+ */
+static void mtest_fast_fault(struct mtest_fast *t)
+{
+	struct sandbox_state *state = state_get_current();
+	ulong offset = state->mem_fault_addr - t->start_addr;
+
+	if (state->mem_fault_bit && offset < t->words * sizeof(ulong))
+		t->buf[offset / sizeof(ulong)] &= ~state->mem_fault_bit;
+}
+
+static int sandbox_cmdline_cb_mem_fault(struct sandbox_state *state,
+					const char *arg)
+{
+	char *end;
+
+	state->mem_fault_addr = simple_strtoul(arg, &end, 16);
+	if (*end != ':') {
+		printf("Invalid memory fault '%s'\n", arg);
+		return 1;
+	}
+	state->mem_fault_bit = 1UL << simple_strtoul(end + 1, NULL, 10);
+
+	return 0;
+}
+SANDBOX_CMDLINE_OPT(mem_fault, 1, "make a RAM bit stick at 0: <addr>:<bit>");
+#else
+static inline void mtest_fast_fault(struct mtest_fast *t) {}
+#endif
+
+static void mtest_fast_report(struct mtest_fast *t, ulong i,
+			      const struct mtest_pattern *pat)
+{
+	ulong val = pat->val + i * pat->inc;
+	ulong n;
+
+	for (n = 0; n < MTEST_BURST; n++, val += pat->inc) {
+		ulong readback = t->buf[i + n];
+
+		if (readback == val)
+			continue;
+		if (++t->errs <= MTEST_MAX_REPORT)
+			printf("\nMem error @ 0x%08lX: found %08lX, expected %08lX",
+			       t->start_addr + (i + n) * sizeof(ulong),
+			       readback, val);
+	}
+}
+
+/*
+ * Go through n words from word i, upwards or downwards a burst at a time,
+ * checking each burst against one pattern (if chk is not NULL) and then
+ * writing another (if wr is not NULL).
+ */
+static void mtest_fast_run(struct mtest_fast *t, ulong i, ulong n,
+			   const struct mtest_pattern *chk,
+			   const struct mtest_pattern *wr, int down)
+{
+	long step = down ? -MTEST_BURST : MTEST_BURST;
+	ulong first = down ? i + n - MTEST_BURST : i;
+	ulong *p = t->buf + first;
+	ulong cinc = chk ? chk->inc : 0, winc = wr ? wr->inc : 0;
+	ulong cval = chk ? chk->val + first * cinc : 0;
+	ulong wval = wr ? wr->val + first * winc : 0;
+	ulong diff, k;
+
+	for (k = n / MTEST_BURST; k; k--) {
+		if (chk) {
+			diff = (p[0] ^ cval) | (p[1] ^ (cval + cinc)) |
+				(p[2] ^ (cval + 2 * cinc)) |
+				(p[3] ^ (cval + 3 * cinc)) |
+				(p[4] ^ (cval + 4 * cinc)) |
+				(p[5] ^ (cval + 5 * cinc)) |
+				(p[6] ^ (cval + 6 * cinc)) |
+				(p[7] ^ (cval + 7 * cinc));
+			if (diff)
+				mtest_fast_report(t, p - t->buf, chk);
+			cval += step * cinc;
+		}
+		if (wr) {
+			p[0] = wval;
+			p[1] = wval + winc;
+			p[2] = wval + 2 * winc;
+			p[3] = wval + 3 * winc;
+			p[4] = wval + 4 * winc;
+			p[5] = wval + 5 * winc;
+			p[6] = wval + 6 * winc;
+			p[7] = wval + 7 * winc;
+			wval += step * winc;
+		}
+		p += step;
+	}
+}
+
+/*
+ * Make one pass through memory with mtest_fast_run(), in chunks so that
+ * we can be interrupted.
+ *
+ * @return 0 if ok, -1 if interrupted
+ */
+static int mtest_fast_pass(struct mtest_fast *t,
+			   const struct mtest_pattern *chk,
+			   const struct mtest_pattern *wr, int down)
+{
+	const ulong chunk = MTEST_CHUNK / sizeof(ulong);
+	ulong pos, n;
+	ulong start;
+
+	mtest_fast_fault(t);
+	start = timer_get_us();
+	for (pos = 0; pos < t->words; pos += n) {
+		WATCHDOG_RESET();
+		if (ctrlc())
+			return -1;
+		n = min(chunk, t->words - pos);
+		mtest_fast_run(t, down ? t->words - pos - n : pos, n, chk, wr,
+			       down);
+	}
+	/* Make sure the writes are done before anything reads them back */
+	barrier();
+	t->us += timer_get_us() - start;
+	t->bytes += (u64)t->words * sizeof(ulong) * (!!chk + !!wr);
+
+	return 0;
+}
+
+/*
+ * Fill memory with each of a few patterns, and the given one, and read it
+ * back
+ */
+static int mtest_fast_solid(struct mtest_fast *t, ulong pattern)
+{
+	const ulong patterns[] = { 0, ~0UL, ~0UL / 3, ~0UL / 3 * 2, pattern };
+	struct mtest_pattern pat = { .inc = 0 };
+	int count = ARRAY_SIZE(patterns);
+	int i;
+
+	/* Don't repeat one of the fixed patterns */
+	if (!pattern || !~pattern)
+		count--;
+	for (i = 0; i < count; i++) {
+		pat.val = patterns[i];
+		if (mtest_fast_pass(t, NULL, &pat, 0) ||
+		    mtest_fast_pass(t, &pat, NULL, 0))
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Moving inversions: going up, check each burst and write its inverse,
+ * then going down, check the inverse and write the pattern back. This finds
+ * faults where writing one cell disturbs another.
+ */
+static int mtest_fast_inversions(struct mtest_fast *t, ulong pattern)
+{
+	struct mtest_pattern pat = { .val = pattern, .inc = 0 };
+	struct mtest_pattern inv = { .val = ~pattern, .inc = 0 };
+
+	if (mtest_fast_pass(t, NULL, &pat, 0) ||
+	    mtest_fast_pass(t, &pat, &inv, 0) ||
+	    mtest_fast_pass(t, &inv, &pat, 1) ||
+	    mtest_fast_pass(t, &pat, NULL, 0))
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Address in address: each word holds its own address, and then the
+ * inverse of it. This finds address lines which are stuck or shorted.
+ */
+static int mtest_fast_address(struct mtest_fast *t, ulong pattern)
+{
+	struct mtest_pattern pat = {
+		.val = t->start_addr, .inc = sizeof(ulong),
+	};
+	struct mtest_pattern inv = {
+		.val = ~t->start_addr, .inc = -sizeof(ulong),
+	};
+
+	if (mtest_fast_pass(t, NULL, &pat, 0) ||
+	    mtest_fast_pass(t, &pat, &inv, 0) ||
+	    mtest_fast_pass(t, &inv, NULL, 1))
+		return -1;
+
+	return 0;
+}
+
+static const struct {
+	const char *name;
+	int (*test)(struct mtest_fast *t, ulong pattern);
+} mtest_fast_tests[] = {
+	{ "Pattern fill", mtest_fast_solid },
+	{ "Moving inversions", mtest_fast_inversions },
+	{ "Address in address", mtest_fast_address },
+};
+
+/*
+ * Run each of the fast tests over memory, showing the errors found and
+ * the bandwidth reached.
+ *
+ * @return number of errors, or -1 if interrupted
+ */
+static ulong mem_test_fast(vu_long *buf, ulong start_addr, ulong end_addr,
+			   ulong pattern)
+{
+	struct mtest_fast t;
+	ulong errs = 0;
+	ulong mbps;
+	int i;
+
+	t.buf = (ulong *)buf;
+	t.start_addr = start_addr;
+	t.words = (end_addr - start_addr) / sizeof(ulong);
+	t.words -= t.words % MTEST_BURST;
+
+	for (i = 0; i < ARRAY_SIZE(mtest_fast_tests); i++) {
+		t.errs = 0;
+		t.bytes = 0;
+		t.us = 0;
+		printf("%-20s", mtest_fast_tests[i].name);
+		if (mtest_fast_tests[i].test(&t, pattern))
+			return -1;
+
+		/* Bytes per microsecond is MB/s */
+		mbps = lldiv(t.bytes, max(t.us, 1UL));
+		if (t.errs)
+			printf("\n%-20s", "");
+		printf("%lu.%02lu GB/s, %lu errors\n", mbps / 1000,
+		       mbps % 1000 / 10, t.errs);
+		errs += t.errs;
+	}
+
+	return errs;
+}
+#endif /* CONFIG_SYS_MEMTEST_FAST */
+
 /*
  * Perform a memory test. A more complete alternative test can be
  * configured using CONFIG_SYS_ALT_MEMTEST. The complete test loops until
@@ -1001,6 +1277,15 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 #else
 	const int alt_test = 0;
 #endif
+	int fast_test = 0;
+
+#ifdef CONFIG_SYS_MEMTEST_FAST
+	if (argc > 1 && !strcmp(argv[1], "-f")) {
+		fast_test = 1;
+		argc--;
+		argv++;
+	}
+#endif
 
 	if (argc > 1)
 		start = simple_strtoul(argv[1], NULL, 16);
@@ -1038,7 +1323,12 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 
 		printf("Iteration: %6d\r", iteration + 1);
 		debug("\n");
-		if (alt_test) {
+		if (fast_test) {
+#ifdef CONFIG_SYS_MEMTEST_FAST
+			putc('\n');
+			errs = mem_test_fast(buf, start, end, pattern);
+#endif
+		} else if (alt_test) {
 			errs = mem_test_alt(buf, start, end, dummy);
 		} else {
 			errs = mem_test_quick(buf, start, end, pattern,
@@ -1362,9 +1652,14 @@ U_BOOT_CMD(
 
 #ifdef CONFIG_CMD_MEMTEST
 U_BOOT_CMD(
-	mtest,	5,	1,	do_mem_mtest,
+	mtest,	6,	1,	do_mem_mtest,
 	"simple RAM read/write test",
+#ifdef CONFIG_SYS_MEMTEST_FAST
+	"[-f] [start [end [pattern [iterations]]]]\n"
+	"    -f: test at full speed, in bursts, and show the bandwidth"
+#else
 	"[start [end [pattern [iterations]]]]"
+#endif
 );
 #endif	/* CONFIG_CMD_MEMTEST */
 
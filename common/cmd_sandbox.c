@@ -9,6 +9,7 @@
 #include <part.h>
 #include <sandboxblockdev.h>
 #include <asm/errno.h>
+#include <asm/eth.h>
 
 static int do_sandbox_load(cmd_tbl_t *cmdtp, int flag, int argc,
 			   char * const argv[])
@@ -85,12 +86,55 @@ static int do_sandbox_info(cmd_tbl_t *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#ifdef CONFIG_ETH_SANDBOX
+static int do_sandbox_eth(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	struct sandbox_eth_stats stats;
+	uint64_t us;
+
+	if (argc > 2)
+		return CMD_RET_USAGE;
+	if (argc == 2) {
+		if (strcmp(argv[1], "reset"))
+			return CMD_RET_USAGE;
+		sandbox_eth_reset_stats();
+		return 0;
+	}
+
+	sandbox_eth_get_stats(&stats);
+	us = stats.last_us - stats.first_us;
+	printf("tx:      %lu frames, %lu bytes\n", stats.tx_frames,
+	       stats.tx_bytes);
+	printf("rx:      %lu frames, %lu bytes\n", stats.rx_frames,
+	       stats.rx_bytes);
+	printf("time:    %llu us", (unsigned long long)us);
+	if (us)
+		printf(", rx %llu KiB/s, tx %llu KiB/s",
+		       (unsigned long long)stats.rx_bytes * 1000000 / 1024 / us,
+		       (unsigned long long)stats.tx_bytes * 1000000 / 1024 / us);
+	puts("\n");
+	if (stats.replies)
+		printf("latency: min %llu us, avg %llu us, max %llu us "
+		       "(%lu replies)\n",
+		       (unsigned long long)stats.latency_min_us,
+		       (unsigned long long)stats.latency_us / stats.replies,
+		       (unsigned long long)stats.latency_max_us,
+		       stats.replies);
+
+	return 0;
+}
+#endif
+
 static cmd_tbl_t cmd_sandbox_sub[] = {
 	U_BOOT_CMD_MKENT(load, 7, 0, do_sandbox_load, "", ""),
 	U_BOOT_CMD_MKENT(ls, 3, 0, do_sandbox_ls, "", ""),
 	U_BOOT_CMD_MKENT(save, 6, 0, do_sandbox_save, "", ""),
 	U_BOOT_CMD_MKENT(bind, 3, 0, do_sandbox_bind, "", ""),
 	U_BOOT_CMD_MKENT(info, 3, 0, do_sandbox_info, "", ""),
+#ifdef CONFIG_ETH_SANDBOX
+	U_BOOT_CMD_MKENT(eth, 2, 0, do_sandbox_eth, "", ""),
+#endif
 };
 
 static int do_sandbox(cmd_tbl_t *cmdtp, int flag, int argc,
@@ -121,4 +165,7 @@ U_BOOT_CMD(
 		"save a file to host\n"
 	"sb bind <dev> [<filename>] - bind \"host\" device to file\n"
 	"sb info [<dev>]            - show device binding & info"
+#ifdef CONFIG_ETH_SANDBOX
+	"\nsb eth [reset]             - show (or zero) ethernet traffic & timing"
+#endif
 );
@@ -77,6 +77,45 @@ static int create_call_list(int argc, char * const argv[])
 	return 0;
 }
 
+static int create_func_times(int argc, char * const argv[])
+{
+	size_t buff_size, avail, buff_ptr, used;
+	unsigned int needed;
+	char *buff;
+	int err;
+
+	if (get_args(argc, argv, &buff, &buff_ptr, &buff_size))
+		return -1;
+
+	avail = buff_size - buff_ptr;
+	err = trace_list_func_times(buff + buff_ptr, avail, &needed);
+	if (err)
+		printf("Error: truncated (%#x bytes needed)\n", needed);
+	used = min(avail, needed);
+	printf("Function times dumped to %08lx, size %#zx\n",
+	       (ulong)map_to_sysmem(buff + buff_ptr), used);
+
+	setenv_hex("profbase", map_to_sysmem(buff));
+	setenv_hex("profsize", buff_size);
+	setenv_hex("profoffset", buff_ptr + used);
+
+	return 0;
+}
+
+static int set_mode(int argc, char * const argv[])
+{
+	if (argc < 3)
+		return -1;
+	if (!strcmp(argv[2], "aggregate"))
+		trace_set_aggregate(1);
+	else if (!strcmp(argv[2], "calls"))
+		trace_set_aggregate(0);
+	else
+		return -1;
+
+	return 0;
+}
+
 int do_trace(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	const char *cmd = argc < 2 ? NULL : argv[1];
@@ -101,6 +140,14 @@ int do_trace(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	case 's':
 		trace_print_stats();
 		break;
+	case 't':
+		if (create_func_times(argc, argv))
+			return cmd_usage(cmdtp);
+		break;
+	case 'm':
+		if (set_mode(argc, argv))
+			return cmd_usage(cmdtp);
+		break;
 	default:
 		return CMD_RET_USAGE;
 	}
@@ -116,5 +163,9 @@ U_BOOT_CMD(
 	"trace resume                       - resume tracing\n"
 	"trace funclist [<addr> <size>]     - dump function list into buffer\n"
 	"trace calls  [<addr> <size>]       "
-		"- dump function call trace into buffer"
+		"- dump function call trace into buffer\n"
+	"trace times  [<addr> <size>]       "
+		"- dump function counts and times into buffer\n"
+	"trace mode aggregate|calls         "
+		"- record only counters, or every call"
 );
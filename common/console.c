@@ -103,6 +103,8 @@ static int console_setfile(int file, struct stdio_dev * dev)
 	if (dev == NULL)
 		return -1;
 
+	console_flush();
+
 	switch (file) {
 	case stdin:
 	case stdout:
@@ -251,6 +253,115 @@ static inline void console_doenv(int file, struct stdio_dev *dev)
 }
 #endif /* defined(CONFIG_CONSOLE_MUX) */
 
+#if defined(CONFIG_CONSOLE_TX_BUFFER) && !defined(CONFIG_SPL_BUILD)
+/*
+ * Output to stdout is queued here and handed to the device as fast as it
+ * will take it without waiting, so that long prints do not hold up the
+ * caller while each character goes out. The queue is drained further on
+ * each output and while polling for input, and flushed before reading
+ * input, before other output to the device and before booting or reset.
+ */
+#if CONFIG_CONSOLE_TX_BUFFER & (CONFIG_CONSOLE_TX_BUFFER - 1)
+#error "CONFIG_CONSOLE_TX_BUFFER must be a power of two"
+#endif
+#define TX_BUF_IDX(idx) ((idx) & (CONFIG_CONSOLE_TX_BUFFER - 1))
+
+static char console_tx_buf[CONFIG_CONSOLE_TX_BUFFER];
+static unsigned int console_tx_head, console_tx_tail;
+
+/* The device to buffer for, if stdout is a single device which allows it */
+static struct stdio_dev *console_tx_dev(void)
+{
+	struct stdio_dev *dev;
+
+	if (!(gd->flags & GD_FLG_DEVINIT))
+		return NULL;
+#ifdef CONFIG_CONSOLE_MUX
+	if (cd_count[stdout] != 1)
+		return NULL;
+	dev = console_devices[stdout][0];
+#else
+	dev = stdio_devices[stdout];
+#endif
+
+	return dev && dev->puts_nowait ? dev : NULL;
+}
+
+/* Send as much of the queue as the device will take without waiting */
+static void console_tx_drain(struct stdio_dev *dev)
+{
+	while (console_tx_head != console_tx_tail) {
+		unsigned int start = TX_BUF_IDX(console_tx_tail);
+		int len, sent;
+
+		len = min(console_tx_head - console_tx_tail,
+			  CONFIG_CONSOLE_TX_BUFFER - start);
+		sent = dev->puts_nowait(console_tx_buf + start, len);
+		console_tx_tail += sent;
+		if (sent < len)
+			break;
+	}
+}
+
+void console_flush(void)
+{
+	struct stdio_dev *dev;
+
+	if (console_tx_head == console_tx_tail)
+		return;
+	dev = console_tx_dev();
+	while (dev && console_tx_head != console_tx_tail)
+		console_tx_drain(dev);
+
+	/* The device is gone, so there is nowhere to send the rest */
+	console_tx_tail = console_tx_head;
+}
+
+static void console_tx_poll(void)
+{
+	struct stdio_dev *dev;
+
+	if (console_tx_head != console_tx_tail) {
+		dev = console_tx_dev();
+		if (dev)
+			console_tx_drain(dev);
+	}
+}
+
+/*
+ * Queue output for stdout, or flush the queue ahead of output to another
+ * file. Returns 1 if the output was queued.
+ */
+static int console_tx_queue(int file, const char *s, int len)
+{
+	struct stdio_dev *dev;
+	int i;
+
+	dev = file == stdout ? console_tx_dev() : NULL;
+	if (!dev) {
+		console_flush();
+		return 0;
+	}
+
+	for (i = 0; i < len; i++) {
+		while (console_tx_head - console_tx_tail ==
+		       CONFIG_CONSOLE_TX_BUFFER)
+			console_tx_drain(dev);
+		console_tx_buf[TX_BUF_IDX(console_tx_head++)] = s[i];
+	}
+	console_tx_drain(dev);
+
+	return 1;
+}
+#else
+static inline void console_tx_poll(void) {}
+
+static inline int console_tx_queue(int file, const char *s, int len)
+{
+	return 0;
+}
+#endif /* CONFIG_CONSOLE_TX_BUFFER */
+
 /** U-Boot INITIAL CONSOLE-NOT COMPATIBLE FUNCTIONS *************************/
 
 int serial_printf(const char *fmt, ...)
@@ -274,6 +385,7 @@ int serial_printf(const char *fmt, ...)
 int fgetc(int file)
 {
 	if (file < MAX_FILES) {
+		console_flush();
 #if defined(CONFIG_CONSOLE_MUX)
 		/*
 		 * Effectively poll for input wherever it may be available.
@@ -304,21 +416,23 @@ int fgetc(int file)
 
 int ftstc(int file)
 {
-	if (file < MAX_FILES)
+	if (file < MAX_FILES) {
+		console_tx_poll();
 		return console_tstc(file);
+	}
 
 	return -1;
 }
 
 void fputc(int file, const char c)
 {
-	if (file < MAX_FILES)
+	if (file < MAX_FILES && !console_tx_queue(file, &c, 1))
 		console_putc(file, c);
 }
 
 void fputs(int file, const char *s)
 {
-	if (file < MAX_FILES)
+	if (file < MAX_FILES && !console_tx_queue(file, s, strlen(s)))
 		console_puts(file, s);
 }
 
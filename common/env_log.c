@@ -0,0 +1,499 @@
+/*
+ * Log-structured environment on a block device
+ *
+ * The environment area is split into two banks. Each bank starts with a
+ * snapshot of the whole environment and is followed by records holding only
+ * the variables changed by each later saveenv, so a save normally writes a
+ * block or two rather than the whole area. Each record starts on a new
+ * block, so that a save never rewrites a block holding earlier records.
+ * When a bank fills up, a new snapshot is written to the other bank with a
+ * higher generation number, which leaves the old bank intact until the new
+ * one is complete.
+ *
+ * Each record is a struct env_log_hdr followed by "name=value" strings in
+ * hexport() format, with "name=" for a deleted variable, ending with an
+ * empty string. Loading uses the bank with the highest generation whose
+ * snapshot is intact and replays its records up to the first one that does
+ * not check out, e.g. one that was torn by a power failure.
+ *
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+/* #define DEBUG */
+
+#include <common.h>
+
+#include <command.h>
+#include <environment.h>
+#include <linux/stddef.h>
+#include <malloc.h>
+#include <mmc.h>
+#include <part.h>
+#include <search.h>
+#include <errno.h>
+
+#ifndef CONFIG_ENV_LOG_INTERFACE
+#error CONFIG_ENV_LOG_INTERFACE must be defined, e.g. "mmc"
+#endif
+#ifndef CONFIG_ENV_LOG_DEVICE
+#define CONFIG_ENV_LOG_DEVICE	0
+#endif
+#ifndef CONFIG_ENV_OFFSET
+#define CONFIG_ENV_OFFSET	0
+#endif
+
+#define ENV_LOG_MAGIC		0x474f4c45	/* "ELOG" */
+#define ENV_LOG_BANK_SIZE	(CONFIG_ENV_SIZE / 2)
+#define ENV_LOG_ALIGN		4
+
+char *env_name_spec = "LOG";
+
+env_t *env_ptr;
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/**
+ * struct env_log_hdr - header of a record in the log
+ *
+ * @magic:	ENV_LOG_MAGIC
+ * @gen:	Generation of the bank holding the record
+ * @len:	Number of data bytes following the header
+ * @crc:	crc32 of the header (with @crc set to 0) and the data
+ */
+struct env_log_hdr {
+	uint32_t magic;
+	uint32_t gen;
+	uint32_t len;
+	uint32_t crc;
+};
+
+/* Copy of the bank in use, and where the next record goes */
+static char *env_log_buf;
+static int env_log_bank;
+static uint32_t env_log_gen;
+static size_t env_log_used;
+
+/* The stored environment as sorted by hexport(), to find what changed */
+static char *env_log_shadow;
+
+/* The area was read and holds an environment, or nothing, so can be saved */
+static bool env_log_writable;
+
+static block_dev_desc_t *env_log_get_dev(void)
+{
+	block_dev_desc_t *dev_desc;
+	int dev = CONFIG_ENV_LOG_DEVICE;
+
+#ifdef CONFIG_MMC
+	if (strcmp(CONFIG_ENV_LOG_INTERFACE, "mmc") == 0) {
+		struct mmc *mmc = find_mmc_device(dev);
+
+		if (!mmc) {
+			printf("no mmc device at slot %x\n", dev);
+			return NULL;
+		}
+
+		mmc->has_init = 0;
+		mmc_init(mmc);
+	}
+#endif /* CONFIG_MMC */
+
+	dev_desc = get_dev(CONFIG_ENV_LOG_INTERFACE, dev);
+	if (dev_desc == NULL) {
+		printf("Failed to find %s%d\n", CONFIG_ENV_LOG_INTERFACE, dev);
+		return NULL;
+	}
+
+	if (CONFIG_ENV_OFFSET % dev_desc->blksz ||
+	    ENV_LOG_BANK_SIZE % dev_desc->blksz) {
+		printf("Environment is not aligned to %s%d blocks\n",
+		       CONFIG_ENV_LOG_INTERFACE, dev);
+		return NULL;
+	}
+
+	return dev_desc;
+}
+
+static uint32_t env_log_crc(const struct env_log_hdr *hdr, const char *data)
+{
+	struct env_log_hdr tmp = *hdr;
+
+	tmp.crc = 0;
+	return crc32(crc32(0, (uchar *)&tmp, sizeof(tmp)), (uchar *)data,
+		     hdr->len);
+}
+
+/**
+ * env_log_check() - Check the record at a given position in a bank
+ *
+ * @bank:	Contents of the bank
+ * @pos:	Offset of the record within the bank
+ * @gen:	Generation the record must have
+ * @return size of the record including its header and padding, or 0 if
+ *	there is no valid record there
+ */
+static size_t env_log_check(const char *bank, size_t pos, uint32_t gen)
+{
+	struct env_log_hdr hdr;
+
+	if (pos + sizeof(hdr) > ENV_LOG_BANK_SIZE)
+		return 0;
+	memcpy(&hdr, bank + pos, sizeof(hdr));
+	if (hdr.magic != ENV_LOG_MAGIC || hdr.gen != gen || !hdr.len ||
+	    hdr.len > ENV_LOG_BANK_SIZE - pos - sizeof(hdr) ||
+	    bank[pos + sizeof(hdr) + hdr.len - 1] != '\0')
+		return 0;
+	if (env_log_crc(&hdr, bank + pos + sizeof(hdr)) != hdr.crc)
+		return 0;
+
+	return ALIGN(sizeof(hdr) + hdr.len, ENV_LOG_ALIGN);
+}
+
+/* Add a record to the in-memory bank, returning its size */
+static size_t env_log_add(char *bank, size_t pos, uint32_t gen,
+			  const char *data, size_t len)
+{
+	struct env_log_hdr hdr;
+	size_t size = ALIGN(sizeof(hdr) + len, ENV_LOG_ALIGN);
+
+	hdr.magic = ENV_LOG_MAGIC;
+	hdr.gen = gen;
+	hdr.len = len;
+	hdr.crc = env_log_crc(&hdr, data);
+	memcpy(bank + pos, &hdr, sizeof(hdr));
+	memcpy(bank + pos + sizeof(hdr), data, len);
+	memset(bank + pos + sizeof(hdr) + len, '\0',
+	       size - sizeof(hdr) - len);
+
+	return size;
+}
+
+/* Length of a list of strings, including its terminating empty string */
+static size_t env_log_list_len(const char *list)
+{
+	const char *p;
+
+	for (p = list; *p; p += strlen(p) + 1)
+		;
+
+	return p - list + 1;
+}
+
+/* Length of the name in a "name=value" string */
+static size_t env_log_name_len(const char *entry)
+{
+	return strchr(entry, '=') - entry;
+}
+
+/* Compare the names of two "name=value" strings, as hexport() sorts them */
+static int env_log_name_cmp(const char *a, const char *b)
+{
+	size_t alen = env_log_name_len(a);
+	size_t blen = env_log_name_len(b);
+	int ret;
+
+	ret = memcmp(a, b, min(alen, blen));
+	if (ret)
+		return ret;
+
+	return alen < blen ? -1 : alen > blen;
+}
+
+/**
+ * env_log_diff() - Work out the changes from one environment to another
+ *
+ * Both environments are lists of "name=value" strings sorted by name.
+ *
+ * @old:	Environment as stored
+ * @new:	Environment now
+ * @delta:	Returns the entries that were added or changed, and "name="
+ *		for those that were deleted, ending with an empty string
+ * @size:	Size of the delta buffer
+ * @return length of the delta including its terminator (1 if nothing
+ *	changed), or -ENOSPC if it does not fit
+ */
+static int env_log_diff(const char *old, const char *new, char *delta,
+			size_t size)
+{
+	size_t len = 0, n;
+	const char *add;
+	int cmp;
+
+	while (*old || *new) {
+		if (!*old)
+			cmp = 1;
+		else if (!*new)
+			cmp = -1;
+		else
+			cmp = env_log_name_cmp(old, new);
+
+		add = NULL;
+		n = 0;
+		if (cmp < 0) {
+			add = old;
+			n = env_log_name_len(old) + 1;
+		} else if (cmp > 0 || strcmp(old, new)) {
+			add = new;
+			n = strlen(new);
+		}
+		if (add) {
+			if (len + n + 2 > size)
+				return -ENOSPC;
+			memcpy(delta + len, add, n);
+			delta[len + n] = '\0';
+			len += n + 1;
+		}
+
+		if (cmp <= 0)
+			old += strlen(old) + 1;
+		if (cmp >= 0)
+			new += strlen(new) + 1;
+	}
+	delta[len++] = '\0';
+
+	return len;
+}
+
+#ifdef CONFIG_CMD_SAVEENV
+/* Write [start, end) of the in-memory bank to a bank, from a block start */
+static int env_log_write(block_dev_desc_t *dev_desc, int bank, size_t start,
+			 size_t end)
+{
+	ulong blksz = dev_desc->blksz;
+	ulong blk, cnt, n;
+
+	blk = (CONFIG_ENV_OFFSET + bank * ENV_LOG_BANK_SIZE + start) / blksz;
+	cnt = DIV_ROUND_UP(end - start, blksz);
+	n = dev_desc->block_write(dev_desc->dev, blk, cnt,
+				  env_log_buf + start);
+
+	return n == cnt ? 0 : -EIO;
+}
+
+int saveenv(void)
+{
+	block_dev_desc_t *dev_desc;
+	char *res = NULL, *delta = NULL;
+	size_t max = ENV_LOG_BANK_SIZE - sizeof(struct env_log_hdr);
+	size_t pos, avail;
+	ssize_t len;
+	int dlen;
+	int ret = 1;
+
+	/* Do not overwrite something we could not read, or do not know */
+	if (!env_log_writable) {
+		printf("Not saving: no environment area found on %s%d\n",
+		       CONFIG_ENV_LOG_INTERFACE, CONFIG_ENV_LOG_DEVICE);
+		return 1;
+	}
+	dev_desc = env_log_get_dev();
+	if (!dev_desc)
+		return 1;
+
+	res = malloc(max);
+	delta = malloc(max);
+	if (!res || !delta)
+		goto done;
+	len = hexport_r(&env_htab, '\0', 0, &res, max, 0, NULL);
+	if (len < 0) {
+		error("Cannot export environment: errno = %d\n", errno);
+		goto done;
+	}
+	len = env_log_list_len(res);
+
+	/* Append the changes if they fit, else write a new snapshot */
+	dlen = -ENOSPC;
+	pos = roundup(env_log_used, dev_desc->blksz);
+	avail = pos < ENV_LOG_BANK_SIZE ? ENV_LOG_BANK_SIZE - pos : 0;
+	if (env_log_shadow && avail > sizeof(struct env_log_hdr))
+		dlen = env_log_diff(env_log_shadow, res, delta,
+				    avail - sizeof(struct env_log_hdr));
+	if (dlen == 1) {
+		puts("unchanged\n");
+		ret = 0;
+	} else if (dlen > 0) {
+		printf("Appending %d bytes to %s%d... ", dlen,
+		       CONFIG_ENV_LOG_INTERFACE, CONFIG_ENV_LOG_DEVICE);
+		memset(env_log_buf + env_log_used, '\0', pos - env_log_used);
+		env_log_used = pos + env_log_add(env_log_buf, pos, env_log_gen,
+						 delta, dlen);
+		ret = env_log_write(dev_desc, env_log_bank, pos,
+				    env_log_used);
+	} else {
+		/*
+		 * Start afresh in the other bank. Only switch to it once the
+		 * snapshot is written, so that a failed save is retried there
+		 * rather than in the bank holding the last good environment.
+		 */
+		printf("Writing %zd bytes to %s%d bank %d... ", len,
+		       CONFIG_ENV_LOG_INTERFACE, CONFIG_ENV_LOG_DEVICE,
+		       env_log_bank ^ 1);
+		memset(env_log_buf, '\0', ENV_LOG_BANK_SIZE);
+		env_log_used = env_log_add(env_log_buf, 0, env_log_gen + 1,
+					   res, len);
+		ret = env_log_write(dev_desc, env_log_bank ^ 1, 0,
+				    env_log_used);
+		if (!ret) {
+			env_log_bank ^= 1;
+			env_log_gen++;
+		}
+	}
+	if (ret) {
+		puts("failed\n");
+		ret = 1;
+		/* Make sure the next save writes a new snapshot */
+		free(env_log_shadow);
+		env_log_shadow = NULL;
+		goto done;
+	}
+	if (dlen != 1)
+		puts("done\n");
+
+	free(env_log_shadow);
+	env_log_shadow = res;
+	res = NULL;
+
+done:
+	free(delta);
+	free(res);
+	return ret;
+}
+#endif /* CONFIG_CMD_SAVEENV */
+
+/**
+ * env_log_load_bank() - Load the environment from a bank
+ *
+ * @bank:	Contents of the bank
+ * @gen:	Generation of the bank
+ * @blksz:	Block size of the device; each record starts on a block
+ * @return number of bytes of the bank in use, or 0 if the snapshot at its
+ *	start could not be imported
+ */
+static size_t env_log_load_bank(const char *bank, uint32_t gen, ulong blksz)
+{
+	const struct env_log_hdr *hdr;
+	size_t pos, size, end = 0;
+	int flag = 0;
+
+	for (pos = 0; (size = env_log_check(bank, pos, gen));
+	     pos = roundup(end, blksz)) {
+		hdr = (const struct env_log_hdr *)(bank + pos);
+		debug("%s: record at %zu, %u bytes\n", __func__, pos,
+		      hdr->len);
+		if (!himport_r(&env_htab, (char *)(hdr + 1), hdr->len, '\0',
+			       flag, 0, NULL)) {
+			error("Cannot import environment: errno = %d\n",
+			      errno);
+			if (!pos)
+				return 0;
+		}
+		/* Later records are changes to what is there already */
+		flag = H_NOCLEAR | H_FORCE;
+		end = pos + size;
+	}
+
+	return end;
+}
+
+/* Check whether an area is erased, i.e. all zeroes or all ones */
+static bool env_log_blank(const char *buf, size_t size)
+{
+	size_t i;
+
+	if (buf[0] != 0 && buf[0] != (char)0xff)
+		return false;
+	for (i = 1; i < size; i++) {
+		if (buf[i] != buf[0])
+			return false;
+	}
+
+	return true;
+}
+
+void env_relocate_spec(void)
+{
+	block_dev_desc_t *dev_desc;
+	const struct env_log_hdr *hdr;
+	char *buf, *bank;
+	ulong blk, cnt;
+	int i;
+
+	buf = malloc(CONFIG_ENV_SIZE);
+	if (!buf) {
+		set_default_env("!malloc() failed\n");
+		return;
+	}
+
+	dev_desc = env_log_get_dev();
+	if (!dev_desc) {
+		set_default_env(NULL);
+		goto done;
+	}
+	blk = CONFIG_ENV_OFFSET / dev_desc->blksz;
+	cnt = CONFIG_ENV_SIZE / dev_desc->blksz;
+	if (dev_desc->block_read(dev_desc->dev, blk, cnt, buf) != cnt) {
+		printf("Failed to read %s%d\n", CONFIG_ENV_LOG_INTERFACE,
+		       CONFIG_ENV_LOG_DEVICE);
+		set_default_env(NULL);
+		goto done;
+	}
+
+	/* Use the newest bank with a valid snapshot */
+	env_log_bank = -1;
+	for (i = 0; i < 2; i++) {
+		bank = buf + i * ENV_LOG_BANK_SIZE;
+		hdr = (const struct env_log_hdr *)bank;
+		/* Even a torn log shows that the area is ours */
+		if (hdr->magic == ENV_LOG_MAGIC)
+			env_log_writable = true;
+		if (!env_log_check(bank, 0, hdr->gen))
+			continue;
+		if (env_log_bank == -1 ||
+		    (int32_t)(hdr->gen - env_log_gen) > 0) {
+			env_log_bank = i;
+			env_log_gen = hdr->gen;
+		}
+	}
+
+	env_log_used = 0;
+	if (env_log_bank != -1) {
+		bank = buf + env_log_bank * ENV_LOG_BANK_SIZE;
+		env_log_used = env_log_load_bank(bank, env_log_gen,
+						 dev_desc->blksz);
+	}
+
+	if (env_log_used) {
+		memmove(buf, bank, ENV_LOG_BANK_SIZE);
+		gd->flags |= GD_FLG_ENV_READY;
+		if (hexport_r(&env_htab, '\0', 0, &env_log_shadow, 0, 0,
+			      NULL) < 0)
+			env_log_shadow = NULL;
+	} else {
+		/*
+		 * Pick up an environment saved in the usual format, if any.
+		 * The first saveenv then writes a new snapshot. Anything else
+		 * in the area, such as a boot sector, is left alone.
+		 */
+		if (env_import(buf, 1) || env_log_blank(buf, CONFIG_ENV_SIZE))
+			env_log_writable = true;
+		if (env_log_bank == -1)
+			env_log_bank = 1;
+		memset(buf, '\0', ENV_LOG_BANK_SIZE);
+	}
+
+	env_log_buf = buf;
+	buf = NULL;
+done:
+	free(buf);
+}
+
+int env_init(void)
+{
+	/* use default */
+	gd->env_addr = (ulong)&default_environment[0];
+	gd->env_valid = 1;
+
+	return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * Writing of fastboot images to MMC partitions
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <fb_mmc.h>
+#include <image-sparse.h>
+#include <mmc.h>
+#include <part.h>
+
+#ifndef CONFIG_FASTBOOT_FLASH_MMC_DEV
+#define CONFIG_FASTBOOT_FLASH_MMC_DEV	0
+#endif
+
+/* Partitions searched when looking one up by name */
+#define FB_MMC_MAX_PARTITIONS	128
+
+static void fb_mmc_fail(char *response, const char *reason)
+{
+	printf("FAILED: %s\n", reason);
+	snprintf(response, FASTBOOT_RESPONSE_LEN, "FAIL%s", reason);
+}
+
+static struct mmc *fb_mmc_get_dev(char *response)
+{
+	struct mmc *mmc;
+
+	mmc = find_mmc_device(CONFIG_FASTBOOT_FLASH_MMC_DEV);
+	if (!mmc || mmc_init(mmc)) {
+		fb_mmc_fail(response, "MMC device not found");
+		return NULL;
+	}
+
+	return mmc;
+}
+
+static int fb_mmc_get_part(block_dev_desc_t *dev, const char *name,
+			   disk_partition_t *info)
+{
+	char *end;
+	int part;
+
+	part = simple_strtoul(name, &end, 10);
+	if (*name && !*end)
+		return get_partition_info(dev, part, info);
+
+	for (part = 1; part <= FB_MMC_MAX_PARTITIONS; part++) {
+		if (get_partition_info(dev, part, info))
+			continue;
+		if (!strcmp((char *)info->name, name))
+			return 0;
+	}
+
+	return -ENOENT;
+}
+
+static lbaint_t fb_mmc_sparse_write(struct sparse_storage *info,
+				    lbaint_t blk, lbaint_t blkcnt,
+				    const void *buf)
+{
+	block_dev_desc_t *dev = info->priv;
+
+	return dev->block_write(dev->dev, blk, blkcnt, buf);
+}
+
+static int fb_mmc_write_sparse(block_dev_desc_t *dev, disk_partition_t *info,
+			       void *buffer, unsigned int size)
+{
+	struct sparse_storage storage;
+	struct sparse_stats stats;
+	int ret;
+
+	storage.blksz = info->blksz;
+	storage.start = info->start;
+	storage.size = info->size;
+	storage.priv = dev;
+	storage.write = fb_mmc_sparse_write;
+
+	ret = write_sparse_image(&storage, buffer, size, &stats);
+	if (!ret)
+		printf("sparse: " LBAFU " blocks written, " LBAFU " filled, "
+		       LBAFU " skipped\n", stats.written, stats.filled,
+		       stats.skipped);
+
+	return ret;
+}
+
+static int fb_mmc_write_raw(block_dev_desc_t *dev, disk_partition_t *info,
+			    void *buffer, unsigned int size)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(char, tail, info->blksz);
+	lbaint_t blkcnt;
+	unsigned int rest;
+
+	if (DIV_ROUND_UP(size, info->blksz) > info->size)
+		return -ENOSPC;
+	blkcnt = size / info->blksz;
+	if (blkcnt && dev->block_write(dev->dev, info->start, blkcnt,
+				       buffer) != blkcnt)
+		return -EIO;
+
+	/* Pad the last block with zeroes, not what follows the image */
+	rest = size % info->blksz;
+	if (rest) {
+		memcpy(tail, buffer + blkcnt * info->blksz, rest);
+		memset(tail + rest, '\0', info->blksz - rest);
+		if (dev->block_write(dev->dev, info->start + blkcnt, 1,
+				     tail) != 1)
+			return -EIO;
+	}
+
+	return 0;
+}
+
+void fb_mmc_flash_write(const char *part, void *buffer, unsigned int size,
+			char *response)
+{
+	disk_partition_t info;
+	block_dev_desc_t *dev;
+	struct mmc *mmc;
+	ulong start;
+	int ret;
+
+	mmc = fb_mmc_get_dev(response);
+	if (!mmc)
+		return;
+	dev = &mmc->block_dev;
+	if (fb_mmc_get_part(dev, part, &info)) {
+		fb_mmc_fail(response, "partition not found");
+		return;
+	}
+
+	printf("Flashing %u bytes to '%s'\n", size, part);
+	start = get_timer(0);
+	if (is_sparse_image(buffer))
+		ret = fb_mmc_write_sparse(dev, &info, buffer, size);
+	else
+		ret = fb_mmc_write_raw(dev, &info, buffer, size);
+	if (ret == -ENOSPC) {
+		fb_mmc_fail(response, "image too large for partition");
+		return;
+	} else if (ret) {
+		fb_mmc_fail(response, "write failed");
+		return;
+	}
+	printf("Flashed '%s' in %lu ms\n", part, get_timer(start));
+	strcpy(response, "OKAY");
+}
+
+void fb_mmc_erase(const char *part, char *response)
+{
+	disk_partition_t info;
+	block_dev_desc_t *dev;
+	lbaint_t blk, blkcnt, grp;
+	struct mmc *mmc;
+
+	mmc = fb_mmc_get_dev(response);
+	if (!mmc)
+		return;
+	dev = &mmc->block_dev;
+	if (fb_mmc_get_part(dev, part, &info)) {
+		fb_mmc_fail(response, "partition not found");
+		return;
+	}
+
+	/* Erase whole erase groups inside the partition, and nothing else */
+	grp = mmc->erase_grp_size;
+	blk = roundup(info.start, grp);
+	if (info.start + info.size < blk + grp) {
+		fb_mmc_fail(response, "partition too small to erase");
+		return;
+	}
+	blkcnt = (info.start + info.size - blk) / grp * grp;
+
+	printf("Erasing blocks " LBAFU " to " LBAFU " of '%s'\n", blk,
+	       blk + blkcnt - 1, part);
+	if (dev->block_erase(dev->dev, blk, blkcnt) != blkcnt) {
+		fb_mmc_fail(response, "erase failed");
+		return;
+	}
+	strcpy(response, "OKAY");
+}
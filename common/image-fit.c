@@ -705,6 +705,54 @@ int fit_image_get_entry(const void *fit, int noffset, ulong *entry)
 	return 0;
 }
 
+/**
+ * fit_image_get_data_offset - get external data offset for a component image
+ * @fit: pointer to the FIT format image header
+ * @noffset: component image node offset
+ * @offset: pointer to ulong, will hold the offset of the image data from
+ *	fit_get_ext_offset()
+ *
+ * returns:
+ *     0, on success
+ *     -1, if the image does not have external data
+ */
+int fit_image_get_data_offset(const void *fit, int noffset, ulong *offset)
+{
+	const fdt32_t *val;
+
+	val = fdt_getprop(fit, noffset, FIT_DATA_OFFSET_PROP, NULL);
+	if (!val)
+		return -1;
+
+	*offset = fdt32_to_cpu(*val);
+	return 0;
+}
+
+/**
+ * fit_image_get_data_size - get external data size for a component image
+ * @fit: pointer to the FIT format image header
+ * @noffset: component image node offset
+ * @size: pointer to size_t, will hold the size of the image data
+ *
+ * returns:
+ *     0, on success
+ *     -1, on failure
+ */
+int fit_image_get_data_size(const void *fit, int noffset, size_t *size)
+{
+	const fdt32_t *val;
+	int len;
+
+	val = fdt_getprop(fit, noffset, FIT_DATA_SIZE_PROP, &len);
+	if (!val) {
+		fit_get_debug(fit, noffset, FIT_DATA_SIZE_PROP, len);
+		return -1;
+	}
+
+	*size = fdt32_to_cpu(*val);
+	return 0;
+}
+
 /**
  * fit_image_get_data - get data property and its size for a given component image node
  * @fit: pointer to the FIT format image header
@@ -714,7 +762,8 @@ int fit_image_get_entry(const void *fit, int noffset, ulong *entry)
  *
  * fit_image_get_data() finds data property in a given component image node.
  * If the property is found its data start address and size are returned to
- * the caller.
+ * the caller. For an image with external data, the address is where the
+ * data would be if the whole FIT were in memory.
  *
  * returns:
  *     0, on success
@@ -723,8 +772,14 @@ int fit_image_get_entry(const void *fit, int noffset, ulong *entry)
 int fit_image_get_data(const void *fit, int noffset,
 		const void **data, size_t *size)
 {
+	ulong offset;
 	int len;
 
+	if (!fit_image_get_data_offset(fit, noffset, &offset)) {
+		*data = fit + fit_get_ext_offset(fit) + offset;
+		return fit_image_get_data_size(fit, noffset, size);
+	}
+
 	*data = fdt_getprop(fit, noffset, FIT_DATA_PROP, &len);
 	if (*data == NULL) {
 		fit_get_debug(fit, noffset, FIT_DATA_PROP, len);
@@ -941,33 +996,28 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 }
 
 /**
- * fit_image_verify - verify data intergity
+ * fit_image_verify_data - verify the integrity of loaded image data
  * @fit: pointer to the FIT format image header
  * @image_noffset: component image node offset
+ * @data: image data
+ * @size: size of image data in bytes
  *
- * fit_image_verify() goes over component image hash nodes,
+ * fit_image_verify_data() goes over component image hash nodes,
  * re-calculates each data hash and compares with the value stored in hash
- * node.
+ * node. The data need not be inside the FIT.
  *
  * returns:
  *     1, if all hashes are valid
  *     0, otherwise (or on error)
  */
-int fit_image_verify(const void *fit, int image_noffset)
+int fit_image_verify_data(const void *fit, int image_noffset,
+			  const void *data, size_t size)
 {
-	const void	*data;
-	size_t		size;
 	int		noffset = 0;
 	char		*err_msg = "";
 	int verify_all = 1;
 	int ret;
 
-	/* Get image data and data length */
-	if (fit_image_get_data(fit, image_noffset, &data, &size)) {
-		err_msg = "Can't get image data/size";
-		goto error;
-	}
-
 	/* Verify all required signatures */
 	if (IMAGE_ENABLE_VERIFY &&
 	    fit_image_verify_required_sigs(fit, image_noffset, data, size,
@@ -1019,6 +1069,33 @@ error:
 	return 0;
 }
 
+/**
+ * fit_image_verify - verify data intergity
+ * @fit: pointer to the FIT format image header
+ * @image_noffset: component image node offset
+ *
+ * fit_image_verify() checks the hashes of a component image whose data is
+ * in the FIT (see fit_image_verify_data()).
+ *
+ * returns:
+ *     1, if all hashes are valid
+ *     0, otherwise (or on error)
+ */
+int fit_image_verify(const void *fit, int image_noffset)
+{
+	const void	*data;
+	size_t		size;
+
+	/* Get image data and data length */
+	if (fit_image_get_data(fit, image_noffset, &data, &size)) {
+		printf(" error!\nCan't get image data/size for '%s' image node\n",
+		       fit_get_name(fit, image_noffset, NULL));
+		return 0;
+	}
+
+	return fit_image_verify_data(fit, image_noffset, data, size);
+}
+
 /**
  * fit_all_image_verify - verify data intergity for all images
  * @fit: pointer to the FIT format image header
@@ -1623,7 +1700,7 @@ int fit_image_load(bootm_headers_t *images, const char *prop_name, ulong addr,
 			bootstage_error(bootstage_id + BOOTSTAGE_SUB_LOAD);
 			return -EBADF;
 		}
-	} else {
+	} else if (load_op != FIT_LOAD_OPTIONAL_NON_ZERO || load) {
 		ulong image_start, image_end;
 		ulong load_end;
 		void *dst;
@@ -1660,3 +1737,116 @@ int fit_image_load(bootm_headers_t *images, const char *prop_name, ulong addr,
 
 	return noffset;
 }
+
+#ifndef USE_HOSTCC
+int fit_stream_header(struct fit_loader *load, void *fit, ulong size)
+{
+	ulong total;
+
+	if (size < sizeof(struct fdt_header) ||
+	    load->read(load, 0, sizeof(struct fdt_header), fit) !=
+	    sizeof(struct fdt_header)) {
+		puts("Can't read FIT header\n");
+		return -EIO;
+	}
+	if (fdt_check_header(fit)) {
+		puts("Bad FIT image format\n");
+		return -ENOEXEC;
+	}
+
+	total = fit_get_size(fit);
+	if (total > size) {
+		printf("FIT header too large (%lu bytes)\n", total);
+		return -E2BIG;
+	}
+	if (load->read(load, 0, total, fit) != total) {
+		puts("Can't read FIT header\n");
+		return -EIO;
+	}
+	if (!fit_check_format(fit)) {
+		puts("Bad FIT image format\n");
+		return -ENOEXEC;
+	}
+
+	return 0;
+}
+
+int fit_stream_image(struct fit_loader *load, const void *fit, int noffset,
+		     int verify, ulong *loadp, ulong *lenp)
+{
+	const char *name = fit_get_name(fit, noffset, NULL);
+	ulong fit_start = map_to_sysmem((void *)fit);
+	ulong addr, offset;
+	const void *data;
+	size_t size;
+	int external;
+	void *dst;
+
+	/* The data is copied as it is, with nothing to decompress it */
+	if (!fit_image_check_comp(fit, noffset, IH_COMP_NONE)) {
+		printf("Can't load '%s': it is compressed\n", name);
+		return -ENOEXEC;
+	}
+
+	if (fit_image_get_load(fit, noffset, &addr)) {
+		if (!*loadp) {
+			printf("Can't get '%s' load address\n", name);
+			return -EBADF;
+		}
+		addr = *loadp;
+	}
+
+	external = !fit_image_get_data_offset(fit, noffset, &offset);
+	if (external ? fit_image_get_data_size(fit, noffset, &size) :
+	    fit_image_get_data(fit, noffset, &data, &size)) {
+		printf("Could not find '%s' data\n", name);
+		return -ENOENT;
+	}
+	if (size > load->max_size || addr + size < addr) {
+		printf("Error: '%s' is too large (%lu bytes)\n", name,
+		       (ulong)size);
+		return -E2BIG;
+	}
+	if (addr < fit_start + fit_get_size(fit) && addr + size > fit_start) {
+		printf("Error: '%s' would overwrite the FIT\n", name);
+		return -EXDEV;
+	}
+#if defined(CONFIG_LMB) && !defined(CONFIG_SPL_BUILD)
+	if (load->lmb && size &&
+	    lmb_overlaps_region(&load->lmb->reserved, addr, size) >= 0) {
+		printf("Error: '%s' would overwrite reserved memory\n", name);
+		return -EXDEV;
+	}
+#endif
+
+	printf("   Loading '%s' to 0x%08lx\n", name, addr);
+	dst = map_sysmem(addr, size);
+	if (external) {
+		if (load->read(load, fit_get_ext_offset(fit) + offset, size,
+			       dst) != size) {
+			printf("Can't read '%s' data\n", name);
+			return -EIO;
+		}
+	} else {
+		memmove(dst, data, size);
+	}
+
+	if (verify) {
+		puts("   Verifying Hash Integrity ... ");
+		if (!fit_image_verify_data(fit, noffset, dst, size)) {
+			puts("Bad Data Hash\n");
+			return -EACCES;
+		}
+		puts("OK\n");
+	}
+
+#if defined(CONFIG_LMB) && !defined(CONFIG_SPL_BUILD)
+	if (load->lmb && size)
+		lmb_reserve(load->lmb, addr, size);
+#endif
+	*loadp = addr;
+	*lenp = size;
+
+	return 0;
+}
+#endif /* !USE_HOSTCC */
@@ -23,6 +23,18 @@ struct image_sig_algo image_sig_algos[] = {
 		rsa_sign,
 		rsa_add_verify_data,
 		rsa_verify,
+	},
+	{
+		"sha1,rsa3072",
+		rsa_sign,
+		rsa_add_verify_data,
+		rsa_verify,
+	},
+	{
+		"sha1,rsa4096",
+		rsa_sign,
+		rsa_add_verify_data,
+		rsa_verify,
 	}
 };
 
@@ -227,7 +239,9 @@ int fit_image_verify_required_sigs(const void *fit, int image_noffset,
 int fit_config_check_sig(const void *fit, int noffset, int required_keynode,
 			 char **err_msgp)
 {
-	char * const exc_prop[] = {"data"};
+	/* Image data is checked by its hashes, wherever it is stored */
+	char * const exc_prop[] = {FIT_DATA_PROP, FIT_DATA_OFFSET_PROP,
+				   FIT_DATA_SIZE_PROP};
 	const char *prop, *end, *name;
 	struct image_sign_info info;
 	const uint32_t *strings;
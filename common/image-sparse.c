@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * Decoding of Android sparse images straight into a partition
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <image-sparse.h>
+#include <malloc.h>
+
+/* Size of the buffer used to write fill chunks */
+#define SPARSE_FILL_BUF_SIZE	(256 << 10)
+
+struct sparse_ctx {
+	struct sparse_storage *info;
+	struct sparse_stats *stats;
+	u32 *fill_buf;		/* Fill pattern, allocated on first use */
+	lbaint_t fill_blks;	/* Size of fill_buf in device blocks */
+	u32 fill_val;		/* Value fill_buf holds, if fill_valid */
+	int fill_valid;
+};
+
+int is_sparse_image(const void *buf)
+{
+	const sparse_header_t *hdr = buf;
+
+	return le32_to_cpu(hdr->magic) == SPARSE_HEADER_MAGIC;
+}
+
+static int sparse_fill(struct sparse_ctx *ctx, lbaint_t blk, lbaint_t blkcnt,
+		       u32 val)
+{
+	struct sparse_storage *info = ctx->info;
+	lbaint_t n;
+	ulong i;
+
+	if (!ctx->fill_buf) {
+		ctx->fill_blks = max(SPARSE_FILL_BUF_SIZE / info->blksz, 1UL);
+		ctx->fill_buf = memalign(ARCH_DMA_MINALIGN,
+					 ctx->fill_blks * info->blksz);
+		if (!ctx->fill_buf)
+			return -ENOMEM;
+	}
+	if (!ctx->fill_valid || ctx->fill_val != val) {
+		for (i = 0; i < ctx->fill_blks * info->blksz / sizeof(u32); i++)
+			ctx->fill_buf[i] = val;
+		ctx->fill_val = val;
+		ctx->fill_valid = 1;
+	}
+
+	while (blkcnt) {
+		n = min(blkcnt, ctx->fill_blks);
+		if (info->write(info, blk, n, ctx->fill_buf) != n)
+			return -EIO;
+		ctx->stats->filled += n;
+		blk += n;
+		blkcnt -= n;
+	}
+
+	return 0;
+}
+
+/*
+ * Walk the chunks of a sparse image, checking them and, if do_write is
+ * set, writing them out. The image is checked in full before anything is
+ * written, so a corrupt image leaves the partition alone.
+ */
+static int sparse_walk(struct sparse_ctx *ctx, const void *buf, ulong size,
+		       int do_write)
+{
+	struct sparse_storage *info = ctx->info;
+	const sparse_header_t *hdr = buf;
+	uint hdr_sz = le16_to_cpu(hdr->file_hdr_sz);
+	uint chunk_hdr_sz = le16_to_cpu(hdr->chunk_hdr_sz);
+	uint blk_sz = le32_to_cpu(hdr->blk_sz);
+	uint total_blks = le32_to_cpu(hdr->total_blks);
+	uint total_chunks = le32_to_cpu(hdr->total_chunks);
+	const u8 *p = buf + hdr_sz, *end = buf + size;
+	lbaint_t blk = info->start, blkcnt, mul = blk_sz / info->blksz;
+	uint out_blks = 0, i;
+	int ret;
+
+	for (i = 0; i < total_chunks; i++) {
+		const chunk_header_t *chunk = (const chunk_header_t *)p;
+		uint type, chunk_sz, total_sz;
+		ulong data_sz;
+		u32 val;
+
+		if (end - p < chunk_hdr_sz) {
+			printf("Sparse image truncated at chunk %u\n", i);
+			return -EINVAL;
+		}
+		type = le16_to_cpu(chunk->chunk_type);
+		chunk_sz = le32_to_cpu(chunk->chunk_sz);
+		total_sz = le32_to_cpu(chunk->total_sz);
+		if (total_sz < chunk_hdr_sz || total_sz > end - p) {
+			printf("Sparse image truncated at chunk %u\n", i);
+			return -EINVAL;
+		}
+		if (chunk_sz > total_blks - out_blks) {
+			printf("Sparse chunk %u runs past the image end\n", i);
+			return -EINVAL;
+		}
+		data_sz = total_sz - chunk_hdr_sz;
+		blkcnt = (lbaint_t)chunk_sz * mul;
+
+		switch (type) {
+		case CHUNK_TYPE_RAW:
+			if (data_sz != (u64)chunk_sz * blk_sz)
+				goto bad_chunk;
+			if (!do_write)
+				break;
+			if (info->write(info, blk, blkcnt, p + chunk_hdr_sz) !=
+			    blkcnt)
+				return -EIO;
+			ctx->stats->written += blkcnt;
+			break;
+		case CHUNK_TYPE_FILL:
+			if (data_sz != sizeof(val))
+				goto bad_chunk;
+			if (!do_write)
+				break;
+			/* Keep the bytes in image order, for the pattern */
+			memcpy(&val, p + chunk_hdr_sz, sizeof(val));
+			ret = sparse_fill(ctx, blk, blkcnt, val);
+			if (ret)
+				return ret;
+			break;
+		case CHUNK_TYPE_DONT_CARE:
+			if (data_sz)
+				goto bad_chunk;
+			if (do_write)
+				ctx->stats->skipped += blkcnt;
+			break;
+		case CHUNK_TYPE_CRC32:
+			/* The checksum is not checked; the image is */
+			if (data_sz != sizeof(u32) || chunk_sz)
+				goto bad_chunk;
+			break;
+		default:
+			printf("Sparse chunk %u has unknown type %#x\n", i,
+			       type);
+			return -EINVAL;
+		}
+		blk += blkcnt;
+		out_blks += chunk_sz;
+		p += total_sz;
+	}
+
+	if (out_blks != total_blks) {
+		printf("Sparse image has %u blocks, header says %u\n",
+		       out_blks, total_blks);
+		return -EINVAL;
+	}
+
+	return 0;
+
+bad_chunk:
+	printf("Sparse chunk %u (type %#x) has a bad size\n", i,
+	       le16_to_cpu(((const chunk_header_t *)p)->chunk_type));
+	return -EINVAL;
+}
+
+int write_sparse_image(struct sparse_storage *info, const void *buf,
+		       ulong size, struct sparse_stats *stats)
+{
+	const sparse_header_t *hdr = buf;
+	struct sparse_stats local_stats;
+	struct sparse_ctx ctx;
+	uint blk_sz;
+	int ret;
+
+	if (size < sizeof(*hdr) || !is_sparse_image(buf)) {
+		printf("Not a sparse image\n");
+		return -EINVAL;
+	}
+	if (le16_to_cpu(hdr->major_version) != SPARSE_HEADER_MAJOR_VER ||
+	    le16_to_cpu(hdr->file_hdr_sz) < sizeof(sparse_header_t) ||
+	    le16_to_cpu(hdr->file_hdr_sz) > size ||
+	    le16_to_cpu(hdr->chunk_hdr_sz) < sizeof(chunk_header_t)) {
+		printf("Unsupported sparse image header\n");
+		return -EINVAL;
+	}
+	blk_sz = le32_to_cpu(hdr->blk_sz);
+	if (!blk_sz || blk_sz % sizeof(u32) || blk_sz % info->blksz) {
+		printf("Sparse block size %u does not suit a %lu byte device\n",
+		       blk_sz, info->blksz);
+		return -EINVAL;
+	}
+	if ((u64)le32_to_cpu(hdr->total_blks) * (blk_sz / info->blksz) >
+	    info->size) {
+		printf("Sparse image (%u x %u bytes) exceeds the partition\n",
+		       le32_to_cpu(hdr->total_blks), blk_sz);
+		return -ENOSPC;
+	}
+
+	memset(&ctx, '\0', sizeof(ctx));
+	ctx.info = info;
+	ctx.stats = stats ? stats : &local_stats;
+	memset(ctx.stats, '\0', sizeof(*ctx.stats));
+
+	ret = sparse_walk(&ctx, buf, size, 0);
+	if (!ret)
+		ret = sparse_walk(&ctx, buf, size, 1);
+	free(ctx.fill_buf);
+
+	return ret;
+}
@@ -28,6 +28,7 @@
 #include <watchdog.h>
 #include <asm/unaligned.h>
 #include <splash.h>
+#include <asm/errno.h>
 #include <asm/io.h>
 #include <asm/unaligned.h>
 
@@ -37,6 +38,10 @@
 #include <asm/byteorder.h>
 #endif
 
+#ifdef CONFIG_LCD_BMP_GZIP
+#include <u-boot/zlib.h>
+#endif
+
 #if defined(CONFIG_MPC823)
 #include <lcdvideo.h>
 #endif
@@ -130,12 +135,34 @@ static short console_col;
 static short console_row;
 
 static void *lcd_console_address;
-static void *lcd_base;			/* Start of framebuffer memory	*/
+static void *lcd_base;			/* Start of displayed framebuffer */
+
+#ifdef CONFIG_LCD_HW_SCROLL
+static void *lcd_fb_start;		/* Start of framebuffer memory	*/
+static char lcd_can_pan;		/* 1 if lcd_pan_display() works	*/
+#endif
 
 static char lcd_flush_dcache;	/* 1 to flush dcache after each lcd update */
 
+/* Part of the framebuffer written since the last lcd_sync() */
+static uchar *lcd_dirty_start;
+static uchar *lcd_dirty_end;
+
 /************************************************************************/
 
+static void lcd_mark_dirty(void *start, ulong size)
+{
+	uchar *end = (uchar *)start + size;
+
+	if (lcd_dirty_start == lcd_dirty_end) {
+		lcd_dirty_start = start;
+		lcd_dirty_end = end;
+	} else {
+		lcd_dirty_start = min(lcd_dirty_start, (uchar *)start);
+		lcd_dirty_end = max(lcd_dirty_end, end);
+	}
+}
+
 /* Flush LCD activity to the caches */
 void lcd_sync(void)
 {
@@ -145,11 +172,12 @@ void lcd_sync(void)
 	 * out whether it exists? For now, ARM is safe.
 	 */
 #if defined(CONFIG_ARM) && !defined(CONFIG_SYS_DCACHE_OFF)
-	int line_length;
-
-	if (lcd_flush_dcache)
-		flush_dcache_range((u32)lcd_base,
-			(u32)(lcd_base + lcd_get_size(&line_length)));
+	/* Only the lines written since the last sync need flushing */
+	if (lcd_flush_dcache && lcd_dirty_start != lcd_dirty_end)
+		flush_dcache_range(
+			(u32)lcd_dirty_start & ~(ARCH_DMA_MINALIGN - 1),
+			ALIGN((u32)lcd_dirty_end, ARCH_DMA_MINALIGN));
+	lcd_dirty_start = lcd_dirty_end;
 #elif defined(CONFIG_SANDBOX) && defined(CONFIG_VIDEO_SANDBOX_SDL)
 	static ulong last_sync;
 
@@ -167,10 +195,55 @@ void lcd_set_flush_dcache(int flush)
 
 /*----------------------------------------------------------------------*/
 
+#ifdef CONFIG_LCD_HW_SCROLL
+/*
+ * The framebuffer holds two screens. Scroll by moving the start of the
+ * display down it, so that only the newly exposed rows need clearing. When
+ * the display reaches the end, copy the rows still shown back to the start;
+ * this happens once per screen of scrolling rather than for every line.
+ */
+static int console_scroll_pan(int rows)
+{
+	ulong screen = lcd_line_length * panel_info.vl_row;
+	ulong step = CONSOLE_ROW_SIZE * rows;
+	uchar *top = (uchar *)lcd_base + step;
+	uchar *fb_start = lcd_fb_start;
+
+	/* A logo above the console must stay put, so copy instead */
+	if (!lcd_can_pan || lcd_console_address != lcd_base)
+		return -ENOSYS;
+
+	if (top + screen > fb_start + 2 * screen) {
+		memcpy(fb_start, top, CONSOLE_SIZE - step);
+		lcd_mark_dirty(fb_start, CONSOLE_SIZE - step);
+		top = fb_start;
+	}
+
+	/* Clear the new rows and anything below the console */
+	memset(top + CONSOLE_SIZE - step, COLOR_MASK(lcd_color_bg),
+	       screen - CONSOLE_SIZE + step);
+	lcd_mark_dirty(top + CONSOLE_SIZE - step,
+		       screen - CONSOLE_SIZE + step);
+
+	lcd_base = top;
+	lcd_console_address = top;
+	lcd_sync();
+
+	return lcd_pan_display((top - fb_start) / lcd_line_length);
+}
+#endif
+
 static void console_scrollup(void)
 {
 	const int rows = CONFIG_CONSOLE_SCROLL_LINES;
 
+#ifdef CONFIG_LCD_HW_SCROLL
+	if (!console_scroll_pan(rows)) {
+		console_row -= rows;
+		return;
+	}
+#endif
+
 	/* Copy up rows ignoring those that will be overwritten */
 	memcpy(CONSOLE_ROW_FIRST,
 	       lcd_console_address + CONSOLE_ROW_SIZE * rows,
@@ -181,6 +254,7 @@ static void console_scrollup(void)
 		COLOR_MASK(lcd_color_bg),
 		CONSOLE_ROW_SIZE * rows);
 
+	lcd_mark_dirty(lcd_console_address, CONSOLE_SIZE);
 	lcd_sync();
 	console_row -= rows;
 }
@@ -299,6 +373,7 @@ static void lcd_drawchars(ushort x, ushort y, uchar *str, int count)
 #endif
 
 	dest = (uchar *)(lcd_base + y * lcd_line_length + x * (1 << LCD_BPP) / 8);
+	lcd_mark_dirty(dest, VIDEO_FONT_HEIGHT * lcd_line_length);
 
 	for (row = 0; row < VIDEO_FONT_HEIGHT; ++row, dest += lcd_line_length) {
 		uchar *s = str;
@@ -411,6 +486,15 @@ __weak int lcd_get_size(int *line_length)
 	return *line_length * panel_info.vl_row;
 }
 
+/*
+ * Drivers whose controller can show the framebuffer from any line provide
+ * this, for CONFIG_LCD_HW_SCROLL. Otherwise we scroll by copying.
+ */
+__weak int lcd_pan_display(int yoffset)
+{
+	return -ENOSYS;
+}
+
 int drv_lcd_init(void)
 {
 	struct stdio_dev lcddev;
@@ -462,6 +546,13 @@ void lcd_clear(void)
 	lcd_setbgcolor(CONSOLE_COLOR_BLACK);
 #endif	/* CONFIG_SYS_WHITE_ON_BLACK */
 
+#ifdef CONFIG_LCD_HW_SCROLL
+	if (lcd_can_pan && lcd_base != lcd_fb_start) {
+		lcd_base = lcd_fb_start;
+		lcd_pan_display(0);
+	}
+#endif
+
 #ifdef	LCD_TEST_PATTERN
 	test_pattern();
 #else
@@ -470,6 +561,8 @@ void lcd_clear(void)
 		COLOR_MASK(lcd_getbgcolor()),
 		lcd_line_length * panel_info.vl_row);
 #endif
+	lcd_mark_dirty(lcd_base, lcd_line_length * panel_info.vl_row);
+
 	/* Paint the logo and retrieve LCD base address */
 	debug("[LCD] Drawing the logo...\n");
 	lcd_console_address = lcd_logo();
@@ -514,8 +607,14 @@ static int lcd_init(void *lcdbase)
 
 	lcd_get_size(&lcd_line_length);
 	lcd_is_enabled = 1;
+#ifdef CONFIG_LCD_HW_SCROLL
+	lcd_fb_start = lcd_base;
+#endif
 	lcd_clear();
 	lcd_enable();
+#ifdef CONFIG_LCD_HW_SCROLL
+	lcd_can_pan = !lcd_pan_display(0);
+#endif
 
 	/* Initialize the console */
 	console_col = 0;
@@ -548,6 +647,10 @@ ulong lcd_setmem(ulong addr)
 		panel_info.vl_row, NBITS(panel_info.vl_bpix));
 
 	size = lcd_get_size(&line_length);
+#ifdef CONFIG_LCD_HW_SCROLL
+	/* Leave room to scroll through a second screen */
+	size *= 2;
+#endif
 
 	/* Round up to nearest full page, or MMU section if defined */
 	size = ALIGN(size, CONFIG_LCD_ALIGNMENT);
@@ -704,6 +807,7 @@ void bitmap_plot(int x, int y)
 	}
 
 	WATCHDOG_RESET();
+	lcd_mark_dirty(lcd_base, lcd_line_length * panel_info.vl_row);
 	lcd_sync();
 }
 #else
@@ -891,11 +995,46 @@ static inline void fb_put_word(uchar **fb, uchar **from)
 #endif
 #endif /* CONFIG_BMP_16BPP */
 
-int lcd_display_bitmap(ulong bmp_image, int x, int y)
+/* Load a BMP palette into the LCD colour map, and return the map */
+static ushort *lcd_set_cmap(bmp_color_table_entry_t *table, unsigned colors)
 {
+	ushort *cmap_base = NULL;
 #if !defined(CONFIG_MCC200)
-	ushort *cmap = NULL;
+	/* MCC200 LCD doesn't need CMAP, supports 1bpp b&w only */
+	ushort *cmap;
+	unsigned i;
+
+	cmap = configuration_get_cmap();
+	cmap_base = cmap;
+
+	/* Set color map */
+	for (i = 0; i < colors; ++i) {
+		bmp_color_table_entry_t cte = table[i];
+#if !defined(CONFIG_ATMEL_LCD)
+		ushort colreg =
+			( ((cte.red)   << 8) & 0xf800) |
+			( ((cte.green) << 3) & 0x07e0) |
+			( ((cte.blue)  >> 3) & 0x001f) ;
+#ifdef CONFIG_SYS_INVERT_COLORS
+		*cmap = 0xffff - colreg;
+#else
+		*cmap = colreg;
 #endif
+#if defined(CONFIG_MPC823)
+		cmap--;
+#else
+		cmap++;
+#endif
+#else /* CONFIG_ATMEL_LCD */
+		lcd_setcolreg(i, cte.red, cte.green, cte.blue);
+#endif
+	}
+#endif
+	return cmap_base;
+}
+
+int lcd_display_bitmap(ulong bmp_image, int x, int y)
+{
 	ushort *cmap_base = NULL;
 	ushort i, j;
 	uchar *fb;
@@ -938,36 +1077,8 @@ int lcd_display_bitmap(ulong bmp_image, int x, int y)
 	debug("Display-bmp: %d x %d  with %d colors\n",
 		(int)width, (int)height, (int)colors);
 
-#if !defined(CONFIG_MCC200)
-	/* MCC200 LCD doesn't need CMAP, supports 1bpp b&w only */
-	if (bmp_bpix == 8) {
-		cmap = configuration_get_cmap();
-		cmap_base = cmap;
-
-		/* Set color map */
-		for (i = 0; i < colors; ++i) {
-			bmp_color_table_entry_t cte = bmp->color_table[i];
-#if !defined(CONFIG_ATMEL_LCD)
-			ushort colreg =
-				( ((cte.red)   << 8) & 0xf800) |
-				( ((cte.green) << 3) & 0x07e0) |
-				( ((cte.blue)  >> 3) & 0x001f) ;
-#ifdef CONFIG_SYS_INVERT_COLORS
-			*cmap = 0xffff - colreg;
-#else
-			*cmap = colreg;
-#endif
-#if defined(CONFIG_MPC823)
-			cmap--;
-#else
-			cmap++;
-#endif
-#else /* CONFIG_ATMEL_LCD */
-			lcd_setcolreg(i, cte.red, cte.green, cte.blue);
-#endif
-		}
-	}
-#endif
+	if (bmp_bpix == 8)
+		cmap_base = lcd_set_cmap(bmp->color_table, colors);
 	/*
 	 *  BMP format for Monochrome assumes that the state of a
 	 * pixel is described on a per Bit basis, not per Byte.
@@ -1068,9 +1179,179 @@ int lcd_display_bitmap(ulong bmp_image, int x, int y)
 		break;
 	};
 
+	lcd_mark_dirty(lcd_base, lcd_line_length * panel_info.vl_row);
 	lcd_sync();
 	return 0;
 }
+
+#ifdef CONFIG_LCD_BMP_GZIP
+/*
+ * Inflate the next len bytes of a gzipped BMP to dst, or throw them away
+ * if dst is NULL. inflate() only reads the avail_in bytes of compressed
+ * data it was given, so a truncated or corrupt image ends in an error
+ * rather than a read past the end of it.
+ */
+static int lcd_gzip_read(z_stream *s, void *dst, ulong len)
+{
+	uchar skip[64];
+	int ret;
+
+	while (len) {
+		s->next_out = dst ? dst : skip;
+		s->avail_out = dst ? len : min(len, (ulong)sizeof(skip));
+		len -= s->avail_out;
+		while (s->avail_out) {
+			ret = inflate(s, Z_SYNC_FLUSH);
+			if (ret == Z_STREAM_END && !s->avail_out)
+				break;
+			if (ret != Z_OK)
+				return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/* Row formats that inflate straight into the framebuffer */
+static int lcd_bmp_gzip_supported(unsigned bmp_bpix, unsigned bpix)
+{
+	switch (bmp_bpix) {
+	case 8:
+		return bpix == 8 || bpix == 16;
+#if defined(CONFIG_BMP_16BPP) && !defined(CONFIG_ATMEL_LCD_BGR555)
+	case 16:
+		return bpix == 16;
+#endif
+#if defined(CONFIG_BMP_32BPP)
+	case 32:
+		return bpix == 32;
+#endif
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Display a gzipped BMP. Each row is inflated straight into its place in
+ * the framebuffer, so there is no need for a buffer to hold the whole
+ * image. 8bpp rows for a 16bpp panel are inflated into the right half of
+ * the framebuffer row and expanded through the colour map from the left,
+ * which never overwrites a pixel before it is read. size is the length of
+ * the compressed image, which inflate() is never allowed to read past.
+ */
+int lcd_display_bitmap_gzip(ulong bmp_image, ulong size, int x, int y)
+{
+	uchar *src = map_sysmem(bmp_image, 0);
+	bmp_color_table_entry_t palette[256];
+	bmp_header_t hdr;
+	ushort *cmap_base = NULL;
+	ulong width, height, offset, row_size, byte_width;
+	unsigned long pwidth = panel_info.vl_col;
+	unsigned bpix, bmp_bpix, colors;
+	uchar *fb, *bmap;
+	z_stream s;
+	int start, ret = 1;
+	ulong i, j;
+
+	start = gzip_parse_header(src, size);
+	if (start < 0)
+		return 1;
+
+	s.zalloc = gzalloc;
+	s.zfree = gzfree;
+	if (inflateInit2(&s, -MAX_WBITS) != Z_OK)
+		return 1;
+	s.next_in = src + start;
+	s.avail_in = size - start;
+
+	if (lcd_gzip_read(&s, &hdr, sizeof(hdr)) ||
+	    !(hdr.signature[0] == 'B' && hdr.signature[1] == 'M')) {
+		printf("Error: no valid bmp image at %lx\n", bmp_image);
+		goto out;
+	}
+
+	width = get_unaligned_le32(&hdr.width);
+	height = get_unaligned_le32(&hdr.height);
+	bmp_bpix = get_unaligned_le16(&hdr.bit_count);
+	offset = get_unaligned_le32(&hdr.data_offset);
+	bpix = NBITS(panel_info.vl_bpix);
+
+	if (!lcd_bmp_gzip_supported(bmp_bpix, bpix) ||
+	    get_unaligned_le32(&hdr.compression) != BMP_BI_RGB ||
+	    offset < sizeof(hdr)) {
+		printf("Error: %d bit/pixel mode, but BMP has %d bit/pixel\n",
+		       bpix, bmp_bpix);
+		goto out;
+	}
+
+	debug("Display-bmp-gzip: %d x %d  with %d bpp\n",
+	      (int)width, (int)height, bmp_bpix);
+
+	/* The palette runs from the header to the image data */
+	offset -= sizeof(hdr);
+	if (bmp_bpix == 8) {
+		colors = min(offset / sizeof(palette[0]),
+			     (ulong)ARRAY_SIZE(palette));
+		memset(palette, '\0', sizeof(palette));
+		if (lcd_gzip_read(&s, palette, colors * sizeof(palette[0])))
+			goto short_image;
+		offset -= colors * sizeof(palette[0]);
+		cmap_base = lcd_set_cmap(palette, ARRAY_SIZE(palette));
+	}
+	if (lcd_gzip_read(&s, NULL, offset))
+		goto short_image;
+
+	row_size = ALIGN(width * bmp_bpix / 8, BMP_DATA_ALIGN);
+
+#ifdef CONFIG_SPLASH_SCREEN_ALIGN
+	splash_align_axis(&x, pwidth, width);
+	splash_align_axis(&y, panel_info.vl_row, height);
+#endif /* CONFIG_SPLASH_SCREEN_ALIGN */
+
+	if ((x + width) > pwidth)
+		width = pwidth - x;
+	if ((y + height) > panel_info.vl_row)
+		height = panel_info.vl_row - y;
+
+	byte_width = width * bmp_bpix / 8;
+	fb = (uchar *)(lcd_base +
+		(y + height - 1) * lcd_line_length + x * bpix / 8);
+
+	/* BMP rows go from the bottom of the image to the top */
+	for (i = 0; i < height; ++i) {
+		WATCHDOG_RESET();
+		bmap = bpix > bmp_bpix ? fb + byte_width : fb;
+		if (lcd_gzip_read(&s, bmap, byte_width))
+			goto short_image;
+		if (i != height - 1 &&
+		    lcd_gzip_read(&s, NULL, row_size - byte_width))
+			goto short_image;
+
+		if (bpix > bmp_bpix) {
+			for (j = 0; j < width; j++)
+				((ushort *)fb)[j] = cmap_base[bmap[j]];
+		}
+#if defined(CONFIG_MPC823) || defined(CONFIG_MCC200)
+		else if (bpix == 8) {
+			for (j = 0; j < width; j++)
+				fb[j] = 255 - fb[j];
+		}
+#endif
+		fb -= lcd_line_length;
+	}
+	ret = 0;
+
+short_image:
+	if (ret)
+		printf("Error: bmp image at %lx is truncated\n", bmp_image);
+	lcd_mark_dirty(lcd_base, lcd_line_length * panel_info.vl_row);
+	lcd_sync();
+out:
+	inflateEnd(&s);
+
+	return ret;
+}
+#endif /* CONFIG_LCD_BMP_GZIP */
 #endif
 
 static void *lcd_logo(void)
@@ -1179,7 +1460,8 @@ static int lcd_dt_simplefb_configure_node(void *blob, int off)
 
 	stride = panel_info.vl_col * 2;
 
-	cells[0] = cpu_to_fdt32(gd->fb_base);
+	/* This is where the display starts, after any scrolling */
+	cells[0] = cpu_to_fdt32(map_to_sysmem(lcd_base));
 	cells[1] = cpu_to_fdt32(stride * panel_info.vl_row);
 	ret = fdt_setprop(blob, off, "reg", cells, sizeof(cells[0]) * 2);
 	if (ret < 0)
@@ -10,6 +10,7 @@
  */
 
 #include <common.h>
+#include <errno.h>
 #include <spl.h>
 #include <asm/u-boot.h>
 #include <fat.h>
@@ -70,6 +71,31 @@ end:
 	return (err <= 0);
 }
 
+#ifdef CONFIG_SPL_FIT_SUPPORT
+static ulong spl_fat_fit_read(struct fit_loader *load, ulong offset,
+			      ulong size, void *buf)
+{
+	long ret;
+
+	/* A zero length would read the whole file */
+	if (!size)
+		return 0;
+	ret = file_fat_read_at(load->priv, offset, buf, size);
+
+	return ret < 0 ? 0 : ret;
+}
+
+static int spl_load_fit_fat(const char *filename)
+{
+	struct fit_loader load;
+
+	load.read = spl_fat_fit_read;
+	load.priv = (void *)filename;
+
+	return spl_load_fit(&load);
+}
+#endif
+
 #ifdef CONFIG_SPL_OS_BOOT
 int spl_load_image_fat_os(block_dev_desc_t *block_dev, int partition)
 {
@@ -79,6 +105,13 @@ int spl_load_image_fat_os(block_dev_desc_t *block_dev, int partition)
 	if (err)
 		return err;
 
+#ifdef CONFIG_SPL_FIT_SUPPORT
+	/* A FIT holds the kernel and device tree, so no args are read */
+	err = spl_load_fit_fat(CONFIG_SPL_FAT_LOAD_KERNEL_NAME);
+	if (err != -ENOENT)
+		return err;
+#endif
+
 	err = file_fat_read(CONFIG_SPL_FAT_LOAD_ARGS_NAME,
 			    (void *)CONFIG_SYS_SPL_ARGS_ADDR, 0);
 	if (err <= 0) {
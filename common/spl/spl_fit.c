@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * Load a Linux kernel and its device tree from a FIT, for Falcon mode
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <image.h>
+#include <spl.h>
+
+/* Where the FIT itself is read to; U-Boot is not loaded in Falcon mode */
+#ifndef CONFIG_SPL_FIT_ADDR
+#define CONFIG_SPL_FIT_ADDR	CONFIG_SYS_TEXT_BASE
+#endif
+#ifndef CONFIG_SPL_FIT_MAX_SIZE
+#define CONFIG_SPL_FIT_MAX_SIZE	(1 << 20)
+#endif
+#ifndef CONFIG_SYS_BOOTM_LEN
+#define CONFIG_SYS_BOOTM_LEN	0x800000	/* use 8MByte as default max */
+#endif
+
+#ifdef CONFIG_SPL_FIT_VERIFY
+#define SPL_FIT_VERIFY		1
+#else
+#define SPL_FIT_VERIFY		0
+#endif
+
+int spl_load_fit(struct fit_loader *load)
+{
+	void *fit = (void *)CONFIG_SPL_FIT_ADDR;
+	ulong addr, len, entry;
+	int cfg_noffset, noffset;
+	uint8_t os;
+
+	/* Not a FIT: let the caller try a legacy image instead */
+	if (load->read(load, 0, sizeof(u32), fit) != sizeof(u32) ||
+	    fdt_magic(fit) != FDT_MAGIC)
+		return -ENOENT;
+
+	/* SPL has no record of its memory use, so only the size is limited */
+	load->max_size = CONFIG_SYS_BOOTM_LEN;
+	load->lmb = NULL;
+
+	/* With 'mkimage -E' this is small, and the images are read later */
+	if (fit_stream_header(load, fit, CONFIG_SPL_FIT_MAX_SIZE))
+		return -EIO;
+
+	cfg_noffset = fit_conf_get_node(fit, NULL);
+	if (cfg_noffset < 0) {
+		puts("Could not find configuration node\n");
+		return -EINVAL;
+	}
+	printf("   Using '%s' configuration\n",
+	       fit_get_name(fit, cfg_noffset, NULL));
+
+	/* SPL does not decompress or relocate the kernel */
+	noffset = fit_conf_get_prop_node(fit, cfg_noffset, FIT_KERNEL_PROP);
+	if (noffset < 0 || !fit_image_check_type(fit, noffset, IH_TYPE_KERNEL) ||
+	    !fit_image_check_comp(fit, noffset, IH_COMP_NONE) ||
+	    fit_image_get_os(fit, noffset, &os) ||
+	    fit_image_get_entry(fit, noffset, &entry)) {
+		puts("Unsupported kernel image in FIT\n");
+		return -EINVAL;
+	}
+	addr = 0;
+	if (fit_stream_image(load, fit, noffset, SPL_FIT_VERIFY, &addr, &len))
+		return -EIO;
+	spl_image.name = fit_get_name(fit, noffset, NULL);
+	spl_image.os = os;
+	spl_image.load_addr = addr;
+	spl_image.entry_point = entry;
+	spl_image.size = len;
+
+	/* The kernel is passed the device tree as it is, without fixups */
+	noffset = fit_conf_get_prop_node(fit, cfg_noffset, FIT_FDT_PROP);
+	if (noffset < 0) {
+		puts("Could not find FDT image in FIT\n");
+		return -EINVAL;
+	}
+	addr = 0;
+	if (fit_stream_image(load, fit, noffset, SPL_FIT_VERIFY, &addr, &len))
+		return -EIO;
+	spl_image.arg = (void *)addr;
+
+	return 0;
+}
@@ -7,6 +7,7 @@
  * SPDX-License-Identifier:	GPL-2.0+
  */
 #include <common.h>
+#include <errno.h>
 #include <spl.h>
 #include <asm/u-boot.h>
 #include <mmc.h>
@@ -53,9 +54,69 @@ end:
 	return (err == 0);
 }
 
+#ifdef CONFIG_SPL_FIT_SUPPORT
+struct mmc_fit_raw {
+	struct mmc *mmc;
+	unsigned long sector;
+};
+
+static ulong mmc_fit_read(struct fit_loader *load, ulong offset, ulong size,
+			  void *buf)
+{
+	struct mmc_fit_raw *raw = load->priv;
+	struct mmc *mmc = raw->mmc;
+	ALLOC_CACHE_ALIGN_BUFFER(u8, bounce, MMC_MAX_BLOCK_LEN);
+	ulong blksz = mmc->read_bl_len;
+	ulong done, count, skip;
+	lbaint_t blk, blks;
+
+	/* Whole blocks go straight to buf, partial ones via the bounce */
+	for (done = 0; done < size; done += count) {
+		blk = raw->sector + (offset + done) / blksz;
+		skip = (offset + done) % blksz;
+		count = size - done;
+		if (skip || count < blksz) {
+			if (mmc->block_dev.block_read(0, blk, 1, bounce) != 1)
+				break;
+			count = min(count, blksz - skip);
+			memcpy(buf + done, bounce + skip, count);
+		} else {
+			blks = count / blksz;
+			if (mmc->block_dev.block_read(0, blk, blks,
+						      buf + done) != blks)
+				break;
+			count = blks * blksz;
+		}
+	}
+
+	return done;
+}
+
+static int mmc_load_fit_raw(struct mmc *mmc, unsigned long sector)
+{
+	struct mmc_fit_raw raw;
+	struct fit_loader load;
+
+	raw.mmc = mmc;
+	raw.sector = sector;
+	load.read = mmc_fit_read;
+	load.priv = &raw;
+
+	return spl_load_fit(&load);
+}
+#endif
+
 #ifdef CONFIG_SPL_OS_BOOT
 static int mmc_load_image_raw_os(struct mmc *mmc)
 {
+#ifdef CONFIG_SPL_FIT_SUPPORT
+	int ret;
+
+	/* A FIT holds the kernel and device tree, so no args are read */
+	ret = mmc_load_fit_raw(mmc, CONFIG_SYS_MMCSD_RAW_MODE_KERNEL_SECTOR);
+	if (ret != -ENOENT)
+		return ret;
+#endif
 	if (!mmc->block_dev.block_read(0,
 				       CONFIG_SYS_MMCSD_RAW_MODE_ARGS_SECTOR,
 				       CONFIG_SYS_MMCSD_RAW_MODE_ARGS_SECTORS,
@@ -67,6 +67,9 @@ static void drv_system_init (void)
 	dev.flags = DEV_FLAGS_OUTPUT | DEV_FLAGS_INPUT | DEV_FLAGS_SYSTEM;
 	dev.putc = serial_putc;
 	dev.puts = serial_puts;
+#ifdef CONFIG_CONSOLE_TX_BUFFER
+	dev.puts_nowait = serial_puts_nowait;
+#endif
 	dev.getc = serial_getc;
 	dev.tstc = serial_tstc;
 	stdio_register (&dev);
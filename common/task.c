@@ -0,0 +1,85 @@
+/*
+ * Cooperative task scheduler
+ *
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <task.h>
+#include <dm/root.h>
+
+/* Tasks which are running, in the order in which they will next run */
+static LIST_HEAD(task_list);
+
+/* Set while a task is running, to prevent tasks from being nested */
+static int in_task;
+
+int task_start(struct task *task)
+{
+	if (task_running(task))
+		return -EBUSY;
+
+	task->result = -EINPROGRESS;
+	task->steps = 0;
+	list_add_tail(&task->node, &task_list);
+	debug("%s: %s\n", __func__, task->name);
+
+	return 0;
+}
+
+/**
+ * task_step() - Run the next step of a task
+ *
+ * If the task finishes, it is removed from the task list and its result
+ * recorded.
+ *
+ * @task: Task to run
+ */
+static void task_step(struct task *task)
+{
+	int was_in_task = in_task;
+	int ret;
+
+	in_task = 1;
+	task->steps++;
+	ret = task->run(task);
+	in_task = was_in_task;
+
+	if (ret != -EAGAIN) {
+		debug("%s: %s finished after %lu steps: %d\n", __func__,
+		      task->name, task->steps, ret);
+		task->result = ret;
+		list_del_init(&task->node);
+	}
+}
+
+void task_yield(void)
+{
+	struct task *task;
+
+	if (in_task)
+		return;
+
+#ifdef CONFIG_DM_BACKGROUND_PROBE
+	in_task = 1;
+	dm_probe_poll_pending(NULL);
+	in_task = 0;
+#endif
+	if (list_empty(&task_list))
+		return;
+
+	task = list_first_entry(&task_list, struct task, node);
+	list_move_tail(&task->node, &task_list);
+	task_step(task);
+}
+
+int task_wait(struct task *task)
+{
+	while (task_running(task))
+		task_step(task);
+
+	return task->result;
+}
@@ -19,6 +19,7 @@
 #include <libata.h>
 #include <linux/ctype.h>
 #include <ahci.h>
+#include <task.h>
 
 static int ata_io_flush(u8 port);
 
@@ -101,8 +102,10 @@ static int waiting_for_cmd_completed(volatile u8 *offset,
 	int i;
 	u32 status;
 
-	for (i = 0; ((status = readl(offset)) & sign) && i < timeout_msec; i++)
+	for (i = 0; ((status = readl(offset)) & sign) && i < timeout_msec; i++) {
+		task_yield();
 		msleep(1);
+	}
 
 	return (i < timeout_msec) ? 0 : -1;
 }
@@ -12,6 +12,7 @@
 
 #include <common.h>
 #include <malloc.h>
+#include <task.h>
 #include <linux/ctype.h>
 #include <asm/errno.h>
 #include <asm/io.h>
@@ -93,8 +94,10 @@ static int waiting_for_cmd_completed(u8 *offset,
 
 	for (i = 0;
 		((status = readl(offset)) & sign) && i < timeout_msec;
-		++i)
+		++i) {
+		task_yield();
 		mdelay(1);
+	}
 
 	return (i < timeout_msec) ? 0 : -1;
 }
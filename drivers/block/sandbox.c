@@ -11,6 +11,8 @@
 #include <malloc.h>
 #include <sandboxblockdev.h>
 #include <asm/errno.h>
+#include <asm/getopt.h>
+#include <asm/state.h>
 
 static struct host_block_dev host_devices[CONFIG_HOST_MAX_DEVICES];
 
@@ -106,6 +108,16 @@ int host_get_dev_err(int dev, block_dev_desc_t **blk_devp)
 	if (!host_dev)
 		return -ENODEV;
 
+	/* Bind on first use a file given with --host */
+	if (!host_dev->blk_dev.priv) {
+		struct sandbox_state *state = state_get_current();
+		const char *fname = state->host_fname[dev];
+
+		state->host_fname[dev] = NULL;
+		if (fname)
+			host_dev_bind(dev, (char *)fname);
+	}
+
 	if (!host_dev->blk_dev.priv)
 		return -ENOENT;
 
@@ -122,3 +134,19 @@ block_dev_desc_t *host_get_dev(int dev)
 
 	return blk_dev;
 }
+
+static int sandbox_cmdline_cb_host(struct sandbox_state *state,
+				   const char *arg)
+{
+	unsigned long dev;
+	char *end;
+
+	dev = simple_strtoul(arg, &end, 10);
+	if (end == arg || *end != ':' || dev >= CONFIG_HOST_MAX_DEVICES) {
+		printf("Invalid host device '%s'\n", arg);
+		return 1;
+	}
+	state->host_fname[dev] = end + 1;
+	return 0;
+}
+SANDBOX_CMDLINE_OPT(host, 1, "bind a host block device: <dev>:<file>");
@@ -15,6 +15,7 @@
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/platdata.h>
+#include <dm/root.h>
 #include <dm/uclass.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
@@ -150,7 +151,7 @@ int device_unbind(struct device *dev)
 	if (!dev)
 		return -EINVAL;
 
-	if (dev->flags & DM_FLAG_ACTIVATED)
+	if (dev->flags & (DM_FLAG_ACTIVATED | DM_FLAG_PROBE_PENDING))
 		return -EINVAL;
 
 	drv = dev->driver;
@@ -200,7 +201,32 @@ static void device_free(struct device *dev)
 	}
 }
 
-int device_probe(struct device *dev)
+/**
+ * device_probe_done() - Activate a device once its driver has probed it
+ * @dev:	Device that has been probed
+ * @return 0 on success, -ve on error
+ */
+static int device_probe_done(struct device *dev)
+{
+	int ret;
+
+	dev->flags |= DM_FLAG_ACTIVATED;
+
+	ret = uclass_post_probe_device(dev);
+	if (ret) {
+		dev->flags &= ~DM_FLAG_ACTIVATED;
+		if (device_remove(dev)) {
+			dm_warn("%s: Device '%s' failed to remove on error path\n",
+				__func__, dev->name);
+		}
+		device_free(dev);
+		return ret;
+	}
+
+	return 0;
+}
+
+int device_probe_start(struct device *dev)
 {
 	struct driver *drv;
 	int size = 0;
@@ -209,7 +235,7 @@ int device_probe(struct device *dev)
 	if (!dev)
 		return -EINVAL;
 
-	if (dev->flags & DM_FLAG_ACTIVATED)
+	if (dev->flags & (DM_FLAG_ACTIVATED | DM_FLAG_PROBE_PENDING))
 		return 0;
 
 	drv = dev->driver;
@@ -259,26 +285,63 @@ int device_probe(struct device *dev)
 			goto fail;
 	}
 
-	dev->flags |= DM_FLAG_ACTIVATED;
-
-	ret = uclass_post_probe_device(dev);
-	if (ret) {
-		dev->flags &= ~DM_FLAG_ACTIVATED;
-		goto fail_uclass;
+	/* The driver will finish the probe in the background */
+	if (drv->probe_poll) {
+		dev->flags |= DM_FLAG_PROBE_PENDING;
+		return 0;
 	}
 
-	return 0;
-fail_uclass:
-	if (device_remove(dev)) {
-		dm_warn("%s: Device '%s' failed to remove on error path\n",
-			__func__, dev->name);
-	}
+	return device_probe_done(dev);
 fail:
 	device_free(dev);
 
 	return ret;
 }
 
+int device_probe_poll(struct device *dev)
+{
+	int ret;
+
+	if (!dev)
+		return -EINVAL;
+
+	if (!(dev->flags & DM_FLAG_PROBE_PENDING))
+		return 0;
+
+	ret = dev->driver->probe_poll(dev);
+	if (ret == -EAGAIN)
+		return ret;
+
+	dev->flags &= ~DM_FLAG_PROBE_PENDING;
+	if (ret) {
+		dm_warn("%s: Device '%s' failed to probe: %d\n", __func__,
+			dev->name, ret);
+		device_free(dev);
+		return ret;
+	}
+
+	return device_probe_done(dev);
+}
+
+int device_probe(struct device *dev)
+{
+	int ret;
+
+	ret = device_probe_start(dev);
+	if (ret)
+		return ret;
+
+	/* Wait for a background probe, letting the others progress too */
+	while (dev->flags & DM_FLAG_PROBE_PENDING) {
+		ret = device_probe_poll(dev);
+		if (ret != -EAGAIN)
+			return ret;
+		dm_probe_poll_pending(dev);
+	}
+
+	return 0;
+}
+
 int device_remove(struct device *dev)
 {
 	struct driver *drv;
@@ -287,6 +350,10 @@ int device_remove(struct device *dev)
 	if (!dev)
 		return -EINVAL;
 
+	/* Let any background probe finish before removing the device */
+	if (dev->flags & DM_FLAG_PROBE_PENDING)
+		device_probe(dev);
+
 	if (!(dev->flags & DM_FLAG_ACTIVATED))
 		return 0;
 
@@ -9,6 +9,7 @@
 
 #include <common.h>
 #include <errno.h>
+#include <malloc.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/platdata.h>
@@ -16,6 +17,8 @@
 #include <dm/util.h>
 #include <linux/compiler.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 struct driver *lists_driver_lookup_name(const char *name)
 {
 	struct driver *drv =
@@ -116,6 +119,150 @@ static int driver_check_compatible(const void *blob, int offset,
 	return -ENOENT;
 }
 
+#ifdef CONFIG_OF_INDEX
+/*
+ * Every compatible string listed by a driver, sorted by string and then by
+ * driver, so that binding a node needs a few binary searches rather than a
+ * device tree lookup for each string of each driver. It is used along with
+ * the device tree index, so is built on first use after relocation.
+ */
+struct driver_compat {
+	const char *compat;
+	struct driver *driver;
+};
+
+static struct driver_compat *driver_compats;
+static int num_driver_compats;
+
+static int compare_driver_compat(const void *a, const void *b)
+{
+	const struct driver_compat *ca = a, *cb = b;
+	int ret;
+
+	ret = strcmp(ca->compat, cb->compat);
+	if (ret)
+		return ret;
+	if (ca->driver != cb->driver)
+		return ca->driver < cb->driver ? -1 : 1;
+
+	return 0;
+}
+
+static int driver_compats_init(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct device_id *of_match;
+	struct driver *entry;
+	int count = 0;
+
+	for (entry = driver; entry != driver + n_ents; entry++)
+		for (of_match = entry->of_match; of_match &&
+		     of_match->compatible; of_match++)
+			count++;
+
+	driver_compats = malloc(count * sizeof(*driver_compats));
+	if (!driver_compats)
+		return -ENOMEM;
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match; of_match &&
+		     of_match->compatible; of_match++) {
+			driver_compats[num_driver_compats].compat =
+				of_match->compatible;
+			driver_compats[num_driver_compats++].driver = entry;
+		}
+	}
+	qsort(driver_compats, num_driver_compats, sizeof(*driver_compats),
+	      compare_driver_compat);
+
+	return 0;
+}
+
+/**
+ * driver_next_compatible() - Find the next driver for a compatible string
+ *
+ * @compat:	Compatible string to match
+ * @after:	Only return drivers after this one in the linker list
+ * @return first matching driver after @after, or NULL if none
+ */
+static struct driver *driver_next_compatible(const char *compat,
+					     struct driver *after)
+{
+	struct driver_compat *entry;
+	int lo = 0, hi = num_driver_compats;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		int ret;
+
+		entry = &driver_compats[mid];
+		ret = strcmp(entry->compat, compat);
+		if (ret < 0 || (!ret && entry->driver <= after))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	entry = &driver_compats[lo];
+	if (lo == num_driver_compats || strcmp(entry->compat, compat))
+		return NULL;
+
+	return entry->driver;
+}
+
+static int lists_bind_fdt_index(struct device *parent, const void *blob,
+				int offset)
+{
+	struct driver *entry, *next;
+	const char *compat, *str;
+	struct device *dev;
+	const char *name;
+	int result = 0;
+	int len, ret;
+
+	if (!driver_compats) {
+		ret = driver_compats_init();
+		if (ret)
+			return ret;
+	}
+	compat = fdt_getprop(blob, offset, "compatible", &len);
+	if (!compat) {
+		if (len == -FDT_ERR_NOTFOUND)
+			return 0;
+		dm_warn("Device tree error at offset %d\n", offset);
+		return -EINVAL;
+	}
+
+	/*
+	 * Bind every matching driver, in linker-list order as a search
+	 * through all drivers would, by taking the earliest driver after the
+	 * last one bound that matches any of the node's strings.
+	 */
+	for (entry = NULL;; entry = next) {
+		next = NULL;
+		for (str = compat; str < compat + len;
+		     str += strnlen(str, compat + len - str) + 1) {
+			struct driver *drv = driver_next_compatible(str, entry);
+
+			if (drv && (!next || drv < next))
+				next = drv;
+		}
+		if (!next)
+			break;
+
+		name = fdt_get_name(blob, offset, NULL);
+		dm_dbg("   - found match at '%s'\n", next->name);
+		ret = device_bind(parent, next, name, NULL, offset, &dev);
+		if (ret) {
+			dm_warn("No match for driver '%s'\n", next->name);
+			if (!result || ret != -ENOENT)
+				result = ret;
+		}
+	}
+
+	return result;
+}
+#endif
+
 int lists_bind_fdt(struct device *parent, const void *blob, int offset)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
@@ -127,6 +274,11 @@ int lists_bind_fdt(struct device *parent, const void *blob, int offset)
 	int ret;
 
 	dm_dbg("bind node %s\n", fdt_get_name(blob, offset, NULL));
+#ifdef CONFIG_OF_INDEX
+	/* Without a device tree index, fall back to checking each driver */
+	if (gd->fdt_index)
+		return lists_bind_fdt_index(parent, blob, offset);
+#endif
 	for (entry = driver; entry != driver + n_ents; entry++) {
 		ret = driver_check_compatible(blob, offset, entry->of_match);
 		if (ret == -ENOENT) {
@@ -14,6 +14,7 @@
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/platdata.h>
+#include <dm/root.h>
 #include <dm/uclass.h>
 #include <dm/util.h>
 #include <linux/list.h>
@@ -66,6 +67,44 @@ int dm_scan_platdata(void)
 	return 0;
 }
 
+int dm_probe_background(void)
+{
+	struct device *dev;
+	struct uclass *uc;
+	int ret = 0, err;
+
+	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
+		list_for_each_entry(dev, &uc->dev_head, uclass_node) {
+			if (!dev->driver->probe_poll)
+				continue;
+			err = device_probe_start(dev);
+			if (err && !ret)
+				ret = err;
+		}
+	}
+
+	return ret;
+}
+
+int dm_probe_poll_pending(struct device *skip)
+{
+	struct device *dev;
+	struct uclass *uc;
+	int pending = 0;
+
+	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
+		list_for_each_entry(dev, &uc->dev_head, uclass_node) {
+			if (dev == skip ||
+			    !(dev->flags & DM_FLAG_PROBE_PENDING))
+				continue;
+			if (device_probe_poll(dev) == -EAGAIN)
+				pending++;
+		}
+	}
+
+	return pending;
+}
+
 #ifdef CONFIG_OF_CONTROL
 int dm_scan_fdt(const void *blob)
 {
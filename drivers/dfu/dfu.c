@@ -13,6 +13,8 @@
 #include <mmc.h>
 #include <fat.h>
 #include <dfu.h>
+#include <div64.h>
+#include <task.h>
 #include <linux/list.h>
 #include <linux/compiler.h>
 
@@ -65,12 +67,46 @@ int dfu_init_env_entities(char *interface, int dev)
 	return 0;
 }
 
-static unsigned char *dfu_buf;
+/*
+ * With a task scheduler there are two buffers: while one is written to the
+ * medium by a task, USB reception carries on into the other.
+ */
+#ifdef CONFIG_TASKS
+#define DFU_NUM_BUFS	2
+#else
+#define DFU_NUM_BUFS	1
+#endif
+
+/* Most that the write task writes to the medium in one step */
+#define DFU_WRITE_SLICE	(256 << 10)
+
+static unsigned char *dfu_buf_mem;
+static unsigned char *dfu_buf;		/* Buffer being filled */
+static int dfu_buf_num;
 static unsigned long dfu_buf_size = CONFIG_SYS_DFU_DATA_BUF_SIZE;
 
+/* Writing out a full buffer, in steps */
+static struct dfu_drain {
+	struct task task;
+	struct dfu_entity *dfu;
+	u8 *buf;		/* Next data to write */
+	long left;		/* Bytes still to write */
+} dfu_drain;
+
+/* Timing of the current transfer, in ms */
+static struct dfu_stats {
+	ulong start;		/* Time of the first block */
+	u64 bytes;		/* Bytes received */
+	ulong write_time;	/* Spent writing to the medium */
+	ulong stall_time;	/* Reception was held up by the medium */
+} dfu_stats;
+
 unsigned char *dfu_free_buf(void)
 {
-	free(dfu_buf);
+	/* The buffer may still be being written */
+	task_wait(&dfu_drain.task);
+	free(dfu_buf_mem);
+	dfu_buf_mem = NULL;
 	dfu_buf = NULL;
 	return dfu_buf;
 }
@@ -91,17 +127,60 @@ unsigned char *dfu_get_buf(void)
 	dfu_buf_size = s ? (unsigned long)simple_strtol(s, NULL, 16) :
 			CONFIG_SYS_DFU_DATA_BUF_SIZE;
 
-	dfu_buf = memalign(CONFIG_SYS_CACHELINE_SIZE, dfu_buf_size);
-	if (dfu_buf == NULL)
+	dfu_buf_mem = memalign(CONFIG_SYS_CACHELINE_SIZE,
+			       dfu_buf_size * DFU_NUM_BUFS);
+	if (dfu_buf_mem == NULL)
 		printf("%s: Could not memalign 0x%lx bytes\n",
-		       __func__, dfu_buf_size);
+		       __func__, dfu_buf_size * DFU_NUM_BUFS);
+	dfu_buf = dfu_buf_mem;
+	dfu_buf_num = 0;
 
 	return dfu_buf;
 }
 
+static int dfu_drain_run(struct task *task)
+{
+	struct dfu_drain *drain = task->priv;
+	struct dfu_entity *dfu = drain->dfu;
+	long w_size = drain->left;
+	ulong start;
+	int ret;
+
+	/*
+	 * With a scheduler, write a slice at a time so that USB is serviced
+	 * in between. NAND erases the blocks it writes, so is written in one
+	 * go. Without one there is nothing to gain by splitting the write.
+	 */
+	if (DFU_NUM_BUFS > 1 && dfu->dev_type != DFU_DEV_NAND)
+		w_size = min(w_size, (long)DFU_WRITE_SLICE);
+
+	/* update CRC32 */
+	dfu->crc = crc32(dfu->crc, drain->buf, w_size);
+
+	start = get_timer(0);
+	ret = dfu->write_medium(dfu, dfu->offset, drain->buf, &w_size);
+	dfu_stats.write_time += get_timer(start);
+	if (ret) {
+		debug("%s: Write error!\n", __func__);
+		return ret;
+	}
+
+	/* update offset */
+	dfu->offset += w_size;
+	drain->buf += w_size;
+	drain->left -= w_size;
+	if (drain->left > 0)
+		return -EAGAIN;
+
+	puts("#");
+
+	return 0;
+}
+
 static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 {
 	long w_size;
+	ulong start;
 	int ret;
 
 	/* flush size? */
@@ -109,29 +188,49 @@ static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 	if (w_size == 0)
 		return 0;
 
-	/* update CRC32 */
-	dfu->crc = crc32(dfu->crc, dfu->i_buf_start, w_size);
-
-	ret = dfu->write_medium(dfu, dfu->offset, dfu->i_buf_start, &w_size);
-	if (ret)
-		debug("%s: Write error!\n", __func__);
+	/* Wait until the previous buffer is written */
+	start = get_timer(0);
+	ret = task_wait(&dfu_drain.task);
+	if (!ret) {
+		dfu_drain.dfu = dfu;
+		dfu_drain.buf = dfu->i_buf_start;
+		dfu_drain.left = w_size;
+		task_init(&dfu_drain.task, "dfu_drain", dfu_drain_run,
+			  &dfu_drain);
+		task_start(&dfu_drain.task);
+		/* Without a scheduler the buffer has been written already */
+		if (!task_running(&dfu_drain.task))
+			ret = dfu_drain.task.result;
+	}
+	dfu_stats.stall_time += get_timer(start);
 
-	/* point back */
+	/* point to the other buffer */
+	dfu_buf_num = (dfu_buf_num + 1) % DFU_NUM_BUFS;
+	dfu_buf = dfu_buf_mem + dfu_buf_num * dfu_buf_size;
+	dfu->i_buf_start = dfu_buf;
+	dfu->i_buf_end = dfu_buf + dfu_buf_size;
 	dfu->i_buf = dfu->i_buf_start;
 
-	/* update offset */
-	dfu->offset += w_size;
+	return ret;
+}
 
-	puts("#");
+static void dfu_show_stats(void)
+{
+	ulong time = get_timer(dfu_stats.start);
 
-	return ret;
+	printf("\nDFU: %llu bytes in %lu ms (%llu KiB/s)\n", dfu_stats.bytes,
+	       time, time ? lldiv(dfu_stats.bytes * 1000 / 1024, time) : 0ULL);
+	printf("DFU: medium writes took %lu ms, transfer waited %lu ms\n",
+	       dfu_stats.write_time, dfu_stats.stall_time);
 }
 
 int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 {
-	int ret = 0;
+	int ret;
 
-	if (dfu->flush_medium)
+	/* the last buffer must be written before the medium is flushed */
+	ret = task_wait(&dfu_drain.task);
+	if (!ret && dfu->flush_medium)
 		ret = dfu->flush_medium(dfu);
 
 	printf("\nDFU complete CRC32: 0x%08x\n", dfu->crc);
@@ -156,7 +255,7 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 
 	debug("%s: name: %s buf: 0x%p size: 0x%x p_num: 0x%x offset: 0x%llx bufoffset: 0x%x\n",
 	      __func__, dfu->name, buf, size, blk_seq_num, dfu->offset,
-	      dfu->i_buf - dfu->i_buf_start);
+	      (int)(dfu->i_buf - dfu->i_buf_start));
 
 	if (!dfu->inited) {
 		/* initial state */
@@ -169,6 +268,9 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 			return -ENOMEM;
 		dfu->i_buf_end = dfu_get_buf() + dfu_buf_size;
 		dfu->i_buf = dfu->i_buf_start;
+		dfu_drain.task.result = 0;
+		memset(&dfu_stats, '\0', sizeof(dfu_stats));
+		dfu_stats.start = get_timer(0);
 
 		dfu->inited = 1;
 	}
@@ -209,8 +311,11 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 		return -1;
 	}
 
-	memcpy(dfu->i_buf, buf, size);
+	/* The caller may have received straight into the buffer */
+	if (buf != dfu->i_buf)
+		memcpy(dfu->i_buf, buf, size);
 	dfu->i_buf += size;
+	dfu_stats.bytes += size;
 
 	/* if end or if buffer full flush */
 	if (size == 0 || (dfu->i_buf + size) > dfu->i_buf_end) {
@@ -219,6 +324,14 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 			ret = tret;
 	}
 
+	/* at the end, wait for everything to be written */
+	if (size == 0) {
+		tret = task_wait(&dfu_drain.task);
+		if (ret == 0)
+			ret = tret;
+		dfu_show_stats();
+	}
+
 	return ret = 0 ? size : ret;
 }
 
@@ -22,7 +22,7 @@ static int dfu_transfer_medium_ram(enum dfu_op op, struct dfu_entity *dfu,
 		return  -EINVAL;
 	}
 
-	if (offset > dfu->data.ram.size) {
+	if (offset + *len > dfu->data.ram.size) {
 		error("request exceeds allowed area\n");
 		return -EINVAL;
 	}
@@ -11,6 +11,7 @@
 #include <common.h>
 #include <malloc.h>
 #include <mmc.h>
+#include <task.h>
 #include <asm/io.h>
 #include <asm/arch/clock.h>
 #include <asm/arch/cpu.h>
@@ -225,6 +226,7 @@ static int mmc_rint_wait(struct mmc *mmc, unsigned int timeout_msecs,
 			      status & SUNXI_MMC_RINT_INTERRUPT_ERROR_BIT);
 			return TIMEOUT;
 		}
+		task_yield();
 		udelay(1000);
 	} while (!(status & done_bit));
 
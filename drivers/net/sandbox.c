@@ -0,0 +1,165 @@
+/*
+ * Ethernet for sandbox, passing frames to and from the host through a tap
+ * device, an AF_PACKET socket or a UDP socket.
+ *
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <net.h>
+#include <netdev.h>
+#include <os.h>
+#include <asm/errno.h>
+#include <asm/eth.h>
+#include <asm/eth-raw-os.h>
+#include <asm/getopt.h>
+#include <asm/state.h>
+
+/* Most frames to hand to the network stack in one recv() call */
+#define SANDBOX_ETH_RX_BUDGET	32
+
+static struct eth_sandbox_raw_priv sandbox_eth_priv = {
+	.fd = -1,
+};
+static struct sandbox_eth_stats sandbox_eth_stats;
+static uint64_t sandbox_eth_tx_pending_us;
+
+static uint64_t sandbox_eth_now_us(void)
+{
+	return os_get_nsec() / 1000;
+}
+
+static void sandbox_eth_stamp(uint64_t now)
+{
+	struct sandbox_eth_stats *stats = &sandbox_eth_stats;
+
+	if (!stats->first_us)
+		stats->first_us = now;
+	stats->last_us = now;
+}
+
+static int sandbox_eth_init(struct eth_device *dev, bd_t *bis)
+{
+	struct sandbox_state *state = state_get_current();
+	struct eth_sandbox_raw_priv *priv = dev->priv;
+
+	if (priv->fd != -1)
+		return 0;
+	if (!state->eth_spec) {
+		printf("%s: no host back-end, use --eth\n", dev->name);
+		return -1;
+	}
+
+	/* Keep the host end open so that a tap keeps its configuration */
+	if (sandbox_eth_raw_os_start(state->eth_spec, priv))
+		return -1;
+
+	return 0;
+}
+
+static int sandbox_eth_send(struct eth_device *dev, void *packet, int length)
+{
+	struct sandbox_eth_stats *stats = &sandbox_eth_stats;
+	uint64_t now;
+	int ret;
+
+	ret = sandbox_eth_raw_os_send(packet, length, dev->priv);
+	if (ret < 0) {
+		debug("%s: send failed %d\n", __func__, ret);
+		return ret;
+	}
+
+	now = sandbox_eth_now_us();
+	sandbox_eth_stamp(now);
+	stats->tx_frames++;
+	stats->tx_bytes += length;
+	if (!sandbox_eth_tx_pending_us)
+		sandbox_eth_tx_pending_us = now;
+
+	return 0;
+}
+
+static int sandbox_eth_recv(struct eth_device *dev)
+{
+	struct sandbox_eth_stats *stats = &sandbox_eth_stats;
+	uint64_t now, latency;
+	int length;
+	int i;
+
+	for (i = 0; i < SANDBOX_ETH_RX_BUDGET; i++) {
+		length = PKTSIZE_ALIGN;
+		if (sandbox_eth_raw_os_recv(NetRxPackets[0], &length,
+					    dev->priv))
+			break;
+
+		/* Skip our own frames, looped back by e.g. raw:lo */
+		if (length >= 12 &&
+		    !memcmp(NetRxPackets[0] + 6, dev->enetaddr, 6))
+			continue;
+
+		now = sandbox_eth_now_us();
+		sandbox_eth_stamp(now);
+		stats->rx_frames++;
+		stats->rx_bytes += length;
+		if (sandbox_eth_tx_pending_us) {
+			latency = now - sandbox_eth_tx_pending_us;
+			if (!stats->replies || latency < stats->latency_min_us)
+				stats->latency_min_us = latency;
+			if (latency > stats->latency_max_us)
+				stats->latency_max_us = latency;
+			stats->latency_us += latency;
+			stats->replies++;
+			sandbox_eth_tx_pending_us = 0;
+		}
+
+		NetReceive(NetRxPackets[0], length);
+	}
+
+	return 0;
+}
+
+static void sandbox_eth_halt(struct eth_device *dev)
+{
+	sandbox_eth_tx_pending_us = 0;
+}
+
+void sandbox_eth_get_stats(struct sandbox_eth_stats *stats)
+{
+	*stats = sandbox_eth_stats;
+}
+
+void sandbox_eth_reset_stats(void)
+{
+	memset(&sandbox_eth_stats, '\0', sizeof(sandbox_eth_stats));
+	sandbox_eth_tx_pending_us = 0;
+}
+
+int sandbox_eth_initialize(bd_t *bis)
+{
+	struct eth_device *dev;
+
+	dev = calloc(1, sizeof(*dev));
+	if (!dev)
+		return -ENOMEM;
+
+	strcpy(dev->name, "sandbox-eth");
+	dev->priv = &sandbox_eth_priv;
+	dev->init = sandbox_eth_init;
+	dev->halt = sandbox_eth_halt;
+	dev->send = sandbox_eth_send;
+	dev->recv = sandbox_eth_recv;
+
+	return eth_register(dev);
+}
+
+static int sandbox_cmdline_cb_eth(struct sandbox_state *state,
+				  const char *arg)
+{
+	state->eth_spec = arg;
+	return 0;
+}
+SANDBOX_CMDLINE_OPT(eth, 1, "connect ethernet: tap:<if>, raw:<if> or "
+		    "udp:<port>:<ip>:<port>");
@@ -34,6 +34,10 @@
 #define CONFIG_SYS_NS16550_IER  0x00
 #endif /* CONFIG_SYS_NS16550_IER */
 
+#ifndef CONFIG_SYS_NS16550_FIFO_SIZE
+#define CONFIG_SYS_NS16550_FIFO_SIZE	1
+#endif
+
 void NS16550_init(NS16550_t com_port, int baud_divisor)
 {
 #if (defined(CONFIG_SPL_BUILD) && defined(CONFIG_OMAP34XX))
@@ -113,6 +117,42 @@ void NS16550_putc(NS16550_t com_port, char c)
 }
 
 #ifndef CONFIG_NS16550_MIN_FUNCTIONS
+/*
+ * With the FIFOs enabled, THRE means that the whole transmit FIFO is empty,
+ * so we can write a FIFO's worth of characters each time it is set rather
+ * than checking it before every character.
+ */
+int NS16550_write(NS16550_t com_port, const char *s, int len, int wait)
+{
+	int space = 0;
+	int cr = 0;
+	int i;
+
+	for (i = 0; i < len;) {
+		if (!space) {
+			if (serial_in(&com_port->lsr) & UART_LSR_THRE)
+				space = CONFIG_SYS_NS16550_FIFO_SIZE;
+			else if (!wait && !cr)
+				break;
+			continue;
+		}
+
+		/* Send "\r\n" for "\n", waiting if the '\r' fills the FIFO */
+		if (s[i] == '\n' && !cr) {
+			serial_out('\r', &com_port->thr);
+			cr = 1;
+		} else {
+			serial_out(s[i], &com_port->thr);
+			if (s[i++] == '\n')
+				WATCHDOG_RESET();
+			cr = 0;
+		}
+		space--;
+	}
+
+	return i;
+}
+
 char NS16550_getc(NS16550_t com_port)
 {
 	while ((serial_in(&com_port->lsr) & UART_LSR_DR) == 0) {
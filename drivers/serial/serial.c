@@ -279,6 +279,7 @@ void serial_stdio_init(void)
 		dev.stop = s->stop;
 		dev.putc = s->putc;
 		dev.puts = s->puts;
+		dev.puts_nowait = s->puts_nowait;
 		dev.getc = s->getc;
 		dev.tstc = s->tstc;
 
@@ -462,6 +463,32 @@ void serial_puts(const char *s)
 	get_current()->puts(s);
 }
 
+/**
+ * serial_puts_nowait() - Output what fits via currently selected serial port
+ * @s:		Characters to be output from the serial port.
+ * @len:	Number of characters
+ *
+ * This function outputs as many of the characters as the hardware can
+ * queue for transfer without waiting, for use by a buffered console. If
+ * the driver cannot do this, all the characters are output with putc(),
+ * which may block. This function uses the get_current() call to determine
+ * which port is selected.
+ *
+ * Returns the number of characters output.
+ */
+int serial_puts_nowait(const char *s, int len)
+{
+	struct serial_device *dev = get_current();
+	int i;
+
+	if (dev->puts_nowait)
+		return dev->puts_nowait(s, len);
+	for (i = 0; i < len; i++)
+		dev->putc(s[i]);
+
+	return len;
+}
+
 /**
  * default_serial_puts() - Output string by calling serial_putc() in loop
  * @s:	Zero-terminated string to be output from the serial port.
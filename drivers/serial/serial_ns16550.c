@@ -104,6 +104,10 @@ static NS16550_t serial_ports[6] = {
 	static void eserial##port##_puts(const char *s) \
 	{ \
 		serial_puts_dev(port, s); \
+	} \
+	static int eserial##port##_puts_nowait(const char *s, int len) \
+	{ \
+		return serial_puts_nowait_dev(port, s, len); \
 	}
 
 /* Serial device descriptor */
@@ -116,6 +120,7 @@ static NS16550_t serial_ports[6] = {
 	.tstc	= eserial##port##_tstc,		\
 	.putc	= eserial##port##_putc,		\
 	.puts	= eserial##port##_puts,		\
+	.puts_nowait = eserial##port##_puts_nowait, \
 }
 
 static int calc_divisor (NS16550_t port)
@@ -163,9 +168,7 @@ _serial_putc_raw(const char c,const int port)
 void
 _serial_puts (const char *s,const int port)
 {
-	while (*s) {
-		_serial_putc (*s++,port);
-	}
+	NS16550_write(PORT, s, strlen(s), 1);
 }
 
 
@@ -208,6 +211,12 @@ serial_puts_dev(unsigned int dev_index,const char *s)
 	_serial_puts(s,dev_index);
 }
 
+static inline int
+serial_puts_nowait_dev(unsigned int dev_index, const char *s, int len)
+{
+	return NS16550_write(serial_ports[dev_index - 1], s, len, 0);
+}
+
 static inline int
 serial_getc_dev(unsigned int dev_index)
 {
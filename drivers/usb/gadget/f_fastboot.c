@@ -0,0 +1,548 @@
+/*
+ * f_fastboot.c -- USB Android fastboot gadget function
+ *
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * Images are downloaded straight into the download buffer and written to
+ * storage from there by the flash command, decoding sparse images on the
+ * way (see fb_mmc.c).
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <errno.h>
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+#include <version.h>
+#include <linux/usb/ch9.h>
+#include <linux/usb/gadget.h>
+#include <linux/usb/composite.h>
+#include <linux/sizes.h>
+#include <fastboot.h>
+#include <fb_mmc.h>
+
+#define FASTBOOT_VERSION		"0.4"
+
+#define FASTBOOT_INTERFACE_CLASS	0xff
+#define FASTBOOT_INTERFACE_SUB_CLASS	0x42
+#define FASTBOOT_INTERFACE_PROTOCOL	0x03
+
+/* Commands are at most 64 bytes, as are responses */
+#define FASTBOOT_COMMAND_LEN		64
+#define EP_BUFFER_SIZE			512
+
+/* Largest request queued while downloading */
+#define FASTBOOT_RX_CHUNK		(unsigned int)SZ_1M
+
+struct f_fastboot {
+	struct usb_function usb_function;
+
+	struct usb_ep *in_ep, *out_ep;
+	struct usb_request *in_req, *out_req;
+	void *out_buf;		/* Command buffer of out_req */
+
+	/* Control flow variables */
+	unsigned char configuration_done;
+	unsigned char rxdata;
+	unsigned char txdata;
+	int status;		/* Status of the last completed request */
+};
+
+static struct f_fastboot *fastboot_func;
+static inline struct f_fastboot *func_to_fastboot(struct usb_function *f)
+{
+	return container_of(f, struct f_fastboot, usb_function);
+}
+
+static unsigned int download_bytes;
+
+static struct usb_interface_descriptor fastboot_intf = {
+	.bLength =		sizeof(fastboot_intf),
+	.bDescriptorType =	USB_DT_INTERFACE,
+
+	.bNumEndpoints =	2,
+	.bInterfaceClass =	FASTBOOT_INTERFACE_CLASS,
+	.bInterfaceSubClass =	FASTBOOT_INTERFACE_SUB_CLASS,
+	.bInterfaceProtocol =	FASTBOOT_INTERFACE_PROTOCOL,
+};
+
+static struct usb_endpoint_descriptor fs_in_desc = {
+	.bLength =		USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType =	USB_DT_ENDPOINT,
+
+	.bEndpointAddress =	USB_DIR_IN,
+	.bmAttributes =		USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize =	__constant_cpu_to_le16(64),
+};
+
+static struct usb_endpoint_descriptor fs_out_desc = {
+	.bLength =		USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType =	USB_DT_ENDPOINT,
+
+	.bEndpointAddress =	USB_DIR_OUT,
+	.bmAttributes =		USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize =	__constant_cpu_to_le16(64),
+};
+
+static struct usb_endpoint_descriptor hs_in_desc = {
+	.bLength =		USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType =	USB_DT_ENDPOINT,
+
+	.bEndpointAddress =	USB_DIR_IN,
+	.bmAttributes =		USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize =	__constant_cpu_to_le16(512),
+};
+
+static struct usb_endpoint_descriptor hs_out_desc = {
+	.bLength =		USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType =	USB_DT_ENDPOINT,
+
+	.bEndpointAddress =	USB_DIR_OUT,
+	.bmAttributes =		USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize =	__constant_cpu_to_le16(512),
+};
+
+static struct usb_descriptor_header *fs_fastboot_function[] = {
+	(struct usb_descriptor_header *)&fastboot_intf,
+	(struct usb_descriptor_header *)&fs_in_desc,
+	(struct usb_descriptor_header *)&fs_out_desc,
+	NULL,
+};
+
+static struct usb_descriptor_header *hs_fastboot_function[] = {
+	(struct usb_descriptor_header *)&fastboot_intf,
+	(struct usb_descriptor_header *)&hs_in_desc,
+	(struct usb_descriptor_header *)&hs_out_desc,
+	NULL,
+};
+
+static inline struct usb_endpoint_descriptor *
+ep_desc(struct usb_gadget *g, struct usb_endpoint_descriptor *hs,
+	struct usb_endpoint_descriptor *fs)
+{
+	if (gadget_is_dualspeed(g) && g->speed == USB_SPEED_HIGH)
+		return hs;
+	return fs;
+}
+
+/* ********************************************************** */
+/*         fastboot protocol - transmission handling	      */
+/* ********************************************************** */
+
+static void fastboot_complete(struct usb_ep *ep, struct usb_request *req)
+{
+	struct f_fastboot *f_fb = fastboot_func;
+
+	f_fb->status = req->status;
+	if (req->status)
+		debug("%s: %s complete --> %d, %d/%d\n", __func__, ep->name,
+		      req->status, req->actual, req->length);
+
+	if (ep == f_fb->out_ep)
+		f_fb->rxdata = 1;
+	else
+		f_fb->txdata = 1;
+}
+
+/* Wait for a request to complete, returning its status */
+static int fastboot_wait(unsigned char *done)
+{
+	struct f_fastboot *f_fb = fastboot_func;
+
+	while (!*done) {
+		usb_gadget_handle_interrupts();
+		if (ctrlc())
+			return -EINTR;
+		/* The host may go away at any point */
+		if (!f_fb->configuration_done)
+			return -ESHUTDOWN;
+	}
+	*done = 0;
+
+	return f_fb->status;
+}
+
+/* Receive up to len bytes into buf, returning the number received */
+static int fastboot_rx(void *buf, unsigned int len)
+{
+	struct f_fastboot *f_fb = fastboot_func;
+	struct usb_request *req = f_fb->out_req;
+	int ret;
+
+	req->buf = buf;
+	req->length = len;
+	ret = usb_ep_queue(f_fb->out_ep, req, 0);
+	if (ret) {
+		error("%s: queue %d bytes --> %d", f_fb->out_ep->name, len,
+		      ret);
+		return ret;
+	}
+	ret = fastboot_wait(&f_fb->rxdata);
+
+	return ret ? ret : req->actual;
+}
+
+static int fastboot_tx(const char *response)
+{
+	struct f_fastboot *f_fb = fastboot_func;
+	struct usb_request *req = f_fb->in_req;
+	int ret;
+
+	debug("%s: %s\n", __func__, response);
+	req->length = strlen(response);
+	memcpy(req->buf, response, req->length);
+	ret = usb_ep_queue(f_fb->in_ep, req, 0);
+	if (ret) {
+		error("%s: queue %d bytes --> %d", f_fb->in_ep->name,
+		      req->length, ret);
+		return ret;
+	}
+
+	return fastboot_wait(&f_fb->txdata);
+}
+
+/* ********************************************************** */
+/*         fastboot protocol - commands			      */
+/* ********************************************************** */
+
+static void fastboot_fail(char *response, const char *reason)
+{
+	snprintf(response, FASTBOOT_RESPONSE_LEN, "FAIL%s", reason);
+}
+
+static void cb_getvar(const char *var, char *response)
+{
+	const char *s;
+
+	strcpy(response, "OKAY");
+	if (!strcmp(var, "version")) {
+		strcat(response, FASTBOOT_VERSION);
+	} else if (!strcmp(var, "bootloader-version") ||
+		   !strcmp(var, "version-bootloader")) {
+		strncat(response, U_BOOT_VERSION, FASTBOOT_RESPONSE_LEN - 5);
+	} else if (!strcmp(var, "downloadsize") ||
+		   !strcmp(var, "max-download-size")) {
+		sprintf(response + 4, "0x%08x", CONFIG_USB_FASTBOOT_BUF_SIZE);
+	} else if (!strcmp(var, "serialno")) {
+		s = getenv("serial#");
+		if (s)
+			strncat(response, s, FASTBOOT_RESPONSE_LEN - 5);
+		else
+			fastboot_fail(response, "Value not set");
+	} else {
+		fastboot_fail(response, "Variable not implemented");
+	}
+}
+
+static int cb_download(const char *arg, char *response)
+{
+	void *buf = (void *)CONFIG_USB_FASTBOOT_BUF_ADDR;
+	unsigned int size, maxpacket = fastboot_func->out_ep->maxpacket;
+	unsigned int len;
+	ulong start;
+	int ret;
+
+	size = simple_strtoul(arg, NULL, 16);
+	download_bytes = 0;
+	if (!size) {
+		fastboot_fail(response, "data invalid");
+		return 0;
+	} else if (size > CONFIG_USB_FASTBOOT_BUF_SIZE) {
+		fastboot_fail(response, "data too large");
+		return 0;
+	}
+
+	sprintf(response, "DATA%08x", size);
+	ret = fastboot_tx(response);
+	if (ret)
+		return ret;
+
+	printf("Downloading %u bytes...\n", size);
+	start = get_timer(0);
+	while (download_bytes < size) {
+		/*
+		 * Queue whole packets; this stays inside the buffer since its
+		 * size is a multiple of the packet size
+		 */
+		len = min(size - download_bytes, FASTBOOT_RX_CHUNK);
+		len = roundup(len, maxpacket);
+		ret = fastboot_rx(buf + download_bytes, len);
+		if (ret < 0) {
+			download_bytes = 0;
+			return ret;
+		}
+		download_bytes += ret;
+	}
+	start = get_timer(start);
+	printf("Downloaded %u bytes in %lu ms (%lu KiB/s)\n", download_bytes,
+	       start, start ? download_bytes / start * 1000 / 1024 : 0);
+	download_bytes = size;
+	strcpy(response, "OKAY");
+
+	return 0;
+}
+
+static void cb_flash(const char *part, char *response)
+{
+	if (!download_bytes) {
+		fastboot_fail(response, "no image downloaded");
+		return;
+	}
+#ifdef CONFIG_FASTBOOT_FLASH
+	fb_mmc_flash_write(part, (void *)CONFIG_USB_FASTBOOT_BUF_ADDR,
+			   download_bytes, response);
+#else
+	fastboot_fail(response, "flashing not supported");
+#endif
+}
+
+static void cb_erase(const char *part, char *response)
+{
+#ifdef CONFIG_FASTBOOT_FLASH
+	fb_mmc_erase(part, response);
+#else
+	fastboot_fail(response, "erasing not supported");
+#endif
+}
+
+/* Returns 1 if the host has ended the session, 0 if not, -ve on error */
+static int fastboot_command(char *cmd, int *exitp)
+{
+	char response[FASTBOOT_RESPONSE_LEN];
+	int ret;
+
+	debug("%s: %s\n", __func__, cmd);
+	if (!strncmp(cmd, "getvar:", 7)) {
+		cb_getvar(cmd + 7, response);
+	} else if (!strncmp(cmd, "download:", 9)) {
+		ret = cb_download(cmd + 9, response);
+		if (ret)
+			return ret;
+	} else if (!strncmp(cmd, "flash:", 6)) {
+		cb_flash(cmd + 6, response);
+	} else if (!strncmp(cmd, "erase:", 6)) {
+		cb_erase(cmd + 6, response);
+	} else if (!strcmp(cmd, "boot")) {
+		*exitp = FASTBOOT_BOOT;
+		strcpy(response, "OKAY");
+	} else if (!strcmp(cmd, "continue")) {
+		*exitp = FASTBOOT_CONTINUE;
+		strcpy(response, "OKAY");
+	} else if (!strcmp(cmd, "reboot")) {
+		ret = fastboot_tx("OKAY");
+		if (ret)
+			return ret;
+		do_reset(NULL, 0, 0, NULL);
+	} else {
+		error("unknown command: %s", cmd);
+		fastboot_fail(response, "unknown command");
+	}
+
+	ret = fastboot_tx(response);
+	if (ret)
+		return ret;
+
+	return *exitp >= 0;
+}
+
+int fastboot_handle(void)
+{
+	struct f_fastboot *f_fb = fastboot_func;
+	int exit = -1;
+	int ret;
+
+	/* Wait for a device enumeration and configuration settings */
+	debug("fastboot enumeration/configuration setting....\n");
+	while (!f_fb->configuration_done) {
+		usb_gadget_handle_interrupts();
+		if (ctrlc())
+			return -EINTR;
+	}
+
+	do {
+		ret = fastboot_rx(f_fb->out_buf, EP_BUFFER_SIZE);
+		if (ret < 0)
+			return ret;
+		/* Commands are not terminated */
+		((char *)f_fb->out_buf)[min(ret, FASTBOOT_COMMAND_LEN)] = '\0';
+		ret = fastboot_command(f_fb->out_buf, &exit);
+		if (ret < 0)
+			return ret;
+	} while (!ret);
+
+	return exit;
+}
+
+/* ********************************************************** */
+/*         fastboot USB Function			      */
+/* ********************************************************** */
+
+static struct usb_request *alloc_ep_req(struct usb_ep *ep, unsigned length)
+{
+	struct usb_request *req;
+
+	req = usb_ep_alloc_request(ep, 0);
+	if (!req)
+		return req;
+
+	req->length = length;
+	req->complete = fastboot_complete;
+	req->buf = memalign(CONFIG_SYS_CACHELINE_SIZE, length);
+	if (!req->buf) {
+		usb_ep_free_request(ep, req);
+		req = NULL;
+	}
+
+	return req;
+}
+
+static void free_ep_req(struct usb_ep *ep, struct usb_request *req)
+{
+	free(req->buf);
+	usb_ep_free_request(ep, req);
+}
+
+static int fastboot_func_bind(struct usb_configuration *c,
+			      struct usb_function *f)
+{
+	struct usb_gadget *gadget = c->cdev->gadget;
+	struct f_fastboot *f_fb = func_to_fastboot(f);
+	int status;
+
+	fastboot_func = f_fb;
+
+	/* DYNAMIC interface numbers assignments */
+	status = usb_interface_id(c, f);
+	if (status < 0)
+		return status;
+	fastboot_intf.bInterfaceNumber = status;
+
+	/* allocate instance-specific endpoints */
+	f_fb->in_ep = usb_ep_autoconfig(gadget, &fs_in_desc);
+	if (!f_fb->in_ep)
+		return -ENODEV;
+	f_fb->in_ep->driver_data = c->cdev; /* claim */
+
+	f_fb->out_ep = usb_ep_autoconfig(gadget, &fs_out_desc);
+	if (!f_fb->out_ep)
+		return -ENODEV;
+	f_fb->out_ep->driver_data = c->cdev; /* claim */
+
+	f->descriptors = fs_fastboot_function;
+	if (gadget_is_dualspeed(gadget)) {
+		hs_in_desc.bEndpointAddress = fs_in_desc.bEndpointAddress;
+		hs_out_desc.bEndpointAddress = fs_out_desc.bEndpointAddress;
+		f->hs_descriptors = hs_fastboot_function;
+	}
+
+	return 0;
+}
+
+static void fastboot_unbind(struct usb_configuration *c,
+			    struct usb_function *f)
+{
+	memset(fastboot_func, 0, sizeof(*fastboot_func));
+	fastboot_func = NULL;
+}
+
+static void fastboot_func_disable(struct usb_function *f)
+{
+	struct f_fastboot *f_fb = func_to_fastboot(f);
+
+	debug("%s:\n", __func__);
+	f_fb->configuration_done = 0;
+
+	if (f_fb->out_req) {
+		usb_ep_disable(f_fb->out_ep);
+		/* The request may point into the download buffer */
+		f_fb->out_req->buf = f_fb->out_buf;
+		free_ep_req(f_fb->out_ep, f_fb->out_req);
+		f_fb->out_req = NULL;
+	}
+	if (f_fb->in_req) {
+		usb_ep_disable(f_fb->in_ep);
+		free_ep_req(f_fb->in_ep, f_fb->in_req);
+		f_fb->in_req = NULL;
+	}
+}
+
+static int fastboot_func_set_alt(struct usb_function *f,
+				 unsigned intf, unsigned alt)
+{
+	struct f_fastboot *f_fb = func_to_fastboot(f);
+	struct usb_gadget *gadget = f->config->cdev->gadget;
+	int ret;
+
+	debug("%s: func: %s intf: %d alt: %d\n",
+	      __func__, f->name, intf, alt);
+
+	/* Start again from a clean state, e.g. after a bus reset */
+	fastboot_func_disable(f);
+
+	ret = usb_ep_enable(f_fb->out_ep,
+			    ep_desc(gadget, &hs_out_desc, &fs_out_desc));
+	if (ret)
+		return ret;
+	f_fb->out_req = alloc_ep_req(f_fb->out_ep, EP_BUFFER_SIZE);
+	if (!f_fb->out_req) {
+		usb_ep_disable(f_fb->out_ep);
+		return -ENOMEM;
+	}
+	f_fb->out_buf = f_fb->out_req->buf;
+
+	ret = usb_ep_enable(f_fb->in_ep,
+			    ep_desc(gadget, &hs_in_desc, &fs_in_desc));
+	if (ret)
+		goto err;
+	f_fb->in_req = alloc_ep_req(f_fb->in_ep, EP_BUFFER_SIZE);
+	if (!f_fb->in_req) {
+		usb_ep_disable(f_fb->in_ep);
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	f_fb->rxdata = 0;
+	f_fb->txdata = 0;
+	f_fb->configuration_done = 1;
+
+	return 0;
+
+err:
+	error("%s: EPs setup failed: %d", __func__, ret);
+	fastboot_func_disable(f);
+
+	return ret;
+}
+
+static int fastboot_func_init(struct usb_configuration *c)
+{
+	struct f_fastboot *f_fb;
+	int status;
+
+	debug("%s: cdev: 0x%p\n", __func__, c->cdev);
+
+	f_fb = memalign(CONFIG_SYS_CACHELINE_SIZE, sizeof(*f_fb));
+	if (!f_fb)
+		return -ENOMEM;
+
+	memset(f_fb, 0, sizeof(*f_fb));
+
+	f_fb->usb_function.name = "f_fastboot";
+	f_fb->usb_function.bind = fastboot_func_bind;
+	f_fb->usb_function.unbind = fastboot_unbind;
+	f_fb->usb_function.set_alt = fastboot_func_set_alt;
+	f_fb->usb_function.disable = fastboot_func_disable;
+
+	status = usb_add_function(c, &f_fb->usb_function);
+	if (status)
+		free(f_fb);
+
+	return status;
+}
+
+int fastboot_add(struct usb_configuration *c)
+{
+	debug("%s:\n", __func__);
+	return fastboot_func_init(c);
+}
@@ -25,6 +25,7 @@
 #include <linux/usb/cdc.h>
 #include <g_dnl.h>
 #include <dfu.h>
+#include <task.h>
 
 #include "f_thor.h"
 
@@ -172,6 +173,8 @@ static long long int download_head(unsigned long long total,
 				      ret, *cnt);
 				return ret;
 			}
+			/* DFU may have moved on to another buffer */
+			transfer_buffer = dfu_get_buf();
 			buf = transfer_buffer;
 		}
 		send_data_rsp(0, ++usb_pkt_cnt);
@@ -543,6 +546,7 @@ static int thor_rx_data(void)
 
 		while (!dev->rxdata) {
 			usb_gadget_handle_interrupts();
+			task_yield();
 			if (ctrlc())
 				return -1;
 		}
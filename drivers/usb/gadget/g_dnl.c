@@ -17,6 +17,7 @@
 #include <usb_mass_storage.h>
 #include <dfu.h>
 #include <thor.h>
+#include <fastboot.h>
 
 #include "gadget_chips.h"
 #include "composite.c"
@@ -117,6 +118,8 @@ static int g_dnl_do_config(struct usb_configuration *c)
 		ret = fsg_add(c);
 	else if (!strcmp(s, "usb_dnl_thor"))
 		ret = thor_add(c);
+	else if (!strcmp(s, "usb_dnl_fastboot"))
+		ret = fastboot_add(c);
 
 	return ret;
 }
@@ -229,8 +232,8 @@ static struct usb_composite_driver g_dnl_driver = {
 
 int g_dnl_register(const char *type)
 {
-	/* The largest function name is 4 */
-	static char name[sizeof(shortname) + 4];
+	/* The largest function name is 8 */
+	static char name[sizeof(shortname) + 8];
 	int ret;
 
 	if (!strcmp(type, "dfu")) {
@@ -242,6 +245,9 @@ int g_dnl_register(const char *type)
 	} else if (!strcmp(type, "thor")) {
 		strcpy(name, shortname);
 		strcat(name, type);
+	} else if (!strcmp(type, "fastboot")) {
+		strcpy(name, shortname);
+		strcat(name, type);
 	} else {
 		printf("%s: unknown command: %s\n", __func__, type);
 		return -EINVAL;
@@ -27,6 +27,7 @@
 #include <usb.h>
 #include <asm/io.h>
 #include <malloc.h>
+#include <task.h>
 #include <watchdog.h>
 #include <linux/compiler.h>
 
@@ -163,6 +164,7 @@ static int handshake(uint32_t *ptr, uint32_t mask, uint32_t done, int usec)
 		result &= mask;
 		if (result == done)
 			return 0;
+		task_yield();
 		usec--;
 	} while (usec > 0);
 	return -1;
@@ -216,6 +216,8 @@
 
 #ifndef CONFIG_BLACKFIN
 
+#ifndef CONFIG_USB_MUSB_SUNXI
+
 /*
  * Common USB registers
  */
@@ -318,6 +320,80 @@
 #define MUSB_BUSCTL_OFFSET(_epnum, _offset) \
 	(0x80 + (8*(_epnum)) + (_offset))
 
+#else /* CONFIG_USB_MUSB_SUNXI */
+
+/*
+ * The Allwinner (sunxi) core has the usual registers at other offsets,
+ * and only supports the indexed endpoint model.
+ */
+
+#define MUSB_FADDR		0x0098	/* 8-bit */
+#define MUSB_POWER		0x0040	/* 8-bit */
+
+#define MUSB_INTRTX		0x0044	/* 16-bit */
+#define MUSB_INTRRX		0x0046
+#define MUSB_INTRTXE		0x0048
+#define MUSB_INTRRXE		0x004A
+#define MUSB_INTRUSB		0x004C	/* 8 bit */
+#define MUSB_INTRUSBE		0x0050	/* 8 bit */
+#define MUSB_FRAME		0x0054
+#define MUSB_INDEX		0x0042	/* 8 bit */
+#define MUSB_TESTMODE		0x007C	/* 8 bit */
+
+/* Get offset for a given FIFO from musb->mregs */
+#define MUSB_FIFO_OFFSET(epnum)	((epnum) * 4)
+
+/*
+ * Additional Control Registers
+ */
+
+#define MUSB_DEVCTL		0x0041	/* 8 bit */
+
+/* These are always controlled through the INDEX register */
+#define MUSB_TXFIFOSZ		0x0090	/* 8-bit (see masks) */
+#define MUSB_RXFIFOSZ		0x0094	/* 8-bit (see masks) */
+#define MUSB_TXFIFOADD		0x0092	/* 16-bit offset shifted right 3 */
+#define MUSB_RXFIFOADD		0x0096	/* 16-bit offset shifted right 3 */
+
+/* Vendor register: selects PIO or DMA access to the FIFOs */
+#define MUSB_VEND0		0x0043	/* 8 bit */
+
+/* Offsets to endpoint registers; there is a 2 byte hole before TXTYPE */
+#define MUSB_TXMAXP		0x0080
+#define MUSB_TXCSR		0x0082
+#define MUSB_CSR0		MUSB_TXCSR	/* Re-used for EP0 */
+#define MUSB_RXMAXP		0x0084
+#define MUSB_RXCSR		0x0086
+#define MUSB_RXCOUNT		0x0088
+#define MUSB_COUNT0		MUSB_RXCOUNT	/* Re-used for EP0 */
+#define MUSB_TXTYPE		0x008C
+#define MUSB_TYPE0		MUSB_TXTYPE	/* Re-used for EP0 */
+#define MUSB_TXINTERVAL		0x008D
+#define MUSB_NAKLIMIT0		MUSB_TXINTERVAL	/* Re-used for EP0 */
+#define MUSB_RXTYPE		0x008E
+#define MUSB_RXINTERVAL		0x008F
+#define MUSB_FIFOSIZE		0x0090
+#define MUSB_CONFIGDATA		0x00B0	/* musb_read_configdata() adds 0x10 */
+
+/* Offsets to endpoint registers in indexed model (using INDEX register) */
+#define MUSB_INDEXED_OFFSET(_epnum, _offset)	(_offset)
+
+#define MUSB_TXCSR_MODE			0x2000
+
+/* "bus control"/target registers, for host side multipoint (external hubs) */
+#define MUSB_TXFUNCADDR		0x0098
+#define MUSB_TXHUBADDR		0x009A
+#define MUSB_TXHUBPORT		0x009B
+
+#define MUSB_RXFUNCADDR		0x009C
+#define MUSB_RXHUBADDR		0x009E
+#define MUSB_RXHUBPORT		0x009F
+
+/* The endpoint is selected with MUSB_INDEX */
+#define MUSB_BUSCTL_OFFSET(_epnum, _offset)	(_offset)
+
+#endif /* CONFIG_USB_MUSB_SUNXI */
+
 static inline void musb_write_txfifosz(void __iomem *mbase, u8 c_size)
 {
 	musb_writeb(mbase, MUSB_TXFIFOSZ, c_size);
@@ -340,7 +416,9 @@ static inline void  musb_write_rxfifoadd(void __iomem *mbase, u16 c_off)
 
 static inline void musb_write_ulpi_buscontrol(void __iomem *mbase, u8 val)
 {
+#ifndef CONFIG_USB_MUSB_SUNXI
 	musb_writeb(mbase, MUSB_ULPI_BUSCONTROL, val);
+#endif
 }
 
 static inline u8 musb_read_txfifosz(void __iomem *mbase)
@@ -365,7 +443,11 @@ static inline u16  musb_read_rxfifoadd(void __iomem *mbase)
 
 static inline u8 musb_read_ulpi_buscontrol(void __iomem *mbase)
 {
+#ifdef CONFIG_USB_MUSB_SUNXI
+	return 0;	/* No ULPI */
+#else
 	return musb_readb(mbase, MUSB_ULPI_BUSCONTROL);
+#endif
 }
 
 static inline u8 musb_read_configdata(void __iomem *mbase)
@@ -376,7 +458,11 @@ static inline u8 musb_read_configdata(void __iomem *mbase)
 
 static inline u16 musb_read_hwvers(void __iomem *mbase)
 {
+#ifdef CONFIG_USB_MUSB_SUNXI
+	return 0;	/* No version register */
+#else
 	return musb_readw(mbase, MUSB_HWVERS);
+#endif
 }
 
 static inline void __iomem *musb_read_target_reg_base(u8 i, void __iomem *mbase)
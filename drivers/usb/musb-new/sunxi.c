@@ -0,0 +1,186 @@
+/*
+ * Allwinner sunxi "glue layer"
+ *
+ * The USB0 port of the sun4i, sun5i and sun7i is a Mentor Graphics
+ * Inventra OTG controller with its own register layout (see musb_regs.h),
+ * an integrated PHY and FIFO RAM which is borrowed from SRAM D.
+ *
+ * Based on the sunxi USB controller code in Allwinner's Linux 3.4 tree.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#define __UBOOT__
+#include <common.h>
+#include <asm/io.h>
+#include <asm/arch/clock.h>
+#include <asm/arch/cpu.h>
+#include <asm/arch/musb.h>
+#include "linux-compat.h"
+#include "musb_core.h"
+
+/* Glue registers, relative to the controller base */
+#define SUNXI_USB_ISCR			0x0400
+#define SUNXI_USB_PHYCTL		0x0404
+
+/* Interface status and control register */
+#define SUNXI_ISCR_VBUS_CHANGE_DETECT	(1 << 6)
+#define SUNXI_ISCR_ID_CHANGE_DETECT	(1 << 5)
+#define SUNXI_ISCR_DPDM_CHANGE_DETECT	(1 << 4)
+#define SUNXI_ISCR_CHANGE_DETECT	(SUNXI_ISCR_VBUS_CHANGE_DETECT | \
+					 SUNXI_ISCR_ID_CHANGE_DETECT | \
+					 SUNXI_ISCR_DPDM_CHANGE_DETECT)
+#define SUNXI_ISCR_ID_PULLUP_EN		(1 << 17)
+#define SUNXI_ISCR_DPDM_PULLUP_EN	(1 << 16)
+#define SUNXI_ISCR_FORCE_ID_MASK	(3 << 14)
+#define SUNXI_ISCR_FORCE_ID_LOW		(2 << 14)
+#define SUNXI_ISCR_FORCE_ID_HIGH	(3 << 14)
+#define SUNXI_ISCR_FORCE_VBUS_MASK	(3 << 12)
+#define SUNXI_ISCR_FORCE_VBUS_HIGH	(3 << 12)
+
+/* PHY control register: the PHY is programmed one bit at a time */
+#define SUNXI_PHYCTL_DATA		(1 << 7)
+#define SUNXI_PHYCTL_ADDR_SHIFT		8
+#define SUNXI_PHYCTL_ADDR_MASK		(0xff << SUNXI_PHYCTL_ADDR_SHIFT)
+#define SUNXI_PHYCTL_WRITE(phy)		(1 << ((phy) * 2))
+
+/* SRAM controller: map SRAM D to the USB0 FIFOs */
+#define SUNXI_SRAMC_CFG			0x04
+#define SUNXI_SRAMC_SRAMD_MASK		3
+#define SUNXI_SRAMC_SRAMD_USB0		1
+
+/* MUSB_VEND0 */
+#define SUNXI_VEND0_PIO_MODE		0
+
+static void sunxi_phy_write(int phy, int addr, int data, int len)
+{
+	void *phyctl = (void *)SUNXI_USB0_BASE + SUNXI_USB_PHYCTL;
+	int i;
+
+	for (i = 0; i < len; i++) {
+		clrsetbits_le32(phyctl, SUNXI_PHYCTL_ADDR_MASK,
+				(addr + i) << SUNXI_PHYCTL_ADDR_SHIFT);
+		if (data & 1)
+			setbits_le32(phyctl, SUNXI_PHYCTL_DATA);
+		else
+			clrbits_le32(phyctl, SUNXI_PHYCTL_DATA);
+		/* Latch the bit */
+		setbits_le32(phyctl, SUNXI_PHYCTL_WRITE(phy));
+		clrbits_le32(phyctl, SUNXI_PHYCTL_WRITE(phy));
+		data >>= 1;
+	}
+}
+
+static void sunxi_phy_init(void)
+{
+	/* 45 ohm termination calibration, for the OTG PHY only */
+	sunxi_phy_write(0, 0x0c, 0x01, 1);
+
+	/* High-speed signal amplitude and slew rate */
+	sunxi_phy_write(0, 0x20, 0x14, 5);
+
+	/* Disconnect threshold */
+#ifdef CONFIG_SUN4I
+	sunxi_phy_write(0, 0x2a, 3, 2);
+#else
+	sunxi_phy_write(0, 0x2a, 2, 2);
+#endif
+}
+
+static void sunxi_phy_power(int on)
+{
+	struct sunxi_ccm_reg *ccm = (struct sunxi_ccm_reg *)SUNXI_CCM_BASE;
+
+	if (on) {
+		setbits_le32(&ccm->usb_clk_cfg,
+			     CCM_USB_CTRL_PHYGATE | CCM_USB_CTRL_PHY0_RST);
+		setbits_le32(&ccm->ahb_gate0, 1 << AHB_GATE_OFFSET_USB);
+		sunxi_phy_init();
+	} else {
+		clrbits_le32(&ccm->ahb_gate0, 1 << AHB_GATE_OFFSET_USB);
+		clrbits_le32(&ccm->usb_clk_cfg, CCM_USB_CTRL_PHY0_RST);
+	}
+}
+
+/* Update the ISCR without acking any pending change-detect bits */
+static void sunxi_iscr_update(void __iomem *base, u32 clr, u32 set)
+{
+	u32 reg = readl(base + SUNXI_USB_ISCR);
+
+	reg &= ~(clr | SUNXI_ISCR_CHANGE_DETECT);
+	writel(reg | set, base + SUNXI_USB_ISCR);
+}
+
+static irqreturn_t sunxi_musb_interrupt(int irq, void *__hci)
+{
+	struct musb *musb = __hci;
+	irqreturn_t retval = IRQ_NONE;
+
+	/* Interrupts are not cleared on read, but by writing them back */
+	musb->int_usb = musb_readb(musb->mregs, MUSB_INTRUSB);
+	if (musb->int_usb)
+		musb_writeb(musb->mregs, MUSB_INTRUSB, musb->int_usb);
+	musb->int_tx = musb_readw(musb->mregs, MUSB_INTRTX);
+	if (musb->int_tx)
+		musb_writew(musb->mregs, MUSB_INTRTX, musb->int_tx);
+	musb->int_rx = musb_readw(musb->mregs, MUSB_INTRRX);
+	if (musb->int_rx)
+		musb_writew(musb->mregs, MUSB_INTRRX, musb->int_rx);
+
+	if (musb->int_usb || musb->int_tx || musb->int_rx)
+		retval |= musb_interrupt(musb);
+
+	return retval;
+}
+
+static void sunxi_musb_enable(struct musb *musb)
+{
+	/* The FIFOs are accessed by the CPU, a word at a time */
+	musb_writeb(musb->mregs, MUSB_VEND0, SUNXI_VEND0_PIO_MODE);
+}
+
+static void sunxi_musb_disable(struct musb *musb)
+{
+}
+
+static int sunxi_musb_init(struct musb *musb)
+{
+	void __iomem *base = musb->mregs;
+
+	sunxi_phy_power(1);
+
+	/* Give the FIFOs 8KiB of SRAM D */
+	clrsetbits_le32(SUNXI_SRAMC_BASE + SUNXI_SRAMC_CFG,
+			SUNXI_SRAMC_SRAMD_MASK, SUNXI_SRAMC_SRAMD_USB0);
+
+	/*
+	 * There is no ID pin or VBUS detection here, so force the port to
+	 * the mode it was registered in with a valid VBUS.
+	 */
+	sunxi_iscr_update(base, 0, SUNXI_ISCR_DPDM_PULLUP_EN |
+			  SUNXI_ISCR_ID_PULLUP_EN);
+	sunxi_iscr_update(base, SUNXI_ISCR_FORCE_ID_MASK,
+			  is_host_enabled(musb) ? SUNXI_ISCR_FORCE_ID_LOW :
+			  SUNXI_ISCR_FORCE_ID_HIGH);
+	sunxi_iscr_update(base, SUNXI_ISCR_FORCE_VBUS_MASK,
+			  SUNXI_ISCR_FORCE_VBUS_HIGH);
+
+	musb->isr = sunxi_musb_interrupt;
+
+	return 0;
+}
+
+static int sunxi_musb_exit(struct musb *musb)
+{
+	sunxi_phy_power(0);
+
+	return 0;
+}
+
+const struct musb_platform_ops sunxi_musb_ops = {
+	.init		= sunxi_musb_init,
+	.exit		= sunxi_musb_exit,
+
+	.enable		= sunxi_musb_enable,
+	.disable	= sunxi_musb_disable,
+};
@@ -44,6 +44,12 @@ void lcd_enable(void)
 		puts("LCD init failed\n");
 }
 
+int lcd_pan_display(int yoffset)
+{
+	/* lcd_sync() passes the start of the display to SDL, so nothing to do */
+	return 0;
+}
+
 int sandbox_lcd_sdl_early_init(void)
 {
 	const void *blob = gd->fdt_blob;
@@ -27,8 +27,12 @@
 #include <config.h>
 #include <ext4fs.h>
 #include <ext_common.h>
+#include <bouncebuf.h>
 #include "ext4_common.h"
 
+/* Largest read done through a bounce buffer in one go */
+#define EXT4_BOUNCE_BYTES	65536
+
 lbaint_t part_offset;
 
 static block_dev_desc_t *ext4fs_block_dev_desc;
@@ -45,6 +49,62 @@ void ext4fs_set_blk_dev(block_dev_desc_t *rbdd, disk_partition_t *info)
 		get_fs()->dev_desc->log2blksz;
 }
 
+/*
+ * Read 'nsect' whole sectors into 'buf'. They go straight into the buffer
+ * when it is aligned for DMA, otherwise through a bounce buffer (or one
+ * sector at a time without CONFIG_BOUNCE_BUFFER).
+ * Return 1 on success, 0 otherwise.
+ */
+static int ext4fs_read_sects(lbaint_t sector, lbaint_t nsect, char *buf)
+{
+	block_dev_desc_t *dev_desc = ext4fs_block_dev_desc;
+#ifdef CONFIG_BOUNCE_BUFFER
+	struct bounce_buffer bbstate;
+	lbaint_t max = EXT4_BOUNCE_BYTES >> dev_desc->log2blksz;
+	lbaint_t n;
+#else
+	ALLOC_CACHE_ALIGN_BUFFER(char, sec_buf, dev_desc->blksz);
+#endif
+	unsigned long ret;
+
+	if (!((unsigned long)buf & (ARCH_DMA_MINALIGN - 1))) {
+		ret = dev_desc->block_read(dev_desc->dev,
+					   part_info->start + sector, nsect,
+					   (unsigned long *)buf);
+		return ret == nsect;
+	}
+
+#ifdef CONFIG_BOUNCE_BUFFER
+	while (nsect) {
+		n = min(nsect, max);
+		if (bounce_buffer_start(&bbstate, buf,
+					n << dev_desc->log2blksz,
+					GEN_BB_WRITE))
+			return 0;
+		ret = dev_desc->block_read(dev_desc->dev,
+					   part_info->start + sector, n,
+					   bbstate.bounce_buffer);
+		bounce_buffer_stop(&bbstate);
+		if (ret != n)
+			return 0;
+		sector += n;
+		nsect -= n;
+		buf += n << dev_desc->log2blksz;
+	}
+#else
+	while (nsect--) {
+		if (dev_desc->block_read(dev_desc->dev,
+					 part_info->start + sector++, 1,
+					 (unsigned long *)sec_buf) != 1)
+			return 0;
+		memcpy(buf, sec_buf, dev_desc->blksz);
+		buf += dev_desc->blksz;
+	}
+#endif
+
+	return 1;
+}
+
 int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf)
 {
 	unsigned block_len;
@@ -56,6 +116,9 @@ int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf)
 		printf("** Invalid Block Device Descriptor (NULL)\n");
 		return 0;
 	}
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+	ext4fs_cache_stats.devreads++;
+#endif
 
 	/* Check partition boundaries */
 	if ((sector < 0) ||
@@ -98,21 +161,19 @@ int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf)
 	block_len = byte_len & ~(ext4fs_block_dev_desc->blksz - 1);
 
 	if (block_len == 0) {
-		ALLOC_CACHE_ALIGN_BUFFER(u8, p, ext4fs_block_dev_desc->blksz);
-
-		block_len = ext4fs_block_dev_desc->blksz;
-		ext4fs_block_dev_desc->block_read(ext4fs_block_dev_desc->dev,
-						  part_info->start + sector,
-						  1, (unsigned long *)p);
-		memcpy(buf, p, byte_len);
+		if (ext4fs_block_dev_desc->
+		    block_read(ext4fs_block_dev_desc->dev,
+				part_info->start + sector, 1,
+				(unsigned long *) sec_buf) != 1) {
+			printf(" ** %s read error - block\n", __func__);
+			return 0;
+		}
+		memcpy(buf, sec_buf, byte_len);
 		return 1;
 	}
 
-	if (ext4fs_block_dev_desc->block_read(ext4fs_block_dev_desc->dev,
-					       part_info->start + sector,
-					       block_len >> log2blksz,
-					       (unsigned long *) buf) !=
-					       block_len >> log2blksz) {
+	/* DMA straight into the destination where possible */
+	if (!ext4fs_read_sects(sector, block_len >> log2blksz, buf)) {
 		printf(" ** %s read error - block\n", __func__);
 		return 0;
 	}
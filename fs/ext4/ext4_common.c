@@ -44,6 +44,32 @@ int ext4fs_indir3_blkno = -1;
 struct ext2_inode *g_parent_inode;
 static int symlinknest;
 
+/*
+ * The extent index or leaf block last read at each level of an extent tree,
+ * so that walking a file block by block reads each of them only once
+ */
+#define EXT4_EXT_MAX_DEPTH	5
+static struct {
+	char *buf;
+	unsigned long long blkno;
+} ext4fs_ext_cache[EXT4_EXT_MAX_DEPTH];
+
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+struct ext4fs_cache_stats ext4fs_cache_stats;
+
+/* The device and partition ext4fs_root was mounted from */
+static struct {
+	block_dev_desc_t *dev_desc;
+	lbaint_t start;
+	uint64_t total_sect;
+	int stale;
+} ext4fs_mounted;
+
+/* The whole group descriptor table, read on first use */
+static struct ext2_block_group *ext4fs_gdt;
+static unsigned int ext4fs_gdt_count;
+#endif
+
 #if defined(CONFIG_EXT4_WRITE)
 uint32_t ext4fs_div_roundup(uint32_t size, uint32_t n)
 {
@@ -379,6 +405,13 @@ void ext4fs_update_parent_dentry(char *filename, int *p_ino, int file_type)
 		printf("No Memory\n");
 		return;
 	}
+
+	/*
+	 * The entry is appended without updating the hash index, so the
+	 * index would no longer find it. Turn the index off; e2fsck -D can
+	 * build it again.
+	 */
+	g_parent_inode->flags &= ~EXT4_INDEX_FL;
 restart:
 
 	/* read the block no allocated to a file */
@@ -973,6 +1006,52 @@ fail:
 	return -1;
 }
 
+/* Get the block group holding block 'blknr' */
+static unsigned int ext4fs_blk_group(long int blknr)
+{
+	unsigned int blk_per_grp = ext4fs_root->sblock.blocks_per_group;
+
+	/* With 1KiB blocks, block 0 is the boot block outside any group */
+	if (get_fs()->blksz == 1024)
+		return (blknr - 1) / blk_per_grp;
+
+	return blknr / blk_per_grp;
+}
+
+/*
+ * Allocate up to *count contiguous blocks following on from the last block
+ * allocated. The run ends at the first block in use or at the end of the
+ * block group, so the group bitmap is only journalled once per run.
+ * Returns the first block of the run and sets *count to its length, or
+ * returns -1 if there are no free blocks.
+ */
+long int ext4fs_get_new_blk_run(unsigned int *count)
+{
+	struct ext_filesystem *fs = get_fs();
+	struct ext2_block_group *bgd = (struct ext2_block_group *)fs->gdtable;
+	unsigned int bg_idx, len;
+	long int start;
+
+	start = ext4fs_get_new_blk_no();
+	if (start == -1)
+		return -1;
+
+	bg_idx = ext4fs_blk_group(start);
+	for (len = 1; len < *count; len++) {
+		if (ext4fs_blk_group(start + len) != bg_idx)
+			break;
+		if (ext4fs_set_block_bmap(start + len, fs->blk_bmaps[bg_idx],
+					  bg_idx))
+			break;
+	}
+	bgd[bg_idx].free_blocks -= len - 1;
+	fs->sb->free_blocks -= len - 1;
+	fs->curr_blkno = start + len - 1;
+	*count = len;
+
+	return start;
+}
+
 int ext4fs_get_new_inode_no(void)
 {
 	short i;
@@ -1405,16 +1484,156 @@ void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 	*total_no_of_block += no_blks_reqd;
 }
 
+/*
+ * Build the extent tree of 'file_inode' from the 'count' extents in 'ext'.
+ * Up to four entries fit in the inode itself; beyond that, the entries are
+ * packed into tree blocks and the next level up indexes those, until the
+ * top level fits in the inode. Extent and index entries have the same size
+ * and both start with the first logical block they cover.
+ */
+static int ext4fs_build_extent_tree(struct ext2_inode *file_inode,
+				    struct ext4_extent *ext, int count,
+				    unsigned int *tree_blocks)
+{
+	struct ext_filesystem *fs = get_fs();
+	struct ext4_extent_header *eh;
+	struct ext4_extent_idx *idx;
+	struct ext4_extent *entries = ext;
+	int per_blk, root_max, nblocks, depth = 0;
+	int i, n, ret = -1;
+	long int blknr;
+	char *buf;
+
+	per_blk = (fs->blksz - sizeof(*eh)) / sizeof(*ext);
+	root_max = (sizeof(file_inode->b.blocks) - sizeof(*eh)) / sizeof(*ext);
+
+	buf = zalloc(fs->blksz);
+	if (!buf)
+		return -ENOMEM;
+
+	while (count > root_max) {
+		nblocks = DIV_ROUND_UP(count, per_blk);
+		idx = zalloc(nblocks * sizeof(*idx));
+		if (!idx)
+			goto fail;
+		for (i = 0; i < nblocks; i++) {
+			n = min(per_blk, count - i * per_blk);
+			blknr = ext4fs_get_new_blk_no();
+			if (blknr == -1) {
+				free(idx);
+				goto fail;
+			}
+			(*tree_blocks)++;
+
+			memset(buf, '\0', fs->blksz);
+			eh = (struct ext4_extent_header *)buf;
+			eh->eh_magic = cpu_to_le16(EXT4_EXT_MAGIC);
+			eh->eh_entries = cpu_to_le16(n);
+			eh->eh_max = cpu_to_le16(per_blk);
+			eh->eh_depth = cpu_to_le16(depth);
+			memcpy(eh + 1, &entries[i * per_blk], n * sizeof(*ext));
+			put_ext4((uint64_t)blknr * fs->blksz, buf, fs->blksz);
+
+			idx[i].ei_block = entries[i * per_blk].ee_block;
+			idx[i].ei_leaf_lo = cpu_to_le32(blknr);
+			idx[i].ei_leaf_hi = 0;
+		}
+		if (entries != ext)
+			free(entries);
+		entries = (struct ext4_extent *)idx;
+		count = nblocks;
+		depth++;
+	}
+
+	memset(&file_inode->b.blocks, '\0', sizeof(file_inode->b.blocks));
+	eh = (struct ext4_extent_header *)file_inode->b.blocks.dir_blocks;
+	eh->eh_magic = cpu_to_le16(EXT4_EXT_MAGIC);
+	eh->eh_entries = cpu_to_le16(count);
+	eh->eh_max = cpu_to_le16(root_max);
+	eh->eh_depth = cpu_to_le16(depth);
+	memcpy(eh + 1, entries, count * sizeof(*ext));
+	file_inode->flags |= cpu_to_le32(EXT4_EXTENTS_FL);
+	ret = 0;
+fail:
+	if (entries != ext)
+		free(entries);
+	free(buf);
+
+	return ret;
+}
+
+/*
+ * Allocate the data blocks of 'file_inode' as runs of contiguous blocks and
+ * describe them with an extent tree. Returns the number of extents and sets
+ * *extents to them, for the caller to free, or returns -1 on failure.
+ * Blocks used by the tree itself are added to *total_no_of_block.
+ */
+int ext4fs_allocate_extents(struct ext2_inode *file_inode,
+			    unsigned int total_remaining_blocks,
+			    unsigned int *total_no_of_block,
+			    struct ext4_extent **extents)
+{
+	struct ext4_extent *ext = NULL, *new_ext, *last;
+	unsigned int fileblock = 0, len, tree_blocks = 0;
+	int count = 0, max = 0;
+	long int start;
+
+	while (total_remaining_blocks) {
+		len = min(total_remaining_blocks, EXT4_EXT_MAX_LEN);
+		start = ext4fs_get_new_blk_run(&len);
+		if (start == -1) {
+			printf("no block left to assign\n");
+			goto fail;
+		}
+		debug("EXT %u: %ld +%u\n", fileblock, start, len);
+
+		/* Runs only break at block group boundaries may be merged */
+		last = count ? &ext[count - 1] : NULL;
+		if (last && le32_to_cpu(last->ee_start_lo) +
+		    le16_to_cpu(last->ee_len) == start &&
+		    le16_to_cpu(last->ee_len) + len <= EXT4_EXT_MAX_LEN) {
+			last->ee_len = cpu_to_le16(le16_to_cpu(last->ee_len) +
+						   len);
+		} else {
+			if (count == max) {
+				max = max ? max * 2 : 16;
+				new_ext = realloc(ext, max * sizeof(*ext));
+				if (!new_ext)
+					goto fail;
+				ext = new_ext;
+			}
+			ext[count].ee_block = cpu_to_le32(fileblock);
+			ext[count].ee_len = cpu_to_le16(len);
+			ext[count].ee_start_hi = 0;
+			ext[count].ee_start_lo = cpu_to_le32(start);
+			count++;
+		}
+		fileblock += len;
+		total_remaining_blocks -= len;
+	}
+
+	if (ext4fs_build_extent_tree(file_inode, ext, count, &tree_blocks))
+		goto fail;
+	*total_no_of_block += tree_blocks;
+	*extents = ext;
+
+	return count;
+fail:
+	free(ext);
+
+	return -1;
+}
+
 #endif
 
 static struct ext4_extent_header *ext4fs_get_extent_block
-	(struct ext2_data *data, char *buf,
-		struct ext4_extent_header *ext_block,
+	(struct ext2_data *data, struct ext4_extent_header *ext_block,
 		uint32_t fileblock, int log2_blksz)
 {
 	struct ext4_extent_idx *index;
 	unsigned long long block;
 	int blksz = EXT2_BLOCK_SIZE(data);
+	int depth = 0;
 	int i;
 
 	while (1) {
@@ -1432,19 +1651,71 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 				break;
 		} while (fileblock >= le32_to_cpu(index[i].ei_block));
 
-		if (--i < 0)
+		if (--i < 0 || depth >= EXT4_EXT_MAX_DEPTH)
 			return 0;
 
 		block = le16_to_cpu(index[i].ei_leaf_hi);
 		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
 
-		if (ext4fs_devread((lbaint_t)block << log2_blksz, 0, blksz,
-				   buf))
-			ext_block = (struct ext4_extent_header *)buf;
-		else
+		if (!ext4fs_ext_cache[depth].buf) {
+			ext4fs_ext_cache[depth].buf = zalloc(blksz);
+			if (!ext4fs_ext_cache[depth].buf)
+				return 0;
+		} else if (ext4fs_ext_cache[depth].blkno == block) {
+			ext_block = (struct ext4_extent_header *)
+				ext4fs_ext_cache[depth++].buf;
+			continue;
+		}
+
+		ext4fs_ext_cache[depth].blkno = 0;
+		if (!ext4fs_devread((lbaint_t)block << log2_blksz, 0, blksz,
+				    ext4fs_ext_cache[depth].buf))
 			return 0;
+		ext4fs_ext_cache[depth].blkno = block;
+		ext_block = (struct ext4_extent_header *)
+			ext4fs_ext_cache[depth++].buf;
+	}
+}
+
+void ext4fs_extent_cache_flush(void)
+{
+	int i;
+
+	for (i = 0; i < EXT4_EXT_MAX_DEPTH; i++) {
+		free(ext4fs_ext_cache[i].buf);
+		ext4fs_ext_cache[i].buf = NULL;
+		ext4fs_ext_cache[i].blkno = 0;
+	}
+}
+
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+static void ext4fs_gdt_load(struct ext2_data *data)
+{
+	struct ext2_sblock *sblock = &data->sblock;
+	int log2blksz = get_fs()->dev_desc->log2blksz;
+	unsigned int count, size;
+	long int blkno;
+
+	count = (__le32_to_cpu(sblock->total_blocks) -
+		 __le32_to_cpu(sblock->first_data_block) +
+		 __le32_to_cpu(sblock->blocks_per_group) - 1) /
+		__le32_to_cpu(sblock->blocks_per_group);
+	size = roundup(count * sizeof(struct ext2_block_group),
+		       EXT2_BLOCK_SIZE(data));
+	ext4fs_gdt = zalloc(size);
+	if (!ext4fs_gdt)
+		return;
+
+	blkno = __le32_to_cpu(sblock->first_data_block) + 1;
+	if (!ext4fs_devread((lbaint_t)blkno << (LOG2_BLOCK_SIZE(data) -
+			    log2blksz), 0, size, (char *)ext4fs_gdt)) {
+		free(ext4fs_gdt);
+		ext4fs_gdt = NULL;
+		return;
 	}
+	ext4fs_gdt_count = count;
 }
+#endif
 
 static int ext4fs_blockgroup
 	(struct ext2_data *data, int group, struct ext2_block_group *blkgrp)
@@ -1455,6 +1726,17 @@ static int ext4fs_blockgroup
 
 	desc_per_blk = EXT2_BLOCK_SIZE(data) / sizeof(struct ext2_block_group);
 
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+	if (!ext4fs_gdt)
+		ext4fs_gdt_load(data);
+	if (ext4fs_gdt && group < ext4fs_gdt_count) {
+		memcpy(blkgrp, &ext4fs_gdt[group], sizeof(*blkgrp));
+		ext4fs_cache_stats.gdt_hits++;
+		ext4fs_cache_stats.saved_reads++;
+		return 1;
+	}
+#endif
+
 	blkno = __le32_to_cpu(data->sblock.first_data_block) + 1 +
 			group / desc_per_blk;
 	blkoff = (group % desc_per_blk) * sizeof(struct ext2_block_group);
@@ -1515,20 +1797,16 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 		- get_fs()->dev_desc->log2blksz;
 
 	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
-		char *buf = zalloc(blksz);
-		if (!buf)
-			return -ENOMEM;
 		struct ext4_extent_header *ext_block;
 		struct ext4_extent *extent;
 		int i = -1;
 		ext_block =
-			ext4fs_get_extent_block(ext4fs_root, buf,
+			ext4fs_get_extent_block(ext4fs_root,
 						(struct ext4_extent_header *)
 						inode->b.blocks.dir_blocks,
 						fileblock, log2_blksz);
 		if (!ext_block) {
 			printf("invalid extent block\n");
-			free(buf);
 			return -EINVAL;
 		}
 
@@ -1541,20 +1819,16 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 		} while (fileblock >= le32_to_cpu(extent[i].ee_block));
 		if (--i >= 0) {
 			fileblock -= le32_to_cpu(extent[i].ee_block);
-			if (fileblock >= le16_to_cpu(extent[i].ee_len)) {
-				free(buf);
+			if (fileblock >= le16_to_cpu(extent[i].ee_len))
 				return 0;
-			}
 
 			start = le16_to_cpu(extent[i].ee_start_hi);
 			start = (start << 32) +
 					le32_to_cpu(extent[i].ee_start_lo);
-			free(buf);
 			return fileblock + start;
 		}
 
 		printf("Extent Error\n");
-		free(buf);
 		return -1;
 	}
 
@@ -1843,12 +2117,17 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock)
 	return blknr;
 }
 
-void ext4fs_close(void)
+static void ext4fs_umount(void)
 {
-	if ((ext4fs_file != NULL) && (ext4fs_root != NULL)) {
-		ext4fs_free_node(ext4fs_file, &ext4fs_root->diropen);
-		ext4fs_file = NULL;
-	}
+	ext4fs_dcache_flush();
+	ext4fs_extent_cache_flush();
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+	free(ext4fs_gdt);
+	ext4fs_gdt = NULL;
+	ext4fs_gdt_count = 0;
+	ext4fs_mounted.dev_desc = NULL;
+	ext4fs_mounted.stale = 0;
+#endif
 	if (ext4fs_root != NULL) {
 		free(ext4fs_root);
 		ext4fs_root = NULL;
@@ -1873,12 +2152,331 @@ void ext4fs_close(void)
 	}
 }
 
+void ext4fs_close(void)
+{
+	if ((ext4fs_file != NULL) && (ext4fs_root != NULL)) {
+		ext4fs_free_node(ext4fs_file, &ext4fs_root->diropen);
+		ext4fs_file = NULL;
+	}
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+	/* Keep the mount for the next command unless it was written to */
+	if (ext4fs_root != NULL && !ext4fs_mounted.stale)
+		return;
+#endif
+	ext4fs_umount();
+}
+
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+/*
+ * Check whether ext4fs_root is still what the current device holds. The
+ * superblock is read back and compared, which catches a swapped card or a
+ * filesystem that was changed by something other than us.
+ */
+static int ext4fs_mount_cached(void)
+{
+	struct ext_filesystem *fs = get_fs();
+	char *sblock;
+	int same;
+
+	if (ext4fs_root == NULL || ext4fs_mounted.stale ||
+	    ext4fs_mounted.dev_desc != fs->dev_desc ||
+	    ext4fs_mounted.start != part_offset ||
+	    ext4fs_mounted.total_sect != fs->total_sect)
+		return 0;
+
+	sblock = zalloc(SUPERBLOCK_SIZE);
+	if (!sblock)
+		return 0;
+	same = ext4_read_superblock(sblock) &&
+		!memcmp(sblock, &ext4fs_root->sblock,
+			sizeof(struct ext2_sblock));
+	free(sblock);
+	if (!same)
+		return 0;
+
+	/* The root inode does not need reading again */
+	ext4fs_cache_stats.mount_hits++;
+	ext4fs_cache_stats.saved_reads++;
+
+	return 1;
+}
+
+void ext4fs_cache_invalidate(void)
+{
+	ext4fs_mounted.stale = 1;
+}
+
+void ext4fs_cache_print(void)
+{
+	struct ext4fs_cache_stats *stats = &ext4fs_cache_stats;
+
+	if (ext4fs_root != NULL && !ext4fs_mounted.stale) {
+		printf("Mounted:      device %d, start " LBAFU ", %llu sectors\n",
+		       ext4fs_mounted.dev_desc->dev, ext4fs_mounted.start,
+		       ext4fs_mounted.total_sect);
+		printf("Groups:       %u%s\n", ext4fs_gdt_count,
+		       ext4fs_gdt ? "" : " (not cached)");
+	} else {
+		printf("Mounted:      none\n");
+	}
+	printf("Mounts:       %lu (%lu from cache)\n", stats->mounts,
+	       stats->mount_hits);
+	printf("Group descs:  %lu from cache\n", stats->gdt_hits);
+	printf("Name lookups: %lu from cache, %lu read\n", stats->dcache_hits,
+	       stats->dcache_misses);
+	printf("Device reads: %lu\n", stats->devreads);
+	printf("Reads saved:  %lu or more\n", stats->saved_reads);
+}
+#endif
+
+/*
+ * Cache of recent name lookups, keyed by parent directory inode and name.
+ * It only lives as long as the mount and is dropped whenever we write.
+ */
+struct ext4fs_dentry {
+	int dir_ino;
+	int ino;
+	int type;
+	char *name;
+};
+
+static struct ext4fs_dentry ext4fs_dcache[CONFIG_EXT4_DCACHE_ENTRIES];
+
+static struct ext4fs_dentry *ext4fs_dcache_slot(int dir_ino, const char *name)
+{
+	unsigned int hash = dir_ino;
+
+	while (*name)
+		hash = hash * 31 + (unsigned char)*name++;
+
+	return &ext4fs_dcache[hash % CONFIG_EXT4_DCACHE_ENTRIES];
+}
+
+static struct ext2fs_node *ext4fs_dcache_lookup(struct ext2fs_node *dir,
+						const char *name, int *ftype)
+{
+	struct ext4fs_dentry *dentry = ext4fs_dcache_slot(dir->ino, name);
+	struct ext2fs_node *fdiro;
+
+	if (!dentry->name || dentry->dir_ino != dir->ino ||
+	    strcmp(dentry->name, name)) {
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+		ext4fs_cache_stats.dcache_misses++;
+#endif
+		return NULL;
+	}
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+	ext4fs_cache_stats.dcache_hits++;
+	ext4fs_cache_stats.saved_reads++;
+#endif
+
+	fdiro = zalloc(sizeof(struct ext2fs_node));
+	if (!fdiro)
+		return NULL;
+	fdiro->data = dir->data;
+	fdiro->ino = dentry->ino;
+	*ftype = dentry->type;
+
+	return fdiro;
+}
+
+static void ext4fs_dcache_add(int dir_ino, const char *name, int ino, int type)
+{
+	struct ext4fs_dentry *dentry = ext4fs_dcache_slot(dir_ino, name);
+
+	free(dentry->name);
+	dentry->name = strdup(name);
+	dentry->dir_ino = dir_ino;
+	dentry->ino = ino;
+	dentry->type = type;
+}
+
+void ext4fs_dcache_flush(void)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_EXT4_DCACHE_ENTRIES; i++) {
+		free(ext4fs_dcache[i].name);
+		ext4fs_dcache[i].name = NULL;
+	}
+}
+
+struct ext2_dirent *ext4fs_find_dirent(char *buf, unsigned int len,
+				       const char *name, int namelen)
+{
+	struct ext2_dirent *dirent;
+	unsigned int pos, direntlen;
+
+	for (pos = 0; pos + sizeof(struct ext2_dirent) <= len;
+	     pos += direntlen) {
+		dirent = (struct ext2_dirent *)(buf + pos);
+		direntlen = __le16_to_cpu(dirent->direntlen);
+		if (direntlen < sizeof(struct ext2_dirent) ||
+		    pos + direntlen > len)
+			break;
+		if (dirent->inode && dirent->namelen == namelen &&
+		    !memcmp(dirent + 1, name, namelen))
+			return dirent;
+	}
+
+	return NULL;
+}
+
+/* Make a node for a directory entry and work out what type it is */
+static struct ext2fs_node *ext4fs_dirent_node(struct ext2fs_node *diro,
+					      struct ext2_dirent *dirent,
+					      int *ftype)
+{
+	struct ext2fs_node *fdiro;
+	int type = FILETYPE_UNKNOWN;
+	int status;
+
+	fdiro = zalloc(sizeof(struct ext2fs_node));
+	if (!fdiro)
+		return NULL;
+
+	fdiro->data = diro->data;
+	fdiro->ino = __le32_to_cpu(dirent->inode);
+
+	if (dirent->filetype != FILETYPE_UNKNOWN) {
+		fdiro->inode_read = 0;
+
+		if (dirent->filetype == FILETYPE_DIRECTORY)
+			type = FILETYPE_DIRECTORY;
+		else if (dirent->filetype == FILETYPE_SYMLINK)
+			type = FILETYPE_SYMLINK;
+		else if (dirent->filetype == FILETYPE_REG)
+			type = FILETYPE_REG;
+	} else {
+		status = ext4fs_read_inode(diro->data,
+					   __le32_to_cpu(dirent->inode),
+					   &fdiro->inode);
+		if (status == 0) {
+			free(fdiro);
+			return NULL;
+		}
+		fdiro->inode_read = 1;
+
+		if ((__le16_to_cpu(fdiro->inode.mode) &
+		     FILETYPE_INO_MASK) == FILETYPE_INO_DIRECTORY) {
+			type = FILETYPE_DIRECTORY;
+		} else if ((__le16_to_cpu(fdiro->inode.mode)
+			    & FILETYPE_INO_MASK) == FILETYPE_INO_SYMLINK) {
+			type = FILETYPE_SYMLINK;
+		} else if ((__le16_to_cpu(fdiro->inode.mode)
+			    & FILETYPE_INO_MASK) == FILETYPE_INO_REG) {
+			type = FILETYPE_REG;
+		}
+	}
+	*ftype = type;
+
+	return fdiro;
+}
+
+static int ext4fs_print_dirent(struct ext2fs_node *diro,
+			       struct ext2_dirent *dirent)
+{
+	char filename[dirent->namelen + 1];
+	struct ext2fs_node *fdiro;
+	int status;
+	int type;
+
+	fdiro = ext4fs_dirent_node(diro, dirent, &type);
+	if (!fdiro)
+		return -1;
+
+	memcpy(filename, dirent + 1, dirent->namelen);
+	filename[dirent->namelen] = '\0';
+
+	if (fdiro->inode_read == 0) {
+		status = ext4fs_read_inode(diro->data, fdiro->ino,
+					   &fdiro->inode);
+		if (status == 0) {
+			free(fdiro);
+			return -1;
+		}
+		fdiro->inode_read = 1;
+	}
+	switch (type) {
+	case FILETYPE_DIRECTORY:
+		printf("<DIR> ");
+		break;
+	case FILETYPE_SYMLINK:
+		printf("<SYM> ");
+		break;
+	case FILETYPE_REG:
+		printf("      ");
+		break;
+	default:
+		printf("< ? > ");
+		break;
+	}
+	printf("%10d %s\n", __le32_to_cpu(fdiro->inode.size), filename);
+	free(fdiro);
+
+	return 0;
+}
+
+/*
+ * Go through the directory a block at a time, either listing it (name is
+ * NULL) or looking for name. Returns 1 and fills in *dirent if found.
+ */
+static int ext4fs_scan_dir(struct ext2fs_node *diro, const char *name,
+			   struct ext2_dirent *dirent)
+{
+	unsigned int size = __le32_to_cpu(diro->inode.size);
+	unsigned int blksz = EXT2_BLOCK_SIZE(diro->data);
+	struct ext2_dirent *de;
+	unsigned int fpos, pos, len;
+	char *buf;
+	int ret = 0;
+
+	buf = zalloc(blksz);
+	if (!buf)
+		return 0;
+
+	for (fpos = 0; fpos < size; fpos += blksz) {
+		len = min(blksz, size - fpos);
+		if (ext4fs_read_file(diro, fpos, len, buf) < 1)
+			break;
+
+		if (name) {
+			de = ext4fs_find_dirent(buf, len, name, strlen(name));
+			if (de) {
+				memcpy(dirent, de, sizeof(*dirent));
+				ret = 1;
+				break;
+			}
+			continue;
+		}
+
+		for (pos = 0; pos + sizeof(struct ext2_dirent) <= len;
+		     pos += __le16_to_cpu(de->direntlen)) {
+			de = (struct ext2_dirent *)(buf + pos);
+			if (__le16_to_cpu(de->direntlen) <
+			    sizeof(struct ext2_dirent))
+				break;
+			if (de->namelen == 0 ||
+			    pos + sizeof(*de) + de->namelen > len)
+				continue;
+			if (ext4fs_print_dirent(diro, de))
+				goto out;
+		}
+	}
+out:
+	free(buf);
+
+	return ret;
+}
+
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 				struct ext2fs_node **fnode, int *ftype)
 {
-	unsigned int fpos = 0;
-	int status;
 	struct ext2fs_node *diro = (struct ext2fs_node *) dir;
+	struct ext2_sblock *sb = &diro->data->sblock;
+	struct ext2fs_node *fdiro;
+	struct ext2_dirent dirent;
+	int status;
 
 #ifdef DEBUG
 	if (name != NULL)
@@ -1889,116 +2487,36 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 		if (status == 0)
 			return 0;
 	}
-	/* Search the file.  */
-	while (fpos < __le32_to_cpu(diro->inode.size)) {
-		struct ext2_dirent dirent;
-
-		status = ext4fs_read_file(diro, fpos,
-					   sizeof(struct ext2_dirent),
-					   (char *) &dirent);
-		if (status < 1)
-			return 0;
-
-		if (dirent.namelen != 0) {
-			char filename[dirent.namelen + 1];
-			struct ext2fs_node *fdiro;
-			int type = FILETYPE_UNKNOWN;
 
-			status = ext4fs_read_file(diro,
-						  fpos +
-						  sizeof(struct ext2_dirent),
-						  dirent.namelen, filename);
-			if (status < 1)
-				return 0;
-
-			fdiro = zalloc(sizeof(struct ext2fs_node));
-			if (!fdiro)
-				return 0;
+	if ((name == NULL) || (fnode == NULL) || (ftype == NULL)) {
+		ext4fs_scan_dir(diro, NULL, NULL);
+		return 0;
+	}
 
-			fdiro->data = diro->data;
-			fdiro->ino = __le32_to_cpu(dirent.inode);
+	fdiro = ext4fs_dcache_lookup(diro, name, ftype);
+	if (fdiro) {
+		*fnode = fdiro;
+		return 1;
+	}
 
-			filename[dirent.namelen] = '\0';
+	/* Use the hash index if there is one, else fall back to a scan */
+	status = -1;
+	if ((__le32_to_cpu(sb->feature_compatibility) &
+	     EXT4_FEATURE_COMPAT_DIR_INDEX) &&
+	    (__le32_to_cpu(diro->inode.flags) & EXT4_INDEX_FL))
+		status = ext4fs_dx_lookup(diro, name, &dirent);
+	if (status < 0)
+		status = ext4fs_scan_dir(diro, name, &dirent);
+	if (status <= 0)
+		return 0;
 
-			if (dirent.filetype != FILETYPE_UNKNOWN) {
-				fdiro->inode_read = 0;
+	fdiro = ext4fs_dirent_node(diro, &dirent, ftype);
+	if (!fdiro)
+		return 0;
+	ext4fs_dcache_add(diro->ino, name, fdiro->ino, *ftype);
+	*fnode = fdiro;
 
-				if (dirent.filetype == FILETYPE_DIRECTORY)
-					type = FILETYPE_DIRECTORY;
-				else if (dirent.filetype == FILETYPE_SYMLINK)
-					type = FILETYPE_SYMLINK;
-				else if (dirent.filetype == FILETYPE_REG)
-					type = FILETYPE_REG;
-			} else {
-				status = ext4fs_read_inode(diro->data,
-							   __le32_to_cpu
-							   (dirent.inode),
-							   &fdiro->inode);
-				if (status == 0) {
-					free(fdiro);
-					return 0;
-				}
-				fdiro->inode_read = 1;
-
-				if ((__le16_to_cpu(fdiro->inode.mode) &
-				     FILETYPE_INO_MASK) ==
-				    FILETYPE_INO_DIRECTORY) {
-					type = FILETYPE_DIRECTORY;
-				} else if ((__le16_to_cpu(fdiro->inode.mode)
-					    & FILETYPE_INO_MASK) ==
-					   FILETYPE_INO_SYMLINK) {
-					type = FILETYPE_SYMLINK;
-				} else if ((__le16_to_cpu(fdiro->inode.mode)
-					    & FILETYPE_INO_MASK) ==
-					   FILETYPE_INO_REG) {
-					type = FILETYPE_REG;
-				}
-			}
-#ifdef DEBUG
-			printf("iterate >%s<\n", filename);
-#endif /* of DEBUG */
-			if ((name != NULL) && (fnode != NULL)
-			    && (ftype != NULL)) {
-				if (strcmp(filename, name) == 0) {
-					*ftype = type;
-					*fnode = fdiro;
-					return 1;
-				}
-			} else {
-				if (fdiro->inode_read == 0) {
-					status = ext4fs_read_inode(diro->data,
-								 __le32_to_cpu(
-								 dirent.inode),
-								 &fdiro->inode);
-					if (status == 0) {
-						free(fdiro);
-						return 0;
-					}
-					fdiro->inode_read = 1;
-				}
-				switch (type) {
-				case FILETYPE_DIRECTORY:
-					printf("<DIR> ");
-					break;
-				case FILETYPE_SYMLINK:
-					printf("<SYM> ");
-					break;
-				case FILETYPE_REG:
-					printf("      ");
-					break;
-				default:
-					printf("< ? > ");
-					break;
-				}
-				printf("%10d %s\n",
-					__le32_to_cpu(fdiro->inode.size),
-					filename);
-			}
-			free(fdiro);
-		}
-		fpos += __le16_to_cpu(dirent.direntlen);
-	}
-	return 0;
+	return 1;
 }
 
 static char *ext4fs_read_symlink(struct ext2fs_node *node)
@@ -2192,6 +2710,14 @@ int ext4fs_mount(unsigned part_length)
 	struct ext2_data *data;
 	int status;
 	struct ext_filesystem *fs = get_fs();
+
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+	ext4fs_cache_stats.mounts++;
+	if (ext4fs_mount_cached())
+		return 1;
+#endif
+	ext4fs_umount();
+
 	data = zalloc(SUPERBLOCK_SIZE);
 	if (!data)
 		return 0;
@@ -2224,6 +2750,11 @@ int ext4fs_mount(unsigned part_length)
 		goto fail;
 
 	ext4fs_root = data;
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+	ext4fs_mounted.dev_desc = fs->dev_desc;
+	ext4fs_mounted.start = part_offset;
+	ext4fs_mounted.total_sect = fs->total_sect;
+#endif
 
 	return 1;
 fail:
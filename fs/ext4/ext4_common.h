@@ -41,6 +41,11 @@
 #define SUPERBLOCK_SIZE	1024
 #define F_FILE			1
 
+/* Number of name lookups remembered while a filesystem is mounted */
+#ifndef CONFIG_EXT4_DCACHE_ENTRIES
+#define CONFIG_EXT4_DCACHE_ENTRIES	64
+#endif
+
 static inline void *zalloc(size_t size)
 {
 	void *p = memalign(ARCH_DMA_MINALIGN, size);
@@ -56,6 +61,12 @@ int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
 			struct ext2fs_node **foundnode, int expecttype);
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			struct ext2fs_node **fnode, int *ftype);
+struct ext2_dirent *ext4fs_find_dirent(char *buf, unsigned int len,
+				       const char *name, int namelen);
+int ext4fs_dx_lookup(struct ext2fs_node *dir, const char *name,
+		     struct ext2_dirent *dirent);
+void ext4fs_dcache_flush(void);
+void ext4fs_extent_cache_flush(void);
 
 #if defined(CONFIG_EXT4_WRITE)
 uint32_t ext4fs_div_roundup(uint32_t size, uint32_t n);
@@ -63,6 +74,7 @@ int ext4fs_checksum_update(unsigned int i);
 int ext4fs_get_parent_inode_num(const char *dirname, char *dname, int flags);
 void ext4fs_update_parent_dentry(char *filename, int *p_ino, int file_type);
 long int ext4fs_get_new_blk_no(void);
+long int ext4fs_get_new_blk_run(unsigned int *count);
 int ext4fs_get_new_inode_no(void);
 void ext4fs_reset_block_bmap(long int blockno, unsigned char *buffer,
 					int index);
@@ -73,6 +85,10 @@ int ext4fs_iget(int inode_no, struct ext2_inode *inode);
 void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 				unsigned int total_remaining_blocks,
 				unsigned int *total_no_of_block);
+int ext4fs_allocate_extents(struct ext2_inode *file_inode,
+			    unsigned int total_remaining_blocks,
+			    unsigned int *total_no_of_block,
+			    struct ext4_extent **extents);
 void put_ext4(uint64_t off, void *buf, uint32_t size);
 #endif
 #endif
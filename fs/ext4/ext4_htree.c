@@ -0,0 +1,462 @@
+/*
+ * Lookups in hash-indexed (htree) ext4 directories
+ *
+ * The directory hash functions are taken from Linux fs/ext4/hash.c,
+ * Copyright (C) 2002 by Theodore Ts'o
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <ext_common.h>
+#include <ext4fs.h>
+#include <malloc.h>
+#include <asm/byteorder.h>
+#include "ext4_common.h"
+
+#define DX_HASH_LEGACY			0
+#define DX_HASH_HALF_MD4		1
+#define DX_HASH_TEA			2
+#define DX_HASH_LEGACY_UNSIGNED		3
+#define DX_HASH_HALF_MD4_UNSIGNED	4
+#define DX_HASH_TEA_UNSIGNED		5
+
+#define DX_HTREE_EOF			0x7fffffff
+#define DX_MAX_LEVELS			3	/* with the largedir feature */
+#define DX_BLOCK_MASK			0x00ffffff
+
+/*
+ * Block 0 of an indexed directory starts with the '.' and '..' entries,
+ * the latter covering the rest of the block. The index lives inside it.
+ */
+struct dx_root_info {
+	__le32 reserved_zero;
+	__u8 hash_version;
+	__u8 info_length;	/* 8 */
+	__u8 indirect_levels;
+	__u8 unused_flags;
+};
+
+#define DX_ROOT_INFO_OFFSET	24	/* after the '.' and '..' entries */
+
+/* The first entry of each index block holds the limit and count instead */
+struct dx_entry {
+	__le32 hash;
+	__le32 block;
+};
+
+struct dx_countlimit {
+	__le16 limit;
+	__le16 count;
+};
+
+struct dx_frame {
+	char *buf;
+	struct dx_entry *entries;
+	struct dx_entry *at;
+	unsigned int count;
+};
+
+#define DELTA 0x9E3779B9
+
+static void tea_transform(__u32 buf[4], __u32 const in[])
+{
+	__u32 sum = 0;
+	__u32 b0 = buf[0], b1 = buf[1];
+	__u32 a = in[0], b = in[1], c = in[2], d = in[3];
+	int n = 16;
+
+	do {
+		sum += DELTA;
+		b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+		b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+	} while (--n);
+
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+static inline __u32 rol32(__u32 word, unsigned int shift)
+{
+	return (word << shift) | (word >> (32 - shift));
+}
+
+/* F, G and H are basic MD4 functions: selection, majority, parity */
+#define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define H(x, y, z) ((x) ^ (y) ^ (z))
+
+#define MD4_ROUND(f, a, b, c, d, x, s)	\
+	(a += f(b, c, d) + x, a = rol32(a, s))
+#define K1 0
+#define K2 013240474631UL
+#define K3 015666365641UL
+
+/* Basic cut-down MD4 transform, returns only 32 bits of result */
+static void half_md4_transform(__u32 buf[4], __u32 const in[8])
+{
+	__u32 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	/* Round 1 */
+	MD4_ROUND(F, a, b, c, d, in[0] + K1,  3);
+	MD4_ROUND(F, d, a, b, c, in[1] + K1,  7);
+	MD4_ROUND(F, c, d, a, b, in[2] + K1, 11);
+	MD4_ROUND(F, b, c, d, a, in[3] + K1, 19);
+	MD4_ROUND(F, a, b, c, d, in[4] + K1,  3);
+	MD4_ROUND(F, d, a, b, c, in[5] + K1,  7);
+	MD4_ROUND(F, c, d, a, b, in[6] + K1, 11);
+	MD4_ROUND(F, b, c, d, a, in[7] + K1, 19);
+
+	/* Round 2 */
+	MD4_ROUND(G, a, b, c, d, in[1] + K2,  3);
+	MD4_ROUND(G, d, a, b, c, in[3] + K2,  5);
+	MD4_ROUND(G, c, d, a, b, in[5] + K2,  9);
+	MD4_ROUND(G, b, c, d, a, in[7] + K2, 13);
+	MD4_ROUND(G, a, b, c, d, in[0] + K2,  3);
+	MD4_ROUND(G, d, a, b, c, in[2] + K2,  5);
+	MD4_ROUND(G, c, d, a, b, in[4] + K2,  9);
+	MD4_ROUND(G, b, c, d, a, in[6] + K2, 13);
+
+	/* Round 3 */
+	MD4_ROUND(H, a, b, c, d, in[3] + K3,  3);
+	MD4_ROUND(H, d, a, b, c, in[7] + K3,  9);
+	MD4_ROUND(H, c, d, a, b, in[2] + K3, 11);
+	MD4_ROUND(H, b, c, d, a, in[6] + K3, 15);
+	MD4_ROUND(H, a, b, c, d, in[1] + K3,  3);
+	MD4_ROUND(H, d, a, b, c, in[5] + K3,  9);
+	MD4_ROUND(H, c, d, a, b, in[0] + K3, 11);
+	MD4_ROUND(H, b, c, d, a, in[4] + K3, 15);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+#undef MD4_ROUND
+#undef F
+#undef G
+#undef H
+#undef K1
+#undef K2
+#undef K3
+
+/* The old legacy hash */
+static __u32 dx_hack_hash_unsigned(const char *name, int len)
+{
+	__u32 hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+	const unsigned char *ucp = (const unsigned char *)name;
+
+	while (len--) {
+		hash = hash1 + (hash0 ^ (((int)*ucp++) * 7152373));
+
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+	return hash0 << 1;
+}
+
+static __u32 dx_hack_hash_signed(const char *name, int len)
+{
+	__u32 hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+	const signed char *scp = (const signed char *)name;
+
+	while (len--) {
+		hash = hash1 + (hash0 ^ (((int)*scp++) * 7152373));
+
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+	return hash0 << 1;
+}
+
+static void str2hashbuf_signed(const char *msg, int len, __u32 *buf, int num)
+{
+	__u32 pad, val;
+	int i;
+	const signed char *scp = (const signed char *)msg;
+
+	pad = (__u32)len | ((__u32)len << 8);
+	pad |= pad << 16;
+
+	val = pad;
+	if (len > num * 4)
+		len = num * 4;
+	for (i = 0; i < len; i++) {
+		if ((i % 4) == 0)
+			val = pad;
+		val = ((int)scp[i]) + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+	if (--num >= 0)
+		*buf++ = val;
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+static void str2hashbuf_unsigned(const char *msg, int len, __u32 *buf,
+				 int num)
+{
+	__u32 pad, val;
+	int i;
+	const unsigned char *ucp = (const unsigned char *)msg;
+
+	pad = (__u32)len | ((__u32)len << 8);
+	pad |= pad << 16;
+
+	val = pad;
+	if (len > num * 4)
+		len = num * 4;
+	for (i = 0; i < len; i++) {
+		if ((i % 4) == 0)
+			val = pad;
+		val = ((int)ucp[i]) + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+	if (--num >= 0)
+		*buf++ = val;
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+/*
+ * Work out the directory hash of a name, as Linux ext4fs_dirhash() does.
+ * The low bit is left clear; it marks hash collisions in the index.
+ * Returns 0 on success, -1 for an unknown hash version.
+ */
+static int ext4fs_dirhash(const char *name, int len, const __u32 *seed,
+			  int version, __u32 *hashp)
+{
+	void (*str2hashbuf)(const char *, int, __u32 *, int) =
+		str2hashbuf_signed;
+	__u32 in[8], buf[4];
+	__u32 hash;
+	int i;
+
+	/* Initialize the default seed for the hash checksum functions */
+	buf[0] = 0x67452301;
+	buf[1] = 0xefcdab89;
+	buf[2] = 0x98badcfe;
+	buf[3] = 0x10325476;
+
+	/* Check to see if the seed is all zero's */
+	for (i = 0; i < 4; i++) {
+		if (seed[i]) {
+			for (i = 0; i < 4; i++)
+				buf[i] = __le32_to_cpu(seed[i]);
+			break;
+		}
+	}
+
+	switch (version) {
+	case DX_HASH_LEGACY_UNSIGNED:
+		hash = dx_hack_hash_unsigned(name, len);
+		break;
+	case DX_HASH_LEGACY:
+		hash = dx_hack_hash_signed(name, len);
+		break;
+	case DX_HASH_HALF_MD4_UNSIGNED:
+		str2hashbuf = str2hashbuf_unsigned;
+		/* fall through */
+	case DX_HASH_HALF_MD4:
+		while (len > 0) {
+			str2hashbuf(name, len, in, 8);
+			half_md4_transform(buf, in);
+			len -= 32;
+			name += 32;
+		}
+		hash = buf[1];
+		break;
+	case DX_HASH_TEA_UNSIGNED:
+		str2hashbuf = str2hashbuf_unsigned;
+		/* fall through */
+	case DX_HASH_TEA:
+		while (len > 0) {
+			str2hashbuf(name, len, in, 4);
+			tea_transform(buf, in);
+			len -= 16;
+			name += 16;
+		}
+		hash = buf[0];
+		break;
+	default:
+		return -1;
+	}
+
+	hash &= ~1;
+	if (hash == (DX_HTREE_EOF << 1))
+		hash = (DX_HTREE_EOF - 1) << 1;
+	*hashp = hash;
+
+	return 0;
+}
+
+static int ext4fs_dx_read_block(struct ext2fs_node *dir, unsigned int block,
+				char *buf)
+{
+	unsigned int blksz = EXT2_BLOCK_SIZE(dir->data);
+
+	if ((block + 1) * blksz > __le32_to_cpu(dir->inode.size))
+		return -1;
+	if (ext4fs_read_file(dir, block * blksz, blksz, buf) != blksz)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * Check the count and limit of the index entries at the start of 'frame'
+ * and find the entry whose range covers 'hash'.
+ */
+static int ext4fs_dx_search(struct dx_frame *frame, unsigned int blksz,
+			    __u32 hash)
+{
+	struct dx_countlimit *cl = (struct dx_countlimit *)frame->entries;
+	struct dx_entry *p, *q, *m;
+	unsigned int limit = __le16_to_cpu(cl->limit);
+
+	frame->count = __le16_to_cpu(cl->count);
+	if (!frame->count || frame->count > limit ||
+	    (char *)(frame->entries + limit) > frame->buf + blksz)
+		return -1;
+
+	p = frame->entries + 1;
+	q = frame->entries + frame->count - 1;
+	while (p <= q) {
+		m = p + (q - p) / 2;
+		if (__le32_to_cpu(m->hash) > hash)
+			q = m - 1;
+		else
+			p = m + 1;
+	}
+	frame->at = p - 1;
+
+	return 0;
+}
+
+/*
+ * Step to the next leaf if it continues the run of names with this hash,
+ * i.e. the index entry after ours has the collision bit set. Returns 1 and
+ * the leaf block number if so, 0 if not and -1 on error.
+ */
+static int ext4fs_dx_next_leaf(struct ext2fs_node *dir, struct dx_frame *frames,
+			       int levels, __u32 hash, unsigned int *block)
+{
+	unsigned int blksz = EXT2_BLOCK_SIZE(dir->data);
+	struct dx_frame *frame = frames + levels;
+	__u32 next;
+
+	/* Find the lowest level that has an entry after the current one */
+	while (++frame->at >= frame->entries + frame->count) {
+		if (frame == frames)
+			return 0;
+		frame--;
+	}
+
+	next = __le32_to_cpu(frame->at->hash);
+	if (!(next & 1) || (next & ~1) != hash)
+		return 0;
+
+	/* Walk back down the leftmost path below the new entry */
+	while (frame < frames + levels) {
+		*block = __le32_to_cpu(frame->at->block) & DX_BLOCK_MASK;
+		frame++;
+		if (ext4fs_dx_read_block(dir, *block, frame->buf))
+			return -1;
+		frame->entries = (struct dx_entry *)(frame->buf +
+						      sizeof(struct ext2_dirent));
+		if (ext4fs_dx_search(frame, blksz, 0))
+			return -1;
+		frame->at = frame->entries;
+	}
+	*block = __le32_to_cpu(frame->at->block) & DX_BLOCK_MASK;
+
+	return 1;
+}
+
+int ext4fs_dx_lookup(struct ext2fs_node *dir, const char *name,
+		     struct ext2_dirent *dirent)
+{
+	struct ext2_sblock *sb = &dir->data->sblock;
+	unsigned int blksz = EXT2_BLOCK_SIZE(dir->data);
+	struct dx_frame frames[DX_MAX_LEVELS];
+	struct dx_root_info *info;
+	struct ext2_dirent *de;
+	unsigned int block;
+	int levels, version, i;
+	int namelen = strlen(name);
+	char *leaf = NULL;
+	__u32 hash;
+	int ret = -1;
+
+	memset(frames, '\0', sizeof(frames));
+	frames[0].buf = zalloc(blksz);
+	if (!frames[0].buf)
+		return -1;
+	if (ext4fs_dx_read_block(dir, 0, frames[0].buf))
+		goto out;
+
+	info = (struct dx_root_info *)(frames[0].buf + DX_ROOT_INFO_OFFSET);
+	levels = info->indirect_levels;
+	if (info->reserved_zero || levels >= DX_MAX_LEVELS ||
+	    info->info_length < sizeof(*info))
+		goto out;
+
+	version = info->hash_version;
+	if (version <= DX_HASH_TEA &&
+	    (__le32_to_cpu(sb->flags) & EXT4_FLAGS_UNSIGNED_HASH))
+		version += DX_HASH_LEGACY_UNSIGNED;
+	if (ext4fs_dirhash(name, namelen, sb->hash_seed, version, &hash))
+		goto out;
+
+	frames[0].entries = (struct dx_entry *)((char *)info +
+						info->info_length);
+	for (i = 0; ; i++) {
+		if (ext4fs_dx_search(&frames[i], blksz, hash))
+			goto out;
+		block = __le32_to_cpu(frames[i].at->block) & DX_BLOCK_MASK;
+		if (i == levels)
+			break;
+
+		frames[i + 1].buf = zalloc(blksz);
+		if (!frames[i + 1].buf ||
+		    ext4fs_dx_read_block(dir, block, frames[i + 1].buf))
+			goto out;
+		frames[i + 1].entries = (struct dx_entry *)(frames[i + 1].buf +
+						sizeof(struct ext2_dirent));
+	}
+
+	leaf = zalloc(blksz);
+	if (!leaf)
+		goto out;
+	do {
+		if (ext4fs_dx_read_block(dir, block, leaf))
+			goto out;
+		de = ext4fs_find_dirent(leaf, blksz, name, namelen);
+		if (de) {
+			memcpy(dirent, de, sizeof(*dirent));
+			ret = 1;
+			goto out;
+		}
+		ret = ext4fs_dx_next_leaf(dir, frames, levels, hash, &block);
+	} while (ret == 1);
+
+out:
+	free(leaf);
+	for (i = 0; i < DX_MAX_LEVELS; i++)
+		free(frames[i].buf);
+
+	return ret;
+}
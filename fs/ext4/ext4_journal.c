@@ -635,18 +635,40 @@ void ext4fs_update_journal(void)
 {
 	struct ext2_inode inode_journal;
 	struct ext_filesystem *fs = get_fs();
-	long int blknr;
-	int i;
+	long int blknr, start = 0;
+	char *batch;
+	int i, n = 0;
 	ext4fs_read_inode(ext4fs_root, EXT2_JOURNAL_INO, &inode_journal);
 	blknr = read_allocated_block(&inode_journal, jrnl_blk_idx++);
 	update_descriptor_block(blknr);
+
+	/*
+	 * The journal is normally contiguous on disk, so gather the logged
+	 * blocks and write them with as few writes as possible
+	 */
+	batch = zalloc(fs->blksz * JOURNAL_WRITE_BATCH);
 	for (i = 0; i < MAX_JOURNAL_ENTRIES; i++) {
 		if (journal_ptr[i]->blknr == -1)
 			break;
 		blknr = read_allocated_block(&inode_journal, jrnl_blk_idx++);
-		put_ext4((uint64_t) ((uint64_t)blknr * (uint64_t)fs->blksz),
-			 journal_ptr[i]->buf, fs->blksz);
+		if (!batch) {
+			put_ext4((uint64_t)blknr * fs->blksz,
+				 journal_ptr[i]->buf, fs->blksz);
+			continue;
+		}
+		if (n && (blknr != start + n || n == JOURNAL_WRITE_BATCH)) {
+			put_ext4((uint64_t)start * fs->blksz, batch,
+				 n * fs->blksz);
+			n = 0;
+		}
+		if (!n)
+			start = blknr;
+		memcpy(batch + n++ * fs->blksz, journal_ptr[i]->buf,
+		       fs->blksz);
 	}
+	if (n)
+		put_ext4((uint64_t)start * fs->blksz, batch, n * fs->blksz);
+	free(batch);
 	blknr = read_allocated_block(&inode_journal, jrnl_blk_idx++);
 	update_commit_block(blknr);
 	printf("update journal finished\n");
@@ -404,6 +404,101 @@ fail:
 	free(journal_buffer);
 }
 
+/*
+ * Release 'len' blocks from 'start' in the block bitmaps, keeping a journal
+ * copy of each bitmap block changed
+ */
+static int ext4fs_release_blk_run(long int start, unsigned int len,
+				  char *journal_buffer)
+{
+	unsigned int blk_per_grp = ext4fs_root->sblock.blocks_per_group;
+	struct ext_filesystem *fs = get_fs();
+	struct ext2_block_group *bgd = (struct ext2_block_group *)fs->gdtable;
+	int bg_idx, prev_bg_idx = -1;
+	int remainder;
+	long int blknr;
+
+	for (blknr = start; blknr < start + len; blknr++) {
+		if (fs->blksz != 1024) {
+			bg_idx = blknr / blk_per_grp;
+		} else {
+			bg_idx = blknr / blk_per_grp;
+			remainder = blknr % blk_per_grp;
+			if (!remainder)
+				bg_idx--;
+		}
+		ext4fs_reset_block_bmap(blknr, fs->blk_bmaps[bg_idx], bg_idx);
+		bgd[bg_idx].free_blocks++;
+		fs->sb->free_blocks++;
+
+		/* journal backup */
+		if (prev_bg_idx != bg_idx) {
+			if (!ext4fs_devread((lbaint_t)bgd[bg_idx].block_id *
+					    fs->sect_perblk, 0, fs->blksz,
+					    journal_buffer))
+				return -EIO;
+			if (ext4fs_log_journal(journal_buffer,
+					       bgd[bg_idx].block_id))
+				return -ENOMEM;
+			prev_bg_idx = bg_idx;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Release the blocks of an extent tree: the data blocks of each extent, and
+ * the tree blocks below 'eh'
+ */
+static int ext4fs_delete_extents(struct ext4_extent_header *eh,
+				 char *journal_buffer)
+{
+	struct ext4_extent *ext = (struct ext4_extent *)(eh + 1);
+	struct ext4_extent_idx *idx = (struct ext4_extent_idx *)(eh + 1);
+	struct ext_filesystem *fs = get_fs();
+	unsigned int len;
+	long int blknr;
+	char *buf;
+	int i, ret;
+
+	if (le16_to_cpu(eh->eh_magic) != EXT4_EXT_MAGIC)
+		return -EINVAL;
+
+	for (i = 0; i < le16_to_cpu(eh->eh_entries); i++) {
+		if (!eh->eh_depth) {
+			len = le16_to_cpu(ext[i].ee_len);
+			/* Uninitialised extents have the top bit set */
+			if (len > EXT4_EXT_MAX_LEN)
+				len -= EXT4_EXT_MAX_LEN;
+			blknr = le32_to_cpu(ext[i].ee_start_lo);
+			debug("EXT4_EXTENTS releasing %ld +%u\n", blknr, len);
+			ret = ext4fs_release_blk_run(blknr, len,
+						     journal_buffer);
+		} else {
+			blknr = le32_to_cpu(idx[i].ei_leaf_lo);
+			buf = zalloc(fs->blksz);
+			if (!buf)
+				return -ENOMEM;
+			if (ext4fs_devread((lbaint_t)blknr * fs->sect_perblk,
+					   0, fs->blksz, buf))
+				ret = ext4fs_delete_extents(
+					(struct ext4_extent_header *)buf,
+					journal_buffer);
+			else
+				ret = -EIO;
+			free(buf);
+			if (!ret)
+				ret = ext4fs_release_blk_run(blknr, 1,
+							     journal_buffer);
+		}
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 static int ext4fs_delete_file(int inodeno)
 {
 	struct ext2_inode inode;
@@ -441,52 +536,10 @@ static int ext4fs_delete_file(int inodeno)
 		no_blocks++;
 
 	if (le32_to_cpu(inode.flags) & EXT4_EXTENTS_FL) {
-		struct ext2fs_node *node_inode =
-		    zalloc(sizeof(struct ext2fs_node));
-		if (!node_inode)
+		if (ext4fs_delete_extents((struct ext4_extent_header *)
+					  inode.b.blocks.dir_blocks,
+					  journal_buffer))
 			goto fail;
-		node_inode->data = ext4fs_root;
-		node_inode->ino = inodeno;
-		node_inode->inode_read = 0;
-		memcpy(&(node_inode->inode), &inode, sizeof(struct ext2_inode));
-
-		for (i = 0; i < no_blocks; i++) {
-			blknr = read_allocated_block(&(node_inode->inode), i);
-			if (fs->blksz != 1024) {
-				bg_idx = blknr / blk_per_grp;
-			} else {
-				bg_idx = blknr / blk_per_grp;
-				remainder = blknr % blk_per_grp;
-				if (!remainder)
-					bg_idx--;
-			}
-			ext4fs_reset_block_bmap(blknr, fs->blk_bmaps[bg_idx],
-						bg_idx);
-			debug("EXT4_EXTENTS Block releasing %ld: %d\n",
-			      blknr, bg_idx);
-
-			bgd[bg_idx].free_blocks++;
-			fs->sb->free_blocks++;
-
-			/* journal backup */
-			if (prev_bg_bmap_idx != bg_idx) {
-				status =
-				    ext4fs_devread((lbaint_t)
-						   bgd[bg_idx].block_id *
-						   fs->sect_perblk, 0,
-						   fs->blksz, journal_buffer);
-				if (status == 0)
-					goto fail;
-				if (ext4fs_log_journal(journal_buffer,
-							bgd[bg_idx].block_id))
-					goto fail;
-				prev_bg_bmap_idx = bg_idx;
-			}
-		}
-		if (node_inode) {
-			free(node_inode);
-			node_inode = NULL;
-		}
 	} else {
 
 		delete_single_indirect_block(&inode);
@@ -604,6 +657,13 @@ int ext4fs_init(void)
 	unsigned int real_free_blocks = 0;
 	struct ext_filesystem *fs = get_fs();
 
+	/* directories and extent trees are about to change under the caches */
+	ext4fs_dcache_flush();
+	ext4fs_extent_cache_flush();
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+	ext4fs_cache_invalidate();
+#endif
+
 	/* populate fs */
 	fs->blksz = EXT2_BLOCK_SIZE(ext4fs_root);
 	fs->inodesz = INODE_SIZE_FILESYSTEM(ext4fs_root);
@@ -698,6 +758,9 @@ void ext4fs_deinit(void)
 	long int blknr;
 	struct ext_filesystem *fs = get_fs();
 
+	ext4fs_dcache_flush();
+	ext4fs_extent_cache_flush();
+
 	/* free journal */
 	char *temp_buff = zalloc(fs->blksz);
 	if (temp_buff) {
@@ -834,11 +897,54 @@ static int ext4fs_write_file(struct ext2_inode *file_inode,
 	return len;
 }
 
+/*
+ * Write the file content into the extents allocated for it, with one write
+ * per extent. The tail of the last block is padded with zeroes.
+ */
+static int ext4fs_write_extents(struct ext4_extent *ext, int count,
+				char *buf, unsigned int len)
+{
+	struct ext_filesystem *fs = get_fs();
+	unsigned int size;
+	uint64_t off;
+	char *tail;
+	int i;
+
+	for (i = 0; i < count && len; i++) {
+		off = (uint64_t)le32_to_cpu(ext[i].ee_start_lo) * fs->blksz;
+		size = le16_to_cpu(ext[i].ee_len) * fs->blksz;
+		if (size <= len) {
+			put_ext4(off, buf, size);
+			buf += size;
+			len -= size;
+			continue;
+		}
+
+		/* The file ends in this extent, maybe part way into a block */
+		size = len & ~(fs->blksz - 1);
+		if (size)
+			put_ext4(off, buf, size);
+		if (len > size) {
+			tail = zalloc(fs->blksz);
+			if (!tail)
+				return -1;
+			memcpy(tail, buf + size, len - size);
+			put_ext4(off + size, tail, fs->blksz);
+			free(tail);
+		}
+		len = 0;
+	}
+
+	return 0;
+}
+
 int ext4fs_write(const char *fname, unsigned char *buffer,
 					unsigned long sizebytes)
 {
 	int ret = 0;
 	struct ext2_inode *file_inode = NULL;
+	struct ext4_extent *extents = NULL;
+	int nr_extents = -1;
 	unsigned char *inode_buffer = NULL;
 	int parent_inodeno;
 	int inodeno;
@@ -915,8 +1021,17 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	file_inode->size = sizebytes;
 
 	/* Allocate data blocks */
-	ext4fs_allocate_blocks(file_inode, blocks_remaining,
-			       &blks_reqd_for_file);
+	if (fs->sb->feature_incompat & EXT4_FEATURE_INCOMPAT_EXTENTS) {
+		nr_extents = ext4fs_allocate_extents(file_inode,
+						     blocks_remaining,
+						     &blks_reqd_for_file,
+						     &extents);
+		if (nr_extents < 0)
+			goto fail;
+	} else {
+		ext4fs_allocate_blocks(file_inode, blocks_remaining,
+				       &blks_reqd_for_file);
+	}
 	file_inode->blockcnt = (blks_reqd_for_file * fs->blksz) >>
 		fs->dev_desc->log2blksz;
 
@@ -938,7 +1053,13 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	if (ext4fs_put_metadata(temp_ptr, itable_blkno))
 		goto fail;
 	/* copy the file content into data blocks */
-	if (ext4fs_write_file(file_inode, 0, sizebytes, (char *)buffer) == -1) {
+	if (nr_extents >= 0)
+		ret = ext4fs_write_extents(extents, nr_extents,
+					   (char *)buffer, sizebytes);
+	else
+		ret = ext4fs_write_file(file_inode, 0, sizebytes,
+					(char *)buffer);
+	if (ret == -1) {
 		printf("Error in copying content\n");
 		goto fail;
 	}
@@ -979,6 +1100,7 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	fs->curr_blkno = 0;
 	fs->first_pass_ibmap = 0;
 	fs->curr_inode_no = 0;
+	free(extents);
 	free(inode_buffer);
 	free(g_parent_inode);
 	g_parent_inode = NULL;
@@ -986,6 +1108,7 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	return 0;
 fail:
 	ext4fs_deinit();
+	free(extents);
 	free(inode_buffer);
 	free(g_parent_inode);
 	g_parent_inode = NULL;
@@ -64,8 +64,10 @@ int ext4fs_read_file(struct ext2fs_node *node, int pos,
 	short status;
 
 	/* Adjust len so it we can't read past the end of the file. */
-	if (len > filesize)
-		len = filesize;
+	if (pos >= filesize)
+		return 0;
+	if (len > filesize - pos)
+		len = filesize - pos;
 
 	blockcnt = ((len + pos) + blocksize - 1) / blocksize;
 
@@ -136,7 +138,7 @@ int ext4fs_read_file(struct ext2fs_node *node, int pos,
 					return -1;
 				previous_block_number = -1;
 			}
-			memset(buf, 0, blocksize - skipfirst);
+			memset(buf, 0, blockend);
 		}
 		buf += blocksize - skipfirst;
 	}
@@ -182,12 +184,12 @@ int ext4fs_exists(const char *filename)
 	return file_len >= 0;
 }
 
-int ext4fs_read(char *buf, unsigned len)
+int ext4fs_read(char *buf, int offset, unsigned len)
 {
 	if (ext4fs_root == NULL || ext4fs_file == NULL)
 		return 0;
 
-	return ext4fs_read_file(ext4fs_file, 0, len, buf);
+	return ext4fs_read_file(ext4fs_file, offset, len, buf);
 }
 
 int ext4fs_probe(block_dev_desc_t *fs_dev_desc,
@@ -208,11 +210,6 @@ int ext4_read_file(const char *filename, void *buf, int offset, int len)
 	int file_len;
 	int len_read;
 
-	if (offset != 0) {
-		printf("** Cannot support non-zero offset **\n");
-		return -1;
-	}
-
 	file_len = ext4fs_open(filename);
 	if (file_len < 0) {
 		printf("** File not found %s **\n", filename);
@@ -222,7 +219,7 @@ int ext4_read_file(const char *filename, void *buf, int offset, int len)
 	if (len == 0)
 		len = file_len;
 
-	len_read = ext4fs_read(buf, len);
+	len_read = ext4fs_read(buf, offset, len);
 
 	return len_read;
 }
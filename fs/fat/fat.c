@@ -16,6 +16,7 @@
 #include <asm/byteorder.h>
 #include <part.h>
 #include <malloc.h>
+#include <bouncebuf.h>
 #include <linux/compiler.h>
 #include <linux/ctype.h>
 
@@ -252,14 +253,77 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 }
 
 /*
- * Read at most 'size' bytes from the specified cluster into 'buffer'.
+ * Read 'nsect' whole sectors into 'buffer'. They go straight into the
+ * buffer when it is aligned for DMA, otherwise through a bounce buffer of
+ * at most MAX_CLUSTSIZE bytes at a time (or one sector at a time without
+ * CONFIG_BOUNCE_BUFFER).
  * Return 0 on success, -1 otherwise.
  */
 static int
-get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
+fat_read_sects(fsdata *mydata, __u32 startsect, __u32 nsect, __u8 *buffer)
 {
+#ifdef CONFIG_BOUNCE_BUFFER
+	struct bounce_buffer bbstate;
+	__u32 n;
+#else
+	ALLOC_CACHE_ALIGN_BUFFER(__u8, tmpbuf, mydata->sect_size);
+#endif
+	int ret;
+
+	if (!((unsigned long)buffer & (ARCH_DMA_MINALIGN - 1))) {
+		ret = disk_read(startsect, nsect, buffer);
+		if (ret != nsect) {
+			debug("Error reading data (got %d)\n", ret);
+			return -1;
+		}
+		return 0;
+	}
+
+#ifdef CONFIG_BOUNCE_BUFFER
+	while (nsect) {
+		n = min(nsect, (__u32)(MAX_CLUSTSIZE / mydata->sect_size));
+		if (bounce_buffer_start(&bbstate, buffer,
+					n * mydata->sect_size, GEN_BB_WRITE))
+			return -1;
+		ret = disk_read(startsect, n, bbstate.bounce_buffer);
+		bounce_buffer_stop(&bbstate);
+		if (ret != n) {
+			debug("Error reading data (got %d)\n", ret);
+			return -1;
+		}
+		startsect += n;
+		nsect -= n;
+		buffer += n * mydata->sect_size;
+	}
+#else
+	while (nsect--) {
+		ret = disk_read(startsect++, 1, tmpbuf);
+		if (ret != 1) {
+			debug("Error reading data (got %d)\n", ret);
+			return -1;
+		}
+		memcpy(buffer, tmpbuf, mydata->sect_size);
+		buffer += mydata->sect_size;
+	}
+#endif
+
+	return 0;
+}
+
+/*
+ * Read 'size' bytes from 'pos' bytes into the specified cluster into
+ * 'buffer'. Whole sectors are read directly; only a partial first or last
+ * sector is copied through a sector buffer.
+ * Return 0 on success, -1 otherwise.
+ */
+static int
+get_cluster_at(fsdata *mydata, __u32 clustnum, unsigned long pos,
+	       __u8 *buffer, unsigned long size)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(__u8, tmpbuf, mydata->sect_size);
 	__u32 idx = 0;
 	__u32 startsect;
+	unsigned long n;
 	int ret;
 
 	if (clustnum > 0) {
@@ -269,39 +333,32 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 		startsect = mydata->rootdir_sect;
 	}
 
-	debug("gc - clustnum: %d, startsect: %d\n", clustnum, startsect);
-
-	if ((unsigned long)buffer & (ARCH_DMA_MINALIGN - 1)) {
-		ALLOC_CACHE_ALIGN_BUFFER(__u8, tmpbuf, mydata->sect_size);
-
-		printf("FAT: Misaligned buffer address (%p)\n", buffer);
+	debug("gc - clustnum: %d, startsect: %d, pos: %lu\n", clustnum,
+	      startsect, pos);
 
-		while (size >= mydata->sect_size) {
-			ret = disk_read(startsect++, 1, tmpbuf);
-			if (ret != 1) {
-				debug("Error reading data (got %d)\n", ret);
-				return -1;
-			}
-
-			memcpy(buffer, tmpbuf, mydata->sect_size);
-			buffer += mydata->sect_size;
-			size -= mydata->sect_size;
-		}
-	} else {
-		idx = size / mydata->sect_size;
-		ret = disk_read(startsect, idx, buffer);
-		if (ret != idx) {
+	startsect += pos / mydata->sect_size;
+	pos %= mydata->sect_size;
+	if (pos && size) {
+		ret = disk_read(startsect++, 1, tmpbuf);
+		if (ret != 1) {
 			debug("Error reading data (got %d)\n", ret);
 			return -1;
 		}
-		startsect += idx;
-		idx *= mydata->sect_size;
-		buffer += idx;
-		size -= idx;
+		n = min(size, mydata->sect_size - pos);
+		memcpy(buffer, tmpbuf + pos, n);
+		buffer += n;
+		size -= n;
 	}
-	if (size) {
-		ALLOC_CACHE_ALIGN_BUFFER(__u8, tmpbuf, mydata->sect_size);
 
+	idx = size / mydata->sect_size;
+	if (idx && fat_read_sects(mydata, startsect, idx, buffer))
+		return -1;
+	startsect += idx;
+	idx *= mydata->sect_size;
+	buffer += idx;
+	size -= idx;
+
+	if (size) {
 		ret = disk_read(startsect, 1, tmpbuf);
 		if (ret != 1) {
 			debug("Error reading data (got %d)\n", ret);
@@ -314,6 +371,16 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+/*
+ * Read at most 'size' bytes from the specified cluster into 'buffer'.
+ * Return 0 on success, -1 otherwise.
+ */
+static int
+get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
+{
+	return get_cluster_at(mydata, clustnum, 0, buffer, size);
+}
+
 /*
  * Read at most 'maxsize' bytes from 'pos' in the file associated with 'dentptr'
  * into 'buffer'.
@@ -365,14 +432,13 @@ get_contents(fsdata *mydata, dir_entry *dentptr, unsigned long pos,
 	/* align to beginning of next cluster if any */
 	if (pos) {
 		actsize = min(filesize, bytesperclust);
-		if (get_cluster(mydata, curclust, get_contents_vfatname_block,
-				(int)actsize) != 0) {
+		if (get_cluster_at(mydata, curclust, pos, buffer,
+				   actsize - pos) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		filesize -= actsize;
 		actsize -= pos;
-		memcpy(buffer, get_contents_vfatname_block + pos, actsize);
 		gotsize += actsize;
 		if (!filesize)
 			return gotsize;
@@ -94,100 +94,173 @@ static void set_name(dir_entry *dirent, const char *filename)
 }
 
 static __u8 num_of_fats;
+
 /*
- * Write fat buffer into block device
+ * FAT table cache
+ *
+ * Writing a file touches FAT entries all over the table: the directory
+ * clusters, the old chain being freed and the new one being allocated. Keep
+ * several windows of FATBUFBLOCKS sectors in memory and remember which of
+ * their sectors were changed, so that each changed sector is written to
+ * every FAT copy once, when the window is evicted or the cache is flushed
+ * at the end of the operation.
  */
-static int flush_fat_buffer(fsdata *mydata)
+#ifndef CONFIG_FAT_WRITE_CACHE_WINDOWS
+#define CONFIG_FAT_WRITE_CACHE_WINDOWS	16
+#endif
+#define FAT_CACHE_WINDOWS	CONFIG_FAT_WRITE_CACHE_WINDOWS
+
+struct fat_window {
+	__u8 *buf;
+	int bufnum;		/* Window held by buf, -1 if none */
+	__u32 dirty;		/* Bitmap of changed sectors in the window */
+	__u32 last_used;	/* For evicting the least recently used */
+};
+
+static struct fat_window fat_cache[FAT_CACHE_WINDOWS];
+static __u8 *fat_cache_mem;
+static __u32 fat_cache_tick;
+
+static int fat_cache_init(fsdata *mydata)
 {
-	int getsize = FATBUFBLOCKS;
-	__u32 fatlength = mydata->fatlength;
-	__u8 *bufptr = mydata->fatbuf;
-	__u32 startblock = mydata->fatbufnum * FATBUFBLOCKS;
-
-	startblock += mydata->fat_sect;
-
-	if (getsize > fatlength)
-		getsize = fatlength;
+	int i;
 
-	/* Write FAT buf */
-	if (disk_write(startblock, getsize, bufptr) < 0) {
-		debug("error: writing FAT blocks\n");
+	fat_cache_mem = memalign(ARCH_DMA_MINALIGN,
+				 FATBUFSIZE * FAT_CACHE_WINDOWS);
+	if (!fat_cache_mem)
 		return -1;
-	}
 
-	if (num_of_fats == 2) {
-		/* Update corresponding second FAT blocks */
-		startblock += mydata->fatlength;
-		if (disk_write(startblock, getsize, bufptr) < 0) {
-			debug("error: writing second FAT blocks\n");
-			return -1;
-		}
+	for (i = 0; i < FAT_CACHE_WINDOWS; i++) {
+		fat_cache[i].buf = fat_cache_mem + i * FATBUFSIZE;
+		fat_cache[i].bufnum = -1;
+		fat_cache[i].dirty = 0;
+		fat_cache[i].last_used = 0;
 	}
+	fat_cache_tick = 0;
+	mydata->fatbuf = NULL;
+	mydata->fatbufnum = -1;
 
 	return 0;
 }
 
-/*
- * Get the entry at index 'entry' in a FAT (12/16/32) table.
- * On failure 0x00 is returned.
- * When bufnum is changed, write back the previous fatbuf to the disk.
- */
-static __u32 get_fatent_value(fsdata *mydata, __u32 entry)
+static void fat_cache_free(fsdata *mydata)
 {
-	__u32 bufnum;
-	__u32 off16, offset;
-	__u32 ret = 0x00;
-	__u16 val1, val2;
+	free(fat_cache_mem);
+	fat_cache_mem = NULL;
+	mydata->fatbuf = NULL;
+	mydata->fatbufnum = -1;
+}
 
-	switch (mydata->fatsize) {
-	case 32:
-		bufnum = entry / FAT32BUFSIZE;
-		offset = entry - bufnum * FAT32BUFSIZE;
-		break;
-	case 16:
-		bufnum = entry / FAT16BUFSIZE;
-		offset = entry - bufnum * FAT16BUFSIZE;
-		break;
-	case 12:
-		bufnum = entry / FAT12BUFSIZE;
-		offset = entry - bufnum * FAT12BUFSIZE;
-		break;
+/* Number of FAT sectors held by window 'bufnum' */
+static int fat_window_sects(fsdata *mydata, int bufnum)
+{
+	__u32 start = bufnum * FATBUFBLOCKS;
 
-	default:
-		/* Unsupported FAT size */
-		return ret;
-	}
+	if (start + FATBUFBLOCKS > mydata->fatlength)
+		return mydata->fatlength - start;
 
-	debug("FAT%d: entry: 0x%04x = %d, offset: 0x%04x = %d\n",
-	       mydata->fatsize, entry, entry, offset, offset);
+	return FATBUFBLOCKS;
+}
 
-	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
+/*
+ * Write the changed sectors of a window to every FAT copy, merging adjacent
+ * sectors into a single write.
+ */
+static int fat_window_flush(fsdata *mydata, struct fat_window *win)
+{
+	int sect, count, fat;
+	__u32 startblock;
+
+	sect = 0;
+	while (win->dirty >> sect) {
+		if (!(win->dirty & (1 << sect))) {
+			sect++;
+			continue;
+		}
+		for (count = 1; win->dirty & (1 << (sect + count)); count++)
+			;
+
+		startblock = mydata->fat_sect + win->bufnum * FATBUFBLOCKS +
+			sect;
+		for (fat = 0; fat < num_of_fats; fat++) {
+			if (disk_write(startblock + fat * mydata->fatlength,
+				       count, win->buf +
+				       sect * mydata->sect_size) < 0) {
+				debug("error: writing FAT %d blocks\n", fat);
+				return -1;
+			}
+		}
+		sect += count;
+	}
+	win->dirty = 0;
 
-		if (getsize > fatlength)
-			getsize = fatlength;
+	return 0;
+}
 
-		fatlength *= mydata->sect_size;	/* We want it in bytes now */
-		startblock += mydata->fat_sect;	/* Offset from start of disk */
+/*
+ * Make window 'bufnum' current in mydata->fatbuf, reading it in if it is not
+ * cached. This may write back the least recently used window.
+ */
+static struct fat_window *fat_cache_get(fsdata *mydata, __u32 bufnum)
+{
+	struct fat_window *win = NULL;
+	int i;
 
-		/* Write back the fatbuf to the disk */
-		if (mydata->fatbufnum != -1) {
-			if (flush_fat_buffer(mydata) < 0)
-				return -1;
+	for (i = 0; i < FAT_CACHE_WINDOWS; i++) {
+		if (fat_cache[i].bufnum == bufnum) {
+			win = &fat_cache[i];
+			break;
 		}
+		if (!win || fat_cache[i].last_used < win->last_used)
+			win = &fat_cache[i];
+	}
 
-		if (disk_read(startblock, getsize, bufptr) < 0) {
+	if (win->bufnum != bufnum) {
+		if (bufnum * FATBUFBLOCKS >= mydata->fatlength) {
+			debug("error: FAT window %u out of range\n", bufnum);
+			return NULL;
+		}
+		if (fat_window_flush(mydata, win) < 0)
+			return NULL;
+		win->bufnum = -1;
+		if (disk_read(mydata->fat_sect + bufnum * FATBUFBLOCKS,
+			      fat_window_sects(mydata, bufnum), win->buf) < 0) {
 			debug("Error reading FAT blocks\n");
-			return ret;
+			return NULL;
 		}
-		mydata->fatbufnum = bufnum;
+		win->bufnum = bufnum;
 	}
+	win->last_used = ++fat_cache_tick;
+	mydata->fatbuf = win->buf;
+	mydata->fatbufnum = bufnum;
+
+	return win;
+}
+
+/*
+ * Write all changed FAT sectors into block device
+ */
+static int flush_fat_buffer(fsdata *mydata)
+{
+	int i;
+
+	for (i = 0; i < FAT_CACHE_WINDOWS; i++) {
+		if (fat_window_flush(mydata, &fat_cache[i]) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Get the entry at index 'offset' in the FAT buffer
+ */
+static __u32 get_fatbuf_entry(fsdata *mydata, __u32 offset)
+{
+	__u32 off16;
+	__u32 ret = 0x00;
+	__u16 val1, val2;
 
-	/* Get the actual entry from the table */
 	switch (mydata->fatsize) {
 	case 32:
 		ret = FAT2CPU32(((__u32 *) mydata->fatbuf)[offset]);
@@ -226,6 +299,48 @@ static __u32 get_fatent_value(fsdata *mydata, __u32 entry)
 		}
 		break;
 	}
+
+	return ret;
+}
+
+/*
+ * Get the entry at index 'entry' in a FAT (12/16/32) table.
+ * On failure 0x00 is returned.
+ */
+static __u32 get_fatent_value(fsdata *mydata, __u32 entry)
+{
+	__u32 bufnum;
+	__u32 offset;
+	__u32 ret = 0x00;
+
+	switch (mydata->fatsize) {
+	case 32:
+		bufnum = entry / FAT32BUFSIZE;
+		offset = entry - bufnum * FAT32BUFSIZE;
+		break;
+	case 16:
+		bufnum = entry / FAT16BUFSIZE;
+		offset = entry - bufnum * FAT16BUFSIZE;
+		break;
+	case 12:
+		bufnum = entry / FAT12BUFSIZE;
+		offset = entry - bufnum * FAT12BUFSIZE;
+		break;
+
+	default:
+		/* Unsupported FAT size */
+		return ret;
+	}
+
+	debug("FAT%d: entry: 0x%04x = %d, offset: 0x%04x = %d\n",
+	       mydata->fatsize, entry, entry, offset, offset);
+
+	/* Get the block of FAT entries into the cache */
+	if (!fat_cache_get(mydata, bufnum))
+		return ret;
+
+	/* Get the actual entry from the table */
+	ret = get_fatbuf_entry(mydata, offset);
 	debug("FAT%d: ret: %08x, entry: %08x, offset: %04x\n",
 	       mydata->fatsize, ret, entry, offset);
 
@@ -456,6 +571,7 @@ get_long_file_name(fsdata *mydata, int curclust, __u8 *cluster,
  */
 static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 {
+	struct fat_window *win;
 	__u32 bufnum, offset;
 
 	switch (mydata->fatsize) {
@@ -472,61 +588,191 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 		return -1;
 	}
 
-	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
+	/* Get the block of FAT entries into the cache */
+	win = fat_cache_get(mydata, bufnum);
+	if (!win)
+		return -1;
+
+	/* Set the actual entry */
+	switch (mydata->fatsize) {
+	case 32:
+		((__u32 *) mydata->fatbuf)[offset] = cpu_to_le32(entry_value);
+		win->dirty |= 1 << (offset * 4 / mydata->sect_size);
+		break;
+	case 16:
+		((__u16 *) mydata->fatbuf)[offset] = cpu_to_le16(entry_value);
+		win->dirty |= 1 << (offset * 2 / mydata->sect_size);
+		break;
+	default:
+		return -1;
+	}
+
+	return 0;
+}
 
-		fatlength *= mydata->sect_size;
-		startblock += mydata->fat_sect;
+static inline int clust_in_use(fsdata *mydata, __u32 clust)
+{
+	return mydata->clust_map[clust / 32] & (1U << (clust % 32));
+}
 
-		if (getsize > fatlength)
-			getsize = fatlength;
+static inline void set_clust_in_use(fsdata *mydata, __u32 clust, int in_use)
+{
+	if (clust >= mydata->clust_count)
+		return;
+	if (in_use)
+		mydata->clust_map[clust / 32] |= 1U << (clust % 32);
+	else
+		mydata->clust_map[clust / 32] &= ~(1U << (clust % 32));
+}
 
-		if (mydata->fatbufnum != -1) {
-			if (flush_fat_buffer(mydata) < 0)
-				return -1;
-		}
+/*
+ * The cluster map of the volume last written to, kept between writes. It is
+ * only a hint: a cluster is checked in the FAT before it is allocated, and
+ * the map is rebuilt if it seems to be full.
+ */
+static struct {
+	block_dev_desc_t *dev_desc;
+	lbaint_t start;
+	lbaint_t size;
+	__u8 volume_id[4];
+	int data_begin;
+	__u32 fatlength;
+	__u32 *map;
+	__u32 count;
+	__u32 next_free;
+} clust_map_cache;
+
+static void clust_map_drop(void)
+{
+	free(clust_map_cache.map);
+	clust_map_cache.map = NULL;
+	clust_map_cache.dev_desc = NULL;
+}
 
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return -1;
-		}
-		mydata->fatbufnum = bufnum;
-	}
+/*
+ * Build a bitmap of the clusters in use by going through the whole FAT once,
+ * so that allocating a cluster does not need to search the FAT.
+ * Return 0 on success, -1 otherwise.
+ */
+static int build_clust_map(fsdata *mydata)
+{
+	__u32 entry, bufnum, per_buf, per_sect, count;
 
-	/* Set the actual entry */
 	switch (mydata->fatsize) {
 	case 32:
-		((__u32 *) mydata->fatbuf)[offset] = cpu_to_le32(entry_value);
+		per_buf = FAT32BUFSIZE;
+		per_sect = mydata->sect_size / 4;
 		break;
 	case 16:
-		((__u16 *) mydata->fatbuf)[offset] = cpu_to_le16(entry_value);
+		per_buf = FAT16BUFSIZE;
+		per_sect = mydata->sect_size / 2;
+		break;
+	case 12:
+		per_buf = FAT12BUFSIZE;
+		per_sect = mydata->sect_size * 2 / 3;
 		break;
 	default:
 		return -1;
 	}
 
+	/* Clusters on the disk, limited by the number of entries in the FAT */
+	count = (total_sector - mydata->data_begin) / mydata->clust_size;
+	if (count > mydata->fatlength * per_sect)
+		count = mydata->fatlength * per_sect;
+
+	free(mydata->clust_map);
+	mydata->clust_map = calloc(DIV_ROUND_UP(count, 32), sizeof(__u32));
+	if (!mydata->clust_map) {
+		debug("Error: allocating cluster map\n");
+		return -1;
+	}
+	mydata->clust_count = count;
+	mydata->next_free = 2;
+
+	for (entry = 0; entry < count; entry++) {
+		bufnum = entry / per_buf;
+		if (bufnum != mydata->fatbufnum &&
+		    !fat_cache_get(mydata, bufnum))
+			return -1;
+		if (get_fatbuf_entry(mydata, entry - bufnum * per_buf))
+			set_clust_in_use(mydata, entry, 1);
+	}
+
+	/* Entries 0 and 1 are reserved */
+	set_clust_in_use(mydata, 0, 1);
+	set_clust_in_use(mydata, 1, 1);
+
 	return 0;
 }
 
 /*
- * Determine the entry value at index 'entry' in a FAT (16/32) table
+ * Find a free cluster, starting at 'start' and wrapping around at the end of
+ * the disk. Return the cluster number or 0 if the disk is full.
  */
-static __u32 determine_fatent(fsdata *mydata, __u32 entry)
+static __u32 find_free_clust(fsdata *mydata, __u32 start)
 {
-	__u32 next_fat, next_entry = entry + 1;
+	__u32 clust = start, left = mydata->clust_count;
+
+	while (left--) {
+		if (clust >= mydata->clust_count)
+			clust = 2;
+
+		/* Skip whole words of clusters in use */
+		if (!(clust % 32) && clust + 32 <= mydata->clust_count &&
+		    mydata->clust_map[clust / 32] == ~0U) {
+			clust += 32;
+			left = left > 31 ? left - 31 : 0;
+			continue;
+		}
+		if (!clust_in_use(mydata, clust))
+			return clust;
+		clust++;
+	}
+
+	return 0;
+}
+
+/*
+ * Allocate a free cluster, preferring 'start' so that files stay contiguous.
+ * Return the cluster number or 0 if the disk is full.
+ */
+static __u32 alloc_clust(fsdata *mydata, __u32 start)
+{
+	int rebuilt = 0;
+	__u32 clust;
 
 	while (1) {
-		next_fat = get_fatent_value(mydata, next_entry);
-		if (next_fat == 0) {
-			set_fatent_value(mydata, entry, next_entry);
-			break;
+		clust = find_free_clust(mydata, start);
+		if (!clust) {
+			/* A kept map may be missing clusters freed since */
+			if (rebuilt || build_clust_map(mydata))
+				return 0;
+			rebuilt = 1;
+			continue;
 		}
-		next_entry++;
+		set_clust_in_use(mydata, clust, 1);
+		/* ...or have clusters allocated since as free */
+		if (!get_fatent_value(mydata, clust))
+			break;
+		start = clust + 1;
 	}
+	mydata->next_free = clust + 1;
+
+	return clust;
+}
+
+/*
+ * Determine the entry value at index 'entry' in a FAT (16/32) table
+ * Return the new entry value or 0 if there are no free clusters.
+ */
+static __u32 determine_fatent(fsdata *mydata, __u32 entry)
+{
+	__u32 next_entry;
+
+	/* The next cluster keeps the file contiguous, if it is free */
+	next_entry = alloc_clust(mydata, entry + 1);
+	if (next_entry)
+		set_fatent_value(mydata, entry, next_entry);
 	debug("FAT%d: entry: %08x, entry_value: %04x\n",
 	       mydata->fatsize, entry, next_entry);
 
@@ -578,20 +824,12 @@ set_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer,
 }
 
 /*
- * Find the first empty cluster
+ * Allocate an empty cluster, following on from the last one allocated
+ * Return the cluster number or 0 if there are none.
  */
-static int find_empty_cluster(fsdata *mydata)
+static __u32 find_empty_cluster(fsdata *mydata)
 {
-	__u32 fat_val, entry = 3;
-
-	while (1) {
-		fat_val = get_fatent_value(mydata, entry);
-		if (fat_val == 0)
-			break;
-		entry++;
-	}
-
-	return entry;
+	return alloc_clust(mydata, mydata->next_free);
 }
 
 /*
@@ -608,6 +846,10 @@ static void flush_dir_table(fsdata *mydata, dir_entry **dentptr)
 		return;
 	}
 	dir_newclust = find_empty_cluster(mydata);
+	if (!dir_newclust) {
+		printf("error: no free cluster for directory entry\n");
+		return;
+	}
 	set_fatent_value(mydata, dir_curclust, dir_newclust);
 	if (mydata->fatsize == 32)
 		set_fatent_value(mydata, dir_newclust, 0xffffff8);
@@ -616,9 +858,6 @@ static void flush_dir_table(fsdata *mydata, dir_entry **dentptr)
 
 	dir_curclust = dir_newclust;
 
-	if (flush_fat_buffer(mydata) < 0)
-		return;
-
 	memset(get_dentfromdir_block, 0x00,
 		mydata->clust_size * mydata->sect_size);
 
@@ -634,10 +873,12 @@ static int clear_fatent(fsdata *mydata, __u32 entry)
 
 	while (1) {
 		fat_val = get_fatent_value(mydata, entry);
-		if (fat_val != 0)
+		if (fat_val != 0) {
 			set_fatent_value(mydata, entry, 0);
-		else
+			set_clust_in_use(mydata, entry, 0);
+		} else {
 			break;
+		}
 
 		if (fat_val == 0xfffffff || fat_val == 0xffff)
 			break;
@@ -645,10 +886,6 @@ static int clear_fatent(fsdata *mydata, __u32 entry)
 		entry = fat_val;
 	}
 
-	/* Flush fat buffer */
-	if (flush_fat_buffer(mydata) < 0)
-		return -1;
-
 	return 0;
 }
 
@@ -680,6 +917,10 @@ set_contents(fsdata *mydata, dir_entry *dentptr, __u8 *buffer,
 		/* search for consecutive clusters */
 		while (actsize < filesize) {
 			newclust = determine_fatent(mydata, endclust);
+			if (!newclust) {
+				debug("error: no free clusters\n");
+				return -1;
+			}
 
 			if ((newclust - 1) != endclust)
 				goto getit;
@@ -951,13 +1192,30 @@ static int do_fat_write(const char *filename, void *buffer,
 					(mydata->clust_size * 2);
 	}
 
-	mydata->fatbufnum = -1;
-	mydata->fatbuf = malloc(FATBUFSIZE);
-	if (mydata->fatbuf == NULL) {
+	mydata->clust_map = NULL;
+	if (fat_cache_init(mydata)) {
 		debug("Error: allocating memory\n");
 		return -1;
 	}
 
+	/* Reuse the cluster map from the last write to this volume */
+	if (clust_map_cache.map && clust_map_cache.dev_desc == cur_dev &&
+	    clust_map_cache.start == cur_part_info.start &&
+	    clust_map_cache.size == cur_part_info.size &&
+	    !memcmp(clust_map_cache.volume_id, volinfo.volume_id,
+		    sizeof(volinfo.volume_id)) &&
+	    clust_map_cache.data_begin == mydata->data_begin &&
+	    clust_map_cache.fatlength == mydata->fatlength) {
+		mydata->clust_map = clust_map_cache.map;
+		mydata->clust_count = clust_map_cache.count;
+		mydata->next_free = clust_map_cache.next_free;
+		clust_map_cache.map = NULL;
+	} else if (build_clust_map(mydata)) {
+		printf("Error: reading FAT\n");
+		goto exit;
+	}
+	clust_map_drop();
+
 	if (disk_read(cursect,
 		(mydata->fatsize == 32) ?
 		(mydata->clust_size) :
@@ -997,6 +1255,8 @@ static int do_fat_write(const char *filename, void *buffer,
 			printf("Error: clearing FAT entries\n");
 			goto exit;
 		}
+		/* The file is rewritten starting at the same cluster */
+		set_clust_in_use(mydata, start_cluster, 1);
 
 		ret = set_contents(mydata, retdent, buffer, size);
 		if (ret < 0) {
@@ -1026,9 +1286,10 @@ static int do_fat_write(const char *filename, void *buffer,
 		set_name(empty_dentptr, filename);
 		fill_dir_slot(mydata, &empty_dentptr, filename);
 
-		ret = start_cluster = find_empty_cluster(mydata);
-		if (ret < 0) {
+		start_cluster = find_empty_cluster(mydata);
+		if (!start_cluster) {
 			printf("Error: finding empty cluster\n");
+			ret = -1;
 			goto exit;
 		}
 
@@ -1068,7 +1329,22 @@ static int do_fat_write(const char *filename, void *buffer,
 	}
 
 exit:
-	free(mydata->fatbuf);
+	/* After a failure the FAT on the disk may not match the map */
+	if (ret >= 0 && mydata->clust_map) {
+		clust_map_cache.dev_desc = cur_dev;
+		clust_map_cache.start = cur_part_info.start;
+		clust_map_cache.size = cur_part_info.size;
+		memcpy(clust_map_cache.volume_id, volinfo.volume_id,
+		       sizeof(volinfo.volume_id));
+		clust_map_cache.data_begin = mydata->data_begin;
+		clust_map_cache.fatlength = mydata->fatlength;
+		clust_map_cache.map = mydata->clust_map;
+		clust_map_cache.count = mydata->clust_count;
+		clust_map_cache.next_free = mydata->next_free;
+	} else {
+		free(mydata->clust_map);
+	}
+	fat_cache_free(mydata);
 	return ret < 0 ? ret : write_size;
 }
 
@@ -20,6 +20,7 @@
 #include <ext4fs.h>
 #include <fat.h>
 #include <fs.h>
+#include <image.h>
 #include <sandboxfs.h>
 #include <asm/io.h>
 
@@ -397,3 +398,118 @@ int do_save(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 
 	return 0;
 }
+
+#ifdef CONFIG_FIT
+#ifndef CONFIG_SYS_BOOTM_LEN
+#define CONFIG_SYS_BOOTM_LEN	0x800000	/* use 8MByte as default max */
+#endif
+
+struct fs_fit_file {
+	const char *ifname;
+	const char *dev_part_str;
+	const char *filename;
+	int fstype;
+};
+
+static ulong fs_fit_read(struct fit_loader *load, ulong offset, ulong size,
+			 void *buf)
+{
+	struct fs_fit_file *file = load->priv;
+	int ret;
+
+	/* A zero length would read the whole file */
+	if (!size)
+		return 0;
+
+	/* The filesystem is closed after every operation */
+	if (fs_set_blk_dev(file->ifname, file->dev_part_str, file->fstype))
+		return 0;
+	ret = fs_read(file->filename, map_to_sysmem(buf), offset, size);
+
+	return ret < 0 ? 0 : ret;
+}
+
+int do_fitload(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
+		int fstype)
+{
+	static const char * const props[] = {
+		FIT_KERNEL_PROP, FIT_FDT_PROP, FIT_RAMDISK_PROP,
+	};
+	struct fs_fit_file file;
+	struct fit_loader load;
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+#endif
+	ulong addr, data, len, next;
+	int cfg_noffset, noffset;
+	char name[30];
+	int verify;
+	void *fit;
+	int i;
+
+	if (argc < 5 || argc > 6)
+		return CMD_RET_USAGE;
+
+	file.ifname = argv[1];
+	file.dev_part_str = argv[2];
+	file.filename = argv[4];
+	file.fstype = fstype;
+	load.read = fs_fit_read;
+	load.priv = &file;
+	load.max_size = CONFIG_SYS_BOOTM_LEN;
+	load.lmb = NULL;
+	addr = simple_strtoul(argv[3], NULL, 16);
+	fit = map_sysmem(addr, CONFIG_SYS_BOOTM_LEN);
+
+	/* Only the FIT itself is read here, not the image data after it */
+	if (fit_stream_header(&load, fit, CONFIG_SYS_BOOTM_LEN))
+		return 1;
+
+#ifdef CONFIG_LMB
+	/* Keep the images off U-Boot's code, stack and malloc area */
+	lmb_init(&lmb);
+	lmb_add(&lmb, getenv_bootm_low(), getenv_bootm_size());
+	arch_lmb_reserve(&lmb);
+	board_lmb_reserve(&lmb);
+	lmb_reserve(&lmb, addr, fit_get_size(fit));
+	load.lmb = &lmb;
+#endif
+
+	cfg_noffset = fit_conf_get_node(fit, argc > 5 ? argv[5] : NULL);
+	if (cfg_noffset < 0) {
+		puts("Could not find configuration node\n");
+		return 1;
+	}
+	printf("   Using '%s' configuration\n",
+	       fit_get_name(fit, cfg_noffset, NULL));
+
+	verify = getenv_yesno("verify") != 0;
+	if (IMAGE_ENABLE_VERIFY && verify) {
+		puts("   Verifying Hash Integrity ... ");
+		if (!fit_config_verify(fit, cfg_noffset)) {
+			puts("Bad Data Hash\n");
+			return 1;
+		}
+		puts("OK\n");
+	}
+
+	/* Images without a load address, e.g. the fdt, go after the FIT */
+	next = ALIGN(addr + fit_get_size(fit), ARCH_DMA_MINALIGN);
+	for (i = 0; i < ARRAY_SIZE(props); i++) {
+		noffset = fit_conf_get_prop_node(fit, cfg_noffset, props[i]);
+		if (noffset < 0)
+			continue;
+		data = next;
+		if (fit_stream_image(&load, fit, noffset, verify, &data, &len))
+			return 1;
+		if (data == next)
+			next = ALIGN(data + len, ARCH_DMA_MINALIGN);
+		snprintf(name, sizeof(name), "fit_%s_addr", props[i]);
+		setenv_hex(name, data);
+		snprintf(name, sizeof(name), "fit_%s_size", props[i]);
+		setenv_hex(name, len);
+	}
+
+	return 0;
+}
+#endif /* CONFIG_FIT */
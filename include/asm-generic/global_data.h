@@ -71,6 +71,9 @@ typedef struct global_data {
 
 	const void *fdt_blob;	/* Our device tree, NULL if none */
 	void *new_fdt;		/* Relocated FDT */
+#ifdef CONFIG_OF_INDEX
+	struct fdt_index *fdt_index;	/* Lookup index for fdt_blob */
+#endif
 	unsigned long fdt_size;	/* Space reserved for relocated FDT */
 	void **jt;		/* jump table */
 	char env_buf[32];	/* buffer for getenv() before reloc. */
@@ -13,13 +13,18 @@
 
 /* The number of boot stage records available for the user */
 #ifndef CONFIG_BOOTSTAGE_USER_COUNT
+#ifdef CONFIG_BOOTSTAGE_INITCALL
+#define CONFIG_BOOTSTAGE_USER_COUNT	150
+#else
 #define CONFIG_BOOTSTAGE_USER_COUNT	20
 #endif
+#endif
 
 /* Flags for each bootstage record */
 enum bootstage_flags {
 	BOOTSTAGEF_ERROR	= 1 << 0,	/* Error record */
 	BOOTSTAGEF_ALLOC	= 1 << 1,	/* Allocate an id */
+	BOOTSTAGEF_INITCALL	= 1 << 2,	/* Duration of an initcall */
 };
 
 /* bootstate sub-IDs used for kernel and ramdisk ranges */
@@ -264,6 +269,19 @@ ulong bootstage_mark_name(enum bootstage_id id, const char *name);
 ulong bootstage_mark_code(const char *file, const char *func,
 			  int linenum);
 
+/**
+ * Record the time taken by an initcall
+ *
+ * This allocates a new record holding the start time and duration of the
+ * initcall. It is reported separately from normal marks, sorted by the
+ * time taken.
+ *
+ * @param addr		Link-time address of the initcall function
+ * @param start_us	Time the initcall was started, in microseconds
+ * @return time now, in microseconds
+ */
+ulong bootstage_initcall(ulong addr, ulong start_us);
+
 /**
  * Mark the start of a bootstage activity. The end will be marked later with
  * bootstage_accum() and at that point we accumulate the time taken. Calling
@@ -363,6 +381,11 @@ static inline ulong bootstage_mark_code(const char *file, const char *func,
 	return 0;
 }
 
+static inline ulong bootstage_initcall(ulong addr, ulong start_us)
+{
+	return 0;
+}
+
 static inline uint32_t bootstage_start(enum bootstage_id id, const char *name)
 {
 	return 0;
@@ -75,6 +75,10 @@
 #define CONFIG_LIB_RAND
 #endif
 
+#if defined(CONFIG_FASTBOOT_FLASH) && !defined(CONFIG_IMAGE_SPARSE)
+#define CONFIG_IMAGE_SPARSE
+#endif
+
 #ifndef CONFIG_SYS_PROMPT
 #define CONFIG_SYS_PROMPT	"=> "
 #endif
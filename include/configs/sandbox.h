@@ -9,8 +9,9 @@
 #ifdef FTRACE
 #define CONFIG_TRACE
 #define CONFIG_CMD_TRACE
-#define CONFIG_TRACE_BUFFER_SIZE	(16 << 20)
-#define CONFIG_TRACE_EARLY_SIZE		(8 << 20)
+#define CONFIG_TRACE_AGGREGATE
+#define CONFIG_TRACE_BUFFER_SIZE	(32 << 20)
+#define CONFIG_TRACE_EARLY_SIZE		(16 << 20)
 #define CONFIG_TRACE_EARLY
 #define CONFIG_TRACE_EARLY_ADDR		0x00100000
 
@@ -20,6 +21,8 @@
 
 #define CONFIG_BOOTSTAGE
 #define CONFIG_BOOTSTAGE_REPORT
+#define CONFIG_BOOTSTAGE_INITCALL
+#define CONFIG_TASKS
 #define CONFIG_DM
 #define CONFIG_CMD_DEMO
 #define CONFIG_CMD_DM
@@ -35,16 +38,22 @@
 #define CONFIG_OF_CONTROL
 #define CONFIG_OF_HOSTFILE
 #define CONFIG_OF_LIBFDT
+#define CONFIG_OF_INDEX
 #define CONFIG_LMB
 #define CONFIG_FIT
 #define CONFIG_FIT_SIGNATURE
+#define CONFIG_IMAGE_SPARSE
 #define CONFIG_RSA
+#define CONFIG_CMD_TIME
 #define CONFIG_CMD_FDT
 #define CONFIG_DEFAULT_DEVICE_TREE	sandbox
 
 #define CONFIG_FS_FAT
+#define CONFIG_FAT_WRITE
 #define CONFIG_FS_EXT4
 #define CONFIG_EXT4_WRITE
+#define CONFIG_EXT4_MOUNT_CACHE
+#define CONFIG_BOUNCE_BUFFER
 #define CONFIG_CMD_FAT
 #define CONFIG_CMD_EXT4
 #define CONFIG_CMD_EXT4_WRITE
@@ -83,7 +92,15 @@
 #define CONFIG_BOOTDELAY	3
 
 #define CONFIG_ENV_SIZE		8192
+#ifdef CONFIG_SANDBOX_ENV_LOG
+/* Environment log on the file given to --host, for test/env */
+#define CONFIG_ENV_IS_IN_LOG
+#define CONFIG_ENV_OFFSET	0
+#define CONFIG_ENV_LOG_INTERFACE	"host"
+#define CONFIG_ENV_LOG_DEVICE		0
+#else
 #define CONFIG_ENV_IS_NOWHERE
+#endif
 
 /* SPI */
 #define CONFIG_SANDBOX_SPI
@@ -101,6 +118,8 @@
 #define CONFIG_SYS_LOAD_ADDR		0x00000000
 #define CONFIG_SYS_MEMTEST_START	0x00100000
 #define CONFIG_SYS_MEMTEST_END		(CONFIG_SYS_MEMTEST_START + 0x1000)
+#define CONFIG_CMD_MEMTEST
+#define CONFIG_SYS_MEMTEST_FAST
 #define CONFIG_SYS_FDT_LOAD_ADDR	        0x100
 
 #define CONFIG_PHYSMEM
@@ -122,9 +141,9 @@
 /* include default commands */
 #include <config_cmd_default.h>
 
-/* We don't have networking support yet */
-#undef CONFIG_CMD_NET
-#undef CONFIG_CMD_NFS
+/* Networking through a host tap, raw or UDP socket, see --eth */
+#define CONFIG_ETH_SANDBOX
+#define CONFIG_CMD_PING
 
 #define CONFIG_CMD_HASH
 #define CONFIG_HASH_VERIFY
@@ -133,6 +152,12 @@
 
 #define CONFIG_TPM_TIS_SANDBOX
 
+/* DFU back-end only, for the ut_dfu test; there is no USB gadget */
+#define CONFIG_DFU_FUNCTION
+#define CONFIG_DFU_RAM
+#define CONFIG_SYS_DFU_DATA_BUF_SIZE	(1 << 20)
+#define CONFIG_SYS_CACHELINE_SIZE	64
+
 #define CONFIG_CMD_SANDBOX
 
 #define CONFIG_BOOTARGS ""
@@ -152,7 +177,11 @@
 #define CONFIG_SANDBOX_SDL
 #define CONFIG_LCD
 #define CONFIG_VIDEO_SANDBOX_SDL
+#define CONFIG_LCD_HW_SCROLL
 #define CONFIG_CMD_BMP
+#define CONFIG_BMP_16BPP
+#define CONFIG_LCD_BMP_GZIP
+#define CONFIG_SPLASH_SCREEN
 #define CONFIG_BOARD_EARLY_INIT_F
 #define CONFIG_CONSOLE_MUX
 #define CONFIG_SYS_CONSOLE_IS_IN_ENV
@@ -160,7 +189,8 @@
 
 #define CONFIG_EXTRA_ENV_SETTINGS	"stdin=serial,cros-ec-keyb\0" \
 					"stdout=serial,lcd\0" \
-					"stderr=serial,lcd\0"
+					"stderr=serial,lcd\0" \
+					"ethaddr=02:00:11:22:33:44\0"
 
 #define CONFIG_GZIP_COMPRESSED
 #define CONFIG_BZIP2
@@ -44,6 +44,8 @@
 #define CONFIG_SYS_NS16550_COM3		SUNXI_UART2_BASE
 #define CONFIG_SYS_NS16550_COM4		SUNXI_UART3_BASE
 #define CONFIG_SYS_NS16550_COM5		SUNXI_R_UART_BASE
+#define CONFIG_SYS_NS16550_FIFO_SIZE	64
+#define CONFIG_CONSOLE_TX_BUFFER	4096
 
 /* DRAM Base */
 #define CONFIG_SYS_SDRAM_BASE		0x40000000
@@ -110,6 +112,15 @@
 
 #define CONFIG_SYS_LOAD_ADDR		0x48000000 /* default load address */
 
+/*
+ * By default, mtest the first 128MB. This stays clear of U-Boot, which
+ * relocates to the top of DRAM, on boards with 256MB or more.
+ */
+#define CONFIG_CMD_MEMTEST
+#define CONFIG_SYS_MEMTEST_FAST
+#define CONFIG_SYS_MEMTEST_START	CONFIG_SYS_SDRAM_BASE
+#define CONFIG_SYS_MEMTEST_END		(CONFIG_SYS_SDRAM_BASE + (128 << 20))
+
 /* standalone support */
 #define CONFIG_STANDALONE_LOAD_ADDR	0x48000000
 
@@ -247,6 +258,7 @@
 #include <config_cmd_default.h>
 
 #define CONFIG_FAT_WRITE	/* enable write access */
+#define CONFIG_BOUNCE_BUFFER	/* unaligned fatload/ext4load */
 
 #define CONFIG_SPL_FRAMEWORK
 #define CONFIG_SPL_LIBCOMMON_SUPPORT
@@ -306,6 +318,19 @@
 #define CONFIG_SYS_MMCSD_RAW_MODE_ARGS_SECTORS  256
 #define CONFIG_SYS_MMCSD_RAW_MODE_KERNEL_SECTOR 1600
 #endif
+/*
+ * With CONFIG_FIT, the kernel sector may instead hold a FIT (made with
+ * 'mkimage -E') with the kernel and device tree. Add CONFIG_SPL_FIT_VERIFY
+ * to check their hashes, at the cost of a larger SPL. The BananaPi_Falcon
+ * target enables this.
+ */
+#ifdef CONFIG_FIT
+#define CONFIG_SPL_FIT_SUPPORT
+#ifdef CONFIG_SPL_FIT_VERIFY
+#define CONFIG_SPL_CRC32_SUPPORT
+#define CONFIG_SPL_SHA1_SUPPORT
+#endif
+#endif
 #endif
 
 #undef CONFIG_CMD_FPGA
@@ -389,6 +414,48 @@
 #define CONFIG_CONS_INDEX              1       /* UART0 */
 #endif
 
+/*
+ * USB gadget support on the USB0 OTG port, high-speed, for ums, dfu and
+ * fastboot
+ */
+#if !defined CONFIG_SUN6I && !defined CONFIG_SUN8I && !defined CONFIG_SPL_BUILD
+#define CONFIG_USB_MUSB_SUNXI
+#define CONFIG_MUSB_GADGET
+#define CONFIG_MUSB_PIO_ONLY
+#define CONFIG_USB_GADGET
+#define CONFIG_USBDOWNLOAD_GADGET
+#define CONFIG_USB_GADGET_DUALSPEED
+#define CONFIG_USB_GADGET_VBUS_DRAW	2
+#define CONFIG_SYS_CACHELINE_SIZE	64
+
+#define CONFIG_G_DNL_VENDOR_NUM		0x1f3a
+#define CONFIG_G_DNL_PRODUCT_NUM	0x1010
+#define CONFIG_G_DNL_MANUFACTURER	"Allwinner Technology"
+
+#define CONFIG_USB_GADGET_MASS_STORAGE
+#define CONFIG_USB_CABLE_CHECK
+#define CONFIG_CMD_USB_MASS_STORAGE
+
+#define CONFIG_DFU_FUNCTION
+#define CONFIG_DFU_MMC
+#define CONFIG_CMD_DFU
+/* Must fit in the malloc() pool */
+#define CONFIG_SYS_DFU_DATA_BUF_SIZE	(1 << 20)
+/* Write one DFU buffer to MMC while the next is received */
+#define CONFIG_TASKS
+
+#define CONFIG_USB_FUNCTION_FASTBOOT
+#define CONFIG_CMD_FASTBOOT
+/*
+ * On the smallest (256MB) boards this leaves the top 32MB of DRAM for
+ * U-Boot, its malloc() pool, stack and framebuffer
+ */
+#define CONFIG_USB_FASTBOOT_BUF_ADDR	CONFIG_SYS_LOAD_ADDR
+#define CONFIG_USB_FASTBOOT_BUF_SIZE	(96 << 20)
+#define CONFIG_FASTBOOT_FLASH
+#define CONFIG_FASTBOOT_FLASH_MMC_DEV	0
+#endif
+
 /* Ethernet support */
 #ifdef CONFIG_SUNXI_EMAC
 #define CONFIG_MII			/* MII PHY management		*/
@@ -56,13 +56,39 @@ int device_bind_by_name(struct device *parent, const struct driver_info *info,
  * device_probe() - Probe a device, activating it
  *
  * Activate a device so that it is ready for use. All its parents are probed
- * first.
+ * first. If the device is being probed in the background, this waits for
+ * that to finish, polling other background probes in the meantime.
  *
  * @dev: Pointer to device to probe
  * @return 0 if OK, -ve on error
  */
 int device_probe(struct device *dev);
 
+/**
+ * device_probe_start() - Start probing a device
+ *
+ * This is the same as device_probe() except that if the driver has a
+ * probe_poll method, the device is left with DM_FLAG_PROBE_PENDING set
+ * after its probe method returns. Use device_probe_poll() or device_probe()
+ * to complete the probe.
+ *
+ * @dev: Pointer to device to probe
+ * @return 0 if OK (device active or probe pending), -ve on error
+ */
+int device_probe_start(struct device *dev);
+
+/**
+ * device_probe_poll() - Make progress with a background probe
+ *
+ * This calls the driver's probe_poll method once. When that indicates that
+ * the probe is complete, the device is activated.
+ *
+ * @dev: Pointer to device being probed
+ * @return 0 if the device is no longer pending, -EAGAIN if the probe is
+ * still in progress, other -ve on error (the device is then not active)
+ */
+int device_probe_poll(struct device *dev);
+
 /**
  * device_remove() - Remove a device, de-activating it
  *
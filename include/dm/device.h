@@ -23,6 +23,9 @@ struct driver_info;
 /* DM is responsible for allocating and freeing platdata */
 #define DM_FLAG_ALLOC_PDATA	(2 << 0)
 
+/* Probe has started but is still being completed by the probe_poll method */
+#define DM_FLAG_PROBE_PENDING	(1 << 2)
+
 /**
  * struct device - An instance of a driver
  *
@@ -106,6 +109,12 @@ struct device_id {
  * @remove: Called to remove a device, i.e. de-activate it
  * @unbind: Called to unbind a device from its driver
  * @ofdata_to_platdata: Called before probe to decode device tree data
+ * @probe_poll: Called to complete a probe in the background. If this is
+ * provided then the probe method only starts activating the device (e.g.
+ * kicks off a slow hardware reset) and this is called repeatedly until it
+ * finishes. It returns -EAGAIN while the probe is still in progress, 0 when
+ * the device is ready, or another -ve value on error. On error it must undo
+ * anything done by the probe method, since remove will not be called.
  * @priv_auto_alloc_size: If non-zero this is the size of the private data
  * to be allocated in the device's ->priv pointer. If zero, then the driver
  * is responsible for allocating any data required.
@@ -127,6 +136,7 @@ struct driver {
 	int (*remove)(struct device *dev);
 	int (*unbind)(struct device *dev);
 	int (*ofdata_to_platdata)(struct device *dev);
+	int (*probe_poll)(struct device *dev);
 	int priv_auto_alloc_size;
 	int platdata_auto_alloc_size;
 	const void *ops;	/* driver-specific operations */
@@ -40,6 +40,28 @@ int dm_scan_platdata(void);
  */
 int dm_scan_fdt(const void *blob);
 
+/**
+ * dm_probe_background() - Start background probes
+ *
+ * This starts probing all bound devices whose driver has a probe_poll
+ * method, so that slow devices can get ready while U-Boot does other
+ * things. Other devices are probed when first used, as normal.
+ *
+ * @return 0 if OK, -ve on error (the first error seen)
+ */
+int dm_probe_background(void);
+
+/**
+ * dm_probe_poll_pending() - Make progress with all background probes
+ *
+ * This polls each device which is being probed in the background. It can
+ * be called from anywhere that U-Boot is waiting for something.
+ *
+ * @skip: Device not to poll, or NULL for none
+ * @return number of devices still being probed
+ */
+int dm_probe_poll_pending(struct device *skip);
+
 /**
  * dm_init() - Initialize Driver Model structures
  *
@@ -48,6 +48,9 @@ enum {
 	DM_TEST_OP_INIT,
 	DM_TEST_OP_DESTROY,
 
+	/* For background probe */
+	DM_TEST_OP_PROBE_POLL,
+
 	DM_TEST_OP_COUNT,
 };
 
@@ -60,12 +63,16 @@ enum {
 /* The number added to the ping total on each probe */
 #define DM_TEST_START_TOTAL	5
 
+/* The number of polls needed to complete a background probe */
+#define DM_TEST_PROBE_POLLS	3
+
 /**
  * struct dm_test_priv - private data for the test devices
  */
 struct dm_test_priv {
 	int ping_total;
 	int op_count[DM_TEST_OP_COUNT];
+	int probe_polls;
 };
 
 /**
@@ -100,6 +107,7 @@ extern struct dm_test_state global_test_state;
  * @fail_count: Number of tests that failed
  * @force_fail_alloc: Force all memory allocs to fail
  * @skip_post_probe: Skip uclass post-probe processing
+ * @force_fail_probe: Force background probes to fail
  */
 struct dm_test_state {
 	struct device *root;
@@ -107,6 +115,7 @@ struct dm_test_state {
 	int fail_count;
 	int force_fail_alloc;
 	int skip_post_probe;
+	int force_fail_probe;
 };
 
 /* Test flags for each test */
@@ -28,8 +28,11 @@
 #define __EXT4__
 #include <ext_common.h>
 
+#define EXT4_INDEX_FL		0x00001000 /* Directory has a hash index */
 #define EXT4_EXTENTS_FL		0x00080000 /* Inode uses extents */
 #define EXT4_EXT_MAGIC			0xf30a
+#define EXT4_EXT_MAX_LEN		32768U	/* Longest initialised extent */
+#define EXT4_FEATURE_COMPAT_DIR_INDEX	0x0020
 #define EXT4_FEATURE_RO_COMPAT_GDT_CSUM	0x0010
 #define EXT4_FEATURE_INCOMPAT_EXTENTS	0x0040
 #define EXT4_INDIRECT_BLOCKS		12
@@ -38,6 +41,10 @@
 #define EXT4_BG_BLOCK_UNINIT		0x0002
 #define EXT4_BG_INODE_ZEROED		0x0004
 
+/* Superblock flags: which char signedness directory hashes were made with */
+#define EXT4_FLAGS_SIGNED_HASH		0x0001
+#define EXT4_FLAGS_UNSIGNED_HASH	0x0002
+
 /*
  * ext4_inode has i_block array (60 bytes total).
  * The first 12 bytes store ext4_extent_header;
@@ -116,6 +123,24 @@ struct ext_filesystem {
 extern struct ext2_data *ext4fs_root;
 extern struct ext2fs_node *ext4fs_file;
 
+#ifdef CONFIG_EXT4_MOUNT_CACHE
+/* What the mount cache has saved, as shown by 'ext4cache' */
+struct ext4fs_cache_stats {
+	unsigned long mounts;		/* calls to ext4fs_mount() */
+	unsigned long mount_hits;	/* ...that reused the cached mount */
+	unsigned long gdt_hits;		/* group descriptors from memory */
+	unsigned long dcache_hits;	/* name lookups from memory */
+	unsigned long dcache_misses;
+	unsigned long devreads;		/* calls to ext4fs_devread() */
+	unsigned long saved_reads;	/* device reads avoided, at least */
+};
+
+extern struct ext4fs_cache_stats ext4fs_cache_stats;
+
+void ext4fs_cache_invalidate(void);
+void ext4fs_cache_print(void);
+#endif
+
 #if defined(CONFIG_EXT4_WRITE)
 extern struct ext2_inode *g_parent_inode;
 extern int gd_index;
@@ -130,7 +155,7 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 
 struct ext_filesystem *get_fs(void);
 int ext4fs_open(const char *filename);
-int ext4fs_read(char *buf, unsigned len);
+int ext4fs_read(char *buf, int offset, unsigned len);
 int ext4fs_mount(unsigned part_length);
 void ext4fs_close(void);
 int ext4fs_ls(const char *dirname);
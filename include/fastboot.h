@@ -0,0 +1,36 @@
+/*
+ * fastboot.h -- Android fastboot protocol
+ *
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __FASTBOOT_H
+#define __FASTBOOT_H
+
+#include <linux/usb/composite.h>
+
+/* What the host asked for when it ended the session */
+enum fastboot_exit {
+	FASTBOOT_CONTINUE,	/* Carry on booting */
+	FASTBOOT_BOOT,		/* Boot the downloaded image */
+};
+
+/**
+ * fastboot_handle() - Serve fastboot commands until the host is done
+ *
+ * @return FASTBOOT_CONTINUE or FASTBOOT_BOOT when the host ends the
+ * session, -EINTR if interrupted by Ctrl-C, or another -ve error
+ */
+int fastboot_handle(void);
+
+#ifdef CONFIG_USB_FUNCTION_FASTBOOT
+int fastboot_add(struct usb_configuration *c);
+#else
+static inline int fastboot_add(struct usb_configuration *c)
+{
+	return 0;
+}
+#endif
+#endif /* __FASTBOOT_H */
@@ -165,6 +165,9 @@ typedef struct {
 	__u16	clust_size;	/* Size of clusters in sectors */
 	int	data_begin;	/* The sector of the first cluster, can be negative */
 	int	fatbufnum;	/* Used by get_fatent, init to -1 */
+	__u32	*clust_map;	/* Bitmap of clusters in use, for writing */
+	__u32	clust_count;	/* Number of clusters covered by clust_map */
+	__u32	next_free;	/* Where to start looking for a free cluster */
 } fsdata;
 
 typedef int	(file_detectfs_func)(void);
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __FB_MMC_H
+#define __FB_MMC_H
+
+/* Longest fastboot response, plus its terminator */
+#define FASTBOOT_RESPONSE_LEN	(64 + 1)
+
+/**
+ * fb_mmc_flash_write() - Write a downloaded image to an MMC partition
+ *
+ * Sparse images are decoded as they are written; anything else is written
+ * as it is.
+ *
+ * @part:	Partition name, or number
+ * @buffer:	Image to write
+ * @size:	Size of the image in bytes
+ * @response:	Returns the fastboot response (OKAY or FAIL...), which must
+ *		have room for FASTBOOT_RESPONSE_LEN bytes
+ */
+void fb_mmc_flash_write(const char *part, void *buffer, unsigned int size,
+			char *response);
+
+/**
+ * fb_mmc_erase() - Erase an MMC partition
+ *
+ * @part:	Partition name, or number
+ * @response:	Returns the fastboot response
+ */
+void fb_mmc_erase(const char *part, char *response);
+
+#endif
@@ -281,6 +281,73 @@ int fdtdec_prepare_fdt(void);
  */
 int fdtdec_check_fdt(void);
 
+#ifdef CONFIG_OF_INDEX
+/**
+ * Build a lookup index for a device tree, replacing any existing index.
+ *
+ * The functions below then use it for this blob, until its structure
+ * changes. This needs malloc() so is only available after relocation.
+ *
+ * @param blob		FDT blob to index
+ * @return 0 if ok, -FDT_ERR_... on error
+ */
+int fdtdec_index_build(const void *blob);
+
+/**
+ * Free the lookup index, if any.
+ */
+void fdtdec_index_free(void);
+
+/**
+ * Find a node by path, like fdt_path_offset() but using the index.
+ *
+ * @param blob		FDT blob
+ * @param path		Full path of node, or alias followed by a path
+ * @return node offset if found, -FDT_ERR_... on error
+ */
+int fdtdec_path_offset(const void *blob, const char *path);
+
+/**
+ * Find a node by phandle, like fdt_node_offset_by_phandle() but using the
+ * index.
+ *
+ * @param blob		FDT blob
+ * @param phandle	phandle to look for
+ * @return node offset if found, -FDT_ERR_... on error
+ */
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle);
+
+/**
+ * Find the next node with a compatible string, like
+ * fdt_node_offset_by_compatible() but using the index.
+ *
+ * @param blob		FDT blob
+ * @param startoffset	Only find nodes after this offset (-1 for all)
+ * @param compat	Compatible string to look for
+ * @return node offset if found, -FDT_ERR_... on error
+ */
+int fdtdec_node_offset_by_compatible(const void *blob, int startoffset,
+				     const char *compat);
+#else
+static inline int fdtdec_path_offset(const void *blob, const char *path)
+{
+	return fdt_path_offset(blob, path);
+}
+
+static inline int fdtdec_node_offset_by_phandle(const void *blob,
+						uint32_t phandle)
+{
+	return fdt_node_offset_by_phandle(blob, phandle);
+}
+
+static inline int fdtdec_node_offset_by_compatible(const void *blob,
+						   int startoffset,
+						   const char *compat)
+{
+	return fdt_node_offset_by_compatible(blob, startoffset, compat);
+}
+#endif
+
 /**
  * Find the nodes for a peripheral and return a list of them in the correct
  * order. This is used to enumerate all the peripherals of a certain type.
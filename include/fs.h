@@ -84,4 +84,11 @@ int file_exists(const char *dev_type, const char *dev_part, const char *file,
 int do_save(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		int fstype);
 
+/*
+ * Load the images of a FIT configuration to their load addresses, reading
+ * only the parts of the file that are needed (see fit_stream_image()).
+ */
+int do_fitload(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
+		int fstype);
+
 #endif /* _FS_H */
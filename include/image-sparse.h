@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __IMAGE_SPARSE_H
+#define __IMAGE_SPARSE_H
+
+#include <part.h>
+#include <sparse_format.h>
+
+/**
+ * struct sparse_storage - Where a sparse image is written
+ *
+ * @blksz:	Block size of the device in bytes; the sparse block size must
+ *		be a multiple of this
+ * @start:	First device block of the partition
+ * @size:	Number of device blocks in the partition
+ * @priv:	Private data for @write
+ * @write:	Write @blkcnt blocks from @buf to the device, starting at
+ *		block @blk. @buf points into the sparse image so is only
+ *		4-byte aligned. Returns the number of blocks written.
+ */
+struct sparse_storage {
+	ulong blksz;
+	lbaint_t start;
+	lbaint_t size;
+	void *priv;
+
+	lbaint_t (*write)(struct sparse_storage *info, lbaint_t blk,
+			  lbaint_t blkcnt, const void *buf);
+};
+
+/**
+ * struct sparse_stats - What writing a sparse image did, in device blocks
+ *
+ * @written:	Blocks written from raw chunks
+ * @filled:	Blocks written with a fill value
+ * @skipped:	Blocks left untouched (don't care chunks)
+ */
+struct sparse_stats {
+	lbaint_t written;
+	lbaint_t filled;
+	lbaint_t skipped;
+};
+
+/**
+ * is_sparse_image() - Check for the sparse image magic
+ *
+ * @buf:	Start of the image
+ * @return 1 if @buf holds a sparse image header, 0 if not
+ */
+int is_sparse_image(const void *buf);
+
+/**
+ * write_sparse_image() - Write a sparse image to a partition
+ *
+ * The image is decoded chunk by chunk straight from @buf: raw chunks are
+ * written from where they lie in the image, fill chunks from one small
+ * pattern buffer and don't care chunks are skipped, so the expanded image
+ * is never built in memory.
+ *
+ * @info:	Partition to write to
+ * @buf:	Sparse image
+ * @size:	Size of the sparse image in bytes
+ * @stats:	Returns what was done (may be NULL)
+ * @return 0 if OK, -EINVAL if the image is corrupt, -ENOSPC if it does not
+ * fit the partition, -ENOMEM if out of memory, -EIO on a write error
+ */
+int write_sparse_image(struct sparse_storage *info, const void *buf,
+		       ulong size, struct sparse_stats *stats);
+
+#endif
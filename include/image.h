@@ -395,6 +395,7 @@ void genimg_print_time(time_t timestamp);
 enum fit_load_op {
 	FIT_LOAD_IGNORED,	/* Ignore load address */
 	FIT_LOAD_OPTIONAL,	/* Can be provided, but optional */
+	FIT_LOAD_OPTIONAL_NON_ZERO,	/* Optional, a value of 0 is ignored */
 	FIT_LOAD_REQUIRED,	/* Must be provided */
 };
 
@@ -677,6 +678,8 @@ int bootz_setup(ulong image, ulong *start, ulong *end);
 
 /* image node */
 #define FIT_DATA_PROP		"data"
+#define FIT_DATA_OFFSET_PROP	"data-offset"
+#define FIT_DATA_SIZE_PROP	"data-size"
 #define FIT_TIMESTAMP_PROP	"timestamp"
 #define FIT_DESC_PROP		"description"
 #define FIT_ARCH_PROP		"arch"
@@ -727,6 +730,21 @@ static inline ulong fit_get_end(const void *fit)
 	return (ulong)fit + fdt_totalsize(fit);
 }
 
+/**
+ * fit_get_ext_offset - get the offset of external image data
+ * @fit: pointer to the FIT format image header
+ *
+ * Images built with 'mkimage -E' keep their data after the FIT, rather than
+ * in a 'data' property. Each image's 'data-offset' is relative to this.
+ *
+ * returns:
+ *     offset of the external data from the start of the FIT
+ */
+static inline ulong fit_get_ext_offset(const void *fit)
+{
+	return (fdt_totalsize(fit) + 3) & ~3;
+}
+
 /**
  * fit_get_name - get FIT node name
  * @fit: pointer to the FIT format image header
@@ -751,6 +769,8 @@ int fit_image_get_type(const void *fit, int noffset, uint8_t *type);
 int fit_image_get_comp(const void *fit, int noffset, uint8_t *comp);
 int fit_image_get_load(const void *fit, int noffset, ulong *load);
 int fit_image_get_entry(const void *fit, int noffset, ulong *entry);
+int fit_image_get_data_offset(const void *fit, int noffset, ulong *offset);
+int fit_image_get_data_size(const void *fit, int noffset, size_t *size);
 int fit_image_get_data(const void *fit, int noffset,
 				const void **data, size_t *size);
 
@@ -768,10 +788,13 @@ int fit_set_timestamp(void *fit, int noffset, time_t timestamp);
  * @fit:	Pointer to the FIT format image header
  * @comment:	Comment to add to signature nodes
  * @require_keys: Mark all keys as 'required'
+ * @hash_cache:	Directory of previously calculated hash values (or NULL)
  *
  * Adds hash values for all component images in the FIT blob.
  * Hashes are calculated for all component images which have hash subnodes
  * with algorithm property set to one of the supported hash algorithms.
+ * They are calculated in parallel, and looked up in / added to the hash
+ * cache if there is one.
  *
  * Also add signatures if signature nodes are present.
  *
@@ -780,8 +803,71 @@ int fit_set_timestamp(void *fit, int noffset, time_t timestamp);
  *     libfdt error code, on failure
  */
 int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
-			      const char *comment, int require_keys);
+			      const char *comment, int require_keys,
+			      const char *hash_cache);
+
+/**
+ * struct fit_loader - a FIT which is read from storage a piece at a time
+ *
+ * This allows a FIT built with external data ('mkimage -E') to be loaded
+ * without reading all of it: just the FIT itself is read, then the data of
+ * the images that are needed is read straight to their load addresses.
+ *
+ * The size of external data is not covered by a configuration signature,
+ * so it is checked against @max_size, and the load range against @lmb,
+ * before anything is read.
+ *
+ * @read:	Read @size bytes at @offset in the FIT file to @buf. Returns
+ *		the number of bytes read.
+ * @priv:	Private data for @read
+ * @max_size:	Largest image that may be loaded, in bytes
+ * @lmb:	Memory that images must not be loaded over, such as U-Boot
+ *		itself, or NULL if none. Each image is reserved in it once
+ *		loaded.
+ */
+struct fit_loader {
+	ulong (*read)(struct fit_loader *load, ulong offset, ulong size,
+		      void *buf);
+	void *priv;
+	ulong max_size;
+	struct lmb *lmb;
+};
+
+/**
+ * fit_stream_header() - read the FIT part of a FIT file
+ *
+ * This reads the FDT header, then the rest of the FDT, and checks that it
+ * is a FIT. External image data is not read.
+ *
+ * @load:	FIT to read
+ * @fit:	Buffer to hold the FIT
+ * @size:	Size of @fit in bytes
+ * @return 0 if OK, -E2BIG if the FIT is larger than @size, other -ve on
+ * error
+ */
+int fit_stream_header(struct fit_loader *load, void *fit, ulong size);
+
+/**
+ * fit_stream_image() - load an image from a FIT file to its load address
+ *
+ * External data is read straight from @load; data inside the FIT is copied
+ * from it. The image must not be compressed or larger than the limit in
+ * @load, and the data must not overlap @fit or memory reserved in @load.
+ *
+ * @load:	FIT to read
+ * @fit:	FIT read by fit_stream_header()
+ * @noffset:	Image node offset
+ * @verify:	1 to check the image hashes once loaded
+ * @loadp:	On entry, where to load the image if it has no load address,
+ *		or 0 if it must have one. Returns the load address used
+ * @lenp:	Returns the image size in bytes
+ * @return 0 if OK, -ve on error
+ */
+int fit_stream_image(struct fit_loader *load, const void *fit, int noffset,
+		     int verify, ulong *loadp, ulong *lenp);
 
+int fit_image_verify_data(const void *fit, int noffset, const void *data,
+			  size_t size);
 int fit_image_verify(const void *fit, int noffset);
 int fit_config_verify(const void *fit, int conf_noffset);
 int fit_all_image_verify(const void *fit);
@@ -818,9 +904,9 @@ int calculate_hash(const void *data, int data_len, const char *algo,
 
 /*
  * At present we only support signing on the host, and verification on the
- * device
+ * device. SPL has no public keys to verify with, so only checks hashes.
  */
-#if defined(CONFIG_FIT_SIGNATURE)
+#if defined(CONFIG_FIT_SIGNATURE) && !defined(CONFIG_SPL_BUILD)
 # ifdef USE_HOSTCC
 #  define IMAGE_ENABLE_SIGN	1
 #  define IMAGE_ENABLE_VERIFY	0
@@ -267,6 +267,7 @@ void	lcd_puts(const char *s);
 void	lcd_printf(const char *fmt, ...);
 void	lcd_clear(void);
 int	lcd_display_bitmap(ulong bmp_image, int x, int y);
+int	lcd_display_bitmap_gzip(ulong bmp_image, ulong size, int x, int y);
 
 /**
  * Get the width of the LCD in pixels
@@ -316,6 +317,12 @@ int lcd_dt_simplefb_enable_existing_node(void *blob);
 /* Update the LCD / flush the cache */
 void lcd_sync(void);
 
+/*
+ * Show the framebuffer from line yoffset onwards, for CONFIG_LCD_HW_SCROLL.
+ * Returns 0 if ok, -ENOSYS if the controller cannot do this.
+ */
+int lcd_pan_display(int yoffset);
+
 /************************************************************************/
 /* ** BITMAP DISPLAY SUPPORT						*/
 /************************************************************************/
@@ -176,3 +176,18 @@ void NS16550_putc(NS16550_t com_port, char c);
 char NS16550_getc(NS16550_t com_port);
 int NS16550_tstc(NS16550_t com_port);
 void NS16550_reinit(NS16550_t com_port, int baud_divisor);
+
+/**
+ * NS16550_write() - Send characters, filling the transmit FIFO
+ *
+ * Each '\n' is sent as "\r\n". CONFIG_SYS_NS16550_FIFO_SIZE sets the number
+ * of characters written each time the FIFO empties (default 1).
+ *
+ * @com_port:	UART to use
+ * @s:		Characters to send
+ * @len:	Number of characters
+ * @wait:	0 to return when the FIFO is full, 1 to wait for it to empty
+ * @return number of characters of @s sent, which is less than @len only if
+ * @wait is 0
+ */
+int NS16550_write(NS16550_t com_port, const char *s, int len, int wait);
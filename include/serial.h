@@ -14,6 +14,8 @@ struct serial_device {
 	int	(*tstc)(void);
 	void	(*putc)(const char c);
 	void	(*puts)(const char *s);
+	/* Optional: output what fits without waiting, return the count */
+	int	(*puts_nowait)(const char *s, int len);
 #if CONFIG_POST & CONFIG_SYS_POST_UART
 	void	(*loop)(int);
 #endif
@@ -0,0 +1,44 @@
+/*
+ * Android sparse image format
+ *
+ * A sparse image describes a raw partition image as a list of chunks, so
+ * that unused space need not be sent to the board. Every header is
+ * little-endian.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef _SPARSE_FORMAT_H_
+#define _SPARSE_FORMAT_H_
+
+#include <linux/types.h>
+
+#define SPARSE_HEADER_MAGIC	0xed26ff3a
+#define SPARSE_HEADER_MAJOR_VER	1
+
+/* Chunk types */
+#define CHUNK_TYPE_RAW		0xcac1	/* Data follows the chunk header */
+#define CHUNK_TYPE_FILL		0xcac2	/* A 32-bit value fills the chunk */
+#define CHUNK_TYPE_DONT_CARE	0xcac3	/* Leave the blocks unchanged */
+#define CHUNK_TYPE_CRC32	0xcac4	/* CRC32 of the data so far */
+
+typedef struct sparse_header {
+	__le32	magic;		/* SPARSE_HEADER_MAGIC */
+	__le16	major_version;	/* Incompatible changes bump this */
+	__le16	minor_version;	/* Compatible changes bump this */
+	__le16	file_hdr_sz;	/* Bytes in this header (28 for v1.0) */
+	__le16	chunk_hdr_sz;	/* Bytes in each chunk header (12 for v1.0) */
+	__le32	blk_sz;		/* Block size in bytes, a multiple of 4 */
+	__le32	total_blks;	/* Blocks in the expanded image */
+	__le32	total_chunks;	/* Chunks in the sparse image */
+	__le32	image_checksum;	/* CRC32 of the expanded image, unused */
+} sparse_header_t;
+
+typedef struct chunk_header {
+	__le16	chunk_type;	/* CHUNK_TYPE_... */
+	__le16	reserved1;
+	__le32	chunk_sz;	/* Size of the chunk in output blocks */
+	__le32	total_sz;	/* Bytes in the chunk, header and data */
+} chunk_header_t;
+
+#endif /* _SPARSE_FORMAT_H_ */
@@ -25,6 +25,7 @@ struct spl_image_info {
 	u32 entry_point;
 	u32 size;
 	u32 flags;
+	void *arg;	/* OS argument, if not at CONFIG_SYS_SPL_ARGS_ADDR */
 };
 
 #define SPL_COPY_PAYLOAD_ONLY	1
@@ -72,6 +73,10 @@ void spl_sata_load_image(void);
 int spl_load_image_fat(block_dev_desc_t *block_dev, int partition, const char *filename);
 int spl_load_image_fat_os(block_dev_desc_t *block_dev, int partition);
 
+/* SPL FIT image functions */
+struct fit_loader;
+int spl_load_fit(struct fit_loader *load);
+
 #ifdef CONFIG_SPL_BOARD_INIT
 void spl_board_init(void);
 #endif
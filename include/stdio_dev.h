@@ -34,6 +34,8 @@ struct stdio_dev {
 
 	void (*putc) (const char c);	/* To put a char			*/
 	void (*puts) (const char *s);	/* To put a string (accelerator)	*/
+	/* To put as much as fits without waiting, returning the count	*/
+	int (*puts_nowait) (const char *s, int len);
 
 /* INPUT functions */
 
@@ -0,0 +1,138 @@
+/*
+ * Cooperative task scheduler
+ *
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __TASK_H
+#define __TASK_H
+
+#include <errno.h>
+#include <linux/list.h>
+
+/**
+ * struct task - A job which runs while U-Boot is waiting for hardware
+ *
+ * U-Boot has no threads, so a task is a function which does a small piece
+ * of work each time it is called, and then returns. Tasks are run one step
+ * at a time, in turn, from task_yield(), which drivers call from their
+ * busy-wait loops. For example a task can hash or decompress a chunk of an
+ * image which has already been loaded while the next chunk is being read.
+ *
+ * @name: Name of task, for debugging
+ * @run: Do the next piece of work. This returns -EAGAIN if there is more
+ *	to do, 0 when finished, or another -ve value on error
+ * @priv: Private data for the task
+ * @result: Final return value from run(), or -EINPROGRESS if the task is
+ *	still running
+ * @steps: Number of times run() has been called
+ * @node: Link in the list of running tasks
+ *
+ * Set up a task with task_init() before it is first started.
+ */
+struct task {
+	const char *name;
+	int (*run)(struct task *task);
+	void *priv;
+	int result;
+	ulong steps;
+	struct list_head node;
+};
+
+/**
+ * task_init() - Set up a task so that it can be started
+ *
+ * This must not be called while the task is running.
+ *
+ * @task: Task to set up
+ * @name: Name of task, for debugging
+ * @run: Function which does the next piece of work
+ * @priv: Private data for the task
+ */
+static inline void task_init(struct task *task, const char *name,
+			     int (*run)(struct task *task), void *priv)
+{
+	task->name = name;
+	task->run = run;
+	task->priv = priv;
+	task->result = 0;
+	task->steps = 0;
+	INIT_LIST_HEAD(&task->node);
+}
+
+#if defined(CONFIG_TASKS) && !defined(CONFIG_SPL_BUILD)
+/**
+ * task_start() - Start a task
+ *
+ * The task is added to the end of the list of running tasks. It does not
+ * run until the next call to task_yield() or task_wait().
+ *
+ * @task: Task to start, set up by task_init()
+ * @return 0 if OK, -EBUSY if the task is already running
+ */
+int task_start(struct task *task);
+
+/**
+ * task_yield() - Let other tasks run
+ *
+ * This runs one step of the next task in the list, then moves the task to
+ * the end of the list. Tasks are therefore run in turn, in the order in
+ * which they were started. Calls made from within a task do nothing, so
+ * tasks can use code containing yield points.
+ *
+ * With CONFIG_DM_BACKGROUND_PROBE this also polls devices which are being
+ * probed in the background.
+ */
+void task_yield(void);
+
+/**
+ * task_wait() - Wait for a task to finish
+ *
+ * This runs the task until it finishes.
+ *
+ * @task: Task to wait for
+ * @return final return value from the task's run() method
+ */
+int task_wait(struct task *task);
+
+/**
+ * task_running() - Check if a task is still running
+ *
+ * @task: Task to check
+ * @return true if the task has been started but not yet finished
+ */
+static inline bool task_running(struct task *task)
+{
+	return task->result == -EINPROGRESS;
+}
+#else
+/* Without a scheduler, tasks run to completion when they are started */
+static inline int task_start(struct task *task)
+{
+	task->steps = 0;
+	do {
+		task->steps++;
+		task->result = task->run(task);
+	} while (task->result == -EAGAIN);
+
+	return 0;
+}
+
+static inline void task_yield(void)
+{
+}
+
+static inline int task_wait(struct task *task)
+{
+	return task->result;
+}
+
+static inline bool task_running(struct task *task)
+{
+	return false;
+}
+#endif
+
+#endif
@@ -24,11 +24,19 @@ enum {
 	 * this value.
 	 */
 	FUNC_SITE_SIZE	= 4,	/* distance between function sites */
+
+	/*
+	 * Maximum call depth for which function times are recorded. Time
+	 * spent in deeper calls is counted as self time of the deepest
+	 * function we can track.
+	 */
+	TRACE_STACK_DEPTH	= 128,
 };
 
 enum trace_chunk_type {
 	TRACE_CHUNK_FUNCS,
 	TRACE_CHUNK_CALLS,
+	TRACE_CHUNK_FUNC_TIMES,
 };
 
 /* A trace record for a function, as written to the profile output file */
@@ -37,6 +45,14 @@ struct trace_output_func {
 	uint32_t call_count;		/* Number of times called */
 };
 
+/* A timing record for a function, as written to the profile output file */
+struct trace_output_func_time {
+	uint32_t offset;		/* Function offset into code */
+	uint32_t call_count;		/* Number of times called */
+	uint32_t total_us;		/* Time in function and its callees */
+	uint32_t self_us;		/* Time in function itself */
+};
+
 /* A header at the start of the trace output buffer */
 struct trace_output_hdr {
 	enum trace_chunk_type type;	/* Record type */
@@ -80,6 +96,29 @@ struct trace_call {
 
 int trace_list_calls(void *buff, int buff_size, unsigned int *needed);
 
+/**
+ * Dump a list of functions with call counts and times into a buffer
+ *
+ * Each record in the buffer is a struct trace_output_func_time. This
+ * requires CONFIG_TRACE_AGGREGATE.
+ *
+ * @param buff		Buffer in which to place data, or NULL to count size
+ * @param buff_size	Size of buffer
+ * @param needed	Returns number of bytes used / needed
+ * @return 0 if ok, -1 on error (buffer exhausted or not supported)
+ */
+int trace_list_func_times(void *buff, int buff_size, unsigned int *needed);
+
+/**
+ * Select whether individual function calls are recorded
+ *
+ * In aggregate mode only the per-function counters are updated, so the
+ * trace buffer does not fill up and the overhead is lower.
+ *
+ * @param aggregate	1 to record only counters, 0 to record each call
+ */
+void trace_set_aggregate(int aggregate);
+
 /**
  * Turn function tracing on and off
  *
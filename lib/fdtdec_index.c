@@ -0,0 +1,472 @@
+/*
+ * Lookup index for the control device tree
+ *
+ * Finding a node by path, phandle or compatible string with libfdt means
+ * walking the tree from the start each time. Once U-Boot has relocated and
+ * has a malloc() area, we walk it once and keep sorted tables so that these
+ * lookups become binary searches. The tables hold node offsets, so they stay
+ * valid only while the tree's structure is unchanged; each lookup checks
+ * this and falls back to libfdt if not.
+ *
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <fdtdec.h>
+#include <malloc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Deepest node nesting we index */
+#define FDT_INDEX_MAX_DEPTH	32
+
+/*
+ * A node name under its parent. A name with a unit address ("serial@1000")
+ * has a second entry without it ("serial"), since libfdt accepts either.
+ */
+struct fdt_index_name {
+	int parent;
+	const char *name;
+	int len;
+	int offset;
+};
+
+struct fdt_index_phandle {
+	uint32_t phandle;
+	int offset;
+};
+
+struct fdt_index_compat {
+	const char *compat;
+	int offset;
+};
+
+struct fdt_index_alias {
+	const char *name;
+	const char *path;
+};
+
+/**
+ * struct fdt_index - lookup tables for a device tree
+ *
+ * Each table is sorted by key and then by node offset, so the first of
+ * several matching entries is the one libfdt would find.
+ *
+ * @blob:		Device tree that this indexes
+ * @size_dt_struct:	Size of its structure block when indexed
+ * @size_dt_strings:	Size of its strings block when indexed
+ */
+struct fdt_index {
+	const void *blob;
+	uint32_t size_dt_struct;
+	uint32_t size_dt_strings;
+	struct fdt_index_name *names;
+	int num_names;
+	struct fdt_index_phandle *phandles;
+	int num_phandles;
+	struct fdt_index_compat *compats;
+	int num_compats;
+	struct fdt_index_alias *aliases;
+	int num_aliases;
+};
+
+static struct fdt_index *fdt_index_get(const void *blob)
+{
+	struct fdt_index *idx = gd->fdt_index;
+
+	if (!idx || idx->blob != blob ||
+	    fdt_size_dt_struct(blob) != idx->size_dt_struct ||
+	    fdt_size_dt_strings(blob) != idx->size_dt_strings)
+		return NULL;
+
+	return idx;
+}
+
+static int compare_str(const char *a, int alen, const char *b, int blen)
+{
+	int ret;
+
+	ret = memcmp(a, b, min(alen, blen));
+	if (ret)
+		return ret;
+
+	return alen - blen;
+}
+
+static int compare_name(const void *a, const void *b)
+{
+	const struct fdt_index_name *na = a, *nb = b;
+	int ret;
+
+	if (na->parent != nb->parent)
+		return na->parent - nb->parent;
+	ret = compare_str(na->name, na->len, nb->name, nb->len);
+	if (ret)
+		return ret;
+
+	return na->offset - nb->offset;
+}
+
+static int compare_phandle(const void *a, const void *b)
+{
+	const struct fdt_index_phandle *pa = a, *pb = b;
+
+	if (pa->phandle != pb->phandle)
+		return pa->phandle < pb->phandle ? -1 : 1;
+
+	return pa->offset - pb->offset;
+}
+
+static int compare_compat(const void *a, const void *b)
+{
+	const struct fdt_index_compat *ca = a, *cb = b;
+	int ret;
+
+	ret = strcmp(ca->compat, cb->compat);
+	if (ret)
+		return ret;
+
+	return ca->offset - cb->offset;
+}
+
+static int compare_alias(const void *a, const void *b)
+{
+	const struct fdt_index_alias *aa = a, *ab = b;
+
+	return strcmp(aa->name, ab->name);
+}
+
+static int fdt_index_subnode(struct fdt_index *idx, int parent,
+			     const char *name, int len)
+{
+	struct fdt_index_name *entry;
+	int lo = 0, hi = idx->num_names;
+
+	/* Find the first entry not less than (parent, name, offset -1) */
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		entry = &idx->names[mid];
+		if (entry->parent < parent || (entry->parent == parent &&
+		    compare_str(entry->name, entry->len, name, len) < 0))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	entry = &idx->names[lo];
+	if (lo == idx->num_names || entry->parent != parent ||
+	    compare_str(entry->name, entry->len, name, len))
+		return -FDT_ERR_NOTFOUND;
+
+	return entry->offset;
+}
+
+static const char *fdt_index_alias(struct fdt_index *idx, const char *name,
+				   int len)
+{
+	int lo = 0, hi = idx->num_aliases;
+
+	while (lo < hi) {
+		struct fdt_index_alias *alias;
+		int mid = (lo + hi) / 2;
+		int ret;
+
+		alias = &idx->aliases[mid];
+		ret = compare_str(alias->name, strlen(alias->name), name, len);
+		if (!ret)
+			return alias->path;
+		if (ret < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return NULL;
+}
+
+/* This follows fdt_path_offset(), but looks up each name in the index */
+static int fdt_index_path_offset(struct fdt_index *idx, const char *path)
+{
+	const char *end = path + strlen(path);
+	const char *p = path;
+	int offset = 0;
+
+	if (*path != '/') {
+		const char *q = strchr(path, '/');
+
+		if (!q)
+			q = end;
+		p = fdt_index_alias(idx, p, q - p);
+		if (!p)
+			return -FDT_ERR_BADPATH;
+		offset = fdt_index_path_offset(idx, p);
+		if (offset < 0)
+			return offset;
+		p = q;
+	}
+
+	while (*p) {
+		const char *q;
+
+		while (*p == '/')
+			p++;
+		if (!*p)
+			return offset;
+		q = strchr(p, '/');
+		if (!q)
+			q = end;
+		offset = fdt_index_subnode(idx, offset, p, q - p);
+		if (offset < 0)
+			return offset;
+		p = q;
+	}
+
+	return offset;
+}
+
+int fdtdec_path_offset(const void *blob, const char *path)
+{
+	struct fdt_index *idx = fdt_index_get(blob);
+
+	if (!idx)
+		return fdt_path_offset(blob, path);
+
+	return fdt_index_path_offset(idx, path);
+}
+
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle)
+{
+	struct fdt_index *idx = fdt_index_get(blob);
+	int lo, hi;
+
+	if (!idx)
+		return fdt_node_offset_by_phandle(blob, phandle);
+	if (phandle == 0 || phandle == -1)
+		return -FDT_ERR_BADPHANDLE;
+
+	lo = 0;
+	hi = idx->num_phandles;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (idx->phandles[mid].phandle < phandle)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == idx->num_phandles || idx->phandles[lo].phandle != phandle)
+		return -FDT_ERR_NOTFOUND;
+
+	return idx->phandles[lo].offset;
+}
+
+int fdtdec_node_offset_by_compatible(const void *blob, int startoffset,
+				     const char *compat)
+{
+	struct fdt_index *idx = fdt_index_get(blob);
+	struct fdt_index_compat *entry;
+	int lo, hi;
+
+	if (!idx)
+		return fdt_node_offset_by_compatible(blob, startoffset, compat);
+
+	/* Find the first entry for this string after startoffset */
+	lo = 0;
+	hi = idx->num_compats;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		int ret;
+
+		entry = &idx->compats[mid];
+		ret = strcmp(entry->compat, compat);
+		if (ret < 0 || (!ret && entry->offset <= startoffset))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	entry = &idx->compats[lo];
+	if (lo == idx->num_compats || strcmp(entry->compat, compat))
+		return -FDT_ERR_NOTFOUND;
+
+	return entry->offset;
+}
+
+static void fdt_index_add_names(struct fdt_index *idx, int parent,
+				int offset)
+{
+	struct fdt_index_name *entry;
+	const char *name, *at;
+	int len;
+
+	name = fdt_get_name(idx->blob, offset, &len);
+	entry = &idx->names[idx->num_names++];
+	entry->parent = parent;
+	entry->name = name;
+	entry->len = len;
+	entry->offset = offset;
+
+	at = memchr(name, '@', len);
+	if (at) {
+		entry[1] = entry[0];
+		entry[1].len = at - name;
+		idx->num_names++;
+	}
+}
+
+static void fdt_index_add_compats(struct fdt_index *idx, int offset)
+{
+	const char *compat, *end;
+	int len;
+
+	compat = fdt_getprop(idx->blob, offset, "compatible", &len);
+	if (!compat)
+		return;
+	for (end = compat + len; compat < end;
+	     compat += strnlen(compat, end - compat) + 1) {
+		idx->compats[idx->num_compats].compat = compat;
+		idx->compats[idx->num_compats++].offset = offset;
+	}
+}
+
+static int fdt_index_fill(struct fdt_index *idx)
+{
+	const void *blob = idx->blob;
+	int parents[FDT_INDEX_MAX_DEPTH];
+	int offset, depth = 0;
+	uint32_t phandle;
+
+	for (offset = 0; offset >= 0 && depth >= 0;
+	     offset = fdt_next_node(blob, offset, &depth)) {
+		if (depth >= FDT_INDEX_MAX_DEPTH)
+			return -FDT_ERR_BADSTRUCTURE;
+		parents[depth] = offset;
+		if (depth)
+			fdt_index_add_names(idx, parents[depth - 1], offset);
+		phandle = fdt_get_phandle(blob, offset);
+		if (phandle) {
+			idx->phandles[idx->num_phandles].phandle = phandle;
+			idx->phandles[idx->num_phandles++].offset = offset;
+		}
+		fdt_index_add_compats(idx, offset);
+	}
+	if (offset < 0 && offset != -FDT_ERR_NOTFOUND)
+		return offset;
+
+	offset = fdt_path_offset(blob, "/aliases");
+	if (offset >= 0) {
+		for (offset = fdt_first_property_offset(blob, offset);
+		     offset >= 0;
+		     offset = fdt_next_property_offset(blob, offset)) {
+			const struct fdt_property *prop;
+			struct fdt_index_alias *alias;
+
+			prop = fdt_get_property_by_offset(blob, offset, NULL);
+			alias = &idx->aliases[idx->num_aliases++];
+			alias->name = fdt_string(blob,
+						 fdt32_to_cpu(prop->nameoff));
+			alias->path = prop->data;
+		}
+	}
+
+	qsort(idx->names, idx->num_names, sizeof(*idx->names), compare_name);
+	qsort(idx->phandles, idx->num_phandles, sizeof(*idx->phandles),
+	      compare_phandle);
+	qsort(idx->compats, idx->num_compats, sizeof(*idx->compats),
+	      compare_compat);
+	qsort(idx->aliases, idx->num_aliases, sizeof(*idx->aliases),
+	      compare_alias);
+
+	return 0;
+}
+
+/* Count the entries needed, so that we can allocate the tables at once */
+static void fdt_index_count(const void *blob, int *nodesp, int *compatsp,
+			    int *aliasesp)
+{
+	int offset, depth = 0;
+	int nodes = 0, compats = 0, aliases = 0;
+
+	for (offset = 0; offset >= 0 && depth >= 0;
+	     offset = fdt_next_node(blob, offset, &depth)) {
+		const char *compat;
+		int len, i;
+
+		nodes++;
+		compat = fdt_getprop(blob, offset, "compatible", &len);
+		for (i = 0; compat && i < len; i++)
+			if (!compat[i] || i == len - 1)
+				compats++;
+	}
+
+	offset = fdt_path_offset(blob, "/aliases");
+	if (offset >= 0) {
+		for (offset = fdt_first_property_offset(blob, offset);
+		     offset >= 0;
+		     offset = fdt_next_property_offset(blob, offset))
+			aliases++;
+	}
+
+	*nodesp = nodes;
+	*compatsp = compats;
+	*aliasesp = aliases;
+}
+
+int fdtdec_index_build(const void *blob)
+{
+	struct fdt_index *idx;
+	int nodes, compats, aliases;
+	int ret;
+
+	fdtdec_index_free();
+	ret = fdt_check_header(blob);
+	if (ret)
+		return ret;
+	fdt_index_count(blob, &nodes, &compats, &aliases);
+
+	idx = calloc(1, sizeof(*idx));
+	if (!idx)
+		return -FDT_ERR_NOSPACE;
+	idx->blob = blob;
+	idx->size_dt_struct = fdt_size_dt_struct(blob);
+	idx->size_dt_strings = fdt_size_dt_strings(blob);
+	idx->names = malloc(nodes * 2 * sizeof(*idx->names));
+	idx->phandles = malloc(nodes * sizeof(*idx->phandles));
+	idx->compats = malloc(compats * sizeof(*idx->compats));
+	idx->aliases = malloc(aliases * sizeof(*idx->aliases));
+	if (!idx->names || !idx->phandles || (compats && !idx->compats) ||
+	    (aliases && !idx->aliases)) {
+		ret = -FDT_ERR_NOSPACE;
+		goto err;
+	}
+
+	ret = fdt_index_fill(idx);
+	if (ret)
+		goto err;
+	debug("%s: %d nodes, %d phandles, %d compatible strings, %d aliases\n",
+	      __func__, nodes, idx->num_phandles, idx->num_compats,
+	      idx->num_aliases);
+	gd->fdt_index = idx;
+
+	return 0;
+err:
+	gd->fdt_index = idx;
+	fdtdec_index_free();
+
+	return ret;
+}
+
+void fdtdec_index_free(void)
+{
+	struct fdt_index *idx = gd->fdt_index;
+
+	if (!idx)
+		return;
+	free(idx->names);
+	free(idx->phandles);
+	free(idx->compats);
+	free(idx->aliases);
+	free(idx);
+	gd->fdt_index = NULL;
+}
@@ -7,13 +7,39 @@
 #include <common.h>
 #include <initcall.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
+#ifdef CONFIG_BOOTSTAGE_INITCALL
+/*
+ * Record the time taken by an initcall. We use the link-time address so
+ * that it can be looked up in System.map even after relocation.
+ */
+static void initcall_record(init_fnc_t func, ulong start_us)
+{
+	ulong addr = (ulong)func;
+
+	if (gd->flags & GD_FLG_RELOC)
+		addr -= gd->reloc_off;
+	bootstage_initcall(addr, start_us);
+}
+#endif
+
 int initcall_run_list(init_fnc_t init_sequence[])
 {
 	init_fnc_t *init_fnc_ptr;
+	__maybe_unused ulong start_us;
+	int ret;
 
 	for (init_fnc_ptr = init_sequence; *init_fnc_ptr; ++init_fnc_ptr) {
 		debug("initcall: %p\n", *init_fnc_ptr);
-		if ((*init_fnc_ptr)()) {
+#ifdef CONFIG_BOOTSTAGE_INITCALL
+		start_us = timer_get_boot_us();
+#endif
+		ret = (*init_fnc_ptr)();
+#ifdef CONFIG_BOOTSTAGE_INITCALL
+		initcall_record(*init_fnc_ptr, start_us);
+#endif
+		if (ret) {
 			debug("initcall sequence %p failed at call %p\n",
 			      init_sequence, *init_fnc_ptr);
 			return -1;
@@ -258,6 +258,40 @@ err_priv:
 	return ret;
 }
 
+/*
+ * rsa_get_exponent(): - Get the public exponent from an RSA key
+ */
+static int rsa_get_exponent(RSA *key, uint64_t *e)
+{
+	BIGNUM *word;
+	int ret = 0;
+
+	if (BN_num_bits(key->e) > 64) {
+		fprintf(stderr, "RSA exponent is more than 64 bits\n");
+		return -EINVAL;
+	}
+
+	/* BN_get_word() may be only 32 bits, so take one word at a time */
+	word = BN_new();
+	if (!word) {
+		fprintf(stderr, "Out of memory (bignum)\n");
+		return -ENOMEM;
+	}
+	if (!BN_rshift(word, key->e, 32))
+		ret = -1;
+	*e = (uint64_t)BN_get_word(word) << 32;
+	if (!BN_copy(word, key->e) || !BN_mask_bits(word, 32))
+		ret = -1;
+	*e |= BN_get_word(word);
+	BN_free(word);
+	if (ret) {
+		fprintf(stderr, "Bignum operations failed\n");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 /*
  * rsa_get_params(): - Get the important parameters of an RSA public key
  */
@@ -384,6 +418,7 @@ static int fdt_add_bignum(void *blob, int noffset, const char *prop_name,
 int rsa_add_verify_data(struct image_sign_info *info, void *keydest)
 {
 	BIGNUM *modulus, *r_squared;
+	uint64_t exponent;
 	uint32_t n0_inv;
 	int parent, node;
 	char name[100];
@@ -395,9 +430,12 @@ int rsa_add_verify_data(struct image_sign_info *info, void *keydest)
 	ret = rsa_get_pub_key(info->keydir, info->keyname, &rsa);
 	if (ret)
 		return ret;
+	ret = rsa_get_exponent(rsa, &exponent);
+	if (ret)
+		goto err_get_params;
 	ret = rsa_get_params(rsa, &n0_inv, &modulus, &r_squared);
 	if (ret)
-		return ret;
+		goto err_get_params;
 	bits = BN_num_bits(modulus);
 	parent = fdt_subnode_offset(keydest, 0, FIT_SIG_NODENAME);
 	if (parent == -FDT_ERR_NOTFOUND) {
@@ -405,7 +443,8 @@ int rsa_add_verify_data(struct image_sign_info *info, void *keydest)
 		if (parent < 0) {
 			fprintf(stderr, "Couldn't create signature node: %s\n",
 				fdt_strerror(parent));
-			return -EINVAL;
+			ret = -EINVAL;
+			goto done;
 		}
 	}
 
@@ -417,18 +456,21 @@ int rsa_add_verify_data(struct image_sign_info *info, void *keydest)
 		if (node < 0) {
 			fprintf(stderr, "Could not create key subnode: %s\n",
 				fdt_strerror(node));
-			return -EINVAL;
+			ret = -EINVAL;
+			goto done;
 		}
 	} else if (node < 0) {
 		fprintf(stderr, "Cannot select keys parent: %s\n",
 			fdt_strerror(node));
-		return -ENOSPC;
+		ret = -ENOSPC;
+		goto done;
 	}
 
 	ret = fdt_setprop_string(keydest, node, "key-name-hint",
 				 info->keyname);
 	ret |= fdt_setprop_u32(keydest, node, "rsa,num-bits", bits);
 	ret |= fdt_setprop_u32(keydest, node, "rsa,n0-inverse", n0_inv);
+	ret |= fdt_setprop_u64(keydest, node, "rsa,exponent", exponent);
 	ret |= fdt_add_bignum(keydest, node, "rsa,modulus", modulus, bits);
 	ret |= fdt_add_bignum(keydest, node, "rsa,r-squared", r_squared, bits);
 	ret |= fdt_setprop_string(keydest, node, FIT_ALGO_PROP,
@@ -437,10 +479,13 @@ int rsa_add_verify_data(struct image_sign_info *info, void *keydest)
 		fdt_setprop_string(keydest, node, "required",
 				   info->require_keys);
 	}
+	if (ret)
+		ret = -EIO;
+done:
 	BN_free(modulus);
 	BN_free(r_squared);
-	if (ret)
-		return -EIO;
+err_get_params:
+	RSA_free(rsa);
 
-	return 0;
+	return ret;
 }
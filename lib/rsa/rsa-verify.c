@@ -16,59 +16,57 @@
  * struct rsa_public_key - holder for a public key
  *
  * An RSA public key consists of a modulus (typically called N), the inverse
- * and R^2, where R is 2^(# key bits).
+ * and R^2, where R is 2^(# key bits), and the public exponent.
  */
 struct rsa_public_key {
 	uint len;		/* Length of modulus[] in number of uint32_t */
 	uint32_t n0inv;		/* -1 / modulus[0] mod 2^32 */
 	uint32_t *modulus;	/* modulus as little endian array */
 	uint32_t *rr;		/* R^2 as little endian array */
+	uint64_t exponent;	/* public exponent */
 };
 
-#define UINT64_MULT32(v, multby)  (((uint64_t)(v)) * ((uint32_t)(multby)))
-
-#define RSA2048_BYTES	(2048 / 8)
-
 /* This is the minimum/maximum key size we support, in bits */
 #define RSA_MIN_KEY_BITS	2048
-#define RSA_MAX_KEY_BITS	2048
+#define RSA_MAX_KEY_BITS	4096
 
 /* This is the maximum signature length that we support, in bits */
-#define RSA_MAX_SIG_BITS	2048
-
-static const uint8_t padding_sha1_rsa2048[RSA2048_BYTES - SHA1_SUM_LEN] = {
-	0x00, 0x01, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-	0xff, 0xff, 0xff, 0xff, 0x00, 0x30, 0x21, 0x30,
-	0x09, 0x06, 0x05, 0x2b, 0x0e, 0x03, 0x02, 0x1a,
+#define RSA_MAX_SIG_BITS	4096
+
+/* Exponent used by keys which do not give one */
+#define RSA_DEFAULT_PUBEXP	65537
+
+/*
+ * Largest window of exponent bits handled with one multiply. A 64-bit
+ * exponent needs no more than 3, and 65537 is fastest with 1.
+ */
+#define RSA_MAX_WINDOW_BITS	3
+
+/* PKCS#1 v1.5 DigestInfo prefix for SHA-1, which comes before the hash */
+static const uint8_t digest_info_sha1[] = {
+	0x30, 0x21, 0x30, 0x09, 0x06, 0x05, 0x2b, 0x0e, 0x03, 0x02, 0x1a,
 	0x05, 0x00, 0x04, 0x14
 };
 
+/*
+ * MUL_ADD() - Multiply and add two words: hi:lo = a * b + lo + hi
+ *
+ * This cannot overflow. ARMv7 does it in a single instruction.
+ */
+#ifdef __ARM_ARCH_7A__
+#define MUL_ADD(lo, hi, a, b) \
+	__asm__("umaal %0, %1, %2, %3" \
+		: "+r" (lo), "+r" (hi) \
+		: "r" (a), "r" (b))
+#else
+#define MUL_ADD(lo, hi, a, b) \
+	do { \
+		uint64_t __acc = (uint64_t)(a) * (b) + (lo) + (hi); \
+		(lo) = (uint32_t)__acc; \
+		(hi) = (uint32_t)(__acc >> 32); \
+	} while (0)
+#endif
+
 /**
  * subtract_modulus() - subtract modulus from the given value
  *
@@ -97,7 +95,7 @@ static void subtract_modulus(const struct rsa_public_key *key, uint32_t num[])
 static int greater_equal_modulus(const struct rsa_public_key *key,
 				 uint32_t num[])
 {
-	uint32_t i;
+	int i;
 
 	for (i = key->len - 1; i >= 0; i--) {
 		if (num[i] < key->modulus[i])
@@ -109,6 +107,19 @@ static int greater_equal_modulus(const struct rsa_public_key *key,
 	return 1;  /* equal */
 }
 
+/*
+ * One word of montgomery_mul_add_step(): add a * b[i] and d0 * modulus[i]
+ * to result[i], carrying into c1 and c2, and store the low word shifted
+ * down by one word.
+ */
+#define MONT_STEP(i) \
+	do { \
+		uint32_t __lo = result[i]; \
+		MUL_ADD(__lo, c1, a, b[i]); \
+		MUL_ADD(__lo, c2, d0, m[i]); \
+		result[(i) - 1] = __lo; \
+	} while (0)
+
 /**
  * montgomery_mul_add_step() - Perform montgomery multiply-add step
  *
@@ -122,25 +133,35 @@ static int greater_equal_modulus(const struct rsa_public_key *key,
 static void montgomery_mul_add_step(const struct rsa_public_key *key,
 		uint32_t result[], const uint32_t a, const uint32_t b[])
 {
-	uint64_t acc_a, acc_b;
-	uint32_t d0;
+	const uint32_t *m = key->modulus;
+	uint32_t lo, c1, c2, d0;
+	uint64_t top;
 	uint i;
 
-	acc_a = (uint64_t)a * b[0] + result[0];
-	d0 = (uint32_t)acc_a * key->n0inv;
-	acc_b = (uint64_t)d0 * key->modulus[0] + (uint32_t)acc_a;
-	for (i = 1; i < key->len; i++) {
-		acc_a = (acc_a >> 32) + (uint64_t)a * b[i] + result[i];
-		acc_b = (acc_b >> 32) + (uint64_t)d0 * key->modulus[i] +
-				(uint32_t)acc_a;
-		result[i - 1] = (uint32_t)acc_b;
+	c1 = 0;
+	c2 = 0;
+	lo = result[0];
+	MUL_ADD(lo, c1, a, b[0]);
+	d0 = lo * key->n0inv;
+	MUL_ADD(lo, c2, d0, m[0]);
+
+	/*
+	 * Four words at a time, then one at a time for the rest: three words
+	 * when the key is a multiple of four words, as 2048/3072/4096-bit are
+	 */
+	for (i = 1; i + 4 <= key->len; i += 4) {
+		MONT_STEP(i);
+		MONT_STEP(i + 1);
+		MONT_STEP(i + 2);
+		MONT_STEP(i + 3);
 	}
+	for (; i < key->len; i++)
+		MONT_STEP(i);
 
-	acc_a = (acc_a >> 32) + (acc_b >> 32);
-
-	result[i - 1] = (uint32_t)acc_a;
+	top = (uint64_t)c1 + c2;
+	result[i - 1] = (uint32_t)top;
 
-	if (acc_a >> 32)
+	if (top >> 32)
 		subtract_modulus(key, result);
 }
 
@@ -155,7 +176,7 @@ static void montgomery_mul_add_step(const struct rsa_public_key *key,
  * @b:		Multiplicand, as little endian word array
  */
 static void montgomery_mul(const struct rsa_public_key *key,
-		uint32_t result[], uint32_t a[], const uint32_t b[])
+		uint32_t result[], const uint32_t a[], const uint32_t b[])
 {
 	uint i;
 
@@ -165,16 +186,36 @@ static void montgomery_mul(const struct rsa_public_key *key,
 		montgomery_mul_add_step(key, result, a[i], b);
 }
 
+/* Number of significant bits in a 64-bit value */
+static int num_bits(uint64_t val)
+{
+	int bits;
+
+	for (bits = 0; val; bits++)
+		val >>= 1;
+
+	return bits;
+}
+
 /**
  * pow_mod() - in-place public exponentiation
  *
+ * This works left to right through the exponent, squaring for each bit and
+ * multiplying by an odd power of the value for each window of up to
+ * RSA_MAX_WINDOW_BITS bits which starts and ends with a 1. The powers are
+ * kept multiplied by R (in Montgomery form), except that a last multiply
+ * by the value itself is done with the plain value, which takes the result
+ * out of Montgomery form at the same time.
+ *
  * @key:	RSA key
  * @inout:	Big-endian word array containing value and result
  */
 static int pow_mod(const struct rsa_public_key *key, uint32_t *inout)
 {
-	uint32_t *result, *ptr;
-	uint i;
+	uint32_t *result, *ptr, *acc, *tmp, *swap;
+	int bits, window, nsquares;
+	int i, j, started, plain;
+	uint n;
 
 	/* Sanity check for stack size - key->len is in 32-bit words */
 	if (key->len > RSA_MAX_KEY_BITS / 32) {
@@ -182,27 +223,79 @@ static int pow_mod(const struct rsa_public_key *key, uint32_t *inout)
 		      RSA_MAX_KEY_BITS / 32);
 		return -EINVAL;
 	}
+	if (!key->exponent) {
+		debug("RSA exponent must not be zero\n");
+		return -EINVAL;
+	}
 
-	uint32_t val[key->len], acc[key->len], tmp[key->len];
-	result = tmp;  /* Re-use location. */
+	uint32_t val[key->len], buf1[key->len], buf2[key->len];
+	uint32_t table[1 << (RSA_MAX_WINDOW_BITS - 1)][key->len];
+
+	bits = num_bits(key->exponent);
+	window = bits > 24 ? RSA_MAX_WINDOW_BITS : 1;
 
 	/* Convert from big endian byte array to little endian word array. */
 	for (i = 0, ptr = inout + key->len - 1; i < key->len; i++, ptr--)
 		val[i] = get_unaligned_be32(ptr);
 
-	montgomery_mul(key, acc, val, key->rr);  /* axx = a * RR / R mod M */
-	for (i = 0; i < 16; i += 2) {
-		montgomery_mul(key, tmp, acc, acc); /* tmp = acc^2 / R mod M */
-		montgomery_mul(key, acc, tmp, tmp); /* acc = tmp^2 / R mod M */
+	/* table[n] = a^(2n + 1) * R mod M */
+	montgomery_mul(key, table[0], val, key->rr);
+	if (window > 1) {
+		montgomery_mul(key, buf1, table[0], table[0]);
+		for (n = 1; n < 1 << (window - 1); n++)
+			montgomery_mul(key, table[n], table[n - 1], buf1);
+	}
+
+	acc = buf1;
+	tmp = buf2;
+	started = 0;
+	plain = 0;
+	for (i = bits - 1; i >= 0; i = j - 1) {
+		/* Find the longest window i..j ending with a 1 */
+		j = max(i - window + 1, 0);
+		while (!(key->exponent >> j & 1))
+			j++;
+		n = (key->exponent >> j) & ((1 << (i - j + 1)) - 1);
+
+		if (!started) {
+			memcpy(acc, table[n >> 1], key->len * sizeof(*acc));
+			started = 1;
+		} else {
+			for (nsquares = i - j + 1; nsquares; nsquares--) {
+				montgomery_mul(key, tmp, acc, acc);
+				swap = acc, acc = tmp, tmp = swap;
+			}
+			if (!j && n == 1) {
+				montgomery_mul(key, tmp, acc, val);
+				plain = 1;
+			} else {
+				montgomery_mul(key, tmp, acc, table[n >> 1]);
+			}
+			swap = acc, acc = tmp, tmp = swap;
+		}
+
+		/* Square for the zero bits after the window, if any */
+		for (; j > 0 && !(key->exponent >> (j - 1) & 1); j--) {
+			montgomery_mul(key, tmp, acc, acc);
+			swap = acc, acc = tmp, tmp = swap;
+		}
+	}
+
+	/* Take the result out of Montgomery form if not done already */
+	result = acc;
+	if (!plain) {
+		memset(val, '\0', sizeof(val));
+		val[0] = 1;
+		montgomery_mul(key, tmp, acc, val);
+		result = tmp;
 	}
-	montgomery_mul(key, result, acc, val);  /* result = XX * a / R mod M */
 
 	/* Make sure result < mod; result is at most 1x mod too large. */
 	if (greater_equal_modulus(key, result))
 		subtract_modulus(key, result);
 
 	/* Convert to bigendian byte array */
-	for (i = key->len - 1, ptr = inout; (int)i >= 0; i--, ptr++)
+	for (i = key->len - 1, ptr = inout; i >= 0; i--, ptr++)
 		put_unaligned_be32(result[i], ptr);
 
 	return 0;
@@ -211,9 +304,10 @@ static int pow_mod(const struct rsa_public_key *key, uint32_t *inout)
 static int rsa_verify_key(const struct rsa_public_key *key, const uint8_t *sig,
 		const uint32_t sig_len, const uint8_t *hash)
 {
-	const uint8_t *padding;
+	const uint8_t *msg;
 	int pad_len;
 	int ret;
+	int i;
 
 	if (!key || !sig || !hash)
 		return -EIO;
@@ -238,18 +332,25 @@ static int rsa_verify_key(const struct rsa_public_key *key, const uint8_t *sig,
 	if (ret)
 		return ret;
 
-	/* Determine padding to use depending on the signature type. */
-	padding = padding_sha1_rsa2048;
-	pad_len = RSA2048_BYTES - SHA1_SUM_LEN;
-
-	/* Check pkcs1.5 padding bytes. */
-	if (memcmp(buf, padding, pad_len)) {
+	/*
+	 * Check pkcs1.5 padding bytes: 00 01 ff ... ff 00 followed by the
+	 * DigestInfo prefix
+	 */
+	msg = (const uint8_t *)buf;
+	pad_len = sig_len - SHA1_SUM_LEN;
+	for (i = 2; i < pad_len - sizeof(digest_info_sha1) - 1; i++) {
+		if (msg[i] != 0xff)
+			break;
+	}
+	if (msg[0] != 0x00 || msg[1] != 0x01 ||
+	    i != pad_len - sizeof(digest_info_sha1) - 1 || msg[i] != 0x00 ||
+	    memcmp(msg + i + 1, digest_info_sha1, sizeof(digest_info_sha1))) {
 		debug("In RSAVerify(): Padding check failed!\n");
 		return -EINVAL;
 	}
 
 	/* Check hash. */
-	if (memcmp((uint8_t *)buf + pad_len, hash, sig_len - pad_len)) {
+	if (memcmp(msg + pad_len, hash, sig_len - pad_len)) {
 		debug("In RSAVerify(): Hash check failed!\n");
 		return -EACCES;
 	}
@@ -283,6 +384,8 @@ static int rsa_verify_with_keynode(struct image_sign_info *info,
 	}
 	key.len = fdtdec_get_int(blob, node, "rsa,num-bits", 0);
 	key.n0inv = fdtdec_get_int(blob, node, "rsa,n0-inverse", 0);
+	key.exponent = fdtdec_get_uint64(blob, node, "rsa,exponent",
+					 RSA_DEFAULT_PUBEXP);
 	modulus = fdt_getprop(blob, node, "rsa,modulus", NULL);
 	rr = fdt_getprop(blob, node, "rsa,r-squared", NULL);
 	if (!key.len || !modulus || !rr) {
@@ -291,7 +394,8 @@ static int rsa_verify_with_keynode(struct image_sign_info *info,
 	}
 
 	/* Sanity check for stack size */
-	if (key.len > RSA_MAX_KEY_BITS || key.len < RSA_MIN_KEY_BITS) {
+	if (key.len > RSA_MAX_KEY_BITS || key.len < RSA_MIN_KEY_BITS ||
+	    key.len % 32) {
 		debug("RSA key bits %u outside allowed range %d..%d\n",
 		      key.len, RSA_MIN_KEY_BITS, RSA_MAX_KEY_BITS);
 		return -EFAULT;
@@ -13,6 +13,22 @@ DECLARE_GLOBAL_DATA_PTR;
 
 static char trace_enabled __attribute__((section(".data")));
 static char trace_inited __attribute__((section(".data")));
+static char trace_aggregate __attribute__((section(".data")));
+
+/* Time spent in a function, when CONFIG_TRACE_AGGREGATE is enabled */
+struct trace_func_time {
+	uint32_t total_us;	/* Time in function and its callees */
+	uint32_t self_us;	/* Time in function itself */
+};
+
+#ifdef CONFIG_TRACE_AGGREGATE
+/* A function on the call stack, used to work out function times */
+struct trace_frame {
+	uint32_t func;		/* Function number */
+	uint32_t start_us;	/* Time when function was entered */
+	uint32_t child_us;	/* Time spent in callees so far */
+};
+#endif
 
 /* The header block at the start of the trace memory area */
 struct trace_hdr {
@@ -27,6 +43,9 @@ struct trace_hdr {
 	 */
 	uintptr_t *call_accum;
 
+	/* Time taken by each function, indexed as call_accum, or NULL */
+	struct trace_func_time *func_time;
+
 	/* Function trace list */
 	struct trace_call *ftrace;	/* The function call records */
 	ulong ftrace_size;	/* Num. of ftrace records we have space for */
@@ -36,6 +55,11 @@ struct trace_hdr {
 	int depth;
 	int depth_limit;
 	int max_depth;
+
+#ifdef CONFIG_TRACE_AGGREGATE
+	/* Functions we are currently in, for working out function times */
+	struct trace_frame stack[TRACE_STACK_DEPTH];
+#endif
 };
 
 static struct trace_hdr *hdr;	/* Pointer to start of trace buffer */
@@ -59,6 +83,8 @@ static inline uintptr_t __attribute__((no_instrument_function))
 static void __attribute__((no_instrument_function)) add_ftrace(void *func_ptr,
 				void *caller, ulong flags)
 {
+	if (trace_aggregate)
+		return;
 	if (hdr->depth > hdr->depth_limit) {
 		hdr->ftrace_too_deep_count++;
 		return;
@@ -73,6 +99,44 @@ static void __attribute__((no_instrument_function)) add_ftrace(void *func_ptr,
 	hdr->ftrace_count++;
 }
 
+#ifdef CONFIG_TRACE_AGGREGATE
+static void __attribute__((no_instrument_function)) func_time_enter(int func)
+{
+	struct trace_frame *frame;
+
+	if (hdr->depth >= TRACE_STACK_DEPTH)
+		return;
+	frame = &hdr->stack[hdr->depth];
+	frame->func = func;
+	frame->start_us = timer_get_us();
+	frame->child_us = 0;
+}
+
+static void __attribute__((no_instrument_function)) func_time_exit(void)
+{
+	struct trace_frame *frame;
+	uint32_t elapsed;
+
+	if (hdr->depth < 0 || hdr->depth >= TRACE_STACK_DEPTH)
+		return;
+	frame = &hdr->stack[hdr->depth];
+	elapsed = (uint32_t)timer_get_us() - frame->start_us;
+	if (frame->func < hdr->func_count) {
+		struct trace_func_time *time = &hdr->func_time[frame->func];
+
+		time->total_us += elapsed;
+		time->self_us += elapsed - frame->child_us;
+	}
+	if (hdr->depth > 0)
+		frame[-1].child_us += elapsed;
+}
+#else
+static inline void __attribute__((no_instrument_function))
+		func_time_enter(int func) {}
+static inline void __attribute__((no_instrument_function))
+		func_time_exit(void) {}
+#endif
+
 static void __attribute__((no_instrument_function)) add_textbase(void)
 {
 	if (hdr->ftrace_count < hdr->ftrace_size) {
@@ -108,6 +172,7 @@ void __attribute__((no_instrument_function)) __cyg_profile_func_enter(
 		} else {
 			hdr->untracked_count++;
 		}
+		func_time_enter(func);
 		hdr->depth++;
 		if (hdr->depth > hdr->depth_limit)
 			hdr->max_depth = hdr->depth;
@@ -117,7 +182,8 @@ void __attribute__((no_instrument_function)) __cyg_profile_func_enter(
 /**
  * This is called on every function exit
  *
- * We do nothing here.
+ * We record the exit at the same depth as the matching entry, so that
+ * entry and exit records are always paired.
  *
  * @param func_ptr	Pointer to function being entered
  * @param caller	Pointer to function which called this function
@@ -126,8 +192,9 @@ void __attribute__((no_instrument_function)) __cyg_profile_func_exit(
 		void *func_ptr, void *caller)
 {
 	if (trace_enabled) {
-		add_ftrace(func_ptr, caller, FUNCF_EXIT);
 		hdr->depth--;
+		func_time_exit();
+		add_ftrace(func_ptr, caller, FUNCF_EXIT);
 	}
 }
 
@@ -231,6 +298,58 @@ int trace_list_calls(void *buff, int buff_size, unsigned *needed)
 	return 0;
 }
 
+int trace_list_func_times(void *buff, int buff_size, unsigned int *needed)
+{
+#ifdef CONFIG_TRACE_AGGREGATE
+	struct trace_output_hdr *output_hdr = NULL;
+	void *end, *ptr = buff;
+	int func;
+	int upto;
+
+	end = buff ? buff + buff_size : NULL;
+
+	/* Place some header information */
+	if (ptr + sizeof(struct trace_output_hdr) < end)
+		output_hdr = ptr;
+	ptr += sizeof(struct trace_output_hdr);
+
+	/* Add the counts and times for each function */
+	for (func = upto = 0; func < hdr->func_count; func++) {
+		int calls = hdr->call_accum[func];
+
+		if (!calls)
+			continue;
+
+		if (ptr + sizeof(struct trace_output_func_time) < end) {
+			struct trace_output_func_time *stats = ptr;
+
+			stats->offset = func * FUNC_SITE_SIZE;
+			stats->call_count = calls;
+			stats->total_us = hdr->func_time[func].total_us;
+			stats->self_us = hdr->func_time[func].self_us;
+			upto++;
+		}
+		ptr += sizeof(struct trace_output_func_time);
+	}
+
+	/* Update the header */
+	if (output_hdr) {
+		output_hdr->rec_count = upto;
+		output_hdr->type = TRACE_CHUNK_FUNC_TIMES;
+	}
+
+	/* Work out how must of the buffer we used */
+	*needed = ptr - buff;
+	if (ptr > end)
+		return -1;
+	return 0;
+#else
+	puts("trace: function times need CONFIG_TRACE_AGGREGATE\n");
+	*needed = 0;
+	return -1;
+#endif
+}
+
 /* Print basic information about tracing */
 void trace_print_stats(void)
 {
@@ -262,6 +381,8 @@ void trace_print_stats(void)
 	printf("%15d call depth limit\n", hdr->depth_limit);
 	print_grouped_ull(hdr->ftrace_too_deep_count, 10);
 	puts(" calls not traced due to depth\n");
+	if (trace_aggregate)
+		puts("Recording function counters only\n");
 }
 
 void __attribute__((no_instrument_function)) trace_set_enabled(int enabled)
@@ -269,6 +390,40 @@ void __attribute__((no_instrument_function)) trace_set_enabled(int enabled)
 	trace_enabled = enabled != 0;
 }
 
+void __attribute__((no_instrument_function)) trace_set_aggregate(int aggregate)
+{
+	trace_aggregate = aggregate != 0;
+}
+
+/**
+ * Work out the space needed for the trace header and per-function data
+ *
+ * @param func_count	Number of function sites
+ * @return number of bytes needed
+ */
+static size_t __attribute__((no_instrument_function)) trace_hdr_size(
+		ulong func_count)
+{
+	size_t size = sizeof(*hdr) + func_count * sizeof(uintptr_t);
+
+#ifdef CONFIG_TRACE_AGGREGATE
+	size += func_count * sizeof(struct trace_func_time);
+#endif
+	return size;
+}
+
+/* Set up the pointers to the per-function arrays in the trace header */
+static void __attribute__((no_instrument_function)) trace_setup_hdr(
+		ulong func_count)
+{
+	hdr->func_count = func_count;
+	hdr->call_accum = (uintptr_t *)(hdr + 1);
+#ifdef CONFIG_TRACE_AGGREGATE
+	hdr->func_time = (struct trace_func_time *)
+			(hdr->call_accum + func_count);
+#endif
+}
+
 /**
  * Init the tracing system ready for used, and enable it
  *
@@ -306,7 +461,7 @@ int __attribute__((no_instrument_function)) trace_init(void *buff,
 #endif
 	}
 	hdr = (struct trace_hdr *)buff;
-	needed = sizeof(*hdr) + func_count * sizeof(uintptr_t);
+	needed = trace_hdr_size(func_count);
 	if (needed > buff_size) {
 		printf("trace: buffer size %zd bytes: at least %zd needed\n",
 		       buff_size, needed);
@@ -315,8 +470,7 @@ int __attribute__((no_instrument_function)) trace_init(void *buff,
 
 	if (was_disabled)
 		memset(hdr, '\0', needed);
-	hdr->func_count = func_count;
-	hdr->call_accum = (uintptr_t *)(hdr + 1);
+	trace_setup_hdr(func_count);
 
 	/* Use any remaining space for the timed function trace */
 	hdr->ftrace = (struct trace_call *)(buff + needed);
@@ -342,7 +496,7 @@ int __attribute__((no_instrument_function)) trace_early_init(void)
 		return 0;
 
 	hdr = map_sysmem(CONFIG_TRACE_EARLY_ADDR, CONFIG_TRACE_EARLY_SIZE);
-	needed = sizeof(*hdr) + func_count * sizeof(uintptr_t);
+	needed = trace_hdr_size(func_count);
 	if (needed > buff_size) {
 		printf("trace: buffer size is %zd bytes, at least %zd needed\n",
 		       buff_size, needed);
@@ -350,8 +504,7 @@ int __attribute__((no_instrument_function)) trace_early_init(void)
 	}
 
 	memset(hdr, '\0', needed);
-	hdr->call_accum = (uintptr_t *)(hdr + 1);
-	hdr->func_count = func_count;
+	trace_setup_hdr(func_count);
 
 	/* Use any remaining space for the timed function trace */
 	hdr->ftrace = (struct trace_call *)((char *)hdr + needed);
@@ -0,0 +1,163 @@
+/*
+ * Tests for DFU writes through the back-end, using a RAM entity
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <dfu.h>
+#include <malloc.h>
+#include <task.h>
+#include <u-boot/crc.h>
+
+#define errcheck(statement) if (!(statement)) { \
+	fprintf(stderr, "\tFailed: %s\n", #statement); \
+	ret = 1; \
+	goto out; \
+}
+
+enum {
+	DFU_TEST_BUF_SIZE	= 512 << 10,	/* dfu_bufsiz */
+	DFU_TEST_SLICE		= 256 << 10,	/* Written per task step */
+	DFU_TEST_BLOCK		= 4 << 10,	/* Sent per USB transfer */
+	DFU_TEST_SIZE		= (3 << 20) + 1000,
+};
+
+/* Set up a RAM entity covering size bytes at medium */
+static struct dfu_entity *dfu_test_entity(void *medium, ulong size)
+{
+	char alt_info[60];
+
+	snprintf(alt_info, sizeof(alt_info), "img ram %lx %lx",
+		 (ulong)medium, size);
+	setenv("dfu_alt_info", alt_info);
+	setenv_hex("dfu_bufsiz", DFU_TEST_BUF_SIZE);
+	if (dfu_init_env_entities("ram", 0))
+		return NULL;
+
+	return dfu_get_entity(0);
+}
+
+/*
+ * Send size bytes of src in USB-sized blocks, stepping the scheduler after
+ * each one as the dfu command does. Return the first error, if any.
+ */
+static int dfu_test_send(struct dfu_entity *dfu, u8 *src, int size,
+			 int (*check)(u8 *src, int pos))
+{
+	int pos, len, seq = 0;
+	int ret;
+
+	for (pos = 0; pos < size; pos += len) {
+		len = min(size - pos, (int)DFU_TEST_BLOCK);
+		ret = dfu_write(dfu, src + pos, len, seq++);
+		if (ret)
+			return ret;
+		task_yield();
+		if (check && check(src, pos + len))
+			return -EBADMSG;
+	}
+
+	return dfu_write(dfu, NULL, 0, seq);
+}
+
+static u8 *dfu_test_medium;
+
+/*
+ * Once the first buffer is full, one step of the write task should have
+ * written the first slice of it, and the rest should wait for later steps
+ */
+static int dfu_test_check_overlap(u8 *src, int pos)
+{
+	if (pos != DFU_TEST_BUF_SIZE)
+		return 0;
+	if (memcmp(dfu_test_medium, src, DFU_TEST_SLICE))
+		return 1;
+	if (!memcmp(dfu_test_medium + DFU_TEST_SLICE, src + DFU_TEST_SLICE,
+		    DFU_TEST_BUF_SIZE - DFU_TEST_SLICE))
+		return 1;
+
+	return 0;
+}
+
+/* Check that an image is written correctly, while it is being received */
+static int test_dfu_write(void)
+{
+	struct dfu_entity *dfu;
+	u8 *src = NULL;
+	int ret;
+	int i;
+
+	src = malloc(DFU_TEST_SIZE);
+	dfu_test_medium = malloc(DFU_TEST_SIZE);
+	if (!src || !dfu_test_medium) {
+		ret = 1;
+		goto out;
+	}
+	for (i = 0; i < DFU_TEST_SIZE; i++)
+		src[i] = i * 7 + (i >> 8);
+	memset(dfu_test_medium, '\xff', DFU_TEST_SIZE);
+
+	dfu = dfu_test_entity(dfu_test_medium, DFU_TEST_SIZE);
+	errcheck(dfu);
+	errcheck(!dfu_test_send(dfu, src, DFU_TEST_SIZE,
+				dfu_test_check_overlap));
+	errcheck(dfu->crc == crc32(0, src, DFU_TEST_SIZE));
+	errcheck(!dfu_flush(dfu, NULL, 0, 0));
+	errcheck(!memcmp(dfu_test_medium, src, DFU_TEST_SIZE));
+	ret = 0;
+
+out:
+	printf(" %s: %s\n", __func__, ret == 0 ? "ok" : "FAILED");
+	dfu_free_entities();
+	free(dfu_test_medium);
+	free(src);
+	return ret;
+}
+
+/* Check that an error writing to the medium is passed back */
+static int test_dfu_write_error(void)
+{
+	struct dfu_entity *dfu;
+	u8 *src = NULL, *medium = NULL;
+	int ret;
+
+	/* The medium fills up part way through the image */
+	src = calloc(1, DFU_TEST_SIZE);
+	medium = malloc(DFU_TEST_SLICE);
+	if (!src || !medium) {
+		ret = 1;
+		goto out;
+	}
+
+	dfu = dfu_test_entity(medium, DFU_TEST_SLICE);
+	errcheck(dfu);
+	errcheck(dfu_test_send(dfu, src, DFU_TEST_SIZE, NULL) == -EINVAL);
+	dfu_flush(dfu, NULL, 0, 0);
+	ret = 0;
+
+out:
+	printf(" %s: %s\n", __func__, ret == 0 ? "ok" : "FAILED");
+	dfu_free_entities();
+	free(medium);
+	free(src);
+	return ret;
+}
+
+static int do_ut_dfu(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	int err = 0;
+
+	err += test_dfu_write();
+	err += test_dfu_write_error();
+
+	printf("ut_dfu %s\n", err == 0 ? "ok" : "FAILED");
+
+	return err ? CMD_RET_FAILURE : 0;
+}
+
+U_BOOT_CMD(
+	ut_dfu,	1,	1,	do_ut_dfu,
+	"Test DFU writes to a medium while receiving", ""
+);
@@ -57,6 +57,11 @@ static struct driver_info driver_info_manual = {
 	.platdata = &test_pdata_manual,
 };
 
+static struct driver_info driver_info_background = {
+	.name = "test_background_drv",
+	.platdata = &test_pdata_manual,
+};
+
 /* Test that binding with platdata occurs correctly */
 static int dm_test_autobind(struct dm_test_state *dms)
 {
@@ -542,3 +547,80 @@ static int dm_test_children(struct dm_test_state *dms)
 	return 0;
 }
 DM_TEST(dm_test_children, 0);
+
+/* Test that devices can be probed in the background */
+static int dm_test_probe_background(struct dm_test_state *dms)
+{
+	struct device *dev, *dev2, *test_dev;
+	struct dm_test_priv *priv, *priv2;
+
+	/* We don't care about the numbering for this test */
+	dms->skip_post_probe = 1;
+
+	ut_assertok(device_bind_by_name(dms->root, &driver_info_background,
+					&dev));
+	ut_assertok(device_bind_by_name(dms->root, &driver_info_background,
+					&dev2));
+
+	/* Starting the probes should call the probe method only */
+	ut_assertok(dm_probe_background());
+	ut_asserteq(2, dm_testdrv_op_count[DM_TEST_OP_PROBE]);
+	ut_asserteq(0, dm_testdrv_op_count[DM_TEST_OP_PROBE_POLL]);
+	ut_assert(dev->flags & DM_FLAG_PROBE_PENDING);
+	ut_assert(!device_active(dev));
+	ut_assert(dms->root->flags & DM_FLAG_ACTIVATED);
+	priv = dev->priv;
+	priv2 = dev2->priv;
+	ut_assert(priv);
+	ut_assert(priv2);
+
+	/* Starting again should do nothing */
+	ut_assertok(dm_probe_background());
+	ut_asserteq(2, dm_testdrv_op_count[DM_TEST_OP_PROBE]);
+
+	/* Each poll makes progress with both devices */
+	ut_asserteq(2, dm_probe_poll_pending(NULL));
+	ut_asserteq(1, priv->probe_polls);
+	ut_asserteq(1, priv2->probe_polls);
+	ut_asserteq(1, dm_probe_poll_pending(dev));
+	ut_asserteq(1, priv->probe_polls);
+	ut_asserteq(2, priv2->probe_polls);
+	ut_asserteq(0, dm_testdrv_op_count[DM_TEST_OP_POST_PROBE]);
+
+	/* Getting a device waits for it to finish, others carry on */
+	ut_assertok(uclass_get_device(UCLASS_TEST, 0, &test_dev));
+	ut_asserteq_ptr(dev, test_dev);
+	ut_assert(device_active(dev));
+	ut_assert(!(dev->flags & DM_FLAG_PROBE_PENDING));
+	ut_asserteq(DM_TEST_PROBE_POLLS, priv->probe_polls);
+	ut_asserteq(DM_TEST_PROBE_POLLS, priv2->probe_polls);
+	ut_asserteq(2, dm_testdrv_op_count[DM_TEST_OP_POST_PROBE]);
+	ut_assert(device_active(dev2));
+	ut_asserteq(0, dm_probe_poll_pending(NULL));
+	ut_asserteq(2 * DM_TEST_PROBE_POLLS,
+		    dm_testdrv_op_count[DM_TEST_OP_PROBE_POLL]);
+
+	/* A pending device cannot be unbound until it is removed */
+	ut_assertok(device_remove(dev));
+	ut_assertok(device_remove(dev2));
+	ut_assertok(device_probe_start(dev));
+	ut_asserteq(-EINVAL, device_unbind(dev));
+	ut_assertok(device_remove(dev));
+	ut_assert(!(dev->flags & DM_FLAG_PROBE_PENDING));
+	ut_assert(!device_active(dev));
+	ut_assert(!dev->priv);
+	ut_assertok(device_unbind(dev));
+
+	/* A failed background probe leaves the device inactive */
+	dms->force_fail_probe = 1;
+	ut_assertok(device_probe_start(dev2));
+	ut_asserteq(-EAGAIN, device_probe_poll(dev2));
+	ut_asserteq(-EIO, device_probe(dev2));
+	ut_assert(!(dev2->flags & DM_FLAG_PROBE_PENDING));
+	ut_assert(!device_active(dev2));
+	ut_assert(!dev2->priv);
+	ut_asserteq(-EIO, uclass_get_device(UCLASS_TEST, 0, &test_dev));
+
+	return 0;
+}
+DM_TEST(dm_test_probe_background, 0);
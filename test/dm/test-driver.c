@@ -135,6 +135,46 @@ static int test_manual_unbind(struct device *dev)
 	return 0;
 }
 
+static int test_background_probe(struct device *dev)
+{
+	struct dm_test_priv *priv = dev_get_priv(dev);
+
+	/* Private data should be allocated */
+	ut_assert(priv);
+
+	dm_testdrv_op_count[DM_TEST_OP_PROBE]++;
+	priv->ping_total += DM_TEST_START_TOTAL;
+	return 0;
+}
+
+static int test_background_probe_poll(struct device *dev)
+{
+	struct dm_test_priv *priv = dev_get_priv(dev);
+
+	/* The device should not be active until we say so */
+	ut_assert(!device_active(dev));
+
+	dm_testdrv_op_count[DM_TEST_OP_PROBE_POLL]++;
+	if (++priv->probe_polls < DM_TEST_PROBE_POLLS)
+		return -EAGAIN;
+	if (dms->force_fail_probe)
+		return -EIO;
+
+	return 0;
+}
+
+U_BOOT_DRIVER(test_background_drv) = {
+	.name	= "test_background_drv",
+	.id	= UCLASS_TEST,
+	.ops	= &test_ops,
+	.bind	= test_bind,
+	.probe	= test_background_probe,
+	.probe_poll = test_background_probe_poll,
+	.remove	= test_remove,
+	.unbind	= test_unbind,
+	.priv_auto_alloc_size = sizeof(struct dm_test_priv),
+};
+
 U_BOOT_DRIVER(test_manual_drv) = {
 	.name	= "test_manual_drv",
 	.id	= UCLASS_TEST,
@@ -0,0 +1,63 @@
+#
+# SPDX-License-Identifier:	GPL-2.0+
+#
+
+# Run the driver model tests with a large device tree, to check the device
+# tree index against libfdt and report the time taken to bind devices.
+
+OUTPUT_DIR=sandbox
+NUM_NODES=2000
+
+fail() {
+	echo "Test failed: $1"
+	if [ -n "${tmp}" ]; then
+		rm -f ${tmp}.dts ${tmp}.dtb ${tmp}.out
+	fi
+	exit 1
+}
+
+build_uboot() {
+	echo "Build sandbox"
+	OPTS="O=${OUTPUT_DIR}"
+	NUM_CPUS=$(grep -c processor /proc/cpuinfo)
+	make ${OPTS} sandbox_config
+	make ${OPTS} -s -j${NUM_CPUS}
+}
+
+# Add top-level nodes that no driver matches, each with a subnode, to the
+# driver model test tree
+make_dtb() {
+	echo "Create a device tree with ${NUM_NODES} extra nodes"
+	sed '$d' test/dm/test.dts >${tmp}.dts
+	for i in $(seq 1 ${NUM_NODES}); do
+		cat >>${tmp}.dts <<EOT
+
+	node@${i} {
+		compatible = "vendor,device-${i}", "vendor,device";
+		reg = <${i}>;
+		phandle = <${i}>;
+
+		child@0 {
+			compatible = "vendor,child";
+			reg = <0>;
+		};
+	};
+EOT
+	done
+	echo "};" >>${tmp}.dts
+	dtc -I dts -O dtb ${tmp}.dts -o ${tmp}.dtb || fail "dtc"
+}
+
+echo "Device tree index test using sandbox"
+echo
+tmp="$(mktemp)"
+build_uboot
+make_dtb
+./${OUTPUT_DIR}/u-boot -d ${tmp}.dtb -c "dm test" >${tmp}.out 2>&1
+if ! grep -q "Failures: 0" ${tmp}.out; then
+	cat ${tmp}.out
+	fail "driver model tests"
+fi
+grep "^Bound" ${tmp}.out || fail "no timing"
+rm -f ${tmp} ${tmp}.dts ${tmp}.dtb ${tmp}.out
+echo "Test passed"
@@ -10,6 +10,7 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <asm/io.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
 #include <dm/root.h>
 #include <dm/ut.h>
@@ -142,3 +143,103 @@ static int dm_test_fdt(struct dm_test_state *dms)
 	return 0;
 }
 DM_TEST(dm_test_fdt, 0);
+
+#ifdef CONFIG_OF_INDEX
+/* Test that the device tree index finds the same nodes as libfdt */
+static int dm_test_fdt_index(struct dm_test_state *dms)
+{
+	const void *blob = gd->fdt_blob;
+	int offset, prev, depth = 0;
+	char path[256];
+
+	ut_assertok(fdtdec_index_build(blob));
+	for (prev = -1, offset = 0; offset >= 0 && depth >= 0;
+	     prev = offset, offset = fdt_next_node(blob, offset, &depth)) {
+		uint32_t phandle = fdt_get_phandle(blob, offset);
+		const char *compat;
+		char *at;
+
+		ut_assertok(fdt_get_path(blob, offset, path, sizeof(path)));
+		ut_asserteq(offset, fdtdec_path_offset(blob, path));
+
+		/* libfdt also accepts a name without its unit address */
+		at = strrchr(path, '@');
+		if (at && !strchr(at, '/')) {
+			*at = '\0';
+			ut_asserteq(fdt_path_offset(blob, path),
+				    fdtdec_path_offset(blob, path));
+		}
+		if (phandle) {
+			ut_asserteq(fdt_node_offset_by_phandle(blob, phandle),
+				    fdtdec_node_offset_by_phandle(blob,
+								  phandle));
+		}
+		compat = fdt_getprop(blob, offset, "compatible", NULL);
+		if (compat) {
+			ut_asserteq(fdt_node_offset_by_compatible(blob, prev,
+								  compat),
+				    fdtdec_node_offset_by_compatible(blob, prev,
+								     compat));
+			ut_asserteq(fdt_node_offset_by_compatible(blob,
+							offset, compat),
+				    fdtdec_node_offset_by_compatible(blob,
+							offset, compat));
+		}
+	}
+
+	/* Aliases and missing nodes */
+	ut_asserteq(fdt_path_offset(blob, "testfdt0"),
+		    fdtdec_path_offset(blob, "testfdt0"));
+	ut_asserteq(fdt_path_offset(blob, "testfdt0/c-test"),
+		    fdtdec_path_offset(blob, "testfdt0/c-test"));
+	ut_asserteq(-FDT_ERR_NOTFOUND, fdtdec_path_offset(blob, "/missing"));
+	ut_asserteq(-FDT_ERR_BADPATH, fdtdec_path_offset(blob, "missing"));
+	ut_asserteq(-FDT_ERR_NOTFOUND,
+		    fdtdec_node_offset_by_compatible(blob, -1, "missing"));
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_index, 0);
+
+static int dm_test_unbind_all(struct dm_test_state *dms)
+{
+	struct device *dev, *next;
+
+	list_for_each_entry_safe(dev, next, &dms->root->child_head,
+				 sibling_node)
+		ut_assertok(device_unbind(dev));
+
+	return 0;
+}
+
+/* Report the time taken to bind devices with and without the index */
+static int dm_test_fdt_index_bind(struct dm_test_state *dms)
+{
+	const void *blob = gd->fdt_blob;
+	ulong start, indexed, linear;
+	int nodes, depth = 0;
+	int offset;
+
+	for (nodes = 0, offset = 0; offset >= 0 && depth >= 0;
+	     offset = fdt_next_node(blob, offset, &depth))
+		nodes++;
+
+	ut_assertok(fdtdec_index_build(blob));
+	start = timer_get_us();
+	ut_assertok(dm_scan_fdt(blob));
+	indexed = timer_get_us() - start;
+	ut_assertok(dm_test_unbind_all(dms));
+
+	fdtdec_index_free();
+	start = timer_get_us();
+	ut_assertok(dm_scan_fdt(blob));
+	linear = timer_get_us() - start;
+	ut_assertok(fdtdec_index_build(blob));
+
+	printf("Bound %d nodes in %lu us with index, %lu us without\n",
+	       nodes, indexed, linear);
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_index_bind, 0);
+#endif
@@ -0,0 +1,125 @@
+#
+# SPDX-License-Identifier:	GPL-2.0+
+#
+
+# Test the log-structured environment (CONFIG_ENV_IS_IN_LOG) with the
+# sandbox_envlog build of sandbox, which keeps it in the file given to
+# --host.
+
+OUTPUT_DIR=sandbox_envlog
+NUM_SAVES=300
+
+fail() {
+	echo "Test failed: $1"
+	if [ -n "${tmp}" ]; then
+		rm -f ${tmp} ${tmp}.out ${tmp}.orig
+	fi
+	exit 1
+}
+
+build_uboot() {
+	echo "Build sandbox"
+	OPTS="O=${OUTPUT_DIR}"
+	NUM_CPUS=$(grep -c processor /proc/cpuinfo)
+	make ${OPTS} sandbox_envlog_config
+	make ${OPTS} -s -j${NUM_CPUS}
+}
+
+run_uboot() {
+	./${OUTPUT_DIR}/u-boot --host 0:${tmp} -c "$1" >${tmp}.out 2>&1
+}
+
+# expect <text> <message>
+expect() {
+	grep -q "$1" ${tmp}.out || fail "$2"
+}
+
+echo "Simple log-structured environment test using sandbox"
+echo
+tmp="$(mktemp)"
+build_uboot
+dd if=/dev/zero of=${tmp} bs=1k count=8 2>/dev/null
+
+echo "Save and reload"
+run_uboot "setenv first one; setenv second two; saveenv"
+expect "Writing .* bytes to host0 bank 0" "first save is not a snapshot"
+run_uboot "printenv first second; setenv first uno; setenv second; saveenv"
+expect "first=one" "first not saved"
+expect "second=two" "second not saved"
+expect "Appending .* bytes" "change not appended"
+run_uboot "printenv first second; saveenv"
+expect "first=uno" "change lost"
+expect "\"second\" not defined" "delete lost"
+expect "unchanged" "nothing changed but environment was written"
+
+echo "Save ${NUM_SAVES} times"
+cmds="setenv stdout serial"
+for i in $(seq 1 ${NUM_SAVES}); do
+	cmds="${cmds}; setenv count ${i}; saveenv"
+done
+run_uboot "${cmds}"
+appends=$(grep -c "Appending" ${tmp}.out)
+snapshots=$(grep -c "Writing .* bytes to host0 bank" ${tmp}.out)
+if [ $((appends + snapshots)) -ne ${NUM_SAVES} ] || [ ${snapshots} -lt 2 ]
+then
+	fail "expected ${NUM_SAVES} saves with some compaction"
+fi
+if grep "Appending" ${tmp}.out | grep -qv "Appending [0-9]\{1,2\} bytes"; then
+	fail "append wrote more than the change"
+fi
+echo "${appends} appends, ${snapshots} snapshots"
+run_uboot "printenv count first"
+expect "count=${NUM_SAVES}" "count lost after compaction"
+expect "first=uno" "first lost after compaction"
+
+echo "Torn record"
+run_uboot "setenv count torn; saveenv"
+expect "Appending" "change not appended"
+# Corrupt the last record, as if the write was cut short
+pos=$(grep -abo "count=torn" ${tmp} | tail -1 | cut -d: -f1)
+printf 'X' | dd of=${tmp} bs=1 seek=${pos} conv=notrunc 2>/dev/null
+run_uboot "printenv count first; setenv count again; saveenv"
+expect "count=${NUM_SAVES}" "torn record was not ignored"
+expect "first=uno" "first lost after torn record"
+run_uboot "printenv count"
+expect "count=again" "save after torn record lost"
+
+echo "Append to a new block"
+cp ${tmp} ${tmp}.orig
+run_uboot "setenv count newblock; saveenv"
+expect "Appending" "change not appended"
+pos=$(grep -abo "count=newblock" ${tmp} | tail -1 | cut -d: -f1)
+start=$((pos - 16))
+[ $((start % 512)) -eq 0 ] || fail "record does not start on a block"
+cmp -s -n ${start} ${tmp} ${tmp}.orig || fail "earlier block was rewritten"
+rm -f ${tmp}.orig
+
+echo "Failed snapshots"
+dd if=/dev/zero of=${tmp} bs=1k count=8 2>/dev/null
+run_uboot "setenv count 0; saveenv"
+expect "bank 0" "first save is not in bank 0"
+# Make writes to bank 1, past the first 4KiB of the file, fail
+cmds="setenv stdout serial"
+for i in $(seq 1 12); do
+	cmds="${cmds}; setenv count ${i}; saveenv"
+done
+(trap '' XFSZ; ulimit -f 4; run_uboot "${cmds}")
+[ $(grep -c "failed" ${tmp}.out) -ge 2 ] || fail "snapshots did not fail"
+if grep "Writing" ${tmp}.out | grep -qv "bank 1"; then
+	fail "failed snapshot moved to the other bank"
+fi
+appends=$(grep -c "Appending" ${tmp}.out)
+run_uboot "printenv count"
+expect "count=${appends}\$" "last good environment lost"
+
+echo "Foreign data"
+# Something which is neither blank nor an environment, e.g. a boot sector
+dd if=/dev/urandom of=${tmp} bs=1k count=8 2>/dev/null
+cp ${tmp} ${tmp}.orig
+run_uboot "setenv first one; saveenv"
+expect "Not saving" "saveenv did not refuse to overwrite foreign data"
+cmp -s ${tmp} ${tmp}.orig || fail "foreign data was overwritten"
+rm -f ${tmp}.orig
+
+rm -f ${tmp} ${tmp}.out
+echo "Test passed"
@@ -0,0 +1,136 @@
+#
+# SPDX-License-Identifier:	GPL-2.0+
+#
+
+# Test ext4 lookups in large, hash-indexed directories with sandbox.
+# Needs mkfs.ext4, debugfs and e2fsck from e2fsprogs 1.43 or later.
+
+OUTPUT_DIR=sandbox
+NUM_FILES=8000
+NUM_SMALL=150
+
+fail() {
+	echo "Test failed: $1"
+	if [ -n "${tmp}" ]; then
+		rm -rf ${tmp} ${tmp}.img ${tmp}.out
+	fi
+	exit 1
+}
+
+build_uboot() {
+	echo "Build sandbox"
+	OPTS="O=${OUTPUT_DIR}"
+	NUM_CPUS=$(grep -c processor /proc/cpuinfo)
+	make ${OPTS} sandbox_config
+	make ${OPTS} -s -j${NUM_CPUS}
+}
+
+# Fill a directory with enough files to need two levels of index at 1KiB,
+# and another with a few blocks for ext4write to add to
+make_tree() {
+	echo "Create ${NUM_FILES} files"
+	mkdir -p ${tmp}/big/sub
+	for i in $(seq 1 ${NUM_FILES}); do
+		echo "file ${i}" >${tmp}/big/name-with-long-prefix-${i}
+	done
+	head -c 100000 /dev/urandom >${tmp}/big/sub/blob
+	ln -s sub/blob ${tmp}/big/link
+	mkdir -p ${tmp}/small
+	for i in $(seq 1 ${NUM_SMALL}); do
+		echo "file ${i}" >${tmp}/small/name-with-long-prefix-${i}
+	done
+}
+
+# make_image <block size> <hash> <flags>
+# The hash index is built by e2fsck, using the default hash version and
+# signedness (flags 1 or 2) from the superblock
+make_image() {
+	rm -f ${tmp}.img
+	mkfs.ext4 -q -b $1 -N $((NUM_FILES + 1024)) -O ^metadata_csum,^64bit \
+		-d ${tmp} ${tmp}.img 64M || fail "mkfs.ext4"
+	debugfs -w -R "ssv def_hash_version $2" ${tmp}.img 2>/dev/null
+	debugfs -w -R "ssv flags $3" ${tmp}.img 2>/dev/null
+	e2fsck -fyD ${tmp}.img >/dev/null 2>&1
+	for dir in big small; do
+		if ! debugfs -R "htree /${dir}" ${tmp}.img 2>/dev/null |
+				grep -q "Hash Version"; then
+			fail "directory /${dir} not indexed"
+		fi
+	done
+}
+
+# Load a spread of files and compare each with the original
+run_lookups() {
+	cmds="sb bind 0 ${tmp}.img"
+	for i in 1 2 $(seq 97 997 ${NUM_FILES}) ${NUM_FILES}; do
+		name=big/name-with-long-prefix-${i}
+		cmds="${cmds}; ext4load host 0 3000000 /${name}"
+		cmds="${cmds}; sb load host 0 4000000 ${tmp}/${name}"
+		cmds="${cmds}; cmp.b 3000000 4000000 \${filesize}"
+	done
+	cmds="${cmds}; ext4load host 0 3000000 /big/link"
+	cmds="${cmds}; sb load host 0 4000000 ${tmp}/big/sub/blob"
+	cmds="${cmds}; cmp.b 3000000 4000000 \${filesize}"
+	cmds="${cmds}; ext4load host 0 3000000 /big/name-with-long-prefix-0"
+	cmds="${cmds}; ext4ls host 0 /big"
+	./${OUTPUT_DIR}/u-boot -c "${cmds}" >${tmp}.out 2>&1
+}
+
+check_results() {
+	# All 12 loads must match, and the missing file must not be found
+	if [ $(grep -c "were the same" ${tmp}.out) -ne 12 ]; then
+		fail "$1: lookup error"
+	fi
+	if ! grep -q "File not found /big/name-with-long-prefix-0" \
+			${tmp}.out; then
+		fail "$1: found missing file"
+	fi
+	if [ $(grep -c "name-with-long-prefix-" ${tmp}.out) -ne \
+			$((NUM_FILES + 1)) ]; then
+		fail "$1: listing error"
+	fi
+}
+
+# ext4write does not update the index, so new files must still be found
+# after writing them into an indexed directory
+run_writes() {
+	cmds="sb bind 0 ${tmp}.img"
+	cmds="${cmds}; sb load host 0 4000000 ${tmp}/big/sub/blob"
+	for i in $(seq 1 5); do
+		cmds="${cmds}; ext4write host 0 4000000 /small/new-${i}"
+		cmds="${cmds} $(printf %x $((i * 1000)))"
+	done
+	for i in $(seq 1 5); do
+		cmds="${cmds}; ext4load host 0 3000000 /small/new-${i}"
+		cmds="${cmds}; cmp.b 3000000 4000000 \${filesize}"
+	done
+	name=small/name-with-long-prefix-${NUM_SMALL}
+	cmds="${cmds}; ext4load host 0 3000000 /${name}"
+	cmds="${cmds}; sb load host 0 4000000 ${tmp}/${name}"
+	cmds="${cmds}; cmp.b 3000000 4000000 \${filesize}"
+	./${OUTPUT_DIR}/u-boot -c "${cmds}" >${tmp}.out 2>&1
+	if grep -q "File not found" ${tmp}.out ||
+			[ $(grep -c "were the same" ${tmp}.out) -ne 6 ]; then
+		fail "$1: lookup error after write"
+	fi
+}
+
+echo "Simple ext4 directory index test using sandbox"
+echo
+tmp="$(mktemp -d)"
+build_uboot
+make_tree
+for bs in 1024 4096; do
+	for hash in legacy half_md4 tea; do
+		for flags in 1 2; do
+			test="${bs} ${hash} flags ${flags}"
+			echo "Check ${test}"
+			make_image ${bs} ${hash} ${flags}
+			run_lookups
+			check_results "${test}"
+			run_writes "${test}"
+		done
+	done
+done
+rm -rf ${tmp} ${tmp}.img ${tmp}.out
+echo "Test passed"
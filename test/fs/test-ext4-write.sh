@@ -0,0 +1,90 @@
+#
+# SPDX-License-Identifier:	GPL-2.0+
+#
+
+# Test ext4write into a fragmented filesystem with sandbox. Each file is
+# split across several extents, and most sizes do not end on a block.
+# Needs mkfs.ext4, debugfs and e2fsck from e2fsprogs 1.43 or later.
+
+OUTPUT_DIR=sandbox
+NUM_FILES=400
+
+fail() {
+	echo "Test failed: $1"
+	if [ -n "${tmp}" ]; then
+		rm -rf ${tmp} ${tmp}.img ${tmp}.out ${tmp}.dump
+	fi
+	exit 1
+}
+
+build_uboot() {
+	echo "Build sandbox"
+	OPTS="O=${OUTPUT_DIR}"
+	NUM_CPUS=$(grep -c processor /proc/cpuinfo)
+	make ${OPTS} sandbox_config
+	make ${OPTS} -s -j${NUM_CPUS}
+}
+
+# make_image <block size>
+# Fill the start of the volume with two-block files and free the blocks of
+# every other one, leaving two-block holes between files that must not be
+# touched. The inodes are kept, since ext4write assumes that the used inodes
+# in each group are contiguous.
+make_image() {
+	rm -rf ${tmp}/root ${tmp}.img
+	mkdir -p ${tmp}/root
+	for i in $(seq 1 ${NUM_FILES}); do
+		head -c $(($1 * 2)) /dev/urandom >${tmp}/root/s${i}
+	done
+	mkfs.ext4 -q -b $1 -O ^metadata_csum,^64bit,uninit_bg \
+		-d ${tmp}/root ${tmp}.img 64M || fail "mkfs.ext4"
+	for i in $(seq 1 2 ${NUM_FILES}); do
+		echo "punch /s${i} 0"
+	done | debugfs -w -f - ${tmp}.img >/dev/null 2>&1
+}
+
+# write_files <block size>
+# Write files that end part way into the last block of an extent, at the
+# end of an extent, and just past the end of one
+write_files() {
+	sizes="$(($1 * 2 + $1 / 2)) $(($1 * 2)) $(($1 * 2 + 1)) $(($1 - 3))"
+	sizes="${sizes} $(($1 * 5 + 17)) 1400123"
+	cmds="sb bind 0 ${tmp}.img; sb load host 0 1000000 ${tmp}/data"
+	n=0
+	for size in ${sizes}; do
+		n=$((n + 1))
+		cmds="${cmds}; ext4write host 0 1000000 /w${n} $(printf %x ${size})"
+	done
+	./${OUTPUT_DIR}/u-boot -c "${cmds}" >${tmp}.out 2>&1
+}
+
+# check_files <test name>
+check_files() {
+	e2fsck -fn ${tmp}.img >/dev/null 2>&1 || fail "$1: e2fsck"
+	n=0
+	for size in ${sizes}; do
+		n=$((n + 1))
+		debugfs -R "dump /w${n} ${tmp}.dump" ${tmp}.img 2>/dev/null
+		head -c ${size} ${tmp}/data | cmp -s - ${tmp}.dump ||
+			fail "$1: /w${n} (${size} bytes) differs"
+	done
+	for i in $(seq 2 2 ${NUM_FILES}); do
+		debugfs -R "dump /s${i} ${tmp}.dump" ${tmp}.img 2>/dev/null
+		cmp -s ${tmp}/root/s${i} ${tmp}.dump ||
+			fail "$1: /s${i} was overwritten"
+	done
+}
+
+echo "Simple ext4write test on a fragmented volume using sandbox"
+echo
+tmp="$(mktemp -d)"
+build_uboot
+head -c 2000000 /dev/urandom >${tmp}/data
+for bs in 1024 4096; do
+	echo "Check ${bs}"
+	make_image ${bs}
+	write_files ${bs}
+	check_files ${bs}
+done
+rm -rf ${tmp} ${tmp}.img ${tmp}.out ${tmp}.dump
+echo "Test passed"
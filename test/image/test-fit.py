@@ -19,6 +19,7 @@ import shutil
 import struct
 import sys
 import tempfile
+import time
 
 # The 'command' library in patman is convenient for running commands
 base_path = os.path.dirname(sys.argv[0])
@@ -41,9 +42,12 @@ base_its = '''
                         type = "kernel";
                         arch = "sandbox";
                         os = "linux";
-                        compression = "none";
+                        compression = "%(kernel_comp)s";
                         load = <0x40000>;
                         entry = <0x8>;
+                        hash@1 {
+                                algo = "sha1";
+                        };
                 };
                 fdt@1 {
                         description = "snow";
@@ -65,6 +69,9 @@ base_its = '''
                         os = "linux";
                         %(ramdisk_load)s
                         compression = "none";
+                        hash@1 {
+                                algo = "sha1";
+                        };
                 };
         };
         configurations {
@@ -103,6 +110,26 @@ sb save host 0 %(ramdisk_out)s %(ramdisk_addr)x %(ramdisk_size)x
 reset
 '''
 
+# This loads the images of a FIT built with 'mkimage -E' without loading all
+# of the FIT, then saves them out
+stream_script = '''
+fitload host 0 %(fit_addr)x %(fit)s
+sb save host 0 %(kernel_out)s ${fit_kernel_addr} ${fit_kernel_size}
+sb save host 0 %(fdt_out)s ${fit_fdt_addr} ${fit_fdt_size}
+sb save host 0 %(ramdisk_out)s ${fit_ramdisk_addr} ${fit_ramdisk_size}
+reset
+'''
+
+# The same, reading the FIT from an ext4 filesystem on a second host device
+ext4_script = '''
+sb bind 1 %(ext4_img)s
+fitload host 1 %(fit_addr)x /fit.fit
+sb save host 0 %(kernel_out)s ${fit_kernel_addr} ${fit_kernel_size}
+sb save host 0 %(fdt_out)s ${fit_fdt_addr} ${fit_fdt_size}
+sb save host 0 %(ramdisk_out)s ${fit_ramdisk_addr} ${fit_ramdisk_size}
+reset
+'''
+
 def make_fname(leaf):
     """Make a temporary filename
 
@@ -162,25 +189,46 @@ def make_its(params):
         print >>fd, base_its % params
     return its
 
-def make_fit(mkimage, params):
+def make_fit(mkimage, params, extra_args=None):
     """Make a sample .fit file ready for loading
 
     This creates a .its script with the selected parameters and uses mkimage to
-    turn this into a .fit image.
+    turn this into a .fit image. The time mkimage takes is printed.
 
     Args:
         mkimage: Filename of 'mkimage' utility
         params: Dictionary containing parameters to embed in the %() strings
+        extra_args: List of extra arguments for mkimage, or None
     Return:
         Filename of .fit file created
     """
     fit = make_fname('test.fit')
     its = make_its(params)
-    command.Output(mkimage, '-f', its, fit)
+    args = [mkimage] + (extra_args or []) + ['-f', its, fit]
+    start = time.time()
+    command.Output(*args)
+    print '    mkimage took %.3f seconds' % (time.time() - start)
     with open(make_fname('u-boot.dts'), 'w') as fd:
         print >>fd, base_fdt
     return fit
 
+def run_uboot(u_boot, control_dtb, cmd):
+    """Run U-Boot with a host device bound, so that 'sb load' can work
+
+    Args:
+        u_boot: Filename of U-Boot sandbox binary
+        control_dtb: Filename of control device tree for U-Boot
+        cmd: Commands to run
+    Return:
+        Output from U-Boot
+    """
+    host = make_fname('host.img')
+    if not os.path.exists(host):
+        with open(host, 'w') as fd:
+            fd.write('\0' * 8192)
+    return command.Output(u_boot, '-d', control_dtb, '--host', '0:' + host,
+                          '-c', cmd)
+
 def make_kernel():
     """Make a sample kernel with test data
 
@@ -305,6 +353,7 @@ def run_fit_test(mkimage, u_boot):
         'kernel_out' : kernel_out,
         'kernel_addr' : 0x40000,
         'kernel_size' : filesize(kernel),
+        'kernel_comp' : 'none',
 
         'fdt_out' : fdt_out,
         'fdt_addr' : 0x80000,
@@ -319,15 +368,15 @@ def run_fit_test(mkimage, u_boot):
         'ramdisk_config' : '',
     }
 
+    # First check that we can load a kernel
+    # We could perhaps reduce duplication with some loss of readability
+    set_test('Kernel load')
+
     # Make a basic FIT and a script to load it
     fit = make_fit(mkimage, params)
     params['fit'] = fit
     cmd = base_script % params
-
-    # First check that we can load a kernel
-    # We could perhaps reduce duplication with some loss of readability
-    set_test('Kernel load')
-    stdout = command.Output(u_boot, '-d', control_dtb, '-c', cmd)
+    stdout = run_uboot(u_boot, control_dtb, cmd)
     if read_file(kernel) != read_file(kernel_out):
         fail('Kernel not loaded', stdout)
     if read_file(control_dtb) == read_file(fdt_out):
@@ -351,7 +400,7 @@ def run_fit_test(mkimage, u_boot):
     set_test('Kernel + FDT load')
     params['fdt_load'] = 'load = <%#x>;' % params['fdt_addr']
     fit = make_fit(mkimage, params)
-    stdout = command.Output(u_boot, '-d', control_dtb, '-c', cmd)
+    stdout = run_uboot(u_boot, control_dtb, cmd)
     if read_file(kernel) != read_file(kernel_out):
         fail('Kernel not loaded', stdout)
     if read_file(control_dtb) != read_file(fdt_out):
@@ -364,10 +413,126 @@ def run_fit_test(mkimage, u_boot):
     params['ramdisk_config'] = 'ramdisk = "ramdisk@1";'
     params['ramdisk_load'] = 'load = <%#x>;' % params['ramdisk_addr']
     fit = make_fit(mkimage, params)
-    stdout = command.Output(u_boot, '-d', control_dtb, '-c', cmd)
+    stdout = run_uboot(u_boot, control_dtb, cmd)
     if read_file(ramdisk) != read_file(ramdisk_out):
         fail('Ramdisk not loaded', stdout)
 
+    # Build the same FIT twice with a hash cache: the second build should
+    # reuse the cached hash values, which U-Boot must still accept
+    set_test('Hash cache')
+    hash_cache = make_fname('hash-cache')
+    os.mkdir(hash_cache)
+    fit = make_fit(mkimage, params, ['-H', hash_cache])
+    entries = [os.path.join(hash_cache, fname)
+               for fname in os.listdir(hash_cache)]
+    if len(entries) != 2:
+        fail('Hash values not cached', '')
+    fit = make_fit(mkimage, params, ['-H', hash_cache])
+    stdout = run_uboot(u_boot, control_dtb, cmd)
+    if read_file(kernel) != read_file(kernel_out):
+        fail('Kernel not loaded', stdout)
+
+    # Plant a value in the cache, to show that it is used, but not when
+    # signing. There are no keys here, but -k is enough to turn it off.
+    bogus = '\xa5' * 20
+    for fname in entries:
+        with open(fname, 'w') as fd:
+            fd.write(bogus)
+    fit = make_fit(mkimage, params, ['-H', hash_cache])
+    if read_file(fit).find(bogus) == -1:
+        fail('Cached hash value not used', '')
+    fit = make_fit(mkimage, params, ['-H', hash_cache, '-k', base_dir])
+    if read_file(fit).find(bogus) != -1:
+        fail('Cached hash value used when signing', '')
+    shutil.rmtree(hash_cache)
+
+    # With the image data after the FIT, bootm should still find it
+    set_test('External data')
+    fit = make_fit(mkimage, params, ['-E'])
+    stdout = run_uboot(u_boot, control_dtb, cmd)
+    if read_file(kernel) != read_file(kernel_out):
+        fail('Kernel not loaded', stdout)
+
+    # Updating the FIT must keep its external data, whether or not -E is
+    # given again
+    set_test('Update external data')
+    for args in (['-E', '-F'], ['-F']):
+        command.Output(*([mkimage] + args + [fit]))
+        if filesize(fit) < filesize(kernel) + filesize(ramdisk):
+            fail('External data lost by mkimage %s' % ' '.join(args), '')
+        os.remove(kernel_out)
+        stdout = run_uboot(u_boot, control_dtb, cmd)
+        if read_file(kernel) != read_file(kernel_out):
+            fail('Kernel not loaded', stdout)
+
+    # fitload reads the FIT, then each image straight to its load address
+    set_test('Streamed load')
+    for fname in [kernel_out, fdt_out, ramdisk_out]:
+        os.remove(fname)
+    stdout = run_uboot(u_boot, control_dtb, stream_script % params)
+    if read_file(kernel) != read_file(kernel_out):
+        fail('Kernel not loaded', stdout)
+    if read_file(control_dtb) != read_file(fdt_out):
+        fail('FDT not loaded', stdout)
+    if read_file(ramdisk) != read_file(ramdisk_out):
+        fail('Ramdisk not loaded', stdout)
+
+    # An fdt with no load address goes after the FIT
+    set_test('Streamed load without load address')
+    params['fdt_load'] = ''
+    fit = make_fit(mkimage, params, ['-E'])
+    os.remove(fdt_out)
+    stdout = run_uboot(u_boot, control_dtb, stream_script % params)
+    if read_file(control_dtb) != read_file(fdt_out):
+        fail('FDT not loaded', stdout)
+    fdt_addr = int(find_matching(stdout, "Loading 'fdt@1' to "), 16)
+    fit_size = struct.unpack('>L', read_file(fit)[4:8])[0]
+    if fdt_addr < params['fit_addr'] + fit_size:
+        fail('FDT loaded to %#x, inside the FIT' % fdt_addr, stdout)
+
+    # The external data is read at offsets that do not start on a block
+    set_test('Streamed load from ext4')
+    ext4_dir = make_fname('ext4')
+    os.mkdir(ext4_dir)
+    shutil.copy(fit, os.path.join(ext4_dir, 'fit.fit'))
+    params['ext4_img'] = make_fname('ext4.img')
+    command.Output('mkfs.ext4', '-q', '-b', '1024', '-O',
+                   '^metadata_csum,^64bit', '-d', ext4_dir,
+                   params['ext4_img'], '4M')
+    for fname in [kernel_out, fdt_out, ramdisk_out]:
+        os.remove(fname)
+    stdout = run_uboot(u_boot, control_dtb, ext4_script % params)
+    if read_file(kernel) != read_file(kernel_out):
+        fail('Kernel not loaded', stdout)
+    if read_file(control_dtb) != read_file(fdt_out):
+        fail('FDT not loaded', stdout)
+    if read_file(ramdisk) != read_file(ramdisk_out):
+        fail('Ramdisk not loaded', stdout)
+
+    # The data size is not signed, so must be checked before loading
+    set_test('Streamed load of oversized image')
+    command.Output('fdtput', '-t', 'x', fit, '/images/kernel@1', 'data-size',
+                   '10000000')
+    os.remove(kernel_out)
+    stdout = run_uboot(u_boot, control_dtb, stream_script % params)
+    if "Error: 'kernel@1' is too large" not in stdout:
+        fail('Oversized kernel not refused', stdout)
+    if os.path.exists(kernel_out) and filesize(kernel_out):
+        fail('Oversized kernel loaded', stdout)
+
+    # fitload cannot decompress, so must refuse a compressed image
+    set_test('Streamed load of compressed image')
+    params['kernel_comp'] = 'gzip'
+    fit = make_fit(mkimage, params, ['-E'])
+    if os.path.exists(kernel_out):
+        os.remove(kernel_out)
+    stdout = run_uboot(u_boot, control_dtb, stream_script % params)
+    if "Can't load 'kernel@1': it is compressed" not in stdout:
+        fail('Compressed kernel not refused', stdout)
+    if os.path.exists(kernel_out) and filesize(kernel_out):
+        fail('Compressed kernel loaded', stdout)
+    params['kernel_comp'] = 'none'
+
 def run_tests():
     """Parse options, run the FIT tests and print the result"""
     global base_path, base_dir
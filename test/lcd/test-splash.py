@@ -0,0 +1,157 @@
+#!/usr/bin/python
+#
+# Copyright (c) 2014 The Chromium OS Authors.
+#
+# Check that gzipped splash images (CONFIG_LCD_BMP_GZIP) look the same as
+# the uncompressed ones on the sandbox SDL display, and report the time to
+# splash for each: loading the file from the host and drawing it with the
+# splash screen code.
+#
+# SPDX-License-Identifier:	GPL-2.0+
+#
+# To run this:
+#
+# make O=sandbox sandbox_config
+# make O=sandbox
+# ./test/lcd/test-splash.py -u sandbox/u-boot
+
+from __future__ import print_function
+
+from optparse import OptionParser
+import gzip
+import io
+import os
+import re
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+SPLASH_ADDR = 0x1000000
+WIDTH = 1280
+HEIGHT = 720
+
+def make_bmp(bpp):
+    """Make a splash-like BMP: a gradient with a noisy block in the middle
+
+    This compresses about as well as a typical boot logo.
+    """
+    row_size = (WIDTH * bpp // 8 + 3) & ~3
+    if bpp == 8:
+        palette = b''.join(struct.pack('<BBBB', i, 255 - i, i // 2, 0)
+                           for i in range(256))
+    else:
+        palette = b''
+    offset = 54 + len(palette)
+    noise = bytearray(os.urandom(WIDTH // 4 * bpp // 8))
+    rows = []
+    for y in range(HEIGHT):
+        if bpp == 8:
+            row = bytearray((x + y) // 8 & 0xff for x in range(WIDTH))
+        else:
+            row = bytearray(struct.pack('<%dH' % WIDTH,
+                            *[((x >> 3) << 11 | (y >> 4) << 5 | (x + y) >> 6)
+                              & 0xffff for x in range(WIDTH)]))
+        if HEIGHT // 3 <= y < HEIGHT * 2 // 3:
+            start = WIDTH * 3 // 8 * bpp // 8
+            row[start:start + len(noise)] = noise
+        rows.append(bytes(row) + b'\0' * (row_size - len(row)))
+    data = b''.join(rows)
+    header = struct.pack('<2sIIIIiiHHIIiiII', b'BM', offset + len(data), 0,
+                         offset, 40, WIDTH, HEIGHT, 1, bpp, 0, len(data),
+                         2835, 2835, 256 if bpp == 8 else 0, 0)
+    return header + palette + data
+
+def gzip_data(data):
+    buf = io.BytesIO()
+    fd = gzip.GzipFile(fileobj=buf, mode='wb', compresslevel=9)
+    fd.write(data)
+    fd.close()
+    return buf.getvalue()
+
+def fail(msg, output):
+    print('Test failed: %s' % msg)
+    print(output)
+    sys.exit(1)
+
+def run_uboot(u_boot, tmpdir, cmds):
+    env = dict(os.environ)
+    # Run the real SDL display code without needing a screen
+    env['SDL_VIDEODRIVER'] = 'dummy'
+    output = subprocess.check_output([u_boot, '--host',
+            '0:%s' % os.path.join(tmpdir, 'disk.img'), '-c', '; '.join(cmds)],
+            stderr=subprocess.STDOUT, env=env)
+    return output.decode('utf-8', 'replace')
+
+def splash(u_boot, tmpdir, fname, fb_base, fb_size):
+    """Show a splash image, returning its timing and the display's CRC"""
+    cmds = ['setenv stdout serial',
+            'setenv splashimage %x' % SPLASH_ADDR,
+            'time sb load host 0 %x %s' % (SPLASH_ADDR,
+                                           os.path.join(tmpdir, fname)),
+            # The first clear of the display shows the splash image
+            'time cls',
+            'crc32 %x %x' % (fb_base, fb_size)]
+    output = run_uboot(u_boot, tmpdir, cmds)
+    times = re.findall(r'time: ([0-9.]+) seconds', output)
+    crc = re.search(r'==> ([0-9a-f]+)', output)
+    if len(times) != 2 or not crc or 'Error' in output:
+        fail('splash %s' % fname, output)
+    return [float(t) for t in times] + [crc.group(1)]
+
+def run_tests():
+    parser = OptionParser()
+    parser.add_option('-u', '--u-boot',
+            default=os.path.join(os.path.dirname(sys.argv[0]),
+                                 '../../sandbox/u-boot'),
+            help='Select U-Boot sandbox binary')
+    (options, args) = parser.parse_args()
+
+    title = 'Sandbox Splash Tests'
+    print(title, '\n', '=' * len(title))
+    tmpdir = tempfile.mkdtemp()
+    try:
+        with open(os.path.join(tmpdir, 'disk.img'), 'wb') as fd:
+            fd.write(b'\0' * 8192)
+        output = run_uboot(options.u_boot, tmpdir, ['setenv stdout serial',
+                                                    'bdinfo'])
+        fb_base = int(re.search(r'FB base += 0x([0-9A-F]+)', output).group(1),
+                      16)
+        # The sandbox display is 1366 x 768 at 16bpp
+        fb_size = 1366 * 768 * 2
+
+        for bpp in (8, 16):
+            bmp = make_bmp(bpp)
+            with open(os.path.join(tmpdir, 'splash.bmp'), 'wb') as fd:
+                fd.write(bmp)
+            with open(os.path.join(tmpdir, 'splash.bmp.gz'), 'wb') as fd:
+                fd.write(gzip_data(bmp))
+            results = {}
+            for fname in ('splash.bmp', 'splash.bmp.gz'):
+                size = os.path.getsize(os.path.join(tmpdir, fname))
+                (load, draw, crc) = splash(options.u_boot, tmpdir, fname,
+                                           fb_base, fb_size)
+                results[fname] = crc
+                print('%2dbpp %-14s %8d bytes: load %.3fs, draw %.3fs, '
+                      'time to splash %.3fs' % (bpp, fname, size, load, draw,
+                                                load + draw))
+            if results['splash.bmp'] != results['splash.bmp.gz']:
+                fail('%dbpp gzipped splash differs from the original' % bpp,
+                     results)
+
+        # A truncated image must be reported, not read past its end
+        with open(os.path.join(tmpdir, 'short.bmp.gz'), 'wb') as fd:
+            fd.write(gzip_data(bmp)[:-100])
+        output = run_uboot(options.u_boot, tmpdir, ['setenv stdout serial',
+                'sb load host 0 %x %s' % (SPLASH_ADDR,
+                                          os.path.join(tmpdir, 'short.bmp.gz')),
+                'bmp display %x' % SPLASH_ADDR])
+        if 'is truncated' not in output:
+            fail('truncated gzipped splash', output)
+        print('Truncated gzipped splash rejected')
+    finally:
+        shutil.rmtree(tmpdir)
+    print('\nTests passed')
+
+run_tests()
@@ -0,0 +1,73 @@
+#
+# SPDX-License-Identifier:	GPL-2.0+
+#
+
+# Test the fast memory test (mtest -f, CONFIG_SYS_MEMTEST_FAST) with
+# sandbox, including a RAM bit stuck at 0, and compare its speed with the
+# normal test.
+
+OUTPUT_DIR=sandbox
+START=1000000
+END=5000000
+FAULT=2345678
+
+fail() {
+	echo "Test failed: $1"
+	if [ -n "${tmp}" ]; then
+		rm -f ${tmp}
+	fi
+	exit 1
+}
+
+build_uboot() {
+	echo "Build sandbox"
+	OPTS="O=${OUTPUT_DIR}"
+	NUM_CPUS=$(grep -c processor /proc/cpuinfo)
+	make ${OPTS} sandbox_config
+	make ${OPTS} -s -j${NUM_CPUS}
+}
+
+# run_uboot <mtest args> [<sandbox args>]
+run_uboot() {
+	./${OUTPUT_DIR}/u-boot $2 -c "setenv stdout serial; time mtest $1" \
+		>${tmp} 2>&1
+}
+
+# expect <text> <message>
+expect() {
+	grep -q "$1" ${tmp} || fail "$2"
+}
+
+echo "Fast memory test using sandbox"
+echo
+tmp="$(mktemp)"
+build_uboot
+
+echo "Good memory"
+run_uboot "-f ${START} ${END} 0 1"
+expect "Tested 1 iteration(s) with 0 errors" "errors found in good memory"
+for test in "Pattern fill" "Moving inversions" "Address in address"; do
+	expect "${test} .* GB/s, 0 errors" "${test} did not run"
+done
+grep "GB/s" ${tmp}
+
+echo "Stuck bit"
+run_uboot "-f ${START} ${END} 0 1" "--mem_fault ${FAULT}:5"
+expect "Mem error @ 0x0*${FAULT}" "error address not reported"
+if ! grep -q "Tested 1 iteration(s) with [1-9][0-9]* errors" ${tmp}; then
+	fail "stuck bit not found"
+fi
+if [ $(grep -c "GB/s, [1-9][0-9]* errors" ${tmp}) -ne 3 ]; then
+	fail "a test did not find the stuck bit"
+fi
+
+echo "Normal test, for comparison"
+run_uboot "${START} ${END} 0 1"
+expect "Tested 1 iteration(s) with 0 errors" "errors found in good memory"
+# It writes and reads back the memory once
+sed -n 's/time: \([0-9.]*\) seconds.*/\1/p' ${tmp} |
+	awk -v bytes=$((2 * (0x${END} - 0x${START}))) \
+	'{ printf "%-20s%.2f GB/s\n", "Normal test", bytes / $1 / 1e9 }'
+
+rm -f ${tmp}
+echo "Test passed"
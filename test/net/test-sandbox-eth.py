@@ -0,0 +1,229 @@
+#!/usr/bin/python
+#
+# Copyright (c) 2014 The Chromium OS Authors.
+#
+# Check ping and TFTP through the sandbox ethernet device, and report its
+# throughput and latency. The device is connected with --eth udp:... to this
+# script, which answers ARP, ping and TFTP read requests itself, so nothing
+# needs to be set up on the host.
+#
+# SPDX-License-Identifier:	GPL-2.0+
+#
+# To run this:
+#
+# make O=sandbox sandbox_config
+# make O=sandbox
+# ./test/net/test-sandbox-eth.py -u sandbox/u-boot
+
+from __future__ import print_function
+
+from optparse import OptionParser
+import os
+import re
+import socket
+import struct
+import subprocess
+import sys
+import threading
+import zlib
+
+SERVER_MAC = b'\x02\x00\x00\x00\x00\x01'
+SERVER_IP = '192.168.0.1'
+CLIENT_IP = '192.168.0.2'
+TFTP_PORT = 69
+TFTP_SERVER_PORT = 1069
+
+ETH_P_IP = 0x0800
+ETH_P_ARP = 0x0806
+IPPROTO_ICMP = 1
+IPPROTO_UDP = 17
+
+def checksum(data):
+    """Internet checksum of a byte string
+
+    >>> hex(checksum(b'\\x45\\x00\\x00\\x1c'))
+    '0xbae3'
+    """
+    if len(data) % 2:
+        data += b'\0'
+    total = sum(struct.unpack('!%dH' % (len(data) // 2), data))
+    while total >> 16:
+        total = (total & 0xffff) + (total >> 16)
+    return ~total & 0xffff
+
+class Peer:
+    """The far end of the sandbox ethernet: an ARP, ping and TFTP server
+
+    Each UDP datagram exchanged with U-Boot holds one ethernet frame.
+    """
+    def __init__(self, data):
+        self.data = data
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind(('127.0.0.1', 0))
+        self.sock.settimeout(0.1)
+        self.port = self.sock.getsockname()[1]
+        self.uboot = None
+        self.client_mac = None
+        self.running = True
+        self.tftp = None
+
+    def send_frame(self, dst_mac, proto, payload):
+        frame = dst_mac + SERVER_MAC + struct.pack('!H', proto) + payload
+        self.sock.sendto(frame, self.uboot)
+
+    def send_ip(self, proto, dst_ip, payload):
+        hdr = struct.pack('!BBHHHBBH4s4s', 0x45, 0, 20 + len(payload), 0, 0,
+                          64, proto, 0, socket.inet_aton(SERVER_IP),
+                          socket.inet_aton(dst_ip))
+        hdr = hdr[:10] + struct.pack('!H', checksum(hdr)) + hdr[12:]
+        self.send_frame(self.client_mac, ETH_P_IP, hdr + payload)
+
+    def send_udp(self, sport, dport, payload):
+        udp = struct.pack('!HHHH', sport, dport, 8 + len(payload), 0)
+        self.send_ip(IPPROTO_UDP, CLIENT_IP, udp + payload)
+
+    def handle_arp(self, src_mac, pkt):
+        (op, sha, spa, tpa) = struct.unpack('!6xH6s4s6x4s', pkt[:28])
+        if op == 1 and socket.inet_ntoa(tpa) == SERVER_IP:
+            reply = struct.pack('!HHBBH6s4s6s4s', 1, ETH_P_IP, 6, 4, 2,
+                                SERVER_MAC, tpa, sha, spa)
+            self.send_frame(src_mac, ETH_P_ARP, reply)
+
+    def handle_icmp(self, pkt):
+        if ord(pkt[0:1]) != 8:
+            return
+        reply = b'\0\0\0\0' + pkt[4:]
+        reply = reply[:2] + struct.pack('!H', checksum(reply)) + reply[4:]
+        self.send_ip(IPPROTO_ICMP, CLIENT_IP, reply)
+
+    def tftp_send_block(self):
+        t = self.tftp
+        start = (t['block'] - 1) * t['blksize']
+        chunk = self.data[start:start + t['blksize']]
+        self.send_udp(TFTP_SERVER_PORT, t['port'],
+                      struct.pack('!HH', 3, t['block'] & 0xffff) + chunk)
+
+    def handle_tftp(self, sport, dport, pkt):
+        opcode = struct.unpack('!H', pkt[:2])[0]
+        if dport == TFTP_PORT and opcode == 1:
+            fields = pkt[2:].split(b'\0')
+            opts = dict(zip(fields[2::2], fields[3::2]))
+            self.tftp = {'port': sport, 'block': 0, 'blksize': 512}
+            if b'blksize' in opts:
+                self.tftp['blksize'] = int(opts[b'blksize'])
+                self.send_udp(TFTP_SERVER_PORT, sport, b'\0\6blksize\0' +
+                              opts[b'blksize'] + b'\0')
+            else:
+                self.tftp['block'] = 1
+                self.tftp_send_block()
+        elif dport == TFTP_SERVER_PORT and opcode == 4 and self.tftp:
+            t = self.tftp
+            block = struct.unpack('!H', pkt[2:4])[0]
+            if block != t['block'] & 0xffff:
+                return
+            # A short block ends the transfer
+            if t['block'] and len(self.data) - \
+                    (t['block'] - 1) * t['blksize'] < t['blksize']:
+                self.tftp = None
+                return
+            t['block'] += 1
+            self.tftp_send_block()
+
+    def handle_frame(self, frame):
+        (dst_mac, src_mac, proto) = struct.unpack('!6s6sH', frame[:14])
+        pkt = frame[14:]
+        if dst_mac not in (SERVER_MAC, b'\xff' * 6):
+            return
+        self.client_mac = src_mac
+        if proto == ETH_P_ARP:
+            self.handle_arp(src_mac, pkt)
+        elif proto == ETH_P_IP:
+            ihl = (ord(pkt[0:1]) & 0xf) * 4
+            ip_proto = ord(pkt[9:10])
+            body = pkt[ihl:struct.unpack('!H', pkt[2:4])[0]]
+            if ip_proto == IPPROTO_ICMP:
+                self.handle_icmp(body)
+            elif ip_proto == IPPROTO_UDP:
+                (sport, dport) = struct.unpack('!HH', body[:4])
+                self.handle_tftp(sport, dport, body[8:])
+
+    def run(self):
+        while self.running:
+            try:
+                (frame, addr) = self.sock.recvfrom(2048)
+            except socket.timeout:
+                continue
+            self.uboot = addr
+            self.handle_frame(frame)
+
+def free_udp_port():
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(('127.0.0.1', 0))
+    port = sock.getsockname()[1]
+    sock.close()
+    return port
+
+def fail(msg, output):
+    print('Test failed: %s' % msg)
+    print(output)
+    sys.exit(1)
+
+def run_test(u_boot, size):
+    data = os.urandom(size)
+    peer = Peer(data)
+    thread = threading.Thread(target=peer.run)
+    thread.start()
+
+    spec = 'udp:%d:127.0.0.1:%d' % (free_udp_port(), peer.port)
+    cmds = ['setenv stdout serial',
+            'setenv ipaddr %s' % CLIENT_IP,
+            'setenv serverip %s' % SERVER_IP,
+            'setenv netmask 255.255.255.0',
+            'ping %s' % SERVER_IP]
+    for blksize in (512, 1468):
+        cmds += ['setenv tftpblocksize %d' % blksize,
+                 'sb eth reset',
+                 'tftp 3000000 file',
+                 'sb eth',
+                 'crc32 3000000 ${filesize}']
+    try:
+        output = subprocess.check_output([u_boot, '--eth', spec,
+                                          '-c', '; '.join(cmds)])
+        output = output.decode('utf-8', 'replace')
+    finally:
+        peer.running = False
+        thread.join()
+
+    if 'host %s is alive' % SERVER_IP not in output:
+        fail('ping', output)
+    if output.count('Bytes transferred = %d ' % size) != 2:
+        fail('tftp', output)
+    crc = '%08x' % (zlib.crc32(data) & 0xffffffff)
+    if output.count('==> %s' % crc) != 2:
+        fail('crc32 mismatch', output)
+    if 'rx:      0 frames' in output or output.count('latency: ') != 2:
+        fail('no timing statistics', output)
+
+    for (blksize, time, rate, latency) in zip((512, 1468),
+            re.findall(r'time: +(\d+) us', output),
+            re.findall(r'rx (\d+) KiB/s', output),
+            re.findall(r'avg (\d+) us', output)):
+        print('blksize %4d: %8s us, %6s KiB/s, average latency %s us' %
+              (blksize, time, rate, latency))
+
+def run_tests():
+    parser = OptionParser()
+    parser.add_option('-u', '--u-boot',
+            default=os.path.join(os.path.dirname(sys.argv[0]),
+                                 '../../sandbox/u-boot'),
+            help='Select U-Boot sandbox binary')
+    parser.add_option('-s', '--size', type='int', default=4 << 20,
+            help='Size of file to transfer')
+    (options, args) = parser.parse_args()
+
+    title = 'Sandbox Ethernet Tests'
+    print(title, '\n', '=' * len(title))
+    run_test(options.u_boot, options.size)
+    print('\nTests passed')
+
+run_tests()
@@ -0,0 +1,380 @@
+/*
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * Tests for the Android sparse image decoder
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <image-sparse.h>
+#include <malloc.h>
+
+#define TEST_BLKSZ		512	/* Device block size */
+#define TEST_SPARSE_BLKSZ	4096	/* Sparse image block size */
+#define TEST_MUL		(TEST_SPARSE_BLKSZ / TEST_BLKSZ)
+#define TEST_DEV_BLKS		4096	/* 2 MiB device */
+#define TEST_PART_START		64
+#define TEST_PART_BLKS		2048	/* 1 MiB partition */
+#define TEST_IMAGE_SIZE		(2 << 20)
+#define TEST_SENTINEL		0xa5
+
+/* A device in RAM, and what the decoder did to it */
+struct test_dev {
+	u8 *data;
+	lbaint_t fail_at;	/* Fail writes covering this block, if not 0 */
+	int writes;		/* Number of calls to test_write() */
+	lbaint_t max_write;	/* Largest write, in blocks */
+	int outside;		/* A write went outside the partition */
+};
+
+/* A sparse image being built, and the device contents it should produce */
+struct test_image {
+	u8 *buf;
+	ulong size;
+	uint chunks;
+	uint blks;
+	u8 *expect;
+};
+
+static struct test_dev dev;
+static struct test_image img;
+static struct sparse_storage storage;
+static u32 seed;
+
+#define errcheck(statement) if (!(statement)) { \
+	fprintf(stderr, "\tFailed: %s\n", #statement); \
+	ret = 1; \
+	goto out; \
+}
+
+static lbaint_t test_write(struct sparse_storage *info, lbaint_t blk,
+			   lbaint_t blkcnt, const void *buf)
+{
+	struct test_dev *tdev = info->priv;
+
+	tdev->writes++;
+	tdev->max_write = max(tdev->max_write, blkcnt);
+	if (blk < info->start || blk + blkcnt > info->start + info->size) {
+		tdev->outside = 1;
+		return 0;
+	}
+	if (tdev->fail_at && blk <= tdev->fail_at &&
+	    tdev->fail_at < blk + blkcnt)
+		return 0;
+	memcpy(tdev->data + blk * TEST_BLKSZ, buf, blkcnt * TEST_BLKSZ);
+
+	return blkcnt;
+}
+
+/* Start a new image on a device full of TEST_SENTINEL */
+static void test_reset(void)
+{
+	memset(dev.data, TEST_SENTINEL, TEST_DEV_BLKS * TEST_BLKSZ);
+	dev.fail_at = 0;
+	dev.writes = 0;
+	dev.max_write = 0;
+	dev.outside = 0;
+
+	memcpy(img.expect, dev.data, TEST_DEV_BLKS * TEST_BLKSZ);
+	img.size = sizeof(sparse_header_t);
+	img.chunks = 0;
+	img.blks = 0;
+}
+
+static u8 *test_out(void)
+{
+	return img.expect + TEST_PART_START * TEST_BLKSZ +
+		img.blks * TEST_SPARSE_BLKSZ;
+}
+
+static chunk_header_t *add_chunk(uint type, uint chunk_sz, uint data_sz)
+{
+	chunk_header_t *chunk = (chunk_header_t *)(img.buf + img.size);
+
+	chunk->chunk_type = cpu_to_le16(type);
+	chunk->reserved1 = 0;
+	chunk->chunk_sz = cpu_to_le32(chunk_sz);
+	chunk->total_sz = cpu_to_le32(sizeof(*chunk) + data_sz);
+	img.size += sizeof(*chunk) + data_sz;
+	img.chunks++;
+	img.blks += chunk_sz;
+
+	return chunk;
+}
+
+static void add_raw(uint blks)
+{
+	u8 *data, *out = test_out();
+	uint i;
+
+	data = (u8 *)(add_chunk(CHUNK_TYPE_RAW, blks,
+				blks * TEST_SPARSE_BLKSZ) + 1);
+	for (i = 0; i < blks * TEST_SPARSE_BLKSZ; i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = seed >> 16;
+		out[i] = data[i];
+	}
+}
+
+static void add_fill(uint blks, u32 val)
+{
+	u8 *out = test_out();
+	uint i;
+
+	val = cpu_to_le32(val);
+	memcpy(add_chunk(CHUNK_TYPE_FILL, blks, sizeof(val)) + 1, &val,
+	       sizeof(val));
+	for (i = 0; i < blks * TEST_SPARSE_BLKSZ; i += sizeof(val))
+		memcpy(out + i, &val, sizeof(val));
+}
+
+static void add_dont_care(uint blks)
+{
+	add_chunk(CHUNK_TYPE_DONT_CARE, blks, 0);
+}
+
+static void add_crc32(void)
+{
+	memset(add_chunk(CHUNK_TYPE_CRC32, 0, sizeof(u32)) + 1, '\0',
+	       sizeof(u32));
+}
+
+static sparse_header_t *finish_image(void)
+{
+	sparse_header_t *hdr = (sparse_header_t *)img.buf;
+
+	hdr->magic = cpu_to_le32(SPARSE_HEADER_MAGIC);
+	hdr->major_version = cpu_to_le16(SPARSE_HEADER_MAJOR_VER);
+	hdr->minor_version = 0;
+	hdr->file_hdr_sz = cpu_to_le16(sizeof(sparse_header_t));
+	hdr->chunk_hdr_sz = cpu_to_le16(sizeof(chunk_header_t));
+	hdr->blk_sz = cpu_to_le32(TEST_SPARSE_BLKSZ);
+	hdr->total_blks = cpu_to_le32(img.blks);
+	hdr->total_chunks = cpu_to_le32(img.chunks);
+	hdr->image_checksum = 0;
+
+	return hdr;
+}
+
+static int check_device(void)
+{
+	return !dev.outside &&
+		!memcmp(dev.data, img.expect, TEST_DEV_BLKS * TEST_BLKSZ);
+}
+
+/* Each chunk type, written in place with nothing else touched */
+static int test_chunks(void)
+{
+	struct sparse_stats stats;
+	int ret;
+
+	test_reset();
+	add_raw(2);
+	add_fill(3, 0x12345678);
+	add_dont_care(4);
+	add_crc32();
+	add_fill(1, 0);
+	add_raw(1);
+	add_dont_care(1);
+	finish_image();
+
+	errcheck(is_sparse_image(img.buf));
+	errcheck(write_sparse_image(&storage, img.buf, img.size,
+				    &stats) == 0);
+	errcheck(check_device());
+	errcheck(stats.written == 3 * TEST_MUL);
+	errcheck(stats.filled == 4 * TEST_MUL);
+	errcheck(stats.skipped == 5 * TEST_MUL);
+	/* One write per raw chunk and one per (small) fill chunk */
+	errcheck(dev.writes == 4);
+
+	ret = 0;
+out:
+	return ret;
+}
+
+/* Fills larger than the fill buffer, and changes of fill value */
+static int test_fill(void)
+{
+	struct sparse_stats stats;
+	int ret;
+
+	test_reset();
+	add_fill(128, 0xdeadbeef);
+	add_fill(1, 0x00c0ffee);
+	add_fill(1, 0xdeadbeef);
+	add_dont_care(TEST_PART_BLKS / TEST_MUL - img.blks);
+	finish_image();
+
+	errcheck(write_sparse_image(&storage, img.buf, img.size,
+				    &stats) == 0);
+	errcheck(check_device());
+	errcheck(stats.filled == 130 * TEST_MUL);
+	errcheck(stats.written == 0);
+	/* 512 KiB takes two writes from the 256 KiB buffer */
+	errcheck(dev.writes == 4);
+	errcheck(dev.max_write == (256 << 10) / TEST_BLKSZ);
+
+	ret = 0;
+out:
+	return ret;
+}
+
+/* Write a corrupt image, which must fail without touching the device */
+static int try_bad_image(ulong size, int expect_ret)
+{
+	int ret;
+
+	ret = write_sparse_image(&storage, img.buf, size, NULL);
+	if (ret != expect_ret) {
+		fprintf(stderr, "\tGot %d, expected %d\n", ret, expect_ret);
+		return 1;
+	}
+	if (dev.writes || !check_device()) {
+		fprintf(stderr, "\tDevice was written\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+static void make_good_image(void)
+{
+	test_reset();
+	add_raw(1);
+	add_fill(2, 0x55aa55aa);
+	add_dont_care(1);
+	add_raw(1);
+	finish_image();
+	/* Nothing should be written */
+	memcpy(img.expect, dev.data, TEST_DEV_BLKS * TEST_BLKSZ);
+}
+
+static int test_errors(void)
+{
+	sparse_header_t *hdr = (sparse_header_t *)img.buf;
+	chunk_header_t *chunk;
+	int ret;
+
+	make_good_image();
+	hdr->magic = cpu_to_le32(SPARSE_HEADER_MAGIC + 1);
+	errcheck(!is_sparse_image(img.buf));
+	errcheck(!try_bad_image(img.size, -EINVAL));
+
+	/* The last chunk is cut short */
+	make_good_image();
+	errcheck(!try_bad_image(img.size - 1, -EINVAL));
+	errcheck(!try_bad_image(sizeof(*hdr) - 1, -EINVAL));
+
+	make_good_image();
+	hdr->major_version = cpu_to_le16(SPARSE_HEADER_MAJOR_VER + 1);
+	errcheck(!try_bad_image(img.size, -EINVAL));
+
+	/* Sparse blocks must be whole device blocks */
+	make_good_image();
+	hdr->blk_sz = cpu_to_le32(TEST_BLKSZ / 2);
+	errcheck(!try_bad_image(img.size, -EINVAL));
+
+	/* One more block than the chunks hold */
+	make_good_image();
+	hdr->total_blks = cpu_to_le32(img.blks + 1);
+	errcheck(!try_bad_image(img.size, -EINVAL));
+
+	/* More blocks in the chunks than the header says */
+	make_good_image();
+	hdr->total_blks = cpu_to_le32(img.blks - 1);
+	errcheck(!try_bad_image(img.size, -EINVAL));
+
+	/* A raw chunk with a block less data than it claims */
+	make_good_image();
+	chunk = (chunk_header_t *)(img.buf + sizeof(*hdr));
+	chunk->chunk_sz = cpu_to_le32(2);
+	hdr->total_blks = cpu_to_le32(img.blks + 1);
+	errcheck(!try_bad_image(img.size, -EINVAL));
+
+	make_good_image();
+	chunk = (chunk_header_t *)(img.buf + sizeof(*hdr));
+	chunk->chunk_type = cpu_to_le16(0xcac5);
+	errcheck(!try_bad_image(img.size, -EINVAL));
+
+	/* Too large for the partition */
+	test_reset();
+	add_dont_care(TEST_PART_BLKS / TEST_MUL + 1);
+	finish_image();
+	errcheck(!try_bad_image(img.size, -ENOSPC));
+
+	ret = 0;
+out:
+	return ret;
+}
+
+/* A failed write stops the decoder */
+static int test_write_error(void)
+{
+	int ret;
+
+	test_reset();
+	add_raw(1);
+	add_raw(1);
+	add_fill(1, 0);
+	finish_image();
+	dev.fail_at = TEST_PART_START + TEST_MUL;
+	errcheck(write_sparse_image(&storage, img.buf, img.size, NULL) ==
+		 -EIO);
+	errcheck(dev.writes == 2);
+
+	ret = 0;
+out:
+	return ret;
+}
+
+static int run_test(char *name, int (*func)(void))
+{
+	int ret;
+
+	ret = func();
+	printf(" %s: %s\n", name, ret == 0 ? "ok" : "FAILED");
+
+	return ret;
+}
+
+static int do_test_sparse(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	int err = 0;
+
+	dev.data = malloc(TEST_DEV_BLKS * TEST_BLKSZ);
+	img.expect = malloc(TEST_DEV_BLKS * TEST_BLKSZ);
+	img.buf = malloc(TEST_IMAGE_SIZE);
+	if (!dev.data || !img.expect || !img.buf) {
+		err = 1;
+		goto out;
+	}
+	storage.blksz = TEST_BLKSZ;
+	storage.start = TEST_PART_START;
+	storage.size = TEST_PART_BLKS;
+	storage.priv = &dev;
+	storage.write = test_write;
+	seed = 1;
+
+	err += run_test("chunks", test_chunks);
+	err += run_test("fill", test_fill);
+	err += run_test("errors", test_errors);
+	err += run_test("write error", test_write_error);
+
+out:
+	printf("test_sparse %s\n", err == 0 ? "ok" : "FAILED");
+	free(img.buf);
+	free(img.expect);
+	free(dev.data);
+
+	return err;
+}
+
+U_BOOT_CMD(
+	test_sparse,	1,	1,	do_test_sparse,
+	"Test the Android sparse image decoder", ""
+);
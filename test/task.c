@@ -0,0 +1,213 @@
+/*
+ * Tests for the cooperative task scheduler
+ *
+ * Copyright (c) 2014 The Chromium OS Authors.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <malloc.h>
+#include <task.h>
+#include <u-boot/crc.h>
+
+#define errcheck(statement) if (!(statement)) { \
+	fprintf(stderr, "\tFailed: %s\n", #statement); \
+	ret = 1; \
+	goto out; \
+}
+
+/* Record of the order in which test tasks run, one character per step */
+static char task_log[40];
+static int task_log_len;
+
+/* A test task which logs its name and runs for a number of steps */
+struct log_task {
+	struct task task;
+	int steps_needed;
+	int result;
+	int nested_yield;
+};
+
+static int log_task_run(struct task *task)
+{
+	struct log_task *ltask = task->priv;
+
+	if (task_log_len < sizeof(task_log) - 1)
+		task_log[task_log_len++] = *task->name;
+
+	/* This should not run any other tasks */
+	if (ltask->nested_yield)
+		task_yield();
+
+	if (task->steps < ltask->steps_needed)
+		return -EAGAIN;
+
+	return ltask->result;
+}
+
+static void init_log_task(struct log_task *ltask, const char *name,
+			  int steps_needed, int result)
+{
+	memset(ltask, '\0', sizeof(*ltask));
+	task_init(&ltask->task, name, log_task_run, ltask);
+	ltask->steps_needed = steps_needed;
+	ltask->result = result;
+}
+
+static void clear_log(void)
+{
+	memset(task_log, '\0', sizeof(task_log));
+	task_log_len = 0;
+}
+
+/* Check that tasks run in turn, and that we can wait for them */
+static int test_task_order(void)
+{
+	struct log_task a, b, c;
+	int ret;
+
+	clear_log();
+	init_log_task(&a, "a", 3, 0);
+	init_log_task(&b, "b", 2, -EIO);
+	init_log_task(&c, "c", 4, 0);
+	c.nested_yield = 1;
+
+	errcheck(!task_start(&a.task));
+	errcheck(!task_start(&b.task));
+	errcheck(task_start(&b.task) == -EBUSY);
+	errcheck(task_running(&a.task));
+
+	/* Nothing runs until we yield */
+	errcheck(task_log_len == 0);
+	task_yield();
+	task_yield();
+	errcheck(!task_start(&c.task));
+	task_yield();
+	task_yield();
+	task_yield();
+	errcheck(!strcmp("ababc", task_log));
+
+	/* b has now finished and should have dropped out */
+	errcheck(!task_running(&b.task));
+	errcheck(b.task.result == -EIO);
+	errcheck(task_wait(&b.task) == -EIO);
+	task_yield();
+	task_yield();
+	errcheck(!strcmp("ababcac", task_log));
+	errcheck(!task_running(&a.task));
+	errcheck(a.task.steps == 3);
+
+	/* Waiting runs just the task we want */
+	errcheck(task_wait(&c.task) == 0);
+	errcheck(!strcmp("ababcaccc", task_log));
+	errcheck(c.task.steps == 4);
+
+	/* With nothing to run, yield does nothing */
+	task_yield();
+	errcheck(task_log_len == 9);
+
+	/* A finished task can be started again */
+	errcheck(!task_start(&a.task));
+	errcheck(a.task.steps == 0);
+	errcheck(task_wait(&a.task) == 0);
+	errcheck(!strcmp("ababcacccaaa", task_log));
+
+	/* A task left with stale state, e.g. on the stack, can be started */
+	memset(&b, '\xff', sizeof(b));
+	b.task.result = -EINPROGRESS;
+	task_init(&b.task, "b", log_task_run, &b);
+	b.steps_needed = 1;
+	b.result = 0;
+	b.nested_yield = 0;
+	errcheck(!task_running(&b.task));
+	errcheck(!task_start(&b.task));
+	errcheck(task_wait(&b.task) == 0);
+	errcheck(!strcmp("ababcacccaaab", task_log));
+	ret = 0;
+
+out:
+	printf(" %s: %s\n", __func__, ret == 0 ? "ok" : "FAILED");
+	return ret;
+}
+
+enum {
+	CRC_BUF_SIZE	= 64 << 10,
+	CRC_CHUNK_SIZE	= 4 << 10,
+};
+
+/* A task which works out the CRC32 of a buffer a chunk at a time */
+struct crc_task {
+	struct task task;
+	const uint8_t *buf;
+	uint pos;
+	uint size;
+	uint32_t crc;
+};
+
+static int crc_task_run(struct task *task)
+{
+	struct crc_task *ctask = task->priv;
+	uint len = min(ctask->size - ctask->pos, (uint)CRC_CHUNK_SIZE);
+
+	ctask->crc = crc32(ctask->crc, ctask->buf + ctask->pos, len);
+	ctask->pos += len;
+
+	return ctask->pos < ctask->size ? -EAGAIN : 0;
+}
+
+/* Check that a real job can progress from a busy-wait loop */
+static int test_task_crc(void)
+{
+	struct crc_task ctask;
+	uint8_t *buf;
+	int loops;
+	int ret;
+	int i;
+
+	buf = malloc(CRC_BUF_SIZE);
+	if (!buf)
+		return 1;
+	for (i = 0; i < CRC_BUF_SIZE; i++)
+		buf[i] = i * 7 + (i >> 8);
+
+	memset(&ctask, '\0', sizeof(ctask));
+	task_init(&ctask.task, "crc", crc_task_run, &ctask);
+	ctask.buf = buf;
+	ctask.size = CRC_BUF_SIZE;
+	errcheck(!task_start(&ctask.task));
+
+	/* Pretend to wait for some hardware */
+	for (loops = 0; task_running(&ctask.task); loops++)
+		task_yield();
+
+	errcheck(loops == CRC_BUF_SIZE / CRC_CHUNK_SIZE);
+	errcheck(ctask.task.result == 0);
+	errcheck(ctask.crc == crc32(0, buf, CRC_BUF_SIZE));
+	ret = 0;
+
+out:
+	printf(" %s: %s\n", __func__, ret == 0 ? "ok" : "FAILED");
+	free(buf);
+	return ret;
+}
+
+static int do_ut_task(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	int err = 0;
+
+	err += test_task_order();
+	err += test_task_crc();
+
+	printf("ut_task %s\n", err == 0 ? "ok" : "FAILED");
+
+	return err ? CMD_RET_FAILURE : 0;
+}
+
+U_BOOT_CMD(
+	ut_task,	1,	1,	do_ut_task,
+	"Test the cooperative task scheduler", ""
+);
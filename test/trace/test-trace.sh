@@ -11,7 +11,7 @@ TRACE_OPT="FTRACE=1"
 fail() {
 	echo "Test failed: $1"
 	if [ -n ${tmp} ]; then
-		rm ${tmp}
+		rm -f ${tmp} ${trace_file}
 	fi
 	exit 1
 }
@@ -41,6 +41,46 @@ run_trace() {
 END
 }
 
+run_profile() {
+	echo "Run profile"
+	./${OUTPUT_DIR}/u-boot <<END
+	hash sha256 0 10000
+	trace mode aggregate
+	hash sha256 0 10000
+	trace pause
+	trace stats
+	trace times 0 2000000
+	trace calls
+	sb save host 0 ${trace_file} 0 \${profoffset}
+	reset
+END
+}
+
+check_profile() {
+	echo "Check profile"
+	PROFTOOL="./${OUTPUT_DIR}/tools/proftool -m ${OUTPUT_DIR}/System.map"
+
+	if ! grep -q "Recording function counters only" ${tmp}; then
+		fail "aggregate mode error"
+	fi
+
+	# The function times should include sha256, with a non-zero count
+	${PROFTOOL} -p ${trace_file} -n 0 dump-profile >${tmp}
+	if ! awk '$5 ~ /^sha256_/ && $1 > 0 { found = 1 }
+			END { exit !found }' ${tmp}; then
+		fail "function profile error"
+	fi
+
+	# Each folded stack should be a list of functions and a time
+	${PROFTOOL} -p ${trace_file} dump-folded >${tmp}
+	if grep -qv '^[^ ;]\+\(;[^ ;]\+\)* [0-9]\+$' ${tmp}; then
+		fail "folded stack format error"
+	fi
+	if ! grep -q ';sha256_[^ ]* [0-9]\+$' ${tmp}; then
+		fail "folded stack error"
+	fi
+}
+
 check_results() {
 	echo "Check results"
 
@@ -69,8 +109,11 @@ check_results() {
 echo "Simple trace test / sanity check using sandbox"
 echo
 tmp="$(tempfile)"
+trace_file="${tmp}.trace"
 build_uboot
 run_trace >${tmp}
 check_results ${tmp}
-rm ${tmp}
+run_profile >${tmp}
+check_profile
+rm ${tmp} ${trace_file}
 echo "Test passed"
@@ -13,7 +13,7 @@ set -e
 #	$1:	Test message
 run_uboot() {
 	echo -n "Test Verified Boot Run: $1: "
-	${uboot} -d sandbox-u-boot.dtb >${tmp} -c '
+	${uboot} -d sandbox-u-boot.dtb --host 0:${tmp}.img >${tmp} -c '
 sb load host 0 100 test.fit;
 fdt addr 100;
 bootm 100;
@@ -28,6 +28,42 @@ reset'
 	fi
 }
 
+# Time checking the signed configuration, with a new key of the given size
+# Args:
+#	$1:	Number of key bits
+time_uboot() {
+	bits=$1
+	kdir=${tmp}.keys
+
+	mkdir -p ${kdir}
+	openssl genrsa -F4 -out ${kdir}/dev.key ${bits} 2>/dev/null
+	openssl req -batch -new -x509 -key ${kdir}/dev.key -out ${kdir}/dev.crt
+	sed "s/sha1,rsa2048/sha1,rsa${bits}/" sign-configs.its >sign-${bits}.its
+	dtc -p 0x1000 sandbox-u-boot.dts -O dtb -o sandbox-u-boot.dtb
+	${mkimage} -D "${dtc}" -f sign-${bits}.its test.fit >${tmp}
+	${mkimage} -D "${dtc}" -F -k ${kdir} -K sandbox-u-boot.dtb -r test.fit \
+		>${tmp}
+	rm -rf sign-${bits}.its ${kdir}
+
+	# 'bootm start' loads and checks the images without booting them
+	check="bootm start 100"
+	for i in $(seq 2 ${count}); do
+		check="${check}; bootm start 100"
+	done
+	${uboot} -d sandbox-u-boot.dtb --host 0:${tmp}.img >${tmp} -c "
+setenv stdout serial;
+sb load host 0 100 test.fit;
+setenv check '${check}';
+time run check"
+	if [ $(grep -c "dev+ OK" ${tmp}) -ne ${count} ]; then
+		echo "Verified boot with ${bits}-bit key failed, output follows:"
+		cat ${tmp}
+		false
+	fi
+	ms=$(sed -n 's/^time: \([0-9]*\)\.\([0-9]*\) seconds.*/\1\2/p' ${tmp})
+	echo "${bits}-bit key: $((10#${ms} * 1000 / count)) us per boot check"
+}
+
 echo "Simple Verified Boot Test"
 echo "========================="
 echo
@@ -36,6 +72,7 @@ echo
 
 err=0
 tmp=/tmp/vboot_test.$$
+count=200
 
 dir=$(dirname $0)
 
@@ -61,6 +98,9 @@ openssl req -batch -new -x509 -key ${keys}/dev.key -out ${keys}/dev.crt
 
 pushd ${dir} >/dev/null
 
+# Sandbox needs a host device for 'sb load'; it also holds the environment
+dd if=/dev/zero of=${tmp}.img bs=1k count=8 2>/dev/null
+
 # Compile our device tree files for kernel and U-Boot (CONFIG_OF_CONTROL)
 dtc -p 0x1000 sandbox-kernel.dts -O dtb -o sandbox-kernel.dtb
 dtc -p 0x1000 sandbox-u-boot.dts -O dtb -o sandbox-u-boot.dtb
@@ -103,6 +143,27 @@ fdtput -t bx test.fit /configurations/conf@1/signature@1 value ${sig}
 
 run_uboot "signed config with bad hash" "Bad Data Hash"
 
+# Moving the image data out of the FIT must not upset the signature
+echo Build FIT with signed configuration and external data
+${mkimage} -D "${dtc}" -f sign-configs.its test.fit >${tmp}
+${mkimage} -D "${dtc}" -E -F -k dev-keys -K sandbox-u-boot.dtb -r test.fit \
+	>${tmp}
+
+run_uboot "signed config, external data" "dev+"
+
+# Signing it again moves the end of the FIT, but the data must follow
+${mkimage} -D "${dtc}" -F -k dev-keys -K sandbox-u-boot.dtb -r \
+	-c "signed again" test.fit >${tmp}
+
+run_uboot "signed config, external data re-signed" "dev+"
+
+echo
+echo "Verified boot timing, ${count} checks each"
+for bits in 2048 3072 4096; do
+	time_uboot ${bits}
+done
+rm -f ${tmp} ${tmp}.img
+
 popd >/dev/null
 
 echo
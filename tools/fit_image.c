@@ -77,6 +77,219 @@ int mmap_fdt(struct image_tool_params *params, const char *fname, void **blobp,
 	return fd;
 }
 
+/**
+ * fit_extract_data() - move the image data out of a FIT
+ *
+ * The 'data' property of each image is replaced by 'data-offset' and
+ * 'data-size' properties, and the data is written after the FIT, each image
+ * aligned to 4 bytes.
+ *
+ * @params:	mkimage parameters
+ * @fname:	FIT file to update
+ * @return 0 if OK, -1 on error
+ */
+static int fit_extract_data(struct image_tool_params *params,
+			    const char *fname)
+{
+	void *fit, *fdt = NULL, *data = NULL;
+	int images, noffset, count, fd;
+	uint32_t data_size = 0;
+	struct stat sbuf;
+	int ret = -1;
+	int size;
+
+	fd = mmap_fdt(params, fname, &fit, &sbuf);
+	if (fd < 0)
+		return -1;
+
+	images = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (images < 0) {
+		fprintf(stderr, "%s: Can't find images parent node '%s' (%s)\n",
+			params->cmdname, FIT_IMAGES_PATH,
+			fdt_strerror(images));
+		goto err;
+	}
+	for (count = 0, noffset = fdt_first_subnode(fit, images);
+	     noffset >= 0;
+	     noffset = fdt_next_subnode(fit, noffset))
+		count++;
+
+	/* Allow for two new properties per image, and their names */
+	size = fdt_totalsize(fit) + count * 32 + 64;
+	fdt = malloc(size);
+	data = calloc(1, sbuf.st_size + count * 4);
+	if (!fdt || !data) {
+		fprintf(stderr, "%s: Out of memory\n", params->cmdname);
+		goto err;
+	}
+	ret = fdt_open_into(fit, fdt, size);
+	if (ret)
+		goto err_fdt;
+
+	images = fdt_path_offset(fdt, FIT_IMAGES_PATH);
+	for (noffset = fdt_first_subnode(fdt, images);
+	     noffset >= 0;
+	     noffset = fdt_next_subnode(fdt, noffset)) {
+		const void *buf;
+		int len;
+
+		buf = fdt_getprop(fdt, noffset, FIT_DATA_PROP, &len);
+		if (!buf)
+			continue;
+		memcpy(data + data_size, buf, len);
+		ret = fdt_delprop(fdt, noffset, FIT_DATA_PROP);
+		if (!ret)
+			ret = fdt_setprop_u32(fdt, noffset,
+					      FIT_DATA_OFFSET_PROP, data_size);
+		if (!ret)
+			ret = fdt_setprop_u32(fdt, noffset, FIT_DATA_SIZE_PROP,
+					      len);
+		if (ret)
+			goto err_fdt;
+		data_size += (len + 3) & ~3;
+	}
+	ret = fdt_pack(fdt);
+	if (ret)
+		goto err_fdt;
+
+	munmap(fit, sbuf.st_size);
+	close(fd);
+	fit = NULL;
+
+	/* Rewrite the file as the FIT, padding, then the image data */
+	ret = -1;
+	fd = open(fname, O_WRONLY | O_TRUNC | O_BINARY);
+	if (fd < 0 ||
+	    write(fd, fdt, fdt_totalsize(fdt)) != fdt_totalsize(fdt) ||
+	    lseek(fd, fit_get_ext_offset(fdt), SEEK_SET) < 0 ||
+	    write(fd, data, data_size) != data_size) {
+		fprintf(stderr, "%s: Can't write %s: %s\n", params->cmdname,
+			fname, strerror(errno));
+		goto out;
+	}
+	ret = 0;
+	goto out;
+
+err_fdt:
+	fprintf(stderr, "%s: Can't move image data out of the FIT: %s\n",
+		params->cmdname, fdt_strerror(ret));
+err:
+	ret = -1;
+out:
+	if (fit)
+		munmap(fit, sbuf.st_size);
+	if (fd >= 0)
+		close(fd);
+	free(data);
+	free(fdt);
+
+	return ret;
+}
+
+/**
+ * fit_import_data() - move external image data back into a FIT
+ *
+ * This undoes fit_extract_data(), so that an existing FIT can be updated:
+ * adding hashes or signatures grows the FIT and so moves the place its
+ * external data must start.
+ *
+ * @params:	mkimage parameters
+ * @fname:	FIT file to update
+ * @return 1 if data was moved, 0 if the FIT has no external data, -1 on
+ *	error
+ */
+static int fit_import_data(struct image_tool_params *params,
+			   const char *fname)
+{
+	void *fit, *fdt = NULL;
+	int images, noffset, fd;
+	ulong ext_offset, offset;
+	struct stat sbuf;
+	int moved = 0;
+	int ret = -1;
+	int buf_size;
+	size_t size;
+
+	fd = mmap_fdt(params, fname, &fit, &sbuf);
+	if (fd < 0)
+		return -1;
+
+	images = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (images < 0) {
+		ret = 0;
+		goto out;
+	}
+
+	/* Allow for the data, which is at most all of the file, and more */
+	buf_size = fdt_totalsize(fit) + sbuf.st_size;
+	fdt = malloc(buf_size);
+	if (!fdt) {
+		fprintf(stderr, "%s: Out of memory\n", params->cmdname);
+		goto out;
+	}
+	ret = fdt_open_into(fit, fdt, buf_size);
+	if (ret)
+		goto err_fdt;
+
+	ext_offset = fit_get_ext_offset(fit);
+	images = fdt_path_offset(fdt, FIT_IMAGES_PATH);
+	for (noffset = fdt_first_subnode(fdt, images);
+	     noffset >= 0;
+	     noffset = fdt_next_subnode(fdt, noffset)) {
+		if (fit_image_get_data_offset(fdt, noffset, &offset))
+			continue;
+		if (fit_image_get_data_size(fdt, noffset, &size) ||
+		    ext_offset + offset + size > sbuf.st_size) {
+			fprintf(stderr, "%s: External data of '%s' is not in %s\n",
+				params->cmdname,
+				fit_get_name(fdt, noffset, NULL), fname);
+			ret = -1;
+			goto out;
+		}
+		ret = fdt_setprop(fdt, noffset, FIT_DATA_PROP,
+				  fit + ext_offset + offset, size);
+		if (!ret)
+			ret = fdt_delprop(fdt, noffset, FIT_DATA_OFFSET_PROP);
+		if (!ret)
+			ret = fdt_delprop(fdt, noffset, FIT_DATA_SIZE_PROP);
+		if (ret)
+			goto err_fdt;
+		moved = 1;
+	}
+	ret = 0;
+	if (!moved)
+		goto out;
+
+	/* Keep the free space: hashes and signatures are added next */
+	munmap(fit, sbuf.st_size);
+	close(fd);
+	fit = NULL;
+
+	fd = open(fname, O_WRONLY | O_TRUNC | O_BINARY);
+	if (fd < 0 ||
+	    write(fd, fdt, fdt_totalsize(fdt)) != fdt_totalsize(fdt)) {
+		fprintf(stderr, "%s: Can't write %s: %s\n", params->cmdname,
+			fname, strerror(errno));
+		ret = -1;
+		goto out;
+	}
+	ret = 1;
+	goto out;
+
+err_fdt:
+	fprintf(stderr, "%s: Can't move image data into the FIT: %s\n",
+		params->cmdname, fdt_strerror(ret));
+	ret = -1;
+out:
+	if (fit)
+		munmap(fit, sbuf.st_size);
+	if (fd >= 0)
+		close(fd);
+	free(fdt);
+
+	return ret;
+}
+
 /**
  * fit_handle_file - main FIT file processing function
  *
@@ -98,6 +311,7 @@ static int fit_handle_file(struct image_tool_params *params)
 	struct stat sbuf;
 	void *ptr;
 	off_t destfd_size = 0;
+	int ret;
 
 	/* Flattened Image Tree (FIT) format  handling */
 	debug ("FIT format handling\n");
@@ -128,6 +342,18 @@ static int fit_handle_file(struct image_tool_params *params)
 		goto err_system;
 	}
 
+	/*
+	 * Work on an existing FIT with its data inside, and keep the data
+	 * outside afterwards if that is where it was
+	 */
+	if (!params->datafile) {
+		ret = fit_import_data(params, tmpfile);
+		if (ret < 0)
+			goto err_system;
+		if (ret)
+			params->external_data = 1;
+	}
+
 	if (params->keydest) {
 		destfd = mmap_fdt(params, params->keydest, &dest_blob, &sbuf);
 		if (destfd < 0)
@@ -142,7 +368,8 @@ static int fit_handle_file(struct image_tool_params *params)
 	/* set hashes for images in the blob */
 	if (fit_add_verification_data(params->keydir,
 				      dest_blob, ptr, params->comment,
-				      params->require_keys)) {
+				      params->require_keys,
+				      params->hash_cache)) {
 		fprintf(stderr, "%s Can't add hashes to FIT blob\n",
 			params->cmdname);
 		goto err_add_hashes;
@@ -163,6 +390,12 @@ static int fit_handle_file(struct image_tool_params *params)
 		close(destfd);
 	}
 
+	/* Move the image data out of the FIT, if requested */
+	if (params->external_data && fit_extract_data(params, tmpfile)) {
+		unlink(tmpfile);
+		return EXIT_FAILURE;
+	}
+
 	if (rename (tmpfile, params->imagefile) == -1) {
 		fprintf (stderr, "%s: Can't rename %s to %s: %s\n",
 				params->cmdname, tmpfile, params->imagefile,
@@ -11,6 +11,8 @@
 
 #include "mkimage.h"
 #include <image.h>
+#include <limits.h>
+#include <pthread.h>
 #include <version.h>
 
 /**
@@ -43,42 +45,340 @@ static int fit_set_hash_value(void *fit, int noffset, uint8_t *value,
 	return 0;
 }
 
+/* Largest number of threads used to calculate hashes */
+#define FIT_HASH_MAX_THREADS	16
+
+/**
+ * struct fit_hash_job - a hash value to calculate for one hash node
+ *
+ * @data:	image data to hash
+ * @size:	size of image data in bytes
+ * @algo:	hash algorithm name (NULL if the node has none)
+ * @value:	calculated hash value
+ * @value_len:	length of the hash value
+ * @ret:	0 if the value was calculated, -1 if the algo is unsupported
+ */
+struct fit_hash_job {
+	const void *data;
+	size_t size;
+	char *algo;
+	uint8_t value[FIT_MAX_HASH_LEN];
+	int value_len;
+	int ret;
+};
+
+/**
+ * struct fit_hash_list - hash values for all hash nodes in the images/ node
+ *
+ * The hash nodes are listed in FIT order, so that they can be written back
+ * by walking the FIT again.
+ *
+ * @jobs:	list of hash nodes
+ * @count:	number of entries in @jobs
+ * @next:	next job to calculate, then next job to write
+ * @cache_dir:	directory holding previously calculated values (or NULL)
+ * @lock:	protects @next while calculating
+ */
+struct fit_hash_list {
+	struct fit_hash_job *jobs;
+	int count;
+	int next;
+	const char *cache_dir;
+	pthread_mutex_t lock;
+};
+
+static uint64_t fit_hash_rotl(uint64_t val, int bits)
+{
+	return (val << bits) | (val >> (64 - bits));
+}
+
+static uint64_t fit_hash_mix(uint64_t val)
+{
+	val ^= val >> 33;
+	val *= 0xff51afd7ed558ccdULL;
+	val ^= val >> 33;
+	val *= 0xc4ceb9fe1a85ec53ULL;
+	val ^= val >> 33;
+
+	return val;
+}
+
+/**
+ * fit_hash_fingerprint() - fast 128-bit fingerprint of some data
+ *
+ * This is MurmurHash3 (x64, 128-bit), which is much quicker than the
+ * hashes it stands in for. It is used to name entries in the hash cache.
+ *
+ * @data:	data to fingerprint
+ * @size:	size of data in bytes
+ * @fp:	returns the fingerprint
+ */
+static void fit_hash_fingerprint(const void *data, size_t size,
+				 uint64_t fp[2])
+{
+	const uint64_t c1 = 0x87c37b91114253d5ULL;
+	const uint64_t c2 = 0x4cf5ad432745937fULL;
+	const uint8_t *ptr = data;
+	uint64_t h1 = 0, h2 = 0, k1, k2;
+	size_t left;
+
+	for (left = size; left >= 16; left -= 16, ptr += 16) {
+		memcpy(&k1, ptr, sizeof(k1));
+		memcpy(&k2, ptr + 8, sizeof(k2));
+
+		h1 ^= fit_hash_rotl(k1 * c1, 31) * c2;
+		h1 = (fit_hash_rotl(h1, 27) + h2) * 5 + 0x52dce729;
+		h2 ^= fit_hash_rotl(k2 * c2, 33) * c1;
+		h2 = (fit_hash_rotl(h2, 31) + h1) * 5 + 0x38495ab5;
+	}
+	if (left) {
+		uint8_t tail[16];
+
+		memset(tail, '\0', sizeof(tail));
+		memcpy(tail, ptr, left);
+		memcpy(&k1, tail, sizeof(k1));
+		memcpy(&k2, tail + 8, sizeof(k2));
+		h1 ^= fit_hash_rotl(k1 * c1, 31) * c2;
+		h2 ^= fit_hash_rotl(k2 * c2, 33) * c1;
+	}
+
+	h1 ^= size;
+	h2 ^= size;
+	h1 += h2;
+	h2 += h1;
+	h1 = fit_hash_mix(h1);
+	h2 = fit_hash_mix(h2);
+	h1 += h2;
+	h2 += h1;
+	fp[0] = h1;
+	fp[1] = h2;
+}
+
+/*
+ * Work out the cache filename for a hash job. Returns -1 if the job must
+ * not be cached.
+ */
+static int fit_hash_cache_name(const char *cache_dir,
+			       struct fit_hash_job *job, char *fname,
+			       int fname_len)
+{
+	uint64_t fp[2];
+	int len;
+
+	if (strchr(job->algo, '/'))
+		return -1;
+	fit_hash_fingerprint(job->data, job->size, fp);
+	len = snprintf(fname, fname_len, "%s/%s-%zx-%016llx%016llx",
+		       cache_dir, job->algo, job->size,
+		       (unsigned long long)fp[0], (unsigned long long)fp[1]);
+
+	return len < fname_len ? 0 : -1;
+}
+
+static int fit_hash_cache_read(const char *fname, struct fit_hash_job *job)
+{
+	int fd, len;
+
+	fd = open(fname, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	len = read(fd, job->value, sizeof(job->value));
+	close(fd);
+	if (len <= 0)
+		return -1;
+	job->value_len = len;
+	debug("Hash cache hit: %s\n", fname);
+
+	return 0;
+}
+
+/*
+ * Store a hash value in the cache. The value is renamed into place so that
+ * concurrent mkimage runs never see part of it. Failures are ignored - the
+ * value is just calculated again next time.
+ */
+static void fit_hash_cache_write(const char *fname, struct fit_hash_job *job)
+{
+	char tmpname[PATH_MAX];
+	int fd, ok;
+
+	if (snprintf(tmpname, sizeof(tmpname), "%s.XXXXXX", fname) >=
+	    sizeof(tmpname))
+		return;
+	fd = mkstemp(tmpname);
+	if (fd < 0)
+		return;
+	ok = write(fd, job->value, job->value_len) == job->value_len;
+	if (close(fd))
+		ok = 0;
+	if (!ok || rename(tmpname, fname))
+		unlink(tmpname);
+}
+
+static void fit_hash_calc(struct fit_hash_list *list, struct fit_hash_job *job)
+{
+	char fname[PATH_MAX];
+	int cached;
+
+	if (!job->data || !job->algo)
+		return;
+	cached = list->cache_dir && !fit_hash_cache_name(list->cache_dir, job,
+							 fname, sizeof(fname));
+	if (cached && !fit_hash_cache_read(fname, job))
+		return;
+	job->ret = calculate_hash(job->data, job->size, job->algo, job->value,
+				  &job->value_len);
+	if (cached && !job->ret)
+		fit_hash_cache_write(fname, job);
+}
+
+static void *fit_hash_thread(void *arg)
+{
+	struct fit_hash_list *list = arg;
+	int i;
+
+	for (;;) {
+		pthread_mutex_lock(&list->lock);
+		i = list->next++;
+		pthread_mutex_unlock(&list->lock);
+		if (i >= list->count)
+			break;
+		fit_hash_calc(list, &list->jobs[i]);
+	}
+
+	return NULL;
+}
+
+/**
+ * fit_hash_collect() - find all hash nodes of the component images
+ *
+ * No changes may be made to the FIT between this and fit_hash_run(), since
+ * the jobs point at the image data within it.
+ *
+ * @fit:	pointer to the FIT format image header
+ * @images_noffset: offset of the images/ node
+ * @list:	list to fill in
+ * @return 0 if ok, -1 on error
+ */
+static int fit_hash_collect(void *fit, int images_noffset,
+			    struct fit_hash_list *list)
+{
+	int image_noffset, noffset;
+
+	for (image_noffset = fdt_first_subnode(fit, images_noffset);
+	     image_noffset >= 0;
+	     image_noffset = fdt_next_subnode(fit, image_noffset)) {
+		const void *data;
+		size_t size;
+
+		if (fit_image_get_data(fit, image_noffset, &data, &size))
+			data = NULL;
+
+		for (noffset = fdt_first_subnode(fit, image_noffset);
+		     noffset >= 0;
+		     noffset = fdt_next_subnode(fit, noffset)) {
+			struct fit_hash_job *job;
+			char *algo;
+
+			if (strncmp(fit_get_name(fit, noffset, NULL),
+				    FIT_HASH_NODENAME,
+				    strlen(FIT_HASH_NODENAME)))
+				continue;
+
+			job = realloc(list->jobs,
+				      (list->count + 1) * sizeof(*job));
+			if (!job) {
+				printf("Out of memory for hash list\n");
+				return -1;
+			}
+			list->jobs = job;
+			job += list->count++;
+			memset(job, '\0', sizeof(*job));
+			job->data = data;
+			job->size = size;
+			if (!fit_image_hash_get_algo(fit, noffset, &algo))
+				job->algo = strdup(algo);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * fit_hash_run() - calculate all hash values, using a thread per CPU
+ *
+ * The calling thread does its share of the work, so this still completes
+ * if no threads can be started.
+ *
+ * @list:	list of hash nodes to process
+ */
+static void fit_hash_run(struct fit_hash_list *list)
+{
+	pthread_t threads[FIT_HASH_MAX_THREADS];
+	long nthreads;
+	int i, started;
+
+	nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads > FIT_HASH_MAX_THREADS)
+		nthreads = FIT_HASH_MAX_THREADS;
+	if (nthreads > list->count)
+		nthreads = list->count;
+
+	pthread_mutex_init(&list->lock, NULL);
+	list->next = 0;
+	for (started = 0; started < nthreads - 1; started++) {
+		if (pthread_create(&threads[started], NULL, fit_hash_thread,
+				   list))
+			break;
+	}
+	fit_hash_thread(list);
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&list->lock);
+	list->next = 0;
+}
+
+static void fit_hash_free(struct fit_hash_list *list)
+{
+	int i;
+
+	for (i = 0; i < list->count; i++)
+		free(list->jobs[i].algo);
+	free(list->jobs);
+}
+
 /**
  * fit_image_process_hash - Process a single subnode of the images/ node
  *
- * Check each subnode and process accordingly. For hash nodes we generate
- * a hash of the supplised data and store it in the node.
+ * Check each subnode and process accordingly. For hash nodes we store the
+ * hash of the image data, calculated earlier by fit_hash_run(), in the node.
  *
  * @fit:	pointer to the FIT format image header
  * @image_name:	name of image being processes (used to display errors)
  * @noffset:	subnode offset
- * @data:	data to process
- * @size:	size of data in bytes
+ * @job:	calculated hash value for this node
  * @return 0 if ok, -1 on error
  */
 static int fit_image_process_hash(void *fit, const char *image_name,
-		int noffset, const void *data, size_t size)
+		int noffset, struct fit_hash_job *job)
 {
-	uint8_t value[FIT_MAX_HASH_LEN];
 	const char *node_name;
-	int value_len;
-	char *algo;
 
 	node_name = fit_get_name(fit, noffset, NULL);
 
-	if (fit_image_hash_get_algo(fit, noffset, &algo)) {
+	if (!job->algo) {
 		printf("Can't get hash algo property for '%s' hash node in '%s' image node\n",
 		       node_name, image_name);
 		return -1;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	if (job->ret) {
 		printf("Unsupported hash algorithm (%s) for '%s' hash node in '%s' image node\n",
-		       algo, node_name, image_name);
+		       job->algo, node_name, image_name);
 		return -1;
 	}
 
-	if (fit_set_hash_value(fit, noffset, value, value_len)) {
+	if (fit_set_hash_value(fit, noffset, job->value, job->value_len)) {
 		printf("Can't set hash value for '%s' hash node in '%s' image node\n",
 		       node_name, image_name);
 		return -1;
@@ -275,11 +575,12 @@ static int fit_image_process_sig(const char *keydir, void *keydest,
  * @image_noffset: Requested component image node
  * @comment:	Comment to add to signature nodes
  * @require_keys: Mark all keys as 'required'
+ * @hashes:	Hash values, positioned at the first hash node of this image
  * @return: 0 on success, <0 on failure
  */
 int fit_image_add_verification_data(const char *keydir, void *keydest,
 		void *fit, int image_noffset, const char *comment,
-		int require_keys)
+		int require_keys, struct fit_hash_list *hashes)
 {
 	const char *image_name;
 	const void *data;
@@ -309,8 +610,10 @@ int fit_image_add_verification_data(const char *keydir, void *keydest,
 		node_name = fit_get_name(fit, noffset, NULL);
 		if (!strncmp(node_name, FIT_HASH_NODENAME,
 			     strlen(FIT_HASH_NODENAME))) {
+			if (hashes->next >= hashes->count)
+				return -1;
 			ret = fit_image_process_hash(fit, image_name, noffset,
-						data, size);
+					&hashes->jobs[hashes->next++]);
 		} else if (IMAGE_ENABLE_SIGN && keydir &&
 			   !strncmp(node_name, FIT_SIG_NODENAME,
 				strlen(FIT_SIG_NODENAME))) {
@@ -486,7 +789,9 @@ static int fit_config_get_data(void *fit, int conf_noffset, int noffset,
 		struct image_region **regionp, int *region_countp,
 		char **region_propp, int *region_proplen)
 {
-	char * const exc_prop[] = {"data"};
+	/* Image data is checked by its hashes, wherever it is stored */
+	char * const exc_prop[] = {FIT_DATA_PROP, FIT_DATA_OFFSET_PROP,
+				   FIT_DATA_SIZE_PROP};
 	struct strlist node_inc;
 	struct image_region *region;
 	struct fdt_region fdt_regions[100];
@@ -642,8 +947,10 @@ static int fit_config_add_verification_data(const char *keydir, void *keydest,
 }
 
 int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
-			      const char *comment, int require_keys)
+			      const char *comment, int require_keys,
+			      const char *hash_cache)
 {
+	struct fit_hash_list hashes;
 	int images_noffset, confs_noffset;
 	int noffset;
 	int ret;
@@ -656,19 +963,37 @@ int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 		return images_noffset;
 	}
 
+	/*
+	 * The hash nodes of all images are independent, so calculate their
+	 * values together, before anything in the FIT moves.
+	 */
+	memset(&hashes, '\0', sizeof(hashes));
+	/*
+	 * Cache entries are found by a fingerprint which is not a
+	 * cryptographic hash, so never use them for hashes we sign
+	 */
+	if (!keydir)
+		hashes.cache_dir = hash_cache;
+	else if (hash_cache)
+		printf("Not using hash cache when signing\n");
+	ret = fit_hash_collect(fit, images_noffset, &hashes);
+	if (!ret)
+		fit_hash_run(&hashes);
+
 	/* Process its subnodes, print out component images details */
 	for (noffset = fdt_first_subnode(fit, images_noffset);
-	     noffset >= 0;
+	     !ret && noffset >= 0;
 	     noffset = fdt_next_subnode(fit, noffset)) {
 		/*
 		 * Direct child node of the images parent node,
 		 * i.e. component image node.
 		 */
 		ret = fit_image_add_verification_data(keydir, keydest,
-				fit, noffset, comment, require_keys);
-		if (ret)
-			return ret;
+				fit, noffset, comment, require_keys, &hashes);
 	}
+	fit_hash_free(&hashes);
+	if (ret)
+		return ret;
 
 	/* If there are no keys, we can't sign configurations */
 	if (!IMAGE_ENABLE_SIGN || !keydir)
@@ -57,6 +57,8 @@ struct image_tool_params {
 	const char *keydest;	/* Destination .dtb for public key */
 	const char *comment;	/* Comment to add to signature node */
 	int require_keys;	/* 1 to mark signing keys as 'required' */
+	const char *hash_cache;	/* Directory caching FIT hash values */
+	int external_data;	/* Store FIT image data after the FDT */
 };
 
 /*
@@ -229,6 +229,14 @@ main (int argc, char **argv)
 				params.type = IH_TYPE_FLATDT;
 				params.fflag = 1;
 				goto NXTARG;
+			case 'E':
+				params.external_data = 1;
+				break;
+			case 'H':
+				if (--argc <= 0)
+					usage();
+				params.hash_cache = *++argv;
+				goto NXTARG;
 			case 'k':
 				if (--argc <= 0)
 					usage();
@@ -633,9 +641,11 @@ static void usage(void)
 			 "          -d ==> use image data from 'datafile'\n"
 			 "          -x ==> set XIP (execute in place)\n",
 		params.cmdname);
-	fprintf(stderr, "       %s [-D dtc_options] [-f fit-image.its|-F] fit-image\n",
+	fprintf(stderr, "       %s [-D dtc_options] [-E] [-H hash_cache] [-f fit-image.its|-F] fit-image\n",
 		params.cmdname);
 	fprintf(stderr, "          -D => set options for device tree compiler\n"
+			"          -E => place image data after the FIT, not in it\n"
+			"          -H => reuse hash values cached in this directory (not with -k)\n"
 			"          -f => input filename for FIT source\n");
 #ifdef CONFIG_FIT_SIGNATURE
 	fprintf(stderr, "Signing / verified boot options: [-k keydir] [-K dtb] [ -c <comment>] [-r]\n"
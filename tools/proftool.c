@@ -31,6 +31,8 @@ struct func_info {
 	const char *name;
 	unsigned long code_size;
 	unsigned long call_count;
+	unsigned long long total_us;	/* Time in function and callees */
+	unsigned long long self_us;	/* Time in the function itself */
 	unsigned flags;
 	/* the section this function is in */
 	struct objsection_info *objsection;
@@ -48,6 +50,23 @@ struct trace_configline_info {
 	regex_t regex;		/* Regex to use if name starts with / */
 };
 
+/* A node in the call graph, one for each distinct call stack */
+struct call_node {
+	struct func_info *func;		/* Function called (NULL for root) */
+	struct call_node *parent;	/* Caller, NULL for root */
+	struct call_node *child;	/* First function called by this one */
+	struct call_node *sibling;	/* Next function called by parent */
+	unsigned long long self_us;	/* Time in the function itself */
+	unsigned long count;		/* Number of calls with this stack */
+};
+
+/* A function which has been entered but not yet exited */
+struct call_frame {
+	struct call_node *node;
+	unsigned long start;		/* Entry timestamp */
+	unsigned long long child_us;	/* Time spent in callees */
+};
+
 /* The contents of the trace config file */
 struct trace_configline_info *trace_config_head;
 
@@ -57,6 +76,9 @@ struct trace_call *call_list;
 int call_count;
 int verbose;	/* Verbosity level 0=none, 1=warn, 2=notice, 3=info, 4=debug */
 unsigned long text_offset;		/* text address of first function */
+int have_func_times;	/* Function times were read from the profile */
+int top_count = 20;	/* Number of functions to show in dump-profile */
+struct call_node *call_root;	/* Root of the call graph */
 
 static void outf(int level, const char *fmt, ...)
 		__attribute__ ((format (__printf__, 2, 3)));
@@ -85,9 +107,12 @@ static void usage(void)
 		"\n"
 		"Commands\n"
 		"   dump-ftrace\t\tDump out textual data in ftrace format\n"
+		"   dump-profile\tDump out functions ordered by self time\n"
+		"   dump-folded\t\tDump out folded call stacks for flame graphs\n"
 		"\n"
 		"Options:\n"
 		"   -m <map>\tSpecify Systen.map file\n"
+		"   -n <count>\tNumber of functions in profile (0 for all)\n"
 		"   -t <trace>\tSpecific trace data file (from U-Boot)\n"
 		"   -v <0-4>\tSpecify verbosity\n");
 	exit(EXIT_FAILURE);
@@ -226,6 +251,49 @@ static int read_calls(FILE *fin, int count)
 	return 0;
 }
 
+static int read_funcs(FILE *fin, int count, int *not_found)
+{
+	struct trace_output_func rec;
+	struct func_info *func;
+	int i;
+
+	notice("function count: %d\n", count);
+	for (i = 0; i < count; i++) {
+		if (read_data(fin, &rec, sizeof(rec)))
+			return 1;
+		func = find_func_by_offset(rec.offset);
+		if (!func) {
+			(*not_found)++;
+			continue;
+		}
+		func->call_count = rec.call_count;
+	}
+	return 0;
+}
+
+static int read_func_times(FILE *fin, int count, int *not_found)
+{
+	struct trace_output_func_time rec;
+	struct func_info *func;
+	int i;
+
+	notice("function time count: %d\n", count);
+	for (i = 0; i < count; i++) {
+		if (read_data(fin, &rec, sizeof(rec)))
+			return 1;
+		func = find_func_by_offset(rec.offset);
+		if (!func) {
+			(*not_found)++;
+			continue;
+		}
+		func->call_count = rec.call_count;
+		func->total_us = rec.total_us;
+		func->self_us = rec.self_us;
+	}
+	have_func_times = 1;
+	return 0;
+}
+
 static int read_profile(FILE *fin, int *not_found)
 {
 	struct trace_output_hdr hdr;
@@ -242,7 +310,13 @@ static int read_profile(FILE *fin, int *not_found)
 
 		switch (hdr.type) {
 		case TRACE_CHUNK_FUNCS:
-			/* Ignored at present */
+			if (read_funcs(fin, hdr.rec_count, not_found))
+				return 1;
+			break;
+
+		case TRACE_CHUNK_FUNC_TIMES:
+			if (read_func_times(fin, hdr.rec_count, not_found))
+				return 1;
 			break;
 
 		case TRACE_CHUNK_CALLS:
@@ -531,6 +605,250 @@ static int make_ftrace(void)
 	return 0;
 }
 
+static struct call_node *find_call_node(struct call_node *parent,
+					struct func_info *func)
+{
+	struct call_node *node;
+
+	for (node = parent->child; node; node = node->sibling) {
+		if (node->func == func)
+			return node;
+	}
+
+	node = calloc(1, sizeof(*node));
+	if (!node)
+		return NULL;
+	node->func = func;
+	node->parent = parent;
+	node->sibling = parent->child;
+	parent->child = node;
+
+	return node;
+}
+
+/* Account for the time taken by a function, once it has exited */
+static void exit_frame(struct call_frame *stack, int depth, ulong time)
+{
+	struct call_frame *frame = &stack[depth];
+	struct func_info *func = frame->node->func;
+	unsigned long long elapsed, self;
+	int i;
+
+	elapsed = (time - frame->start) & FUNCF_TIMESTAMP_MASK;
+	self = elapsed > frame->child_us ? elapsed - frame->child_us : 0;
+	frame->node->self_us += self;
+	if (depth)
+		frame[-1].child_us += elapsed;
+
+	if (have_func_times)
+		return;
+	func->self_us += self;
+
+	/* Don't count the total time of recursive calls twice */
+	for (i = 0; i < depth; i++) {
+		if (stack[i].node->func == func)
+			return;
+	}
+	func->total_us += elapsed;
+}
+
+/**
+ * Build the call graph from the list of calls
+ *
+ * This matches up each function entry with its exit to work out the time
+ * spent in each function and each call stack. If function times were not
+ * provided by U-Boot they are worked out here also.
+ *
+ * @return 0 if ok, -1 on error
+ */
+static int make_call_graph(void)
+{
+	struct call_frame *stack = NULL;
+	struct trace_call *call;
+	int depth = 0, alloced = 0;
+	ulong time = 0;
+	int missing_count = 0;
+	int i;
+
+	if (call_root)
+		return 0;
+	call_root = calloc(1, sizeof(*call_root));
+	if (!call_root) {
+		error("Cannot allocate call graph\n");
+		return -1;
+	}
+	if (!have_func_times) {
+		for (i = 0; i < func_count; i++)
+			func_list[i].call_count = 0;
+	}
+
+	for (i = 0, call = call_list; i < call_count; i++, call++) {
+		struct func_info *func = find_func_by_offset(call->func);
+		struct call_node *parent, *node;
+		int upto;
+
+		if (TRACE_CALL_TYPE(call) != FUNCF_ENTRY &&
+		    TRACE_CALL_TYPE(call) != FUNCF_EXIT)
+			continue;
+		if (!func) {
+			missing_count++;
+			continue;
+		}
+		time = call->flags & FUNCF_TIMESTAMP_MASK;
+
+		if (TRACE_CALL_TYPE(call) == FUNCF_EXIT) {
+			/* Find the matching entry, skipping any missed exits */
+			for (upto = depth - 1; upto >= 0; upto--) {
+				if (stack[upto].node->func == func)
+					break;
+			}
+			if (upto < 0) {
+				debug("Exit from '%s' without entry\n",
+				      func->name);
+				continue;
+			}
+			while (depth > upto)
+				exit_frame(stack, --depth, time);
+			continue;
+		}
+
+		if (depth == alloced) {
+			alloced += 64;
+			stack = realloc(stack, sizeof(*stack) * alloced);
+			if (!stack) {
+				error("Cannot allocate call stack\n");
+				return -1;
+			}
+		}
+		parent = depth ? stack[depth - 1].node : call_root;
+		node = find_call_node(parent, func);
+		if (!node) {
+			error("Cannot allocate call graph node\n");
+			return -1;
+		}
+		node->count++;
+		if (!have_func_times)
+			func->call_count++;
+		stack[depth].node = node;
+		stack[depth].start = time;
+		stack[depth].child_us = 0;
+		depth++;
+	}
+
+	/* Anything still running is counted up to the last timestamp */
+	while (depth > 0)
+		exit_frame(stack, --depth, time);
+	free(stack);
+	info("call graph: %d functions not found\n", missing_count);
+
+	return 0;
+}
+
+static int h_cmp_self_time(const void *v1, const void *v2)
+{
+	const struct func_info *f1 = *(struct func_info **)v1;
+	const struct func_info *f2 = *(struct func_info **)v2;
+
+	if (f1->self_us != f2->self_us)
+		return f1->self_us < f2->self_us ? 1 : -1;
+	return strcmp(f1->name, f2->name);
+}
+
+/*
+ * Print the functions which took the most time, with the number of
+ * calls, the total time (including callees) and the self time, e.g.
+ *
+ *      Calls   Total us    Self us  Function
+ *        112     91,203     85,117  mmc_send_cmd
+ */
+static int make_profile(void)
+{
+	struct func_info **list;
+	unsigned long long total = 0;
+	int i, count;
+
+	if (!have_func_times && make_call_graph())
+		return -1;
+
+	list = calloc(func_count, sizeof(*list));
+	if (!list) {
+		error("Cannot allocate function list\n");
+		return -1;
+	}
+	for (i = count = 0; i < func_count; i++) {
+		struct func_info *func = &func_list[i];
+
+		if (!func->call_count || !(func->flags & FUNCF_TRACE))
+			continue;
+		list[count++] = func;
+		total += func->self_us;
+	}
+	qsort(list, count, sizeof(*list), h_cmp_self_time);
+	if (top_count && count > top_count)
+		count = top_count;
+
+	printf("%10s %10s %10s %6s  %s\n", "Calls", "Total us", "Self us",
+	       "Self%", "Function");
+	for (i = 0; i < count; i++) {
+		struct func_info *func = list[i];
+
+		printf("%10lu %10llu %10llu %5.1f%%  %s\n", func->call_count,
+		       func->total_us, func->self_us,
+		       total ? func->self_us * 100.0 / total : 0.0,
+		       func->name);
+	}
+	free(list);
+
+	return 0;
+}
+
+static void out_folded(struct call_node *node, char *path, int len,
+		       int size)
+{
+	struct call_node *child;
+
+	if (node->func && (node->func->flags & FUNCF_TRACE)) {
+		int name_len = strlen(node->func->name);
+
+		if (len + name_len + 2 < size) {
+			if (len)
+				path[len++] = ';';
+			strcpy(path + len, node->func->name);
+			len += name_len;
+		}
+		if (node->self_us)
+			printf("%s %llu\n", path, node->self_us);
+	}
+
+	for (child = node->child; child; child = child->sibling)
+		out_folded(child, path, len, size);
+}
+
+/*
+ * Print one line for each distinct call stack, with the time spent in the
+ * innermost function, e.g.
+ *
+ *	board_init_r;initr_mmc;mmc_initialize;mmc_send_cmd 85117
+ *
+ * This is the 'folded' format understood by flame graph tools, e.g.
+ * flamegraph.pl.
+ */
+static int make_folded(void)
+{
+	char path[8192];
+
+	if (!call_count) {
+		error("Folded stacks need call records ('trace calls')\n");
+		return -1;
+	}
+	if (make_call_graph())
+		return -1;
+	path[0] = '\0';
+	out_folded(call_root, path, 0, sizeof(path));
+
+	return 0;
+}
+
 static int prof_tool(int argc, char * const argv[],
 		     const char *prof_fname, const char *map_fname,
 		     const char *trace_config_fname)
@@ -551,6 +869,10 @@ static int prof_tool(int argc, char * const argv[],
 
 		if (0 == strcmp(cmd, "dump-ftrace"))
 			err = make_ftrace();
+		else if (0 == strcmp(cmd, "dump-profile"))
+			err = make_profile();
+		else if (0 == strcmp(cmd, "dump-folded"))
+			err = make_folded();
 		else
 			warn("Unknown command '%s'\n", cmd);
 	}
@@ -566,12 +888,16 @@ int main(int argc, char *argv[])
 	int opt;
 
 	verbose = 2;
-	while ((opt = getopt(argc, argv, "m:p:t:v:")) != -1) {
+	while ((opt = getopt(argc, argv, "m:n:p:t:v:")) != -1) {
 		switch (opt) {
 		case 'm':
 			map_fname = optarg;
 			break;
 
+		case 'n':
+			top_count = atoi(optarg);
+			break;
+
 		case 'p':
 			prof_fname = optarg;
 			break;